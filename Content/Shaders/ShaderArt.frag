@@ -6,8 +6,13 @@
 in vec2 v_texcoord;
 out vec4 fragColor;
 
-uniform vec2 iResolution;
-uniform float iTime;
+// filled in by the device once per frame, no per program uniforms to set
+layout(std140) uniform FrameConstants {
+    vec2 iResolution;
+    float iTime;
+    float iTimeDelta;
+    uint iFrame;
+};
 
 /* This animation is the material of my first youtube tutorial about creative 
    coding, which is a video in which I try to introduce programmers to GLSL 
@@ -0,0 +1,150 @@
+#include <SDL3/SDL.h>
+
+#include <BatchRenderer.h>
+#include <GameMath.h>
+#include <GraphicsDevice.h>
+#include <Texture.h>
+
+// compares BatchRenderer_BatchQuad in a loop against BatchRenderer_BatchQuads for the same
+// sprites. a headless device draws offscreen, so the timings include the vertex uploads and
+// draws but not presenting. without a display it falls back on SDL's offscreen video driver.
+// --null runs on the null backend, which times the cpu side alone.
+
+static const uint32_t SPRITE_COUNT = 100000;
+static const uint32_t ITERATIONS = 50;
+static const uint32_t BATCH_TRIANGLES = 20000;
+
+typedef void (*BenchmarkFunction)(BatchRenderer *batchRenderer, SpriteDesc *sprites);
+
+static void Benchmark_BatchQuad(BatchRenderer *batchRenderer, SpriteDesc *sprites) {
+    for (uint32_t index = 0; index < SPRITE_COUNT; index++) {
+        SpriteDesc *sprite = &sprites[index];
+        BatchRenderer_BatchQuad(batchRenderer,
+            &sprite->source,
+            (Vector2){sprite->x, sprite->y},
+            sprite->rotation,
+            (Vector2){sprite->scaleX, sprite->scaleY},
+            (Vector2){sprite->originX, sprite->originY},
+            sprite->uvMode,
+            &sprite->color);
+    }
+}
+
+static void Benchmark_BatchQuads(BatchRenderer *batchRenderer, SpriteDesc *sprites) {
+    BatchRenderer_BatchQuads(batchRenderer, sprites, SPRITE_COUNT);
+}
+
+static void Benchmark_FillSprites(SpriteDesc *sprites, bool rotated) {
+    for (uint32_t index = 0; index < SPRITE_COUNT; index++) {
+        SpriteDesc *sprite = &sprites[index];
+        sprite->x = (float)(index % 1280);
+        sprite->y = (float)(index / 1280 % 720);
+        sprite->rotation = rotated ? (float)index * 0.01f : 0;
+        sprite->scaleX = 1;
+        sprite->scaleY = 1;
+        sprite->originX = 0.5f;
+        sprite->originY = 0.5f;
+        sprite->source = (Rectangle){.x = (index % 8) * 32, .y = 0, .width = 32, .height = 32};
+        sprite->color = (Color){.r = 1, .g = 1, .b = 1, .a = 1};
+        sprite->uvMode = UVMODE_NORMAL;
+    }
+}
+
+static double Benchmark_Run(GraphicsDevice *graphicsDevice, BatchRenderer *batchRenderer,
+    Texture *texture, SpriteDesc *sprites, BenchmarkFunction function) {
+    uint64_t best = UINT64_MAX;
+
+    for (uint32_t iteration = 0; iteration < ITERATIONS; iteration++) {
+        uint64_t start = SDL_GetPerformanceCounter();
+
+        BatchRenderer_Begin(
+            batchRenderer, BLEND_MODE_PREMULTIPLIED_ALPHA, texture, NULL, MATRIX4_IDENTITY);
+        function(batchRenderer, sprites);
+        BatchRenderer_End(batchRenderer);
+
+        // End holds the last draw back, EndFrame is where it goes out
+        GraphicsDevice_EndFrame(graphicsDevice);
+
+        uint64_t elapsed = SDL_GetPerformanceCounter() - start;
+        best = SDL_min(best, elapsed);
+    }
+
+    return best * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+static void Benchmark_Report(const char *name, double milliseconds, double baseline) {
+    SDL_Log("%-28s %8.3f ms %10.0f sprites/ms %6.2fx",
+        name,
+        milliseconds,
+        SPRITE_COUNT / milliseconds,
+        baseline / milliseconds);
+}
+
+int main(int argc, char *argv[]) {
+    GraphicsAPI api = GRAPHICS_API_OPENGL;
+    for (int index = 1; index < argc; index++) {
+        if (SDL_strcmp(argv[index], "--null") == 0) {
+            api = GRAPHICS_API_NULL;
+        } else {
+            SDL_Log("Unknown argument: %s", argv[index]);
+            return 1;
+        }
+    }
+
+    // the null backend doesn't need video at all
+    if (api == GRAPHICS_API_OPENGL && !SDL_Init(SDL_INIT_VIDEO)) {
+        SDL_Log("SDL_Init failed (%s), trying the offscreen video driver", SDL_GetError());
+        SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+        if (!SDL_Init(SDL_INIT_VIDEO)) {
+            SDL_Log("SDL_Init failed: %s", SDL_GetError());
+            return 1;
+        }
+    }
+
+    GraphicsDevice *graphicsDevice = GraphicsDevice_CreateHeadless(api, 1280, 720);
+    if (graphicsDevice == NULL) {
+        SDL_Log("GraphicsDevice_CreateHeadless failed");
+        SDL_Quit();
+        return 1;
+    }
+
+    BatchRenderer *batchRenderer = BatchRenderer_Create(graphicsDevice, BATCH_TRIANGLES);
+    Texture *texture = Texture_CreateFromPixelData(
+        graphicsDevice, 256, 32, NULL, 0, TEXTURE_FILTER_POINT, TEXTURE_TYPE_NORMAL);
+    SpriteDesc *sprites = SDL_malloc(SPRITE_COUNT * sizeof(SpriteDesc));
+
+    if (batchRenderer == NULL || texture == NULL || sprites == NULL) {
+        SDL_Log("Benchmark setup failed");
+        return 1;
+    }
+
+    SDL_Log("%u sprites, best of %u", SPRITE_COUNT, ITERATIONS);
+
+    for (int rotated = 0; rotated < 2; rotated++) {
+        Benchmark_FillSprites(sprites, rotated != 0);
+        GraphicsDevice_ResetStateCallCounts(graphicsDevice);
+
+        double single =
+            Benchmark_Run(graphicsDevice, batchRenderer, texture, sprites, Benchmark_BatchQuad);
+        double bulk =
+            Benchmark_Run(graphicsDevice, batchRenderer, texture, sprites, Benchmark_BatchQuads);
+
+        Benchmark_Report(rotated ? "BatchQuad (rotated)" : "BatchQuad", single, single);
+        Benchmark_Report(rotated ? "BatchQuads (rotated)" : "BatchQuads", bulk, single);
+
+        uint64_t issuedCalls, elidedCalls;
+        GraphicsDevice_GetStateCallCounts(graphicsDevice, &issuedCalls, &elidedCalls);
+        SDL_Log("%-28s %8llu issued %10llu elided",
+            "state calls",
+            (unsigned long long)issuedCalls,
+            (unsigned long long)elidedCalls);
+    }
+
+    SDL_free(sprites);
+    Texture_Destroy(texture);
+    BatchRenderer_Destroy(batchRenderer);
+    GraphicsDevice_Destroy(graphicsDevice);
+    SDL_Quit();
+
+    return 0;
+}
@@ -0,0 +1,365 @@
+#include <SDL3/SDL.h>
+
+#include <CommandCapture.h>
+#include <GraphicsDevice.h>
+
+// replays a command capture (a build with -Dcapture=true writes one when F10 is pressed in the
+// game) on a headless device the size it was captured at, as fast as it goes, and reports how
+// long each frame took. every frame waits for the gpu (a 1x1 ReadPixels), so frame times cover
+// the submission and the drawing. the same capture is the same work before and after a change.
+//
+//   zig build replay -- CAPTURE [options]
+//   --null              the null backend, which times the cpu side alone
+//   --iterations N      times every frame is played, after one warmup pass (100)
+//   --frame N           only this frame of the capture, every frame still plays in the warmup
+//   --output FILE       where the json goes (replay.json)
+//   --baseline FILE     json from an earlier replay of the same capture to compare against,
+//                       exits with 1 if any frame's p50 went up by more than the threshold
+//   --threshold PERCENT what counts as a regression (10)
+
+#define REPLAY_ALL_FRAMES UINT32_MAX
+
+typedef struct ReplayResult {
+    uint32_t frame;
+    double p50;
+    double p90;
+    double p99;
+    double maximum;
+} ReplayResult;
+
+static int Replay_CompareDoubles(const void *a, const void *b) {
+    double left = *(const double *)a;
+    double right = *(const double *)b;
+    return (left > right) - (left < right);
+}
+
+// nearest rank on sorted times
+static double Replay_Percentile(const double *sortedTimes, uint32_t count, double percentile) {
+    uint32_t rank = (uint32_t)SDL_ceilf((float)(percentile / 100.0 * count));
+    return sortedTimes[SDL_clamp(rank, 1, count) - 1];
+}
+
+static void Replay_Summarize(double *times, uint32_t count, uint32_t frame, ReplayResult *result) {
+    SDL_qsort(times, count, sizeof(double), Replay_CompareDoubles);
+    result->frame = frame;
+    result->p50 = Replay_Percentile(times, count, 50);
+    result->p90 = Replay_Percentile(times, count, 90);
+    result->p99 = Replay_Percentile(times, count, 99);
+    result->maximum = times[count - 1];
+}
+
+// milliseconds, or a negative number when the frame couldn't be played
+static double Replay_PlayFrame(
+    CommandReplay *commandReplay, GraphicsDevice *graphicsDevice, uint32_t frame) {
+    uint64_t start = SDL_GetPerformanceCounter();
+
+    if (!CommandReplay_PlayFrame(commandReplay, frame)) {
+        return -1;
+    }
+
+    // waits for the gpu, so the frame is timed until it is drawn
+    uint8_t pixel[4];
+    GraphicsDevice_ReadPixels(graphicsDevice, 0, 0, 1, 1, pixel);
+
+    return (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+// the number after "key": on the line, or -1 without one
+static double Replay_FindNumber(const char *line, const char *key) {
+    const char *found = SDL_strstr(line, key);
+    if (found == NULL) {
+        return -1;
+    }
+    return SDL_strtod(found + SDL_strlen(key), NULL);
+}
+
+// the results out of an earlier replay's json, one result per line as this program writes it
+static uint32_t Replay_LoadBaseline(
+    const char *fileName, ReplayResult *results, uint32_t maximumResults) {
+    size_t dataSize;
+    char *data = SDL_LoadFile(fileName, &dataSize);
+    if (data == NULL) {
+        SDL_Log("SDL_LoadFile failed %s: %s", fileName, SDL_GetError());
+        return 0;
+    }
+
+    uint32_t count = 0;
+    char *line = data;
+    while (line != NULL && *line != '\0' && count < maximumResults) {
+        char *end = SDL_strchr(line, '\n');
+        if (end != NULL) {
+            *end = '\0';
+        }
+
+        double frame = Replay_FindNumber(line, "\"frame\":");
+        if (frame >= 0) {
+            ReplayResult *result = &results[count++];
+            result->frame = (uint32_t)frame;
+            result->p50 = Replay_FindNumber(line, "\"p50\":");
+        }
+
+        line = (end != NULL) ? end + 1 : NULL;
+    }
+
+    SDL_free(data);
+    return count;
+}
+
+// true if no frame got slower than the threshold allows
+static bool Replay_CompareBaseline(ReplayResult *results, uint32_t resultCount,
+    ReplayResult *baseline, uint32_t baselineCount, double thresholdPercent) {
+    bool passed = true;
+
+    SDL_Log("compared to the baseline, regressions are over %.1f%%", thresholdPercent);
+    for (uint32_t index = 0; index < resultCount; index++) {
+        ReplayResult *result = &results[index];
+
+        ReplayResult *previous = NULL;
+        for (uint32_t baselineIndex = 0; baselineIndex < baselineCount; baselineIndex++) {
+            if (baseline[baselineIndex].frame == result->frame) {
+                previous = &baseline[baselineIndex];
+                break;
+            }
+        }
+
+        if (previous == NULL || previous->p50 <= 0) {
+            SDL_Log("frame %4u not in the baseline", result->frame);
+            continue;
+        }
+
+        double change = (result->p50 / previous->p50 - 1) * 100;
+        bool regressed = change > thresholdPercent;
+        SDL_Log("frame %4u %8.3f ms -> %8.3f ms p50 %+7.1f%%%s",
+            result->frame,
+            previous->p50,
+            result->p50,
+            change,
+            regressed ? "  REGRESSION" : "");
+        if (regressed) {
+            passed = false;
+        }
+    }
+
+    return passed;
+}
+
+static bool Replay_WriteResults(const char *fileName, const char *captureFileName,
+    const char *backend, uint32_t iterations, ReplayResult *results, uint32_t resultCount) {
+    SDL_IOStream *output = SDL_IOFromFile(fileName, "w");
+    if (output == NULL) {
+        SDL_Log("SDL_IOFromFile failed %s: %s", fileName, SDL_GetError());
+        return false;
+    }
+
+    SDL_IOprintf(output,
+        "{\"capture\":\"%s\",\"backend\":\"%s\",\"iterations\":%u,\"results\":[\n",
+        captureFileName,
+        backend,
+        iterations);
+    for (uint32_t index = 0; index < resultCount; index++) {
+        ReplayResult *result = &results[index];
+        SDL_IOprintf(output,
+            "    {\"frame\":%u,"
+            "\"frame_ms\":{\"p50\":%.4f,\"p90\":%.4f,\"p99\":%.4f,\"max\":%.4f}}%s\n",
+            result->frame,
+            result->p50,
+            result->p90,
+            result->p99,
+            result->maximum,
+            (index + 1 < resultCount) ? "," : "");
+    }
+    SDL_IOprintf(output, "]}\n");
+
+    if (!SDL_CloseIO(output)) {
+        SDL_Log("SDL_CloseIO failed %s: %s", fileName, SDL_GetError());
+        return false;
+    }
+    SDL_Log("results written to %s", fileName);
+    return true;
+}
+
+// plays the frames iterations times and summarizes every frame, false if one couldn't be played
+static bool Replay_Run(CommandReplay *commandReplay, GraphicsDevice *graphicsDevice,
+    uint32_t firstFrame, uint32_t frameCount, uint32_t iterations, ReplayResult *results) {
+    // every frame once, so state a frame expects from the ones before it is in place
+    for (uint32_t frame = 0; frame < CommandReplay_GetFrameCount(commandReplay); frame++) {
+        if (Replay_PlayFrame(commandReplay, graphicsDevice, frame) < 0) {
+            return false;
+        }
+    }
+
+    double *times = SDL_malloc((size_t)frameCount * iterations * sizeof(double));
+    if (times == NULL) {
+        SDL_Log("SDL_malloc failed");
+        return false;
+    }
+
+    for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+        for (uint32_t frame = 0; frame < frameCount; frame++) {
+            double milliseconds =
+                Replay_PlayFrame(commandReplay, graphicsDevice, firstFrame + frame);
+            if (milliseconds < 0) {
+                SDL_free(times);
+                return false;
+            }
+            times[(size_t)frame * iterations + iteration] = milliseconds;
+        }
+    }
+
+    for (uint32_t frame = 0; frame < frameCount; frame++) {
+        Replay_Summarize(
+            &times[(size_t)frame * iterations], iterations, firstFrame + frame, &results[frame]);
+        SDL_Log("frame %4u %8.3f ms p50 %8.3f ms p90 %8.3f ms p99 %8.3f ms max",
+            results[frame].frame,
+            results[frame].p50,
+            results[frame].p90,
+            results[frame].p99,
+            results[frame].maximum);
+    }
+
+    // every play of every frame together
+    ReplayResult all;
+    Replay_Summarize(times, frameCount * iterations, 0, &all);
+    SDL_Log("all frames %8.3f ms p50 %8.3f ms p90 %8.3f ms p99 %8.3f ms max",
+        all.p50,
+        all.p90,
+        all.p99,
+        all.maximum);
+
+    SDL_free(times);
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    GraphicsAPI api = GRAPHICS_API_OPENGL;
+    const char *captureFileName = NULL;
+    const char *outputFileName = "replay.json";
+    const char *baselineFileName = NULL;
+    uint32_t iterations = 100;
+    uint32_t selectedFrame = REPLAY_ALL_FRAMES;
+    double thresholdPercent = 10;
+
+    for (int index = 1; index < argc; index++) {
+        const char *argument = argv[index];
+        const char *value = (index + 1 < argc) ? argv[index + 1] : NULL;
+
+        if (SDL_strcmp(argument, "--null") == 0) {
+            api = GRAPHICS_API_NULL;
+            continue;
+        }
+
+        if (SDL_strncmp(argument, "--", 2) != 0 && captureFileName == NULL) {
+            captureFileName = argument;
+            continue;
+        }
+
+        if (value == NULL) {
+            SDL_Log("Unknown or incomplete argument: %s", argument);
+            return 1;
+        }
+        index++;
+
+        if (SDL_strcmp(argument, "--iterations") == 0) {
+            iterations = (uint32_t)SDL_strtoul(value, NULL, 10);
+        } else if (SDL_strcmp(argument, "--frame") == 0) {
+            selectedFrame = (uint32_t)SDL_strtoul(value, NULL, 10);
+        } else if (SDL_strcmp(argument, "--output") == 0) {
+            outputFileName = value;
+        } else if (SDL_strcmp(argument, "--baseline") == 0) {
+            baselineFileName = value;
+        } else if (SDL_strcmp(argument, "--threshold") == 0) {
+            thresholdPercent = SDL_strtod(value, NULL);
+        } else {
+            SDL_Log("Unknown argument: %s", argument);
+            return 1;
+        }
+    }
+
+    if (captureFileName == NULL || iterations == 0) {
+        SDL_Log("A capture file is needed, and iterations above 0");
+        return 1;
+    }
+
+    CommandReplay *commandReplay = CommandReplay_Load(captureFileName);
+    if (commandReplay == NULL) {
+        return 1;
+    }
+
+    uint32_t captureFrames = CommandReplay_GetFrameCount(commandReplay);
+    if (selectedFrame != REPLAY_ALL_FRAMES && selectedFrame >= captureFrames) {
+        SDL_Log("The capture only has %u frames", captureFrames);
+        CommandReplay_Destroy(commandReplay);
+        return 1;
+    }
+    uint32_t firstFrame = (selectedFrame != REPLAY_ALL_FRAMES) ? selectedFrame : 0;
+    uint32_t frameCount = (selectedFrame != REPLAY_ALL_FRAMES) ? 1 : captureFrames;
+
+    // the null backend doesn't need video at all
+    if (api == GRAPHICS_API_OPENGL && !SDL_Init(SDL_INIT_VIDEO)) {
+        SDL_Log("SDL_Init failed (%s), trying the offscreen video driver", SDL_GetError());
+        SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+        if (!SDL_Init(SDL_INIT_VIDEO)) {
+            SDL_Log("SDL_Init failed: %s", SDL_GetError());
+            CommandReplay_Destroy(commandReplay);
+            return 1;
+        }
+    }
+
+    uint32_t width, height;
+    CommandReplay_GetSize(commandReplay, &width, &height);
+    GraphicsDevice *graphicsDevice = GraphicsDevice_CreateHeadless(api, width, height);
+    if (graphicsDevice == NULL) {
+        SDL_Log("GraphicsDevice_CreateHeadless failed");
+        CommandReplay_Destroy(commandReplay);
+        SDL_Quit();
+        return 1;
+    }
+
+    const char *backend = (api == GRAPHICS_API_NULL) ? "null" : "opengl";
+    SDL_Log("%s: %u frames at %ux%u on %s, %u iterations",
+        captureFileName,
+        captureFrames,
+        width,
+        height,
+        backend,
+        iterations);
+
+    int exitCode = 1;
+    ReplayResult *results = SDL_malloc(frameCount * sizeof(ReplayResult));
+    if (results == NULL) {
+        SDL_Log("SDL_malloc failed");
+    } else if (CommandReplay_CreateObjects(commandReplay, graphicsDevice) &&
+               Replay_Run(commandReplay,
+                   graphicsDevice,
+                   firstFrame,
+                   frameCount,
+                   iterations,
+                   results)) {
+        exitCode = 0;
+        Replay_WriteResults(
+            outputFileName, captureFileName, backend, iterations, results, frameCount);
+
+        if (baselineFileName != NULL) {
+            ReplayResult *baseline = SDL_malloc(captureFrames * sizeof(ReplayResult));
+            uint32_t baselineCount =
+                (baseline != NULL) ? Replay_LoadBaseline(baselineFileName, baseline, captureFrames)
+                                   : 0;
+            if (baselineCount == 0) {
+                SDL_Log("No results in the baseline %s", baselineFileName);
+                exitCode = 1;
+            } else if (!Replay_CompareBaseline(
+                           results, frameCount, baseline, baselineCount, thresholdPercent)) {
+                exitCode = 1;
+            }
+            SDL_free(baseline);
+        }
+    }
+
+    SDL_free(results);
+    // the replay's objects go before the device
+    CommandReplay_Destroy(commandReplay);
+    GraphicsDevice_Destroy(graphicsDevice);
+    SDL_Quit();
+
+    return exitCode;
+}
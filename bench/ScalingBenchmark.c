@@ -0,0 +1,765 @@
+#include <SDL3/SDL.h>
+
+#include <BatchRenderer.h>
+#include <GameMath.h>
+#include <GraphicsDevice.h>
+#include <ShaderProgram.h>
+#include <Texture.h>
+
+// runs every scenario at 1k, 10k, 100k and 1M items per frame on a headless device and writes
+// the results as json, one result per line. each frame waits for the gpu (a 1x1 ReadPixels), so
+// frame times cover the submission and the drawing but not presenting.
+//
+//   --null              the null backend, which times the cpu side alone
+//   --upload STRATEGY   how batched vertices reach the gpu: subdata, map or persistent (map).
+//                       fence_stalls_per_frame counts the cpu waiting on the gpu for ring space
+//   --scenario NAME     only scenarios whose name contains NAME
+//   --minimum N         smallest item count (1000)
+//   --maximum N         largest item count (1000000)
+//   --frames N          frames timed per count, after two warmup frames (20)
+//   --budget SECONDS    once a frame takes longer, larger counts of the scenario are skipped (2)
+//   --output FILE       where the json goes (bench.json)
+//   --baseline FILE     json from an earlier run to compare against, exits with 1 if any
+//                       result's items per second dropped by more than the threshold
+//   --threshold PERCENT what counts as a regression (10)
+
+#define BENCHMARK_WIDTH 1280
+#define BENCHMARK_HEIGHT 720
+#define BENCHMARK_WARMUP_FRAMES 2
+#define BENCHMARK_BATCH_TRIANGLES 20000
+// sprites and triangles are generated once and reused round robin, the renderer sees no
+// difference and a million of them would only cost memory
+#define BENCHMARK_SPRITES 65536
+#define BENCHMARK_TRIANGLES 65536
+#define BENCHMARK_UPLOAD_SIZE 1024
+#define BENCHMARK_RENDER_TARGET_SIZE 256
+#define BENCHMARK_MAXIMUM_RESULTS 64
+
+typedef struct Benchmark {
+    GraphicsDevice *graphicsDevice;
+    BatchRenderer *batchRenderer;
+    Texture *textures[2];
+    Texture *renderTargets[2];
+    Texture *uploadTexture;
+    ShaderProgram *shaderArtProgram;
+    SpriteDesc *sprites;
+    Vertex2d *triangles;
+    uint8_t *uploadPixels;
+} Benchmark;
+
+// draws count items and returns how many it drew, 0 if the scenario can't run
+typedef uint64_t (*BenchmarkScenarioFunction)(Benchmark *benchmark, uint32_t count);
+
+typedef struct BenchmarkScenario {
+    const char *name;
+    const char *item;
+    BenchmarkScenarioFunction function;
+} BenchmarkScenario;
+
+typedef struct BenchmarkResult {
+    char scenario[64];
+    uint32_t count;
+    double itemsPerSecond;
+} BenchmarkResult;
+
+static const char shaderArtVertexShaderSource[] =
+    "#version 410\n"
+    "in vec4 position;\n"
+    "in vec4 color;\n"
+    "in vec2 texcoord;\n"
+    "out vec2 v_texcoord;\n"
+    // from the device and the batch renderer
+    VIEW_CONSTANTS_GLSL
+    "uniform mat4 TransformMatrix;\n"
+    "void main()\n"
+    "{\n"
+    "	gl_Position = ViewProjectionMatrix * TransformMatrix * position;\n"
+    "	v_texcoord = texcoord;\n"
+    "}\n";
+
+static void Benchmark_BatchSprite(Benchmark *benchmark, uint32_t index) {
+    SpriteDesc *sprite = &benchmark->sprites[index % BENCHMARK_SPRITES];
+    BatchRenderer_BatchQuad(benchmark->batchRenderer,
+        &sprite->source,
+        (Vector2){sprite->x, sprite->y},
+        sprite->rotation,
+        (Vector2){sprite->scaleX, sprite->scaleY},
+        (Vector2){sprite->originX, sprite->originY},
+        sprite->uvMode,
+        &sprite->color);
+}
+
+static uint64_t Benchmark_RotatedSprites(Benchmark *benchmark, uint32_t count) {
+    BatchRenderer_Begin(benchmark->batchRenderer,
+        BLEND_MODE_PREMULTIPLIED_ALPHA,
+        benchmark->textures[0],
+        NULL,
+        MATRIX4_IDENTITY);
+    for (uint32_t index = 0; index < count; index++) {
+        Benchmark_BatchSprite(benchmark, index);
+    }
+    BatchRenderer_End(benchmark->batchRenderer);
+    return count;
+}
+
+// every sprite uses the other texture, so every sprite is a draw of its own
+static uint64_t Benchmark_TextureSwitches(Benchmark *benchmark, uint32_t count) {
+    BatchRenderer_Begin(benchmark->batchRenderer,
+        BLEND_MODE_PREMULTIPLIED_ALPHA,
+        benchmark->textures[0],
+        NULL,
+        MATRIX4_IDENTITY);
+    for (uint32_t index = 0; index < count; index++) {
+        BatchRenderer_SetTexture(benchmark->batchRenderer, benchmark->textures[index & 1]);
+        Benchmark_BatchSprite(benchmark, index);
+    }
+    BatchRenderer_End(benchmark->batchRenderer);
+    return count;
+}
+
+// a Begin/End block per sprite with the same state, which the held back draw joins together
+static uint64_t Benchmark_BeginEndBlocks(Benchmark *benchmark, uint32_t count) {
+    for (uint32_t index = 0; index < count; index++) {
+        BatchRenderer_Begin(benchmark->batchRenderer,
+            BLEND_MODE_PREMULTIPLIED_ALPHA,
+            benchmark->textures[0],
+            NULL,
+            MATRIX4_IDENTITY);
+        Benchmark_BatchSprite(benchmark, index);
+        BatchRenderer_End(benchmark->batchRenderer);
+    }
+    return count;
+}
+
+static uint64_t Benchmark_BatchTriangles(Benchmark *benchmark, uint32_t count) {
+    BatchRenderer_Begin(
+        benchmark->batchRenderer, BLEND_MODE_PREMULTIPLIED_ALPHA, NULL, NULL, MATRIX4_IDENTITY);
+    for (uint32_t start = 0; start < count; start += BENCHMARK_TRIANGLES) {
+        uint32_t triangleCount = SDL_min(count - start, BENCHMARK_TRIANGLES);
+        BatchRenderer_BatchTriangles(
+            benchmark->batchRenderer, benchmark->triangles, (int)triangleCount);
+    }
+    BatchRenderer_End(benchmark->batchRenderer);
+    return count;
+}
+
+// each pass draws one render target into the other, so every pass changes the framebuffer
+static uint64_t Benchmark_RenderTargetPingPong(Benchmark *benchmark, uint32_t count) {
+    Rectangle source = {
+        .x = 0,
+        .y = 0,
+        .width = BENCHMARK_RENDER_TARGET_SIZE,
+        .height = BENCHMARK_RENDER_TARGET_SIZE,
+    };
+
+    for (uint32_t pass = 0; pass < count; pass++) {
+        GraphicsDevice_BindRenderTarget(
+            benchmark->graphicsDevice, benchmark->renderTargets[pass & 1], true);
+        BatchRenderer_Begin(benchmark->batchRenderer,
+            BLEND_MODE_NONE,
+            benchmark->renderTargets[(pass + 1) & 1],
+            NULL,
+            MATRIX4_IDENTITY);
+        BatchRenderer_BatchQuad(benchmark->batchRenderer,
+            &source,
+            (Vector2){0, 0},
+            0,
+            (Vector2){1, 1},
+            (Vector2){0, 0},
+            UVMODE_NORMAL,
+            NULL);
+        BatchRenderer_End(benchmark->batchRenderer);
+    }
+    GraphicsDevice_UnbindRenderTarget(benchmark->graphicsDevice, true);
+    return count;
+}
+
+// count texels in rows of up to 1024, then a sprite so the texture is used
+static uint64_t Benchmark_TextureUpload(Benchmark *benchmark, uint32_t count) {
+    uint32_t width = SDL_min(count, BENCHMARK_UPLOAD_SIZE);
+    uint32_t height = SDL_min(count / width, BENCHMARK_UPLOAD_SIZE);
+
+    Texture_SetTextureData(benchmark->uploadTexture,
+        0,
+        0,
+        width,
+        height,
+        benchmark->uploadPixels,
+        width * height * 4);
+
+    BatchRenderer_Begin(benchmark->batchRenderer,
+        BLEND_MODE_PREMULTIPLIED_ALPHA,
+        benchmark->uploadTexture,
+        NULL,
+        MATRIX4_IDENTITY);
+    Benchmark_BatchSprite(benchmark, 0);
+    BatchRenderer_End(benchmark->batchRenderer);
+    return (uint64_t)width * height;
+}
+
+// ShaderArt.frag over the whole screen once, split into count tiles. the fragment work stays
+// the same while the geometry grows
+static uint64_t Benchmark_ShaderArtFill(Benchmark *benchmark, uint32_t count) {
+    if (benchmark->shaderArtProgram == NULL) {
+        return 0;
+    }
+
+    uint32_t columns = (uint32_t)SDL_ceilf(
+        SDL_sqrtf((float)count * BENCHMARK_WIDTH / BENCHMARK_HEIGHT));
+    uint32_t rows = (count + columns - 1) / columns;
+    float tileWidth = (float)BENCHMARK_WIDTH / columns;
+    float tileHeight = (float)BENCHMARK_HEIGHT / rows;
+
+    BatchRenderer_Begin(benchmark->batchRenderer,
+        BLEND_MODE_NONE,
+        NULL,
+        benchmark->shaderArtProgram,
+        MATRIX4_IDENTITY);
+    for (uint32_t index = 0; index < count; index++) {
+        float x = (index % columns) * tileWidth;
+        float y = (index / columns) * tileHeight;
+        // the shader expects pixel coordinates in texcoord
+        BatchRenderer_BatchQuadUV(benchmark->batchRenderer,
+            (Vector2){x, y},
+            (Vector2){x + tileWidth, y + tileHeight},
+            (Vector2){x, y},
+            (Vector2){x + tileWidth, y + tileHeight},
+            NULL);
+    }
+    BatchRenderer_End(benchmark->batchRenderer);
+    return count;
+}
+
+// names for --upload, in VertexBufferUploadStrategy order
+static const char *uploadStrategyNames[] = {"subdata", "map", "persistent"};
+
+static const BenchmarkScenario scenarios[] = {
+    {"rotated_sprites", "sprite", Benchmark_RotatedSprites},
+    {"texture_switches", "sprite", Benchmark_TextureSwitches},
+    {"begin_end_blocks", "block", Benchmark_BeginEndBlocks},
+    {"batch_triangles", "triangle", Benchmark_BatchTriangles},
+    {"render_target_ping_pong", "pass", Benchmark_RenderTargetPingPong},
+    {"texture_upload", "texel", Benchmark_TextureUpload},
+    {"shader_art_fill", "tile", Benchmark_ShaderArtFill},
+};
+
+static void Benchmark_FillSprites(SpriteDesc *sprites) {
+    for (uint32_t index = 0; index < BENCHMARK_SPRITES; index++) {
+        SpriteDesc *sprite = &sprites[index];
+        sprite->x = (float)(index % BENCHMARK_WIDTH);
+        sprite->y = (float)(index / BENCHMARK_WIDTH % BENCHMARK_HEIGHT);
+        sprite->rotation = (float)index * 0.01f;
+        sprite->scaleX = 1;
+        sprite->scaleY = 1;
+        sprite->originX = 0.5f;
+        sprite->originY = 0.5f;
+        sprite->source = (Rectangle){.x = (index % 8) * 32, .y = 0, .width = 32, .height = 32};
+        sprite->color = (Color){.r = 1, .g = 1, .b = 1, .a = 1};
+        sprite->uvMode = UVMODE_NORMAL;
+    }
+}
+
+static void Benchmark_FillTriangles(Vertex2d *triangles) {
+    for (uint32_t index = 0; index < BENCHMARK_TRIANGLES * 3; index++) {
+        uint32_t triangle = index / 3;
+        uint32_t corner = index % 3;
+        float x = (float)(triangle * 7 % BENCHMARK_WIDTH);
+        float y = (float)(triangle * 13 % BENCHMARK_HEIGHT);
+        triangles[index] = (Vertex2d){
+            .x = x + (corner == 1 ? 8 : 0),
+            .y = y + (corner == 2 ? 8 : 0),
+            .r = 1,
+            .g = (float)corner * 0.5f,
+            .b = 0,
+            .a = 1,
+        };
+    }
+}
+
+static ShaderProgram *Benchmark_CreateShaderArtProgram(GraphicsDevice *graphicsDevice) {
+    FragmentShader *fragmentShader =
+        FragmentShader_Create(graphicsDevice, "Content/Shaders/ShaderArt.frag");
+    if (fragmentShader == NULL) {
+        return NULL;
+    }
+
+    VertexShader *vertexShader = VertexShader_CreateFromBuffer(graphicsDevice,
+        (void *)shaderArtVertexShaderSource,
+        sizeof(shaderArtVertexShaderSource) - 1);
+    if (vertexShader == NULL) {
+        FragmentShader_Destroy(fragmentShader);
+        return NULL;
+    }
+
+    ShaderProgram *shaderProgram =
+        ShaderProgram_Create(graphicsDevice, vertexShader, fragmentShader);
+    VertexShader_Destroy(vertexShader);
+    FragmentShader_Destroy(fragmentShader);
+    return shaderProgram;
+}
+
+static bool Benchmark_Initialize(Benchmark *benchmark, GraphicsAPI api) {
+    GraphicsDevice *graphicsDevice =
+        GraphicsDevice_CreateHeadless(api, BENCHMARK_WIDTH, BENCHMARK_HEIGHT);
+    if (graphicsDevice == NULL) {
+        SDL_Log("GraphicsDevice_CreateHeadless failed");
+        return false;
+    }
+    benchmark->graphicsDevice = graphicsDevice;
+
+    benchmark->batchRenderer = BatchRenderer_Create(graphicsDevice, BENCHMARK_BATCH_TRIANGLES);
+    for (int index = 0; index < 2; index++) {
+        benchmark->textures[index] = Texture_CreateFromPixelData(
+            graphicsDevice, 256, 32, NULL, 0, TEXTURE_FILTER_POINT, TEXTURE_TYPE_NORMAL);
+        benchmark->renderTargets[index] = Texture_CreateFromPixelData(graphicsDevice,
+            BENCHMARK_RENDER_TARGET_SIZE,
+            BENCHMARK_RENDER_TARGET_SIZE,
+            NULL,
+            0,
+            TEXTURE_FILTER_POINT,
+            TEXTURE_TYPE_RENDERTARGET);
+    }
+    benchmark->uploadTexture = Texture_CreateFromPixelData(graphicsDevice,
+        BENCHMARK_UPLOAD_SIZE,
+        BENCHMARK_UPLOAD_SIZE,
+        NULL,
+        0,
+        TEXTURE_FILTER_POINT,
+        TEXTURE_TYPE_NORMAL);
+
+    benchmark->sprites = SDL_malloc(BENCHMARK_SPRITES * sizeof(SpriteDesc));
+    benchmark->triangles = SDL_malloc(BENCHMARK_TRIANGLES * 3 * sizeof(Vertex2d));
+    benchmark->uploadPixels = SDL_calloc(BENCHMARK_UPLOAD_SIZE * BENCHMARK_UPLOAD_SIZE, 4);
+
+    if (benchmark->batchRenderer == NULL || benchmark->textures[0] == NULL ||
+        benchmark->textures[1] == NULL || benchmark->renderTargets[0] == NULL ||
+        benchmark->renderTargets[1] == NULL || benchmark->uploadTexture == NULL ||
+        benchmark->sprites == NULL || benchmark->triangles == NULL ||
+        benchmark->uploadPixels == NULL) {
+        SDL_Log("Benchmark setup failed");
+        return false;
+    }
+
+    Benchmark_FillSprites(benchmark->sprites);
+    Benchmark_FillTriangles(benchmark->triangles);
+
+    // without the shader the fill scenario is skipped, the rest still run
+    benchmark->shaderArtProgram = Benchmark_CreateShaderArtProgram(graphicsDevice);
+    if (benchmark->shaderArtProgram == NULL) {
+        SDL_Log("ShaderArt.frag didn't load, run from the repository root for shader_art_fill");
+    }
+
+    return true;
+}
+
+static void Benchmark_Shutdown(Benchmark *benchmark) {
+    if (benchmark->shaderArtProgram != NULL) {
+        ShaderProgram_Destroy(benchmark->shaderArtProgram);
+    }
+    for (int index = 0; index < 2; index++) {
+        if (benchmark->textures[index] != NULL) {
+            Texture_Destroy(benchmark->textures[index]);
+        }
+        if (benchmark->renderTargets[index] != NULL) {
+            Texture_Destroy(benchmark->renderTargets[index]);
+        }
+    }
+    if (benchmark->uploadTexture != NULL) {
+        Texture_Destroy(benchmark->uploadTexture);
+    }
+    if (benchmark->batchRenderer != NULL) {
+        BatchRenderer_Destroy(benchmark->batchRenderer);
+    }
+    if (benchmark->graphicsDevice != NULL) {
+        GraphicsDevice_Destroy(benchmark->graphicsDevice);
+    }
+
+    SDL_free(benchmark->sprites);
+    SDL_free(benchmark->triangles);
+    SDL_free(benchmark->uploadPixels);
+}
+
+// milliseconds, returns how many items were drawn
+static uint64_t Benchmark_RunFrame(
+    Benchmark *benchmark, const BenchmarkScenario *scenario, uint32_t count, double *milliseconds) {
+    uint64_t start = SDL_GetPerformanceCounter();
+
+    GraphicsDevice_BeginFrame(benchmark->graphicsDevice);
+    GraphicsDevice_ClearScreen(
+        benchmark->graphicsDevice, &(Color){.r = 0, .g = 0, .b = 0, .a = 1});
+    uint64_t items = scenario->function(benchmark, count);
+    GraphicsDevice_EndFrame(benchmark->graphicsDevice);
+
+    // waits for the gpu, so the frame is timed until it is drawn
+    uint8_t pixel[4];
+    GraphicsDevice_ReadPixels(benchmark->graphicsDevice, 0, 0, 1, 1, pixel);
+
+    *milliseconds = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    return items;
+}
+
+static int Benchmark_CompareDoubles(const void *a, const void *b) {
+    double left = *(const double *)a;
+    double right = *(const double *)b;
+    return (left > right) - (left < right);
+}
+
+// nearest rank on sorted times
+static double Benchmark_Percentile(const double *sortedTimes, uint32_t count, double percentile) {
+    uint32_t rank = (uint32_t)SDL_ceilf((float)(percentile / 100.0 * count));
+    return sortedTimes[SDL_clamp(rank, 1, count) - 1];
+}
+
+// false if the scenario can't run. overBudget is set once a frame takes longer than the budget,
+// larger counts would only take longer
+static bool Benchmark_RunScenario(Benchmark *benchmark, const BenchmarkScenario *scenario,
+    uint32_t count, uint32_t frames, double budgetMilliseconds, SDL_IOStream *output,
+    bool *firstResult, BenchmarkResult *result, bool *overBudget) {
+    double milliseconds;
+    for (uint32_t frame = 0; frame < BENCHMARK_WARMUP_FRAMES; frame++) {
+        if (Benchmark_RunFrame(benchmark, scenario, count, &milliseconds) == 0) {
+            return false;
+        }
+    }
+
+    double *times = SDL_malloc(frames * sizeof(double));
+    if (times == NULL) {
+        SDL_Log("SDL_malloc failed");
+        return false;
+    }
+
+    GraphicsDevice_ResetWorkCounts(benchmark->graphicsDevice);
+    GraphicsDevice_ResetStateCallCounts(benchmark->graphicsDevice);
+
+    uint64_t items = 0;
+    double totalMilliseconds = 0;
+    uint32_t timedFrames = 0;
+    *overBudget = false;
+    while (timedFrames < frames && !*overBudget) {
+        items += Benchmark_RunFrame(benchmark, scenario, count, &times[timedFrames]);
+        totalMilliseconds += times[timedFrames];
+        *overBudget = times[timedFrames] > budgetMilliseconds;
+        timedFrames++;
+    }
+
+    uint64_t drawCalls, uploadedBytes, issuedStateCalls, fenceWaits, fenceStalls;
+    GraphicsDevice_GetWorkCounts(benchmark->graphicsDevice, &drawCalls, &uploadedBytes);
+    GraphicsDevice_GetStateCallCounts(benchmark->graphicsDevice, &issuedStateCalls, NULL);
+    GraphicsDevice_GetFenceWaits(benchmark->graphicsDevice, &fenceWaits, &fenceStalls);
+
+    SDL_qsort(times, timedFrames, sizeof(double), Benchmark_CompareDoubles);
+    double itemsPerSecond = items * 1000.0 / totalMilliseconds;
+    double p50 = Benchmark_Percentile(times, timedFrames, 50);
+    double p90 = Benchmark_Percentile(times, timedFrames, 90);
+    double p99 = Benchmark_Percentile(times, timedFrames, 99);
+    double maximum = times[timedFrames - 1];
+    SDL_free(times);
+
+    SDL_Log("%-24s %8u %14.0f %s/s %8.0f draws %10.0f bytes %5.1f stalls %8.3f ms p50 %8.3f ms p99",
+        scenario->name,
+        count,
+        itemsPerSecond,
+        scenario->item,
+        (double)drawCalls / timedFrames,
+        (double)uploadedBytes / timedFrames,
+        (double)fenceStalls / timedFrames,
+        p50,
+        p99);
+
+    SDL_IOprintf(output,
+        "%s    {\"scenario\":\"%s\",\"item\":\"%s\",\"count\":%u,\"frames\":%u,"
+        "\"items_per_second\":%.1f,\"draws_per_frame\":%.1f,\"uploaded_bytes_per_frame\":%.1f,"
+        "\"state_calls_per_frame\":%.1f,\"fence_waits_per_frame\":%.2f,"
+        "\"fence_stalls_per_frame\":%.2f,"
+        "\"frame_ms\":{\"p50\":%.4f,\"p90\":%.4f,\"p99\":%.4f,\"max\":%.4f}}",
+        *firstResult ? "" : ",\n",
+        scenario->name,
+        scenario->item,
+        count,
+        timedFrames,
+        itemsPerSecond,
+        (double)drawCalls / timedFrames,
+        (double)uploadedBytes / timedFrames,
+        (double)issuedStateCalls / timedFrames,
+        (double)fenceWaits / timedFrames,
+        (double)fenceStalls / timedFrames,
+        p50,
+        p90,
+        p99,
+        maximum);
+    *firstResult = false;
+
+    SDL_strlcpy(result->scenario, scenario->name, sizeof(result->scenario));
+    result->count = count;
+    result->itemsPerSecond = itemsPerSecond;
+
+    return true;
+}
+
+// the number after "key": on the line, or -1 without one
+static double Benchmark_FindNumber(const char *line, const char *key) {
+    const char *found = SDL_strstr(line, key);
+    if (found == NULL) {
+        return -1;
+    }
+    return SDL_strtod(found + SDL_strlen(key), NULL);
+}
+
+// reads the results out of an earlier run's json, one result per line as this program writes it
+static uint32_t Benchmark_LoadBaseline(const char *fileName, const char *backend,
+    BenchmarkResult *results, uint32_t maximumResults) {
+    size_t dataSize;
+    char *data = SDL_LoadFile(fileName, &dataSize);
+    if (data == NULL) {
+        SDL_Log("SDL_LoadFile failed %s: %s", fileName, SDL_GetError());
+        return 0;
+    }
+
+    char backendKey[64];
+    SDL_snprintf(backendKey, sizeof(backendKey), "\"backend\":\"%s\"", backend);
+    if (SDL_strstr(data, backendKey) == NULL) {
+        SDL_Log("The baseline %s was run on another backend, it isn't comparable", fileName);
+    }
+
+    uint32_t count = 0;
+    char *line = data;
+    while (line != NULL && *line != '\0' && count < maximumResults) {
+        char *end = SDL_strchr(line, '\n');
+        if (end != NULL) {
+            *end = '\0';
+        }
+
+        const char *scenario = SDL_strstr(line, "\"scenario\":\"");
+        if (scenario != NULL) {
+            scenario += SDL_strlen("\"scenario\":\"");
+            const char *scenarioEnd = SDL_strchr(scenario, '"');
+            if (scenarioEnd != NULL) {
+                BenchmarkResult *result = &results[count++];
+                size_t length =
+                    SDL_min((size_t)(scenarioEnd - scenario), sizeof(result->scenario) - 1);
+                SDL_memcpy(result->scenario, scenario, length);
+                result->scenario[length] = '\0';
+                result->count = (uint32_t)Benchmark_FindNumber(line, "\"count\":");
+                result->itemsPerSecond = Benchmark_FindNumber(line, "\"items_per_second\":");
+            }
+        }
+
+        line = (end != NULL) ? end + 1 : NULL;
+    }
+
+    SDL_free(data);
+    return count;
+}
+
+// true if nothing got slower than the threshold allows
+static bool Benchmark_CompareBaseline(BenchmarkResult *results, uint32_t resultCount,
+    BenchmarkResult *baseline, uint32_t baselineCount, double thresholdPercent) {
+    bool passed = true;
+
+    SDL_Log("compared to the baseline, regressions are over %.1f%%", thresholdPercent);
+    for (uint32_t index = 0; index < resultCount; index++) {
+        BenchmarkResult *result = &results[index];
+
+        BenchmarkResult *previous = NULL;
+        for (uint32_t baselineIndex = 0; baselineIndex < baselineCount; baselineIndex++) {
+            if (baseline[baselineIndex].count == result->count &&
+                SDL_strcmp(baseline[baselineIndex].scenario, result->scenario) == 0) {
+                previous = &baseline[baselineIndex];
+                break;
+            }
+        }
+
+        if (previous == NULL || previous->itemsPerSecond <= 0) {
+            SDL_Log("%-24s %8u not in the baseline", result->scenario, result->count);
+            continue;
+        }
+
+        double change = (result->itemsPerSecond / previous->itemsPerSecond - 1) * 100;
+        bool regressed = change < -thresholdPercent;
+        SDL_Log("%-24s %8u %+7.1f%%%s",
+            result->scenario,
+            result->count,
+            change,
+            regressed ? "  REGRESSION" : "");
+        if (regressed) {
+            passed = false;
+        }
+    }
+
+    return passed;
+}
+
+int main(int argc, char *argv[]) {
+    GraphicsAPI api = GRAPHICS_API_OPENGL;
+    const char *uploadName = NULL;
+    const char *scenarioFilter = NULL;
+    const char *outputFileName = "bench.json";
+    const char *baselineFileName = NULL;
+    uint32_t minimumCount = 1000;
+    uint32_t maximumCount = 1000000;
+    uint32_t frames = 20;
+    double budgetSeconds = 2;
+    double thresholdPercent = 10;
+
+    for (int index = 1; index < argc; index++) {
+        const char *argument = argv[index];
+        const char *value = (index + 1 < argc) ? argv[index + 1] : NULL;
+
+        if (SDL_strcmp(argument, "--null") == 0) {
+            api = GRAPHICS_API_NULL;
+            continue;
+        }
+
+        if (value == NULL) {
+            SDL_Log("Unknown or incomplete argument: %s", argument);
+            return 1;
+        }
+        index++;
+
+        if (SDL_strcmp(argument, "--upload") == 0) {
+            uploadName = value;
+        } else if (SDL_strcmp(argument, "--scenario") == 0) {
+            scenarioFilter = value;
+        } else if (SDL_strcmp(argument, "--minimum") == 0) {
+            minimumCount = (uint32_t)SDL_strtoul(value, NULL, 10);
+        } else if (SDL_strcmp(argument, "--maximum") == 0) {
+            maximumCount = (uint32_t)SDL_strtoul(value, NULL, 10);
+        } else if (SDL_strcmp(argument, "--frames") == 0) {
+            frames = (uint32_t)SDL_strtoul(value, NULL, 10);
+        } else if (SDL_strcmp(argument, "--budget") == 0) {
+            budgetSeconds = SDL_strtod(value, NULL);
+        } else if (SDL_strcmp(argument, "--output") == 0) {
+            outputFileName = value;
+        } else if (SDL_strcmp(argument, "--baseline") == 0) {
+            baselineFileName = value;
+        } else if (SDL_strcmp(argument, "--threshold") == 0) {
+            thresholdPercent = SDL_strtod(value, NULL);
+        } else {
+            SDL_Log("Unknown argument: %s", argument);
+            return 1;
+        }
+    }
+
+    if (minimumCount == 0 || maximumCount < minimumCount || frames == 0) {
+        SDL_Log("The counts and frames need to be above 0, with the minimum below the maximum");
+        return 1;
+    }
+
+    // the null backend doesn't need video at all
+    if (api == GRAPHICS_API_OPENGL && !SDL_Init(SDL_INIT_VIDEO)) {
+        SDL_Log("SDL_Init failed (%s), trying the offscreen video driver", SDL_GetError());
+        SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+        if (!SDL_Init(SDL_INIT_VIDEO)) {
+            SDL_Log("SDL_Init failed: %s", SDL_GetError());
+            return 1;
+        }
+    }
+
+    Benchmark benchmark = {0};
+    if (!Benchmark_Initialize(&benchmark, api)) {
+        Benchmark_Shutdown(&benchmark);
+        SDL_Quit();
+        return 1;
+    }
+
+    if (uploadName != NULL) {
+        size_t upload = 0;
+        while (upload < SDL_arraysize(uploadStrategyNames) &&
+               SDL_strcmp(uploadName, uploadStrategyNames[upload]) != 0) {
+            upload++;
+        }
+        if (upload == SDL_arraysize(uploadStrategyNames) ||
+            !BatchRenderer_SetUploadStrategy(
+                benchmark.batchRenderer, (VertexBufferUploadStrategy)upload)) {
+            SDL_Log("Upload strategy %s isn't available", uploadName);
+            Benchmark_Shutdown(&benchmark);
+            SDL_Quit();
+            return 1;
+        }
+    }
+
+    SDL_IOStream *output = SDL_IOFromFile(outputFileName, "w");
+    if (output == NULL) {
+        SDL_Log("SDL_IOFromFile failed %s: %s", outputFileName, SDL_GetError());
+        Benchmark_Shutdown(&benchmark);
+        SDL_Quit();
+        return 1;
+    }
+
+    const char *backend = (api == GRAPHICS_API_NULL) ? "null" : "opengl";
+    SDL_IOprintf(output,
+        "{\"backend\":\"%s\",\"upload\":\"%s\",\"width\":%d,\"height\":%d,\"results\":[\n",
+        backend,
+        uploadStrategyNames[BatchRenderer_GetUploadStrategy(benchmark.batchRenderer)],
+        BENCHMARK_WIDTH,
+        BENCHMARK_HEIGHT);
+
+    BenchmarkResult results[BENCHMARK_MAXIMUM_RESULTS];
+    uint32_t resultCount = 0;
+    bool firstResult = true;
+
+    for (size_t index = 0; index < SDL_arraysize(scenarios); index++) {
+        const BenchmarkScenario *scenario = &scenarios[index];
+        if (scenarioFilter != NULL && SDL_strstr(scenario->name, scenarioFilter) == NULL) {
+            continue;
+        }
+
+        for (uint32_t count = minimumCount; count <= maximumCount; count *= 10) {
+            if (resultCount == BENCHMARK_MAXIMUM_RESULTS) {
+                break;
+            }
+
+            bool overBudget;
+            if (!Benchmark_RunScenario(&benchmark,
+                    scenario,
+                    count,
+                    frames,
+                    budgetSeconds * 1000,
+                    output,
+                    &firstResult,
+                    &results[resultCount],
+                    &overBudget)) {
+                SDL_Log("%-24s skipped", scenario->name);
+                break;
+            }
+            resultCount++;
+
+            if (overBudget) {
+                SDL_Log("%-24s larger counts skipped, over the %.1f s budget",
+                    scenario->name,
+                    budgetSeconds);
+                break;
+            }
+
+            // the next count would overflow
+            if (count > UINT32_MAX / 10) {
+                break;
+            }
+        }
+    }
+
+    SDL_IOprintf(output, "\n]}\n");
+    if (!SDL_CloseIO(output)) {
+        SDL_Log("SDL_CloseIO failed %s: %s", outputFileName, SDL_GetError());
+    }
+    SDL_Log("results written to %s", outputFileName);
+
+    int exitCode = 0;
+    if (baselineFileName != NULL) {
+        BenchmarkResult baseline[BENCHMARK_MAXIMUM_RESULTS];
+        uint32_t baselineCount = Benchmark_LoadBaseline(
+            baselineFileName, backend, baseline, BENCHMARK_MAXIMUM_RESULTS);
+        if (baselineCount == 0) {
+            SDL_Log("No results in the baseline %s", baselineFileName);
+            exitCode = 1;
+        } else if (!Benchmark_CompareBaseline(
+                       results, resultCount, baseline, baselineCount, thresholdPercent)) {
+            exitCode = 1;
+        }
+    }
+
+    Benchmark_Shutdown(&benchmark);
+    SDL_Quit();
+
+    return exitCode;
+}
@@ -1,8 +1,47 @@
 const std = @import("std");
 
+// everything but main, shared by the game and the benchmarks
+const engine_files = [_][]const u8{
+    "dependencies/glad/gl.c",
+    "source/core/Trace.c",
+    "source/graphics/BatchRenderer.c",
+    "source/graphics/CommandCapture.c",
+    "source/graphics/FrameWriter.c",
+    "source/graphics/GraphicsDevice.c",
+    "source/graphics/IndexBuffer.c",
+    "source/graphics/NullDriver.c",
+    "source/graphics/Profiler.c",
+    "source/graphics/RenderThread.c",
+    "source/graphics/ShaderProgram.c",
+    "source/graphics/ShaderVariants.c",
+    "source/graphics/SpriteRenderer.c",
+    "source/graphics/Texture.c",
+    "source/graphics/VertexBuffer.c",
+};
+
+const c_flags = [_][]const u8{
+    "-Wall",
+    "-Werror",
+};
+
+// with -Dtrace=true, see include/Trace.h, and -Dcapture=true, see include/CommandCapture.h
+const trace_c_flags = c_flags ++ [_][]const u8{"-DPINIM_TRACE"};
+const capture_c_flags = c_flags ++ [_][]const u8{"-DPINIM_CAPTURE"};
+const trace_capture_c_flags = trace_c_flags ++ [_][]const u8{"-DPINIM_CAPTURE"};
+
 pub fn build(b: *std.Build) void {
     const target = b.standardTargetOptions(.{});
     const optimize = b.standardOptimizeOption(.{});
+    const trace = b.option(bool, "trace", "Record trace zones, written to trace.json") orelse false;
+    const capture = b.option(bool, "capture", "Allow command captures (F10)") orelse false;
+    const flags: []const []const u8 = if (trace and capture)
+        &trace_capture_c_flags
+    else if (trace)
+        &trace_c_flags
+    else if (capture)
+        &capture_c_flags
+    else
+        &c_flags;
 
     const exe = b.addExecutable(.{
         .name = "pinim",
@@ -12,19 +51,8 @@ pub fn build(b: *std.Build) void {
     exe.addIncludePath(b.path("dependencies"));
     exe.addIncludePath(b.path("include"));
     exe.addCSourceFiles(.{
-        .files = &.{
-            "dependencies/glad/gl.c",
-            "source/graphics/BatchRenderer.c",
-            "source/graphics/GraphicsDevice.c",
-            "source/graphics/ShaderProgram.c",
-            "source/graphics/Texture.c",
-            "source/graphics/VertexBuffer.c",
-            "source/main.c",
-        },
-        .flags = &.{
-            "-Wall",
-            "-Werror",
-        },
+        .files = &(engine_files ++ [_][]const u8{"source/main.c"}),
+        .flags = flags,
     });
 
     const sdl_dep = b.dependency("sdl", .{
@@ -47,4 +75,71 @@ pub fn build(b: *std.Build) void {
 
     const run_step = b.step("run", "Run the game");
     run_step.dependOn(&run_cmd.step);
+
+    addBenchmark(
+        b,
+        target,
+        flags,
+        sdl_lib,
+        "pinim-bench",
+        "bench/ScalingBenchmark.c",
+        "bench",
+        "Run the scaling benchmarks, options are listed in bench/ScalingBenchmark.c",
+    );
+    addBenchmark(
+        b,
+        target,
+        flags,
+        sdl_lib,
+        "pinim-bench-quads",
+        "bench/BatchQuadsBenchmark.c",
+        "bench-quads",
+        "Compare BatchQuad against BatchQuads",
+    );
+    addBenchmark(
+        b,
+        target,
+        flags,
+        sdl_lib,
+        "pinim-replay",
+        "bench/CaptureReplay.c",
+        "replay",
+        "Replay a command capture and time its frames, options are listed in bench/CaptureReplay.c",
+    );
+}
+
+// benchmarks always build optimized, a debug build measures the wrong thing. they run from the
+// repository root so they find Content
+fn addBenchmark(
+    b: *std.Build,
+    target: std.Build.ResolvedTarget,
+    flags: []const []const u8,
+    sdl_lib: *std.Build.Step.Compile,
+    name: []const u8,
+    comptime source: []const u8,
+    step_name: []const u8,
+    description: []const u8,
+) void {
+    const bench = b.addExecutable(.{
+        .name = name,
+        .target = target,
+        .optimize = .ReleaseFast,
+    });
+    bench.addIncludePath(b.path("dependencies"));
+    bench.addIncludePath(b.path("include"));
+    bench.addCSourceFiles(.{
+        .files = &(engine_files ++ [_][]const u8{source}),
+        .flags = flags,
+    });
+    bench.root_module.linkLibrary(sdl_lib);
+
+    const bench_cmd = b.addRunArtifact(bench);
+    bench_cmd.setCwd(b.path("."));
+
+    if (b.args) |args| {
+        bench_cmd.addArgs(args);
+    }
+
+    const bench_step = b.step(step_name, description);
+    bench_step.dependOn(&bench_cmd.step);
 }
@@ -6,19 +6,102 @@
 #include "Types.h"
 
 BatchRenderer *BatchRenderer_Create(GraphicsDevice *graphicsDevice, uint32_t maximumTriangles);
+// vertexFormat is VERTEX_FORMAT_STANDARD (what BatchRenderer_Create uses) or
+// VERTEX_FORMAT_COMPACT, which halves the vertex size but limits uvs to 0..1 and colors to
+// 8 bits per channel. multi-texture batches use the matching multi-texture format.
+BatchRenderer *BatchRenderer_CreateWithVertexFormat(
+    GraphicsDevice *graphicsDevice, uint32_t maximumTriangles, VertexFormat vertexFormat);
 void BatchRenderer_Destroy(BatchRenderer *batchRenderer);
+uint32_t BatchRenderer_GetMaximumTriangles(BatchRenderer *batchRenderer);
+VertexFormat BatchRenderer_GetVertexFormat(BatchRenderer *batchRenderer);
 
-// texture can be null if your shader doesn't use it
-// shaderProgram can be null if you want to use the default shaders
-// texture and shaderProgram cannot both be null
+// a recorder takes the same Begin/BeginDeferred, batch and End calls as the batch renderer it
+// was created from, but only records them, so each worker thread can fill its own recorder while
+// the main thread owns the gl context. recorders use no gl and share nothing mutable with each
+// other or their owner (textures and shaders are only referenced). multi-texture batches and
+// upload strategies aren't supported. destroy them with BatchRenderer_Destroy, before the owner.
+BatchRenderer *BatchRenderer_CreateRecorder(BatchRenderer *batchRenderer);
+// draws everything recorded since the last submit, in recording order (deferred batches are
+// sorted within themselves), then clears the recorder. call it on the gl thread outside of a
+// batch, once the recorder's thread is done with it. submitting recorders in a fixed order
+// gives the same draws every frame no matter how the threads were scheduled.
+void BatchRenderer_SubmitRecording(BatchRenderer *batchRenderer, BatchRenderer *recorder);
+
+// static batches: geometry recorded once (with a recorder, on any thread) and baked into a static
+// vertex buffer, so drawing it is only the draw calls. the recording's transforms are baked into
+// the vertices and the recorder is cleared. with a chunkSize above 0 the geometry is split into
+// square cells of that size in batch coordinates. cells only reorder geometry that shares a draw
+// state, everything else keeps its recorded order.
+StaticBatch *BatchRenderer_CreateStaticBatch(
+    BatchRenderer *batchRenderer, BatchRenderer *recorder, float chunkSize);
+void BatchRenderer_DestroyStaticBatch(StaticBatch *staticBatch);
+// call it outside of a batch. visibleArea is in batch coordinates and can be null to draw
+// everything, otherwise cells that don't touch it are skipped.
+void BatchRenderer_DrawStaticBatch(BatchRenderer *batchRenderer, StaticBatch *staticBatch,
+    Matrix4 transformMatrix, Rectangle *visibleArea);
+
+// texture can be null if your shader doesn't use it, the default shader then draws plain colors
+// shaderProgram can be null if you want to use the default shaders, they also stand in for
+// programs from ShaderProgram_CreateAsync that aren't ready yet
+// custom shaders get transformMatrix as TransformMatrix (to use with the ViewConstants block) or
+// already projected as ProjectionMatrix, whichever they declare
 void BatchRenderer_Begin(BatchRenderer *batchRenderer, BlendMode blendMode, Texture *texture,
     ShaderProgram *shaderProgram, Matrix4 transformMatrix);
+// multi-texture batching: textures are given slots as they are picked with
+// BatchRenderer_SetTexture, and the batch only flushes when a new texture needs a slot and
+// they are all taken. shaderProgram can be null if you want to use the default shaders.
+// custom shaders get the slot from the textureIndex attribute and sample TextureSampler0,
+// TextureSampler1, ... up to BatchRenderer_GetMaximumTextureSlots.
+void BatchRenderer_BeginMultiTexture(BatchRenderer *batchRenderer, BlendMode blendMode,
+    ShaderProgram *shaderProgram, Matrix4 transformMatrix);
+// picks the texture for the quads and triangles that follow. in a regular batch a different
+// texture flushes first, in a multi-texture batch it only flushes when the slots are full.
+void BatchRenderer_SetTexture(BatchRenderer *batchRenderer, Texture *texture);
+uint32_t BatchRenderer_GetMaximumTextureSlots(BatchRenderer *batchRenderer);
+
+// a variant of the default shader with the given BatchShaderFeature bits, compiled the first time
+// it is asked for and owned by the batch renderer. null shader programs already get
+// BATCH_SHADER_FEATURE_TEXTURE, or no features at all when the texture is null.
+ShaderProgram *BatchRenderer_GetDefaultShaderProgram(
+    BatchRenderer *batchRenderer, uint32_t features);
+
+// deferred batching: nothing is drawn until End (or Flush). every quad and triangle is recorded
+// with a sort key made from the state last given to BatchRenderer_SetSortState, then the records
+// are sorted by layer, blend mode, shader, texture and depth and drawn with as few state changes
+// as possible. records with equal keys keep their submission order.
+void BatchRenderer_BeginDeferred(BatchRenderer *batchRenderer, Matrix4 transformMatrix);
+// texture can be null if your shader doesn't use it
+// shaderProgram can be null if you want to use the default shaders
+// depth is clamped to 0..1, lower depths draw first within the same state
+void BatchRenderer_SetSortState(BatchRenderer *batchRenderer, uint8_t layer, BlendMode blendMode,
+    Texture *texture, ShaderProgram *shaderProgram, float depth);
+
+// a regular batch's last draw is held back, so a following Begin with the same blend mode,
+// texture, shader and matrix keeps adding to it. anything else that touches the device draws it
+// first, as does Flush outside of a batch and GraphicsDevice_EndFrame.
 void BatchRenderer_End(BatchRenderer *batchRenderer);
+
+// batched vertices are written straight into the vertex buffer's memory. the default is
+// VERTEX_BUFFER_UPLOAD_MAP_UNSYNCHRONIZED, switching is only allowed outside of a batch and
+// returns false (leaving the batch on glBufferSubData) if the driver doesn't support it.
+bool BatchRenderer_SetUploadStrategy(
+    BatchRenderer *batchRenderer, VertexBufferUploadStrategy uploadStrategy);
+VertexBufferUploadStrategy BatchRenderer_GetUploadStrategy(BatchRenderer *batchRenderer);
+
 // push through all batched polys without ending the batch
 void BatchRenderer_Flush(BatchRenderer *batchRenderer);
 
 bool BatchRenderer_BatchActive(BatchRenderer *batchRenderer);
 
+// when culling is on, BatchQuad, BatchQuadUV and BatchQuads skip sprites whose bounding circle
+// is entirely outside of the viewport after the transform matrix is applied. the viewport is
+// read in Begin, so change it between batches. recorders don't cull, they have no viewport.
+// culled sprites are counted until the count is reset.
+void BatchRenderer_SetCulling(BatchRenderer *batchRenderer, bool enabled);
+bool BatchRenderer_GetCulling(BatchRenderer *batchRenderer);
+uint32_t BatchRenderer_GetCulledSpriteCount(BatchRenderer *batchRenderer);
+void BatchRenderer_ResetCulledSpriteCount(BatchRenderer *batchRenderer);
+
 // use a source rectangle to calculate UVs for the vertices
 // color can be null if you want to use White
 void BatchRenderer_BatchQuad(BatchRenderer *batchRenderer, Rectangle *sourceRectangle,
@@ -27,6 +110,12 @@ void BatchRenderer_BatchQuad(BatchRenderer *batchRenderer, Rectangle *sourceRect
 void BatchRenderer_BatchQuadUV(
     BatchRenderer *batchRenderer, Vector2 uv0, Vector2 uv1, Vector2 xy0, Vector2 xy1, Color *color);
 
+// the same as calling BatchRenderer_BatchQuad for every sprite, but the sprites are converted
+// in chunks with the corner math vectorized (AVX2, SSE2 or NEON, whichever the build targets),
+// with faster paths for chunks without rotation or uv flips
+void BatchRenderer_BatchQuads(
+    BatchRenderer *batchRenderer, const SpriteDesc *sprites, uint32_t spriteCount);
+
 // render raw vertices as triangles. (Three vertices per triangle.)
 void BatchRenderer_BatchTriangles(
     BatchRenderer *batchRenderer, Vertex2d *triangleVertices, int triangleCount);
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "GameMath.h"
+#include "Types.h"
+
+// records what a game asks of the engine over a few frames into a file, so the frames can be
+// replayed on their own (bench/CaptureReplay.c) as often as needed and timed before and after a
+// change with exactly the same work. recorded are the BatchRenderer calls (a recorder's batches
+// are kept with the submit that draws them), the GraphicsDevice frame and state calls
+// (BeginFrame, EndFrame, Present, ClearScreen, SetViewport, SetBlendMode, the scissors rectangle,
+// render targets, ReadPixels and InvalidateState), Texture_SetTextureData and the shader
+// parameter setters. calls the engine makes itself, like a batch renderer setting its shader's
+// parameters, aren't recorded, replaying the outer call makes them again.
+// batch renderers, textures and shader programs are described the first time a recorded call
+// uses them: batch renderers by size, vertex format, culling and upload strategy, textures by
+// size, filter and type (not their pixels, replays start with blank textures) and shader
+// programs by their sources. static batches and SpriteRenderer aren't recorded.
+// captures are only made when PINIM_CAPTURE is defined (zig build -Dcapture=true), otherwise
+// the hooks compile to nothing and CommandCapture_Create fails. replays work in any build.
+
+// starts at the next GraphicsDevice_BeginFrame and writes fileName once frameCount frames are
+// recorded, at the BeginFrame after the last one so its Present is in it. a frame that submits a
+// recorder which started recording before the capture was created is left out, and the next one
+// is tried. one capture per device at a time. it can be created on any thread.
+CommandCapture *CommandCapture_Create(
+    GraphicsDevice *graphicsDevice, const char *fileName, uint32_t frameCount);
+// writes the frames recorded so far if the capture isn't finished yet, which has to happen on
+// the thread making the device calls. once it is finished any thread can destroy it.
+void CommandCapture_Destroy(CommandCapture *commandCapture);
+// true once the file is written (or writing it failed), on any thread
+bool CommandCapture_IsFinished(CommandCapture *commandCapture);
+
+// reads a capture and checks it, the file is in the byte order of the machine that wrote it
+CommandReplay *CommandReplay_Load(const char *fileName);
+// the objects made for the replay are destroyed with it
+void CommandReplay_Destroy(CommandReplay *commandReplay);
+uint32_t CommandReplay_GetFrameCount(CommandReplay *commandReplay);
+// the window size of the device the frames were captured on
+void CommandReplay_GetSize(CommandReplay *commandReplay, uint32_t *width, uint32_t *height);
+// creates the batch renderers, textures and shader programs the frames use, once, before the
+// first frame is played
+bool CommandReplay_CreateObjects(CommandReplay *commandReplay, GraphicsDevice *graphicsDevice);
+// issues a frame's calls again, BeginFrame through Present. state the frame changes (a render
+// target, the scissors rectangle) carries over into the next frame played, as it did when it was
+// captured, the viewport is set again at every BeginFrame.
+bool CommandReplay_PlayFrame(CommandReplay *commandReplay, uint32_t frameIndex);
+
+// used by the engine. a call is recorded when it is the outermost one, the calls it makes while
+// it runs belong to it. recorders record into a stream of their own, on whichever thread they
+// run, and the stream goes into the capture when the recording is submitted.
+#ifdef PINIM_CAPTURE
+
+typedef struct CommandCaptureCall {
+    CommandCaptureStream *stream; // where the call is recorded, null when it isn't
+    uint32_t *depth;              // calls running in the capture or stream, null outside one
+} CommandCaptureCall;
+
+#define COMMAND_CAPTURE_CONCATENATE_(a, b) a##b
+#define COMMAND_CAPTURE_CONCATENATE(a, b) COMMAND_CAPTURE_CONCATENATE_(a, b)
+#define COMMAND_CAPTURE_VARIABLE COMMAND_CAPTURE_CONCATENATE(commandCaptureCall, __LINE__)
+
+// a call from here to the end of the enclosing block, recorded with record(stream, ...) if it is
+// the outermost one. begin is CommandCapture_BeginCall or CommandCapture_BeginRecorderCall
+#define COMMAND_CAPTURE_RECORD(begin, record, ...)                                                \
+    __attribute__((cleanup(CommandCapture_EndCall))) CommandCaptureCall COMMAND_CAPTURE_VARIABLE = \
+        (begin);                                                                                   \
+    if (COMMAND_CAPTURE_VARIABLE.stream != NULL)                                                   \
+    record(COMMAND_CAPTURE_VARIABLE.stream, ##__VA_ARGS__)
+#define COMMAND_CAPTURE_CALL(graphicsDevice, record, ...)                                         \
+    COMMAND_CAPTURE_RECORD(CommandCapture_BeginCall(graphicsDevice), record, ##__VA_ARGS__)
+// for engine code that makes recorded calls of its own without being a recorded call itself
+#define COMMAND_CAPTURE_SCOPE(graphicsDevice)                                                      \
+    __attribute__((cleanup(CommandCapture_EndCall))) CommandCaptureCall COMMAND_CAPTURE_VARIABLE = \
+        CommandCapture_BeginCall(graphicsDevice)
+#define COMMAND_CAPTURE_BEGIN_FRAME(graphicsDevice) CommandCapture_BeginFrame(graphicsDevice)
+#define COMMAND_CAPTURE_FORGET_OBJECT(graphicsDevice, object)                                      \
+    CommandCapture_ForgetObject(graphicsDevice, object)
+
+CommandCaptureCall CommandCapture_BeginCall(GraphicsDevice *graphicsDevice);
+// stream belongs to the recorder and is created once a capture is attached. a recording is only
+// captured from its start, startable is true for a call that begins the recorder's first batch.
+CommandCaptureCall CommandCapture_BeginRecorderCall(
+    GraphicsDevice *graphicsDevice, CommandCaptureStream **stream, bool startable);
+void CommandCapture_EndCall(CommandCaptureCall *call);
+
+void CommandCapture_DestroyStream(CommandCaptureStream *stream);
+// drops what a recorder captured, after its recording was submitted
+void CommandCapture_ResetStream(CommandCaptureStream *stream);
+// called when the object is destroyed, a new object at the same address is described again
+void CommandCapture_ForgetObject(GraphicsDevice *graphicsDevice, const void *object);
+// starts, continues or finishes the capture, GraphicsDevice_BeginFrame records itself this way
+void CommandCapture_BeginFrame(GraphicsDevice *graphicsDevice);
+
+void CommandCapture_RecordEndFrame(CommandCaptureStream *stream);
+void CommandCapture_RecordPresent(CommandCaptureStream *stream);
+void CommandCapture_RecordClearScreen(CommandCaptureStream *stream, Color *color);
+void CommandCapture_RecordSetViewport(CommandCaptureStream *stream, Rectangle *viewport);
+void CommandCapture_RecordSetBlendMode(CommandCaptureStream *stream, BlendMode blendMode);
+void CommandCapture_RecordEnableScissorsRectangle(
+    CommandCaptureStream *stream, Rectangle *scissorsRectangle);
+void CommandCapture_RecordDisableScissorsRectangle(CommandCaptureStream *stream);
+void CommandCapture_RecordBindRenderTarget(
+    CommandCaptureStream *stream, Texture *renderTarget, bool setViewport);
+void CommandCapture_RecordUnbindRenderTarget(CommandCaptureStream *stream, bool resetViewport);
+void CommandCapture_RecordReadPixels(
+    CommandCaptureStream *stream, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+void CommandCapture_RecordInvalidateState(CommandCaptureStream *stream);
+
+void CommandCapture_RecordSetTextureData(CommandCaptureStream *stream, Texture *texture,
+    uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint8_t *pixelData, uint32_t dataLength);
+
+// type is the parameter's gl type, value holds size bytes
+void CommandCapture_RecordSetParameter(CommandCaptureStream *stream,
+    ShaderProgram *shaderProgram, const char *name, uint32_t type, const void *value,
+    uint32_t size);
+void CommandCapture_RecordSetParameterTexture(CommandCaptureStream *stream,
+    ShaderProgram *shaderProgram, const char *name, Texture *texture, int32_t slotNumber);
+void CommandCapture_RecordClearParameter(
+    CommandCaptureStream *stream, ShaderProgram *shaderProgram, const char *name);
+
+void CommandCapture_RecordBatchBegin(CommandCaptureStream *stream, BatchRenderer *batchRenderer,
+    BlendMode blendMode, Texture *texture, ShaderProgram *shaderProgram,
+    Matrix4 transformMatrix);
+void CommandCapture_RecordBatchBeginMultiTexture(CommandCaptureStream *stream,
+    BatchRenderer *batchRenderer, BlendMode blendMode, ShaderProgram *shaderProgram,
+    Matrix4 transformMatrix);
+void CommandCapture_RecordBatchSetTexture(
+    CommandCaptureStream *stream, BatchRenderer *batchRenderer, Texture *texture);
+void CommandCapture_RecordBatchBeginDeferred(
+    CommandCaptureStream *stream, BatchRenderer *batchRenderer, Matrix4 transformMatrix);
+void CommandCapture_RecordBatchSetSortState(CommandCaptureStream *stream,
+    BatchRenderer *batchRenderer, uint8_t layer, BlendMode blendMode, Texture *texture,
+    ShaderProgram *shaderProgram, float depth);
+void CommandCapture_RecordBatchEnd(CommandCaptureStream *stream, BatchRenderer *batchRenderer);
+void CommandCapture_RecordBatchFlush(CommandCaptureStream *stream, BatchRenderer *batchRenderer);
+void CommandCapture_RecordBatchSetCulling(
+    CommandCaptureStream *stream, BatchRenderer *batchRenderer, bool enabled);
+void CommandCapture_RecordBatchSetUploadStrategy(CommandCaptureStream *stream,
+    BatchRenderer *batchRenderer, VertexBufferUploadStrategy uploadStrategy);
+void CommandCapture_RecordBatchQuad(CommandCaptureStream *stream, BatchRenderer *batchRenderer,
+    Rectangle *sourceRectangle, Vector2 position, float rotation, Vector2 scale, Vector2 origin,
+    UVMode uvMode, Color *color);
+void CommandCapture_RecordBatchQuadUV(CommandCaptureStream *stream,
+    BatchRenderer *batchRenderer, Vector2 uv0, Vector2 uv1, Vector2 xy0, Vector2 xy1,
+    Color *color);
+void CommandCapture_RecordBatchQuads(CommandCaptureStream *stream, BatchRenderer *batchRenderer,
+    const SpriteDesc *sprites, uint32_t spriteCount);
+void CommandCapture_RecordBatchTriangles(CommandCaptureStream *stream,
+    BatchRenderer *batchRenderer, Vertex2d *triangleVertices, int triangleCount);
+// recording is the recorder's stream (null if it has none) and recordingEmpty whether the
+// recorder has any batches. batches from before the stream started leave the frame out
+void CommandCapture_RecordBatchSubmitRecording(CommandCaptureStream *stream,
+    BatchRenderer *batchRenderer, CommandCaptureStream *recording, bool recordingEmpty);
+
+#else
+
+#define COMMAND_CAPTURE_RECORD(begin, record, ...) ((void)0)
+#define COMMAND_CAPTURE_CALL(graphicsDevice, record, ...) ((void)0)
+#define COMMAND_CAPTURE_SCOPE(graphicsDevice) ((void)0)
+#define COMMAND_CAPTURE_BEGIN_FRAME(graphicsDevice) ((void)0)
+#define COMMAND_CAPTURE_FORGET_OBJECT(graphicsDevice, object) ((void)0)
+
+#endif
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Types.h"
+
+// writes captured frames to disk on a worker thread of its own, so encoding and file io stay off
+// the frame. directory must end in a separator (SDL_GetPrefPath does), null for the working
+// directory. png frames are frame000000.png, frame000001.png, ... and raw frames all go into
+// frames.rgba, which ffmpeg reads with -f rawvideo -pix_fmt rgba -s WIDTHxHEIGHT.
+// up to maximumQueuedFrames wait to be written, frames queued past that are dropped.
+FrameWriter *FrameWriter_Create(
+    const char *directory, FrameWriterFormat format, uint32_t maximumQueuedFrames);
+// writes the frames still queued, then stops the thread
+void FrameWriter_Destroy(FrameWriter *frameWriter);
+
+// copies the frame, pixels are rgba rows from the bottom up as gl reads them. returns false if
+// the frame was dropped, frames over 1 GiB always are. queue from one thread at a time.
+bool FrameWriter_QueueFrame(
+    FrameWriter *frameWriter, const uint8_t *pixels, uint32_t width, uint32_t height);
+// a GraphicsDeviceReadbackCallback that queues the readback, with the frame writer as userData
+void FrameWriter_QueueReadback(
+    const uint8_t *pixels, uint32_t width, uint32_t height, void *userData);
+
+uint32_t FrameWriter_GetWrittenFrameCount(FrameWriter *frameWriter);
+uint32_t FrameWriter_GetDroppedFrameCount(FrameWriter *frameWriter);
@@ -21,7 +21,9 @@ void Matrix4_OrthoCamera(
 
 #endif // PINIM_GAME_MATH_INCLUDED
 
-#if defined(PINIM_GAME_MATH_IMPLEMENTATION)
+// the implementation is only emitted once, even if other headers include this one again
+#if defined(PINIM_GAME_MATH_IMPLEMENTATION) && !defined(PINIM_GAME_MATH_IMPLEMENTED)
+#define PINIM_GAME_MATH_IMPLEMENTED
 
 void Vector2_Copy(Vector2 source, Vector2 destination) {
     assert(source != NULL);
@@ -2,20 +2,80 @@
 
 #include <stdint.h>
 
+#include "GameMath.h"
 #include "Types.h"
 
+// declarations of the device's uniform blocks for shader sources, the members are global names
+#define FRAME_CONSTANTS_GLSL                                                                       \
+    "layout(std140) uniform FrameConstants {\n"                                                    \
+    "    vec2 Resolution;\n"                                                                       \
+    "    float Time;\n"                                                                            \
+    "    float DeltaTime;\n"                                                                       \
+    "    uint FrameIndex;\n"                                                                       \
+    "};\n"
+#define VIEW_CONSTANTS_GLSL                                                                        \
+    "layout(std140) uniform ViewConstants {\n"                                                     \
+    "    mat4 ViewProjectionMatrix;\n"                                                             \
+    "    vec2 ViewportSize;\n"                                                                     \
+    "    vec2 ViewportOffset;\n"                                                                   \
+    "};\n"
+
+// draws work that was held back, see GraphicsDevice_SetPendingFlush
+typedef void (*GraphicsDevicePendingFlush)(void *userData);
+// pixels are only valid during the call, rgba rows from the bottom up like ReadPixels gives them
+typedef void (*GraphicsDeviceReadbackCallback)(
+    const uint8_t *pixels, uint32_t width, uint32_t height, void *userData);
+
 uint32_t GraphicsDevice_PrepareSDLWindowAttributes(GraphicsAPI api);
 
+// with GRAPHICS_API_NULL the window is optional and only gives the device its size, nothing is
+// drawn to it
 GraphicsDevice *GraphicsDevice_Create(
     GraphicsAPI api, SDL_Window *window, VerticalSyncType vsyncType);
+// renders into a width by height framebuffer in place of a window, for benchmarks and tests.
+// ReadPixels reads it back and Present does nothing. the context comes from a hidden window, so
+// SDL's video subsystem has to be up. build machines without a display can use SDL's offscreen
+// driver (SDL_VIDEO_DRIVER=offscreen, set before SDL_Init), which goes through egl and works on
+// mesa's llvmpipe. the device owns the window. GRAPHICS_API_NULL needs neither a window nor video.
+GraphicsDevice *GraphicsDevice_CreateHeadless(GraphicsAPI api, uint32_t width, uint32_t height);
+bool GraphicsDevice_IsHeadless(GraphicsDevice *graphicsDevice);
+GraphicsAPI GraphicsDevice_GetGraphicsAPI(GraphicsDevice *graphicsDevice);
+
+// what the null driver was handed since the device was created or the counters were reset, held
+// back draws included. all zero for the other apis, whose work shows up in a profiler instead
+void GraphicsDevice_GetNullDriverCounters(
+    GraphicsDevice *graphicsDevice, NullDriverCounters *counters);
+void GraphicsDevice_ResetNullDriverCounters(GraphicsDevice *graphicsDevice);
 void GraphicsDevice_Destroy(GraphicsDevice *device);
 
+// the gl context is current on one thread at a time, the one that created the device to begin
+// with. release it on that thread before acquiring it on another, every gl call (including
+// creating and destroying resources) has to come from the thread that holds it
+bool GraphicsDevice_AcquireContext(GraphicsDevice *graphicsDevice);
+void GraphicsDevice_ReleaseContext(GraphicsDevice *graphicsDevice);
+
+// swaps the window's buffers, on the thread holding the context
+void GraphicsDevice_Present(GraphicsDevice *graphicsDevice);
+
+// BeginFrame, EndFrame and Present report to the profiler, Profiler_Create sets it
+void GraphicsDevice_SetProfiler(GraphicsDevice *graphicsDevice, Profiler *profiler);
+Profiler *GraphicsDevice_GetProfiler(GraphicsDevice *graphicsDevice);
+
+// the capture recording the device's calls, CommandCapture_Create attaches it and it detaches
+// itself once it is finished
+void GraphicsDevice_SetCommandCapture(
+    GraphicsDevice *graphicsDevice, CommandCapture *commandCapture);
+CommandCapture *GraphicsDevice_GetCommandCapture(GraphicsDevice *graphicsDevice);
+
 void GraphicsDevice_SetViewport(GraphicsDevice *device, Rectangle *viewport);
 void GraphicsDevice_GetViewport(GraphicsDevice *device, Rectangle *viewport);
 
 uint32_t GraphicsDevice_GetWindowWidth(GraphicsDevice *device);
 uint32_t GraphicsDevice_GetWindowHeight(GraphicsDevice *device);
 
+// number of textures a fragment shader can sample at once (GL_MAX_TEXTURE_IMAGE_UNITS)
+uint32_t GraphicsDevice_GetMaximumTextureSlots(GraphicsDevice *device);
+
 void GraphicsDevice_ClearScreen(GraphicsDevice *device, Color *color);
 
 void GraphicsDevice_SetBlendMode(GraphicsDevice *device, BlendMode blendMode);
@@ -29,14 +89,108 @@ void GraphicsDevice_UnbindRenderTarget(GraphicsDevice *graphicsDevice, bool rese
 
 bool GraphicsDevice_IsUsingRenderTarget(GraphicsDevice *device);
 
+// orthographic projection for the current viewport with 0,0 at the top left, flipped as needed
+// when a render target is bound
+void GraphicsDevice_GetProjectionMatrix(GraphicsDevice *device, Matrix4 projectionMatrix);
+// changes whenever the projection matrix does, so callers can cache what they build from it
+uint32_t GraphicsDevice_GetProjectionVersion(GraphicsDevice *device);
+
+// waits for the gpu to finish everything drawn so far, use ReadPixelsAsync every frame instead
 void GraphicsDevice_ReadPixels(GraphicsDevice *graphicsDevice, uint32_t x, uint32_t y,
     uint32_t width, uint32_t height, uint8_t *pixels);
 
+// copies the pixels into one of four pixel pack buffers behind a fence and returns a ticket, or
+// 0 when all four are still in flight. with a callback the readback is handed to it once the
+// fence signals, from PollReadbacks (which EndFrame calls). without one, check the status and
+// take the pixels when it is ready, a few frames later keeps the gpu from stalling.
+uint32_t GraphicsDevice_ReadPixelsAsync(GraphicsDevice *graphicsDevice, uint32_t x, uint32_t y,
+    uint32_t width, uint32_t height, GraphicsDeviceReadbackCallback callback, void *userData);
+ReadbackStatus GraphicsDevice_GetReadbackStatus(GraphicsDevice *graphicsDevice, uint32_t ticket);
+// copies width * height * 4 bytes out and ends the readback, waiting if it isn't ready yet
+bool GraphicsDevice_TakeReadback(GraphicsDevice *graphicsDevice, uint32_t ticket, uint8_t *pixels);
+void GraphicsDevice_PollReadbacks(GraphicsDevice *graphicsDevice);
+
+// also brings ViewConstants up to date if the viewport or render target changed
 void GraphicsDevice_ApplyShaderProgram(
     GraphicsDevice *graphicsDevice, ShaderProgram *shaderProgram);
+void GraphicsDevice_GetFrameConstants(GraphicsDevice *graphicsDevice, FrameConstants *constants);
 
+// linked shader programs are saved to and reloaded from this directory, skipping the compile on
+// later launches. the path must end in a separator (SDL_GetPrefPath does), null turns it off.
+// shaders created while the cache is on only compile when a program misses it, so compile errors
+// show up from ShaderProgram_Create instead
+void GraphicsDevice_SetShaderCacheDirectory(GraphicsDevice *graphicsDevice, const char *directory);
+const char *GraphicsDevice_GetShaderCacheDirectory(GraphicsDevice *graphicsDevice);
+
+// the device shadows the bound program, vertex array, buffers, textures, framebuffer, viewport
+// and scissor state. every module binds through these so calls that wouldn't change anything
+// never reach the driver. deleting an object unbinds it, call the matching Forget afterwards.
+void GraphicsDevice_UseProgram(GraphicsDevice *graphicsDevice, uint32_t programId);
+void GraphicsDevice_BindVertexArray(GraphicsDevice *graphicsDevice, uint32_t vertexArrayId);
+void GraphicsDevice_BindBuffer(
+    GraphicsDevice *graphicsDevice, BufferTarget target, uint32_t bufferId);
+// binds a 2d texture to a texture unit
+void GraphicsDevice_BindTexture(GraphicsDevice *graphicsDevice, uint32_t slot, uint32_t textureId);
+// binds a texture to change its data or parameters, on whichever unit is already active
+void GraphicsDevice_BindTextureForUpdate(GraphicsDevice *graphicsDevice, uint32_t textureId);
+// for briefly using a framebuffer other than the render target's, RestoreFramebuffer goes back
+void GraphicsDevice_BindFramebuffer(GraphicsDevice *graphicsDevice, uint32_t framebufferId);
+void GraphicsDevice_RestoreFramebuffer(GraphicsDevice *graphicsDevice);
+
+void GraphicsDevice_ForgetProgram(GraphicsDevice *graphicsDevice, uint32_t programId);
+void GraphicsDevice_ForgetVertexArray(GraphicsDevice *graphicsDevice, uint32_t vertexArrayId);
+void GraphicsDevice_ForgetBuffer(GraphicsDevice *graphicsDevice, uint32_t bufferId);
+void GraphicsDevice_ForgetTexture(GraphicsDevice *graphicsDevice, uint32_t textureId);
+void GraphicsDevice_ForgetFramebuffer(GraphicsDevice *graphicsDevice, uint32_t framebufferId);
+
+// for code that changes gl state without going through the device, the next binds are all issued
+// and the viewport, scissor and blend state are applied again
+void GraphicsDevice_InvalidateState(GraphicsDevice *graphicsDevice);
+
+// state calls that reached the driver and ones skipped because nothing would have changed, since
+// the device was created or the counts were reset
+void GraphicsDevice_GetStateCallCounts(
+    GraphicsDevice *graphicsDevice, uint64_t *issuedCalls, uint64_t *elidedCalls);
+void GraphicsDevice_ResetStateCallCounts(GraphicsDevice *graphicsDevice);
+
+// draw calls and bytes handed to the driver (vertices, indices, texture data and the device's
+// uniform blocks) since the device was created or the counts were reset, held back draws included
+void GraphicsDevice_GetWorkCounts(
+    GraphicsDevice *graphicsDevice, uint64_t *drawCalls, uint64_t *uploadedBytes);
+void GraphicsDevice_ResetWorkCounts(GraphicsDevice *graphicsDevice);
+// for modules that upload through gl themselves
+void GraphicsDevice_AddUploadedBytes(GraphicsDevice *graphicsDevice, uint64_t bytes);
+// fences the streaming vertex buffers waited on, and the ones the gpu hadn't reached yet so the
+// cpu stalled, reset with the work counts
+void GraphicsDevice_GetFenceWaits(
+    GraphicsDevice *graphicsDevice, uint64_t *fenceWaits, uint64_t *fenceStalls);
+void GraphicsDevice_AddFenceWait(GraphicsDevice *graphicsDevice, bool stalled);
+
+// updates FrameConstants, everything drawn this frame sees the same time
 void GraphicsDevice_BeginFrame(GraphicsDevice *graphicsDevice);
 void GraphicsDevice_EndFrame(GraphicsDevice *graphicsDevice);
 
 void GraphicsDevice_DrawPrimitives(GraphicsDevice *graphicsDevice, VertexBuffer *vertexBuffer,
     RenderPrimitiveType primitiveType, uint32_t vertexStart, uint32_t primitiveCount);
+
+// indices are 32 bit, baseVertex is added to every index before fetching the vertex
+void GraphicsDevice_DrawIndexedPrimitives(GraphicsDevice *graphicsDevice,
+    VertexBuffer *vertexBuffer, IndexBuffer *indexBuffer, RenderPrimitiveType primitiveType,
+    uint32_t baseVertex, uint32_t indexStart, uint32_t primitiveCount);
+
+// draws primitiveCount primitives instanceCount times, attributes with a divisor step per instance
+void GraphicsDevice_DrawInstancedPrimitives(GraphicsDevice *graphicsDevice,
+    VertexBuffer *vertexBuffer, RenderPrimitiveType primitiveType, uint32_t vertexStart,
+    uint32_t primitiveCount, uint32_t instanceCount);
+
+// a renderer can hold back its last draw so a following batch with the same state can join it.
+// the flush runs from GraphicsDevice_NotifyStateChange and EndFrame. only one flush is pending at
+// a time, registering another draws the previous one first.
+void GraphicsDevice_SetPendingFlush(
+    GraphicsDevice *graphicsDevice, GraphicsDevicePendingFlush flush, void *userData);
+// forgets the pending flush if it belongs to userData, for renderers that drew it themselves
+void GraphicsDevice_CancelPendingFlush(GraphicsDevice *graphicsDevice, void *userData);
+// the one hook for anything a held back draw must not see or must come after: the device's own
+// state setters, draws, clears and reads, texture updates and deletes, shader parameter changes
+// and deletes. it draws the pending flush, if there is one.
+void GraphicsDevice_NotifyStateChange(GraphicsDevice *graphicsDevice);
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Types.h"
+
+IndexBuffer *IndexBuffer_Create(
+    GraphicsDevice *graphicsDevice, IndexBufferType bufferType, uint32_t maximumIndices);
+void IndexBuffer_Destroy(IndexBuffer *indexBuffer);
+
+void IndexBuffer_SetIndexData(IndexBuffer *indexBuffer, uint32_t *indices, uint32_t indexCount);
+
+uint32_t IndexBuffer_GetBufferId(IndexBuffer *indexBuffer);
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Types.h"
+
+// an in-memory stand-in for the gl driver behind GRAPHICS_API_NULL. it fills glad's function
+// pointers with functions that keep buffers, shader sources and reflection in memory and count
+// the work instead of drawing it. the pointers are global, so the null and opengl backends can't
+// be used in the same process. GraphicsDevice_Create installs it, the counters are read through
+// GraphicsDevice_GetNullDriverCounters.
+void NullDriver_Install(void);
+// frees every object still alive, gl calls are invalid afterwards
+void NullDriver_Uninstall(void);
+
+void NullDriver_GetCounters(NullDriverCounters *counters);
+void NullDriver_ResetCounters(void);
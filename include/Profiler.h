@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "GameMath.h"
+#include "Types.h"
+
+// times every frame between GraphicsDevice_BeginFrame and EndFrame on the cpu and, with
+// timestamp queries, on the gpu, plus the time GraphicsDevice_Present spends swapping. scopes
+// split the frame further. the queries are read back a few frames later so they never stall, a
+// frame's times are only reported once its gpu times are in.
+// the profiler attaches itself to the device and is used on the thread holding the context.
+Profiler *Profiler_Create(GraphicsDevice *graphicsDevice);
+void Profiler_Destroy(Profiler *profiler);
+
+// scopes nest and name should be a string literal, it is kept as is. scopes past the first 32 in
+// a frame, or outside of a frame, aren't timed
+void Profiler_BeginScope(Profiler *profiler, const char *name);
+void Profiler_EndScope(Profiler *profiler);
+
+// called by the device
+void Profiler_BeginFrame(Profiler *profiler);
+void Profiler_EndFrame(Profiler *profiler);
+void Profiler_AddPresentTime(Profiler *profiler, uint64_t counterTicks);
+
+// the newest frame with all its times, false before there is one
+bool Profiler_GetFrame(Profiler *profiler, ProfilerFrame *frame);
+// that frame's scopes in the order they began, returns how many there were
+uint32_t Profiler_GetScopes(Profiler *profiler, ProfilerScopeTiming *scopes, uint32_t maximum);
+// over the last 256 reported frames
+void Profiler_GetPercentiles(
+    Profiler *profiler, ProfilerMetric metric, float *p50, float *p95, float *p99);
+void Profiler_Reset(Profiler *profiler);
+
+// a bar per reported frame, oldest on the left, with the top left corner at position. each bar
+// stacks the cpu submission (green), present (blue) and the rest of the frame until the next one
+// begins (grey), a red mark shows the gpu time and lines mark 60 and 30 fps. call it outside of
+// a batch on the thread holding the context, with the render thread from a FrameCommandList_Call.
+void Profiler_DrawOverlay(Profiler *profiler, BatchRenderer *batchRenderer, Vector2 position);
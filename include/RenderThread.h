@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Types.h"
+
+// runs on the render thread with the gl context current, for uploads and other gl work that has
+// to happen between the frame's draws
+typedef void (*FrameCommandCallback)(GraphicsDevice *graphicsDevice, void *userData);
+
+// moves all gl work onto a thread of its own. the calling thread records each frame into a frame
+// command list and hands it over, the render thread draws it with batchRenderer and presents it
+// while the next frame is recorded. there are three lists, so recording only waits when the
+// render thread is two whole frames behind.
+// the device's context moves to the render thread, so the calling thread must not use gl (or
+// create and destroy textures, shaders and renderers) until the render thread is destroyed.
+// anything a queued frame references has to stay alive until then too.
+RenderThread *RenderThread_Create(GraphicsDevice *graphicsDevice, BatchRenderer *batchRenderer);
+// draws the frames already handed over, then gives the context back to the calling thread.
+// destroy it before the batch renderer
+void RenderThread_Destroy(RenderThread *renderThread);
+
+// waits for a free frame command list and starts recording into it
+FrameCommandList *RenderThread_BeginFrame(RenderThread *renderThread);
+// hands the frame over, the list must not be touched afterwards
+void RenderThread_EndFrame(RenderThread *renderThread);
+
+// frames handed over that the render thread hasn't finished drawing
+uint32_t RenderThread_GetQueuedFrameCount(RenderThread *renderThread);
+
+// the commands run in the order they are recorded, between GraphicsDevice_BeginFrame and
+// GraphicsDevice_EndFrame.
+// the recorder takes Begin/End batches (see BatchRenderer_CreateRecorder) that are drawn at this
+// point in the frame. get it again after recording any other command, every batch must be ended
+// before the frame is. returns NULL when no recorder could be created.
+BatchRenderer *FrameCommandList_GetRecorder(FrameCommandList *frameCommandList);
+void FrameCommandList_ClearScreen(FrameCommandList *frameCommandList, Color *color);
+void FrameCommandList_SetViewport(FrameCommandList *frameCommandList, Rectangle *viewport);
+void FrameCommandList_BindRenderTarget(
+    FrameCommandList *frameCommandList, Texture *renderTarget, bool setViewport);
+void FrameCommandList_UnbindRenderTarget(FrameCommandList *frameCommandList, bool resetViewport);
+// userData has to stay valid until the frame is drawn
+void FrameCommandList_Call(
+    FrameCommandList *frameCommandList, FrameCommandCallback callback, void *userData);
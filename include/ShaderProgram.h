@@ -7,6 +7,9 @@ VertexShader *VertexShader_Create(GraphicsDevice *graphicsDevice, char *fileName
 
 VertexShader *VertexShader_CreateFromBuffer(
     GraphicsDevice *graphicsDevice, void *buffer, uint32_t length);
+// only submits the compile, errors are logged when a program using the shader is finished
+VertexShader *VertexShader_CreateFromBufferAsync(
+    GraphicsDevice *graphicsDevice, void *buffer, uint32_t length);
 
 void VertexShader_Destroy(VertexShader *vertexShader);
 
@@ -14,6 +17,9 @@ FragmentShader *FragmentShader_Create(GraphicsDevice *graphicsDevice, char *file
 
 FragmentShader *FragmentShader_CreateFromBuffer(
     GraphicsDevice *graphicsDevice, void *buffer, uint32_t length);
+// only submits the compile, errors are logged when a program using the shader is finished
+FragmentShader *FragmentShader_CreateFromBufferAsync(
+    GraphicsDevice *graphicsDevice, void *buffer, uint32_t length);
 
 void FragmentShader_Destroy(FragmentShader *fragmentShader);
 
@@ -21,6 +27,45 @@ ShaderProgram *ShaderProgram_Create(
     GraphicsDevice *graphicsDevice, VertexShader *vertexShader, FragmentShader *fragmentShader);
 void ShaderProgram_Destroy(ShaderProgram *shaderProgram);
 
+// submits the compiles and the link and returns without waiting for them. the shaders can be
+// destroyed right away. the program has no parameters until ShaderProgram_GetStatus reports
+// SHADER_PROGRAM_STATUS_READY, parameters set or handles resolved before that fail and log, they
+// aren't kept for later. BatchRenderer and SpriteRenderer draw with their default shaders in the
+// meantime. with KHR_parallel_shader_compile the driver compiles on its own threads and polling
+// never blocks, without it the first poll waits for the driver.
+// a failed program still has to be destroyed
+ShaderProgram *ShaderProgram_CreateAsync(
+    GraphicsDevice *graphicsDevice, VertexShader *vertexShader, FragmentShader *fragmentShader);
+ShaderProgramStatus ShaderProgram_GetStatus(ShaderProgram *shaderProgram);
+bool ShaderProgram_IsReady(ShaderProgram *shaderProgram);
+
+// handles are parameter indices resolved once by name, -1 when the program doesn't have the
+// parameter (the ByHandle setters then return false). they stay valid until the program is
+// destroyed. setting a value equal to the current one is free, ApplyParameters only uploads
+// values that changed since the program's last apply.
+int32_t ShaderProgram_GetParameterHandle(ShaderProgram *shaderProgram, char *parameterName);
+
+bool ShaderProgram_SetParameterTexture2DByHandle(
+    ShaderProgram *shaderProgram, int32_t handle, Texture *texture, int32_t slotNumber);
+bool ShaderProgram_SetParameterMatrix4ByHandle(
+    ShaderProgram *shaderProgram, int32_t handle, float parameterValue[16]);
+bool ShaderProgram_SetParameterFloatByHandle(
+    ShaderProgram *shaderProgram, int32_t handle, float parameterValue);
+bool ShaderProgram_SetParameterFloat2ByHandle(
+    ShaderProgram *shaderProgram, int32_t handle, float parameterValue[2]);
+bool ShaderProgram_SetParameterFloat3ByHandle(
+    ShaderProgram *shaderProgram, int32_t handle, float parameterValue[3]);
+bool ShaderProgram_SetParameterFloat4ByHandle(
+    ShaderProgram *shaderProgram, int32_t handle, float parameterValue[4]);
+bool ShaderProgram_SetParameterIntByHandle(
+    ShaderProgram *shaderProgram, int32_t handle, int parameterValue);
+bool ShaderProgram_SetParameterInt2ByHandle(
+    ShaderProgram *shaderProgram, int32_t handle, int parameterValue[2]);
+bool ShaderProgram_SetParameterInt3ByHandle(
+    ShaderProgram *shaderProgram, int32_t handle, int parameterValue[3]);
+bool ShaderProgram_SetParameterInt4ByHandle(
+    ShaderProgram *shaderProgram, int32_t handle, int parameterValue[4]);
+
 bool ShaderProgram_SetParameterTexture2D(
     ShaderProgram *shaderProgram, char *parameterName, Texture *texture, int32_t slotNumber);
 
@@ -61,4 +106,10 @@ uint32_t ShaderProgram_GetParameterType(ShaderProgram *shaderProgram, char *para
 int32_t ShaderProgram_GetAttributeLocation(ShaderProgram *shaderProgram, char *attributeName);
 uint32_t ShaderProgram_GetAttributeType(ShaderProgram *shaderProgram, char *attributeName);
 
-uint32_t ShaderProgram_GetShaderId(ShaderProgram *shaderProgram);
\ No newline at end of file
+uint32_t ShaderProgram_GetShaderId(ShaderProgram *shaderProgram);
+
+#ifdef PINIM_CAPTURE
+// the sources the program was made from, kept for captures
+void ShaderProgram_GetSources(ShaderProgram *shaderProgram, const char **vertexSource,
+    uint32_t *vertexLength, const char **fragmentSource, uint32_t *fragmentLength);
+#endif
\ No newline at end of file
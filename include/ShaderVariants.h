@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "GraphicsDevice.h"
+#include "Types.h"
+
+// expands #include "fileName" lines, read relative to includeDirectory (which must end in a
+// separator, null for the working directory), and adds a #define after the #version line for
+// each of defines. defines are "NAME" or "NAME=VALUE".
+// returns a new null terminated source to SDL_free, or null with the error logged
+char *ShaderVariants_Preprocess(const char *source, uint32_t length, const char *includeDirectory,
+    const char **defines, uint32_t defineCount, uint32_t *resultLength);
+
+// a vertex and fragment shader pair specialized by up to 32 feature defines. the includes are
+// expanded once up front, each variant is compiled the first time it is requested and belongs to
+// the set. the file version resolves includes relative to each file.
+ShaderVariants *ShaderVariants_Create(GraphicsDevice *graphicsDevice, char *vertexFileName,
+    char *fragmentFileName, const char **features, uint32_t featureCount);
+ShaderVariants *ShaderVariants_CreateFromBuffer(GraphicsDevice *graphicsDevice,
+    void *vertexSource, uint32_t vertexLength, void *fragmentSource, uint32_t fragmentLength,
+    const char *includeDirectory, const char **features, uint32_t featureCount);
+void ShaderVariants_Destroy(ShaderVariants *shaderVariants);
+
+// bit n of featureMask defines features[n]. returns null if the variant doesn't compile, the
+// errors are logged the first time and it isn't retried
+ShaderProgram *ShaderVariants_GetProgram(ShaderVariants *shaderVariants, uint32_t featureMask);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "GameMath.h"
+#include "Types.h"
+
+// draws sprites as instances: each sprite is one SpriteInstance record and the vertex shader
+// does the corner, rotation and uv math that BatchRenderer_BatchQuad does on the cpu. all the
+// sprites between flushes share a texture, shader and blend mode.
+SpriteRenderer *SpriteRenderer_Create(GraphicsDevice *graphicsDevice, uint32_t maximumSprites);
+void SpriteRenderer_Destroy(SpriteRenderer *spriteRenderer);
+
+// shaderProgram can be null if you want to use the default shaders
+// custom shaders get the instance attributes position, rotation, scale, origin,
+// sourceRectangle, color and uvMode, plus the TransformMatrix (or already projected
+// ProjectionMatrix), TextureSize and TextureSampler uniforms and the ViewConstants block when
+// they declare them
+void SpriteRenderer_Begin(SpriteRenderer *spriteRenderer, BlendMode blendMode, Texture *texture,
+    ShaderProgram *shaderProgram, Matrix4 transformMatrix);
+void SpriteRenderer_End(SpriteRenderer *spriteRenderer);
+
+// flushes first if the texture is different
+void SpriteRenderer_SetTexture(SpriteRenderer *spriteRenderer, Texture *texture);
+
+// push through all batched sprites without ending the batch
+void SpriteRenderer_Flush(SpriteRenderer *spriteRenderer);
+
+// same arguments as BatchRenderer_BatchQuad
+// sourceRectangle can be null to use the whole texture, color can be null if you want to use White
+void SpriteRenderer_BatchSprite(SpriteRenderer *spriteRenderer, Rectangle *sourceRectangle,
+    Vector2 position, float rotation, Vector2 scale, Vector2 origin, UVMode uvMode, Color *color);
+
+// copies prepared instances straight into the instance buffer
+void SpriteRenderer_BatchSpriteInstances(
+    SpriteRenderer *spriteRenderer, SpriteInstance *instances, uint32_t instanceCount);
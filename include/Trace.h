@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+
+// trace zones for a timeline of startup and of single frames, written out as chrome trace json
+// (open it in ui.perfetto.dev or chrome://tracing). they are only recorded when PINIM_TRACE is
+// defined (zig build -Dtrace=true), otherwise every macro compiles to nothing.
+// each thread records into a buffer of its own without locking, a thread's events past the
+// first 65536 are dropped. names must be string literals, they are kept as pointers and written
+// out unescaped.
+#ifdef PINIM_TRACE
+
+#define TRACE_CONCATENATE_(a, b) a##b
+#define TRACE_CONCATENATE(a, b) TRACE_CONCATENATE_(a, b)
+
+// a zone from here to the end of the enclosing block
+#define TRACE_ZONE(name)                                                                           \
+    __attribute__((cleanup(Trace_EndZone))) const char *TRACE_CONCATENATE(traceZone, __LINE__) =  \
+        Trace_Begin(name)
+// for zones that don't line up with a block, every begin needs its end on the same thread
+#define TRACE_BEGIN(name) Trace_Begin(name)
+#define TRACE_END() Trace_End()
+#define TRACE_THREAD_NAME(name) Trace_SetThreadName(name)
+// everything recorded so far, on any thread, recording carries on
+#define TRACE_WRITE(fileName) Trace_Write(fileName)
+
+const char *Trace_Begin(const char *name);
+void Trace_End(void);
+void Trace_EndZone(const char **name);
+void Trace_SetThreadName(const char *name);
+bool Trace_Write(const char *fileName);
+
+#else
+
+#define TRACE_ZONE(name) ((void)0)
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END() ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#define TRACE_WRITE(fileName) ((void)0)
+
+#endif
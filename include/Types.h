@@ -1,5 +1,14 @@
 #pragma once
 
+#include <stdint.h>
+
+// feature bits of the BatchRenderer default shader variants
+typedef enum BatchShaderFeature {
+    BATCH_SHADER_FEATURE_TEXTURE = 1 << 0,           // multiplies in TextureSampler
+    BATCH_SHADER_FEATURE_ALPHA_TEST = 1 << 1,        // discards fragments under half alpha
+    BATCH_SHADER_FEATURE_PREMULTIPLY_ALPHA = 1 << 2, // for straight alpha textures
+} BatchShaderFeature;
+
 typedef enum BlendMode {
     BLEND_MODE_INVALID = -1,
     BLEND_MODE_NONE,
@@ -8,10 +17,37 @@ typedef enum BlendMode {
     BLEND_MODE_PREMULTIPLIED_ALPHA,
 } BlendMode;
 
+// buffer binding points shadowed by the device
+typedef enum BufferTarget {
+    BUFFER_TARGET_ARRAY,
+    BUFFER_TARGET_ELEMENT_ARRAY, // belongs to the bound vertex array
+    BUFFER_TARGET_UNIFORM,
+    BUFFER_TARGET_COPY_WRITE,
+    BUFFER_TARGET_PIXEL_PACK,
+    BUFFER_TARGET_COUNT,
+} BufferTarget;
+
+typedef enum FrameWriterFormat {
+    FRAME_WRITER_FORMAT_PNG, // a numbered png per frame
+    FRAME_WRITER_FORMAT_RAW, // every frame's rgba rows appended to one file, top row first
+} FrameWriterFormat;
+
 typedef enum GraphicsAPI {
     GRAPHICS_API_OPENGL,
+    GRAPHICS_API_NULL, // nothing reaches a driver, for measuring the cpu side, see NullDriver.h
 } GraphicsAPI;
 
+typedef enum IndexBufferType {
+    INDEX_BUFFER_STATIC,
+    INDEX_BUFFER_DYNAMIC,
+} IndexBufferType;
+
+typedef enum ReadbackStatus {
+    READBACK_STATUS_PENDING, // the gpu hasn't finished the copy
+    READBACK_STATUS_READY,
+    READBACK_STATUS_INVALID, // not a ticket, or already taken
+} ReadbackStatus;
+
 typedef enum RenderPrimitiveType {
     RENDER_PRIMITIVE_TRIANGLES,
     RENDER_PRIMITIVE_TRIANGLE_STRIP,
@@ -20,6 +56,12 @@ typedef enum RenderPrimitiveType {
     RENDER_PRIMITIVE_POINTS,
 } RenderPrimitiveType;
 
+typedef enum ShaderProgramStatus {
+    SHADER_PROGRAM_STATUS_PENDING, // still compiling or linking
+    SHADER_PROGRAM_STATUS_READY,
+    SHADER_PROGRAM_STATUS_FAILED, // the errors have been logged
+} ShaderProgramStatus;
+
 typedef enum TextureFilter {
     TEXTURE_FILTER_LINEAR,
     TEXTURE_FILTER_POINT,
@@ -30,6 +72,13 @@ typedef enum TextureType {
     TEXTURE_TYPE_RENDERTARGET,
 } TextureType;
 
+// fixed binding points of the uniform blocks the device keeps up to date, shader programs that
+// declare them are bound automatically
+typedef enum UniformBlockBinding {
+    UNIFORM_BLOCK_FRAME_CONSTANTS = 0, // FrameConstants, updated in GraphicsDevice_BeginFrame
+    UNIFORM_BLOCK_VIEW_CONSTANTS = 1,  // ViewConstants, updated when the viewport changes
+} UniformBlockBinding;
+
 typedef enum UVMode {
     UVMODE_NORMAL = 0,
     UVMODE_ROTATED_CW90 = 1 << 1,    // Matches texture packer rotation
@@ -42,6 +91,21 @@ typedef enum VertexBufferType {
     VERTEX_BUFFER_DYNAMIC,
 } VertexBufferType;
 
+// how a dynamic vertex buffer gets new vertices to the gpu
+typedef enum VertexBufferUploadStrategy {
+    VERTEX_BUFFER_UPLOAD_SUBDATA,            // glBufferSubData over the start of the buffer
+    VERTEX_BUFFER_UPLOAD_MAP_UNSYNCHRONIZED, // fenced ring, mapped unsynchronized per write
+    VERTEX_BUFFER_UPLOAD_PERSISTENT,         // fenced ring, mapped once (ARB_buffer_storage)
+} VertexBufferUploadStrategy;
+
+typedef enum VertexFormat {
+    VERTEX_FORMAT_STANDARD,             // Vertex2d
+    VERTEX_FORMAT_MULTITEXTURE,         // Vertex2dMultiTexture
+    VERTEX_FORMAT_COMPACT,              // Vertex2dCompact
+    VERTEX_FORMAT_COMPACT_MULTITEXTURE, // Vertex2dCompactMultiTexture
+    VERTEX_FORMAT_SPRITE_INSTANCE,      // SpriteInstance, one per instance
+} VertexFormat;
+
 typedef enum VerticalSyncType {
     VERTICAL_SYNC_ADAPTIVE,
     VERTICAL_SYNC_ENABLED,
@@ -62,12 +126,130 @@ typedef struct Vertex2d {
     float r, g, b, a;
 } Vertex2d;
 
+// textureIndex selects which of the batch's bound textures the vertex samples
+typedef struct Vertex2dMultiTexture {
+    float x, y;
+    float u, v;
+    float r, g, b, a;
+    float textureIndex;
+} Vertex2dMultiTexture;
+
+// 16 bytes instead of 32: uvs are normalized to 0..65535 (so they can't go outside 0..1) and
+// colors to 0..255
+typedef struct Vertex2dCompact {
+    float x, y;
+    uint16_t u, v;
+    uint8_t r, g, b, a;
+} Vertex2dCompact;
+
+typedef struct Vertex2dCompactMultiTexture {
+    float x, y;
+    uint16_t u, v;
+    uint8_t r, g, b, a;
+    float textureIndex;
+} Vertex2dCompactMultiTexture;
+
+// one sprite for BatchRenderer_BatchQuads, the same values BatchRenderer_BatchQuad takes.
+// source is in texels of the batch's current texture.
+typedef struct SpriteDesc {
+    float x, y;
+    float rotation;
+    float scaleX, scaleY;
+    float originX, originY;
+    Rectangle source;
+    Color color;
+    UVMode uvMode;
+} SpriteDesc;
+
+// one sprite for SpriteRenderer, the vertex shader expands it to a quad. like
+// BatchRenderer_BatchQuad the destination size is scale times the source rectangle size, origin
+// is relative to that size and rotation (in radians) turns around it. 44 bytes.
+typedef struct SpriteInstance {
+    float x, y;
+    float rotation;
+    float scaleX, scaleY;
+    float originX, originY;
+    uint16_t sourceX, sourceY, sourceWidth, sourceHeight;
+    uint8_t r, g, b, a;
+    uint32_t uvMode;
+} SpriteInstance;
+
+// std140 layout of the FrameConstants uniform block, see FRAME_CONSTANTS_GLSL
+typedef struct FrameConstants {
+    float resolution[2]; // window size in pixels
+    float time;          // seconds since the device was created
+    float deltaTime;     // seconds since the previous frame
+    uint32_t frameIndex;
+    uint32_t padding[3];
+} FrameConstants;
+
+// std140 layout of the ViewConstants uniform block, see VIEW_CONSTANTS_GLSL
+typedef struct ViewConstants {
+    float viewProjectionMatrix[16]; // GraphicsDevice_GetProjectionMatrix
+    float viewportSize[2];
+    float viewportOffset[2];
+} ViewConstants;
+
+// work the null driver was handed since it was installed or its counters were reset
+typedef struct NullDriverCounters {
+    uint64_t uploadedBytes; // buffer data, mapped writes and texture data
+    uint64_t drawCalls;
+    uint64_t drawnVertices; // vertices or indices per instance, times the instances
+    uint64_t stateChanges;  // binds, enables, blend, viewport, scissor and clear color
+    uint64_t uniformUpdates;
+    uint64_t clears;
+} NullDriverCounters;
+
+// what Profiler_GetPercentiles reports on
+typedef enum ProfilerMetric {
+    PROFILER_METRIC_FRAME,   // from one GraphicsDevice_BeginFrame to the next
+    PROFILER_METRIC_CPU,     // BeginFrame to EndFrame on the cpu, the submission
+    PROFILER_METRIC_GPU,     // BeginFrame to EndFrame on the gpu
+    PROFILER_METRIC_PRESENT, // GraphicsDevice_Present, mostly waiting for vsync
+    PROFILER_METRIC_COUNT,
+} ProfilerMetric;
+
+// one frame's times in milliseconds
+typedef struct ProfilerFrame {
+    uint32_t frameIndex;
+    float frameMilliseconds;
+    float cpuMilliseconds;
+    float gpuMilliseconds;
+    float presentMilliseconds;
+} ProfilerFrame;
+
+// one Profiler_BeginScope/EndScope pair, depth counts the scopes it is nested in
+typedef struct ProfilerScopeTiming {
+    const char *name;
+    uint32_t depth;
+    float cpuMilliseconds;
+    float gpuMilliseconds;
+} ProfilerScopeTiming;
+
 typedef struct BatchRenderer BatchRenderer;
 typedef struct Color Color;
+typedef struct CommandCapture CommandCapture;
+typedef struct CommandCaptureStream CommandCaptureStream;
+typedef struct CommandReplay CommandReplay;
 typedef struct FragmentShader FragmentShader;
+typedef struct FrameCommandList FrameCommandList;
+typedef struct FrameConstants FrameConstants;
+typedef struct FrameWriter FrameWriter;
 typedef struct GraphicsDevice GraphicsDevice;
+typedef struct IndexBuffer IndexBuffer;
+typedef struct Profiler Profiler;
+typedef struct RenderThread RenderThread;
 typedef struct ShaderProgram ShaderProgram;
+typedef struct ShaderVariants ShaderVariants;
+typedef struct SpriteDesc SpriteDesc;
+typedef struct SpriteInstance SpriteInstance;
+typedef struct SpriteRenderer SpriteRenderer;
+typedef struct StaticBatch StaticBatch;
 typedef struct Texture Texture;
 typedef struct Vertex2d Vertex2d;
+typedef struct Vertex2dCompact Vertex2dCompact;
+typedef struct Vertex2dCompactMultiTexture Vertex2dCompactMultiTexture;
+typedef struct Vertex2dMultiTexture Vertex2dMultiTexture;
 typedef struct VertexBuffer VertexBuffer;
 typedef struct VertexShader VertexShader;
+typedef struct ViewConstants ViewConstants;
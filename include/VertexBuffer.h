@@ -4,11 +4,43 @@
 
 #include "Types.h"
 
-VertexBuffer *VertexBuffer_Create(VertexBufferType bufferType, uint32_t maximumVertices);
+VertexBuffer *VertexBuffer_Create(GraphicsDevice *graphicsDevice, VertexBufferType bufferType,
+    VertexFormat vertexFormat, uint32_t maximumVertices);
 void VertexBuffer_Destroy(VertexBuffer *vertexBuffer);
 
+uint32_t VertexBuffer_GetVertexSize(VertexFormat vertexFormat);
+
+// the buffer holds maximumVertices of the format it was created with, any format that fits can
+// be uploaded
 void VertexBuffer_SetVertexData(VertexBuffer *vertexBuffer, ShaderProgram *shaderProgram,
-    Vertex2d *vertices, uint32_t vertexCount);
+    VertexFormat vertexFormat, void *vertices, uint32_t vertexCount);
+
+// points the attributes at the start of the buffer for shaderProgram, without uploading anything.
+// for vertices uploaded once and drawn with more than one shader program.
+void VertexBuffer_SetVertexFormat(
+    VertexBuffer *vertexBuffer, ShaderProgram *shaderProgram, VertexFormat vertexFormat);
+
+// dynamic buffers can switch strategy at any time outside of BeginWrite/EndWrite, the contents
+// are lost. returns false if the strategy isn't supported by the driver or the buffer is static.
+bool VertexBuffer_IsUploadStrategySupported(VertexBufferUploadStrategy uploadStrategy);
+bool VertexBuffer_SetUploadStrategy(
+    VertexBuffer *vertexBuffer, VertexBufferUploadStrategy uploadStrategy);
+VertexBufferUploadStrategy VertexBuffer_GetUploadStrategy(VertexBuffer *vertexBuffer);
+
+// returns memory for up to maximumVertices to be written directly, which is gpu memory for the
+// ring strategies. EndWrite uploads (or unmaps) the vertexCount actually written and points the
+// attributes at them, so the next draw starts at vertex 0. a vertexCount of 0 just ends the write.
+// the memory is write only, reading it back can be very slow.
+void *VertexBuffer_BeginWrite(
+    VertexBuffer *vertexBuffer, VertexFormat vertexFormat, uint32_t maximumVertices);
+void VertexBuffer_EndWrite(VertexBuffer *vertexBuffer, ShaderProgram *shaderProgram,
+    VertexFormat vertexFormat, uint32_t vertexCount);
+// hold a write open without keeping the buffer mapped, for vertices that may be added to later.
+// the vertexCount written so far are kept, ResumeWrite returns the memory again (NULL if it can't
+// be mapped, which ends the write). EndWrite can also be called straight on a suspended write.
+void VertexBuffer_SuspendWrite(
+    VertexBuffer *vertexBuffer, VertexFormat vertexFormat, uint32_t vertexCount);
+void *VertexBuffer_ResumeWrite(VertexBuffer *vertexBuffer);
 
 uint32_t VertexBuffer_GetArrayId(VertexBuffer *vertexBuffer);
 uint32_t VertexBuffer_GetBufferId(VertexBuffer *vertexBuffer);
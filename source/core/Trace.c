@@ -0,0 +1,149 @@
+#ifdef PINIM_TRACE
+
+#include <assert.h>
+
+#include <SDL3/SDL.h>
+
+#include <Trace.h>
+
+#define TRACE_BUFFER_EVENTS 65536
+
+typedef struct TraceEvent {
+    const char *name;
+    uint64_t counter;
+    char phase;
+} TraceEvent;
+
+// written only by its thread, count is published after each event so Trace_Write can read the
+// events before it from any thread. buffers are never freed, a thread's events outlive it
+typedef struct TraceBuffer {
+    struct TraceBuffer *next;
+    SDL_ThreadID threadId;
+    void *threadName;
+    SDL_AtomicInt count;
+    TraceEvent events[TRACE_BUFFER_EVENTS];
+} TraceBuffer;
+
+static void *traceBuffers;
+static _Thread_local TraceBuffer *threadBuffer;
+
+static TraceBuffer *Trace_GetThreadBuffer(void) {
+    if (threadBuffer != NULL) {
+        return threadBuffer;
+    }
+
+    TraceBuffer *buffer = SDL_calloc(1, sizeof(TraceBuffer));
+    if (buffer == NULL) {
+        SDL_Log("SDL_calloc failed");
+        return NULL;
+    }
+    buffer->threadId = SDL_GetCurrentThreadID();
+
+    // push onto the list of every thread's buffer
+    do {
+        buffer->next = SDL_GetAtomicPointer(&traceBuffers);
+    } while (!SDL_CompareAndSwapAtomicPointer(&traceBuffers, buffer->next, buffer));
+
+    threadBuffer = buffer;
+    return buffer;
+}
+
+static void Trace_AddEvent(const char *name, char phase) {
+    uint64_t counter = SDL_GetPerformanceCounter();
+
+    TraceBuffer *buffer = Trace_GetThreadBuffer();
+    if (buffer == NULL) {
+        return;
+    }
+
+    int count = SDL_GetAtomicInt(&buffer->count);
+    if (count == TRACE_BUFFER_EVENTS) {
+        return;
+    }
+
+    buffer->events[count] = (TraceEvent){.name = name, .counter = counter, .phase = phase};
+    SDL_SetAtomicInt(&buffer->count, count + 1);
+}
+
+const char *Trace_Begin(const char *name) {
+    assert(name != NULL);
+
+    Trace_AddEvent(name, 'B');
+    return name;
+}
+
+void Trace_End(void) {
+    Trace_AddEvent(NULL, 'E');
+}
+
+void Trace_EndZone(const char **name) {
+    Trace_End();
+}
+
+void Trace_SetThreadName(const char *name) {
+    assert(name != NULL);
+
+    TraceBuffer *buffer = Trace_GetThreadBuffer();
+    if (buffer != NULL) {
+        SDL_SetAtomicPointer(&buffer->threadName, (void *)name);
+    }
+}
+
+bool Trace_Write(const char *fileName) {
+    assert(fileName != NULL);
+
+    SDL_IOStream *stream = SDL_IOFromFile(fileName, "w");
+    if (stream == NULL) {
+        SDL_Log("SDL_IOFromFile failed %s: %s", fileName, SDL_GetError());
+        return false;
+    }
+
+    double microsecondsPerTick = 1000000.0 / (double)SDL_GetPerformanceFrequency();
+    bool first = true;
+
+    SDL_IOprintf(stream, "{\"traceEvents\":[\n");
+    for (TraceBuffer *buffer = SDL_GetAtomicPointer(&traceBuffers); buffer != NULL;
+        buffer = buffer->next) {
+        unsigned long long threadId = (unsigned long long)buffer->threadId;
+
+        const char *threadName = SDL_GetAtomicPointer(&buffer->threadName);
+        if (threadName != NULL) {
+            SDL_IOprintf(stream,
+                "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%llu,"
+                "\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",\n",
+                threadId,
+                threadName);
+            first = false;
+        }
+
+        int count = SDL_GetAtomicInt(&buffer->count);
+        for (int index = 0; index < count; index++) {
+            TraceEvent *event = &buffer->events[index];
+            if (event->phase == 'B') {
+                SDL_IOprintf(stream,
+                    "%s{\"name\":\"%s\",\"ph\":\"B\",\"pid\":1,\"tid\":%llu,\"ts\":%.3f}",
+                    first ? "" : ",\n",
+                    event->name,
+                    threadId,
+                    event->counter * microsecondsPerTick);
+            } else {
+                SDL_IOprintf(stream,
+                    "%s{\"ph\":\"E\",\"pid\":1,\"tid\":%llu,\"ts\":%.3f}",
+                    first ? "" : ",\n",
+                    threadId,
+                    event->counter * microsecondsPerTick);
+            }
+            first = false;
+        }
+    }
+    SDL_IOprintf(stream, "\n]}\n");
+
+    if (!SDL_CloseIO(stream)) {
+        SDL_Log("SDL_CloseIO failed %s: %s", fileName, SDL_GetError());
+        return false;
+    }
+    return true;
+}
+
+#endif
@@ -1,12 +1,25 @@
 #include <assert.h>
+#include <float.h>
 #include <SDL3/SDL.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #include <BatchRenderer.h>
+#include <CommandCapture.h>
 #define PINIM_GAME_MATH_IMPLEMENTATION
 #include <GameMath.h>
 #include <GraphicsDevice.h>
+#include <IndexBuffer.h>
 #include <ShaderProgram.h>
+#include <ShaderVariants.h>
 #include <Texture.h>
+#include <Trace.h>
 #include <VertexBuffer.h>
 
 void CreateOrthographicOffCenterMatrix(float left, float right, float bottom, float top,
@@ -31,18 +44,224 @@ void CreateOrthographicOffCenterMatrix(float left, float right, float bottom, fl
     SDL_memcpy(matrix, result, sizeof(float) * 16);
 }
 
+// quads are batched as four vertices and drawn through a shared index buffer, raw triangles
+// are drawn as they are. switching between the two flushes the batch.
+typedef enum BatchPrimitive {
+    BATCH_PRIMITIVE_QUADS,
+    BATCH_PRIMITIVE_TRIANGLES,
+} BatchPrimitive;
+
+// GL 3.3 guarantees 16 texture image units, which is also all the default shader declares
+#define BATCH_RENDERER_MAXIMUM_TEXTURE_SLOTS 16
+
+// deferred sort key, most significant first:
+// layer (8) | blend mode (4) | shader (12) | texture (16) | primitive (1) | depth (23)
+// shader and texture are ids into the deferred batch's own tables, assigned as they show up.
+// everything above the depth bits is draw state, commands with equal state share a draw.
+#define SORT_KEY_DEPTH_BITS 23
+#define SORT_KEY_PRIMITIVE_SHIFT 23
+#define SORT_KEY_TEXTURE_SHIFT 24
+#define SORT_KEY_SHADER_SHIFT 40
+#define SORT_KEY_BLEND_MODE_SHIFT 52
+#define SORT_KEY_LAYER_SHIFT 56
+#define SORT_KEY_MAXIMUM_TEXTURES (1 << 16)
+#define SORT_KEY_MAXIMUM_SHADERS (1 << 12)
+
+// just enough of a simd abstraction for BatchRenderer_BatchQuads, the widest the build allows
+#if defined(__AVX2__)
+#define SIMD_WIDTH 8
+typedef __m256 SimdFloat;
+#define Simd_Load(pointer) _mm256_loadu_ps(pointer)
+#define Simd_Store(pointer, value) _mm256_storeu_ps(pointer, value)
+#define Simd_Set1(value) _mm256_set1_ps(value)
+#define Simd_Add(a, b) _mm256_add_ps(a, b)
+#define Simd_Sub(a, b) _mm256_sub_ps(a, b)
+#define Simd_Mul(a, b) _mm256_mul_ps(a, b)
+#elif defined(__SSE2__) || defined(_M_X64)
+#define SIMD_WIDTH 4
+typedef __m128 SimdFloat;
+#define Simd_Load(pointer) _mm_loadu_ps(pointer)
+#define Simd_Store(pointer, value) _mm_storeu_ps(pointer, value)
+#define Simd_Set1(value) _mm_set1_ps(value)
+#define Simd_Add(a, b) _mm_add_ps(a, b)
+#define Simd_Sub(a, b) _mm_sub_ps(a, b)
+#define Simd_Mul(a, b) _mm_mul_ps(a, b)
+#elif defined(__ARM_NEON)
+#define SIMD_WIDTH 4
+typedef float32x4_t SimdFloat;
+#define Simd_Load(pointer) vld1q_f32(pointer)
+#define Simd_Store(pointer, value) vst1q_f32(pointer, value)
+#define Simd_Set1(value) vdupq_n_f32(value)
+#define Simd_Add(a, b) vaddq_f32(a, b)
+#define Simd_Sub(a, b) vsubq_f32(a, b)
+#define Simd_Mul(a, b) vmulq_f32(a, b)
+#else
+#define SIMD_WIDTH 1
+typedef float SimdFloat;
+#define Simd_Load(pointer) (*(pointer))
+#define Simd_Store(pointer, value) (*(pointer) = (value))
+#define Simd_Set1(value) (value)
+#define Simd_Add(a, b) ((a) + (b))
+#define Simd_Sub(a, b) ((a) - (b))
+#define Simd_Mul(a, b) ((a) * (b))
+#endif
+
+// sprites converted at a time by BatchRenderer_BatchQuads, a multiple of every SIMD_WIDTH
+#define BATCH_QUADS_CHUNK_SIZE 64
+
+// structure of arrays for a chunk of sprites, filled in per sprite and then transformed a
+// SIMD_WIDTH at a time
+typedef struct BatchQuadsChunk {
+    float x[BATCH_QUADS_CHUNK_SIZE];
+    float y[BATCH_QUADS_CHUNK_SIZE];
+    float rotation[BATCH_QUADS_CHUNK_SIZE];
+    float width[BATCH_QUADS_CHUNK_SIZE];
+    float height[BATCH_QUADS_CHUNK_SIZE];
+    float originX[BATCH_QUADS_CHUNK_SIZE];
+    float originY[BATCH_QUADS_CHUNK_SIZE];
+    // the source rectangle in texels
+    float sourceLeft[BATCH_QUADS_CHUNK_SIZE];
+    float sourceTop[BATCH_QUADS_CHUNK_SIZE];
+    float sourceRight[BATCH_QUADS_CHUNK_SIZE];
+    float sourceBottom[BATCH_QUADS_CHUNK_SIZE];
+    float u[4][BATCH_QUADS_CHUNK_SIZE];
+    float v[4][BATCH_QUADS_CHUNK_SIZE];
+    float positionX[4][BATCH_QUADS_CHUNK_SIZE];
+    float positionY[4][BATCH_QUADS_CHUNK_SIZE];
+    const SpriteDesc *sprites[BATCH_QUADS_CHUNK_SIZE];
+    // entries with a uvMode other than UVMODE_NORMAL, their uvs are fixed up one at a time
+    uint8_t uvModeEntries[BATCH_QUADS_CHUNK_SIZE];
+    uint32_t uvModeEntryCount;
+} BatchQuadsChunk;
+
+typedef struct BatchCommand {
+    uint64_t sortKey;
+    uint32_t firstVertex;
+    uint32_t vertexCount;
+} BatchCommand;
+
+// one Begin/End pair in a recording, commands are the segment's range of the recorder's
+// deferred commands
+typedef struct RecordedSegment {
+    Matrix4 transformMatrix;
+    uint32_t firstCommand;
+    uint32_t commandCount;
+    bool sorted;
+} RecordedSegment;
+
+// a run of static batch vertices drawn with one state, covering bounds in batch coordinates
+typedef struct StaticBatchRange {
+    BlendMode blendMode;
+    ShaderProgram *shaderProgram;
+    Texture *texture;
+    BatchPrimitive primitive;
+    uint32_t firstVertex;
+    uint32_t vertexCount;
+    float left, top, right, bottom;
+} StaticBatchRange;
+
+struct StaticBatch {
+    VertexBuffer *vertexBuffer;
+    VertexFormat vertexFormat;
+    StaticBatchRange *ranges;
+    uint32_t rangeCount;
+};
+
+// a recorded command on its way into a static batch
+typedef struct StaticBatchCommand {
+    BatchCommand *command;
+    RecordedSegment *segment;
+    // consecutive commands with the same draw state share a run, and only get reordered by cell
+    // within it
+    uint32_t run;
+    uint32_t order;
+    uint64_t cell;
+} StaticBatchCommand;
+
 struct BatchRenderer {
     GraphicsDevice *graphicsDevice;
+    // defaultShaderProgram is the textured variant, recorders share the owner's set
+    ShaderVariants *defaultShaderVariants;
     ShaderProgram *defaultShaderProgram;
+    ShaderProgram *defaultMultiTextureShaderProgram;
     ShaderProgram *currentShaderProgram;
     VertexBuffer *vertexBuffer;
+    IndexBuffer *quadIndexBuffer;
     Texture *texture;
+    Texture *textureSlots[BATCH_RENDERER_MAXIMUM_TEXTURE_SLOTS];
+    uint32_t textureSlotCount;
+    uint32_t currentTextureSlot;
+    uint32_t maximumTextureSlots;
     Matrix4 transformMatrix;
     BlendMode blendMode;
+    // the format in use, one of the two below depending on how the batch was started
+    VertexFormat vertexFormat;
+    VertexFormat standardVertexFormat;
+    VertexFormat multiTextureVertexFormat;
+    bool multiTexture;
+    BatchPrimitive primitive;
     uint32_t activeVertices;
     uint32_t maximumVertices;
-    Vertex2d *vertices;
+    // where batched vertices are written: memory from VertexBuffer_BeginWrite (null until the
+    // first vertex after a flush), or the deferred vertex pool
+    uint8_t *vertices;
     bool batchStarted;
+
+    bool deferred;
+    uint64_t deferredSortKey;
+    // false when the current state couldn't get ids, vertices recorded under it are dropped
+    bool deferredSortKeyValid;
+    uint8_t *deferredVertices;
+    uint32_t deferredVertexCapacity;
+    BatchCommand *deferredCommands;
+    uint32_t deferredCommandCount;
+    uint32_t deferredCommandCapacity;
+    BatchCommand *deferredSortScratch;
+    uint32_t deferredSortScratchCapacity;
+    Texture **deferredTextures;
+    uint32_t deferredTextureCount;
+    uint32_t deferredTextureCapacity;
+    ShaderProgram **deferredShaders;
+    uint32_t deferredShaderCount;
+    uint32_t deferredShaderCapacity;
+
+    // recorders have no gl resources of their own, they record into the deferred arrays above
+    // and the owner draws them in BatchRenderer_SubmitRecording
+    bool recorder;
+    BatchRenderer *owner;
+    RecordedSegment *segments;
+    uint32_t segmentCount;
+    uint32_t segmentCapacity;
+#ifdef PINIM_CAPTURE
+    // what a recorder captured since its last submit
+    CommandCaptureStream *captureStream;
+#endif
+
+    // viewport in batch coordinates is found by transforming sprites with transformMatrix, the
+    // bounds and the matrix's largest axis scale are captured in Begin
+    bool culling;
+    uint32_t culledSprites;
+    float cullLeft;
+    float cullTop;
+    float cullRight;
+    float cullBottom;
+    float cullScale;
+
+    // End leaves a regular batch's vertices undrawn, a Begin with the same state keeps adding to
+    // them and anything else draws them first (through the device's pending flush)
+    bool pending;
+
+    // projection times transformMatrix, rebuilt when either changes
+    Matrix4 projectionTransform;
+    Matrix4 projectionSourceTransform;
+    uint32_t projectionVersion;
+
+    // parameter handles of handleShaderProgram, looked up again when the shader changes
+    ShaderProgram *handleShaderProgram;
+    int32_t transformMatrixHandle;
+    int32_t projectionMatrixHandle;
+    int32_t textureSamplerHandle;
+    int32_t textureSamplerHandles[BATCH_RENDERER_MAXIMUM_TEXTURE_SLOTS];
 };
 
 char defaultVertexShaderSource[] =
@@ -55,15 +274,19 @@ char defaultVertexShaderSource[] =
     "out vec4 v_color;\n"
     "out vec2 v_texcoord;\n"
     // custom input from program
-    "uniform mat4 ProjectionMatrix;\n"
+    VIEW_CONSTANTS_GLSL
+    "uniform mat4 TransformMatrix;\n"
     //
     "void main()\n"
     "{\n"
-    "	gl_Position = ProjectionMatrix * position;\n"
+    "	gl_Position = ViewProjectionMatrix * TransformMatrix * position;\n"
     "	v_color = color;\n"
     "	v_texcoord = texcoord;\n"
     "}\n";
 
+// specialized by the BatchShaderFeature defines, in bit order
+static const char *defaultShaderFeatures[] = {"TEXTURE", "ALPHA_TEST", "PREMULTIPLY_ALPHA"};
+
 char defaultFragmentShaderSource[] =
     // input from vertex shader
     "#version 410\n"
@@ -71,16 +294,164 @@ char defaultFragmentShaderSource[] =
     "in vec2 v_texcoord;\n"
     "out vec4 fragColor;\n"
     // custom input from program
+    "#ifdef TEXTURE\n"
     "uniform sampler2D TextureSampler;\n"
+    "#endif\n"
     //
     "void main()\n"
     "{\n"
-    "	fragColor = texture2D(TextureSampler, v_texcoord) * v_color;\n"
+    "#ifdef TEXTURE\n"
+    "	vec4 textureColor = texture2D(TextureSampler, v_texcoord);\n"
+    "#ifdef PREMULTIPLY_ALPHA\n"
+    "	textureColor.rgb *= textureColor.a;\n"
+    "#endif\n"
+    "	fragColor = textureColor * v_color;\n"
+    "#else\n"
+    "	fragColor = v_color;\n"
+    "#endif\n"
+    "#ifdef ALPHA_TEST\n"
+    "	if (fragColor.a < 0.5) discard;\n"
+    "#endif\n"
     "}\n";
 
+char defaultMultiTextureVertexShaderSource[] =
+    // input from CPU
+    "#version 410\n"
+    "in vec4 position;\n"
+    "in vec4 color;\n"
+    "in vec2 texcoord;\n"
+    "in float textureIndex;\n"
+    // output to fragment shader
+    "out vec4 v_color;\n"
+    "out vec2 v_texcoord;\n"
+    "flat out int v_textureIndex;\n"
+    // custom input from program
+    VIEW_CONSTANTS_GLSL
+    "uniform mat4 TransformMatrix;\n"
+    //
+    "void main()\n"
+    "{\n"
+    "	gl_Position = ViewProjectionMatrix * TransformMatrix * position;\n"
+    "	v_color = color;\n"
+    "	v_texcoord = texcoord;\n"
+    "	v_textureIndex = int(textureIndex + 0.5);\n"
+    "}\n";
+
+// sampler arrays can only be indexed with dynamically uniform values, so the fragment shader
+// picks its sampler with a branch per slot. the source is generated for the slot count in use.
+static char *BatchRenderer_CreateMultiTextureFragmentSource(
+    uint32_t textureSlots, uint32_t *sourceLength) {
+    size_t capacity = 512 + textureSlots * 160;
+    char *source = SDL_malloc(capacity);
+    if (source == NULL) {
+        SDL_Log("SDL_malloc failed");
+        return NULL;
+    }
+
+    size_t length = SDL_snprintf(source,
+        capacity,
+        "#version 410\n"
+        "in vec4 v_color;\n"
+        "in vec2 v_texcoord;\n"
+        "flat in int v_textureIndex;\n"
+        "out vec4 fragColor;\n");
+
+    for (uint32_t slot = 0; slot < textureSlots; slot++) {
+        length += SDL_snprintf(
+            source + length, capacity - length, "uniform sampler2D TextureSampler%u;\n", slot);
+    }
+
+    length += SDL_snprintf(source + length,
+        capacity - length,
+        "void main()\n"
+        "{\n"
+        "	vec4 textureColor = vec4(1.0);\n");
+
+    for (uint32_t slot = 0; slot < textureSlots; slot++) {
+        length += SDL_snprintf(source + length,
+            capacity - length,
+            "	%sif (v_textureIndex == %u) textureColor = texture(TextureSampler%u, v_texcoord);\n",
+            (slot == 0) ? "" : "else ",
+            slot,
+            slot);
+    }
+
+    length += SDL_snprintf(source + length,
+        capacity - length,
+        "	fragColor = textureColor * v_color;\n"
+        "}\n");
+
+    *sourceLength = length;
+    return source;
+}
+
+static ShaderProgram *BatchRenderer_CreateShaderProgram(GraphicsDevice *graphicsDevice,
+    char *vertexShaderSource, uint32_t vertexShaderLength, char *fragmentShaderSource,
+    uint32_t fragmentShaderLength) {
+    VertexShader *vertexShader =
+        VertexShader_CreateFromBuffer(graphicsDevice, vertexShaderSource, vertexShaderLength);
+    if (vertexShader == NULL) {
+        SDL_Log("VertexShader_CreateFromBuffer failed");
+        return NULL;
+    }
+
+    FragmentShader *fragmentShader = FragmentShader_CreateFromBuffer(
+        graphicsDevice, fragmentShaderSource, fragmentShaderLength);
+    if (fragmentShader == NULL) {
+        SDL_Log("FragmentShader_CreateFromBuffer failed");
+        VertexShader_Destroy(vertexShader);
+        return NULL;
+    }
+
+    ShaderProgram *shaderProgram =
+        ShaderProgram_Create(graphicsDevice, vertexShader, fragmentShader);
+    if (shaderProgram == NULL) {
+        SDL_Log("ShaderProgram_Create failed");
+    }
+
+    FragmentShader_Destroy(fragmentShader);
+    VertexShader_Destroy(vertexShader);
+
+    return shaderProgram;
+}
+
+// forward declared, flushing lives further down with the rest of the regular batch
+static void BatchRenderer_FlushVertices(BatchRenderer *batchRenderer);
+
+#ifdef PINIM_CAPTURE
+// recorders capture into their own stream, a recording starts with the first Begin after a submit
+static CommandCaptureCall BatchRenderer_BeginCaptureCall(
+    BatchRenderer *batchRenderer, bool startable) {
+    if (batchRenderer->recorder) {
+        return CommandCapture_BeginRecorderCall(
+            batchRenderer->graphicsDevice, &batchRenderer->captureStream, startable);
+    }
+    return CommandCapture_BeginCall(batchRenderer->graphicsDevice);
+}
+
+#define BATCH_RENDERER_CAPTURE(batchRenderer, startable, record, ...)                             \
+    COMMAND_CAPTURE_RECORD(BatchRenderer_BeginCaptureCall(batchRenderer, startable),               \
+        record,                                                                                    \
+        batchRenderer,                                                                             \
+        ##__VA_ARGS__)
+#else
+#define BATCH_RENDERER_CAPTURE(batchRenderer, startable, record, ...) ((void)0)
+#endif
+
 BatchRenderer *BatchRenderer_Create(GraphicsDevice *graphicsDevice, uint32_t maximumTriangles) {
+    return BatchRenderer_CreateWithVertexFormat(
+        graphicsDevice, maximumTriangles, VERTEX_FORMAT_STANDARD);
+}
+
+BatchRenderer *BatchRenderer_CreateWithVertexFormat(
+    GraphicsDevice *graphicsDevice, uint32_t maximumTriangles, VertexFormat vertexFormat) {
     assert(graphicsDevice != NULL);
-    assert(maximumTriangles > 0);
+    assert(maximumTriangles > 1);
+
+    if (vertexFormat != VERTEX_FORMAT_STANDARD && vertexFormat != VERTEX_FORMAT_COMPACT) {
+        SDL_Log("Unsupported BatchRenderer VertexFormat: %d", vertexFormat);
+        return NULL;
+    }
 
     BatchRenderer *batchRenderer;
     batchRenderer = SDL_calloc(1, sizeof(BatchRenderer));
@@ -88,183 +459,1564 @@ BatchRenderer *BatchRenderer_Create(GraphicsDevice *graphicsDevice, uint32_t max
         SDL_Log("SDL_calloc failed");
         return NULL;
     }
-    batchRenderer->maximumVertices = maximumTriangles * 3;
+    batchRenderer->maximumVertices = maximumTriangles * 3;
+    batchRenderer->standardVertexFormat = vertexFormat;
+    batchRenderer->multiTextureVertexFormat = (vertexFormat == VERTEX_FORMAT_COMPACT)
+                                                  ? VERTEX_FORMAT_COMPACT_MULTITEXTURE
+                                                  : VERTEX_FORMAT_MULTITEXTURE;
+    uint32_t deviceTextureSlots = GraphicsDevice_GetMaximumTextureSlots(graphicsDevice);
+    batchRenderer->maximumTextureSlots =
+        SDL_min(deviceTextureSlots, BATCH_RENDERER_MAXIMUM_TEXTURE_SLOTS);
+
+    batchRenderer->defaultShaderVariants = ShaderVariants_CreateFromBuffer(graphicsDevice,
+        defaultVertexShaderSource,
+        sizeof(defaultVertexShaderSource),
+        defaultFragmentShaderSource,
+        sizeof(defaultFragmentShaderSource),
+        NULL,
+        defaultShaderFeatures,
+        SDL_arraysize(defaultShaderFeatures));
+    if (batchRenderer->defaultShaderVariants == NULL) {
+        SDL_Log("ShaderVariants_CreateFromBuffer failed");
+        SDL_free(batchRenderer);
+        return NULL;
+    }
+
+    batchRenderer->defaultShaderProgram = ShaderVariants_GetProgram(
+        batchRenderer->defaultShaderVariants, BATCH_SHADER_FEATURE_TEXTURE);
+    if (batchRenderer->defaultShaderProgram == NULL) {
+        SDL_Log("ShaderVariants_GetProgram failed");
+        ShaderVariants_Destroy(batchRenderer->defaultShaderVariants);
+        SDL_free(batchRenderer);
+        return NULL;
+    }
+
+    uint32_t multiTextureFragmentShaderLength;
+    char *multiTextureFragmentShaderSource = BatchRenderer_CreateMultiTextureFragmentSource(
+        batchRenderer->maximumTextureSlots, &multiTextureFragmentShaderLength);
+    if (multiTextureFragmentShaderSource == NULL) {
+        SDL_Log("BatchRenderer_CreateMultiTextureFragmentSource failed");
+        ShaderVariants_Destroy(batchRenderer->defaultShaderVariants);
+        SDL_free(batchRenderer);
+        return NULL;
+    }
+
+    batchRenderer->defaultMultiTextureShaderProgram =
+        BatchRenderer_CreateShaderProgram(graphicsDevice,
+            defaultMultiTextureVertexShaderSource,
+            sizeof(defaultMultiTextureVertexShaderSource),
+            multiTextureFragmentShaderSource,
+            multiTextureFragmentShaderLength);
+    SDL_free(multiTextureFragmentShaderSource);
+    if (batchRenderer->defaultMultiTextureShaderProgram == NULL) {
+        SDL_Log("BatchRenderer_CreateShaderProgram failed");
+        ShaderVariants_Destroy(batchRenderer->defaultShaderVariants);
+        SDL_free(batchRenderer);
+        return NULL;
+    }
+
+    // sized for the largest vertex format the batch can switch to
+    batchRenderer->vertexBuffer = VertexBuffer_Create(graphicsDevice,
+        VERTEX_BUFFER_DYNAMIC,
+        batchRenderer->multiTextureVertexFormat,
+        batchRenderer->maximumVertices);
+    if (batchRenderer->vertexBuffer == NULL) {
+        SDL_Log("VertexBuffer_Create failed");
+        ShaderProgram_Destroy(batchRenderer->defaultMultiTextureShaderProgram);
+        ShaderVariants_Destroy(batchRenderer->defaultShaderVariants);
+        SDL_free(batchRenderer);
+        return NULL;
+    }
+
+    // every quad is (0, 1, 2) (0, 2, 3) offset by its first vertex, so the pattern never changes
+    uint32_t maximumQuads = batchRenderer->maximumVertices / 4;
+    uint32_t *quadIndices = SDL_malloc(maximumQuads * 6 * sizeof(uint32_t));
+    if (quadIndices == NULL) {
+        SDL_Log("SDL_malloc failed");
+        VertexBuffer_Destroy(batchRenderer->vertexBuffer);
+        ShaderProgram_Destroy(batchRenderer->defaultMultiTextureShaderProgram);
+        ShaderVariants_Destroy(batchRenderer->defaultShaderVariants);
+        SDL_free(batchRenderer);
+        return NULL;
+    }
+
+    for (uint32_t quad = 0; quad < maximumQuads; quad++) {
+        uint32_t *index = &quadIndices[quad * 6];
+        uint32_t firstVertex = quad * 4;
+        index[0] = firstVertex;
+        index[1] = firstVertex + 1;
+        index[2] = firstVertex + 2;
+        index[3] = firstVertex;
+        index[4] = firstVertex + 2;
+        index[5] = firstVertex + 3;
+    }
+
+    batchRenderer->quadIndexBuffer =
+        IndexBuffer_Create(graphicsDevice, INDEX_BUFFER_STATIC, maximumQuads * 6);
+    if (batchRenderer->quadIndexBuffer == NULL) {
+        SDL_Log("IndexBuffer_Create failed");
+        SDL_free(quadIndices);
+        VertexBuffer_Destroy(batchRenderer->vertexBuffer);
+        ShaderProgram_Destroy(batchRenderer->defaultMultiTextureShaderProgram);
+        ShaderVariants_Destroy(batchRenderer->defaultShaderVariants);
+        SDL_free(batchRenderer);
+        return NULL;
+    }
+
+    IndexBuffer_SetIndexData(batchRenderer->quadIndexBuffer, quadIndices, maximumQuads * 6);
+    SDL_free(quadIndices);
+
+    // fall back to glBufferSubData if the driver won't map, SetUploadStrategy logs why
+    VertexBuffer_SetUploadStrategy(
+        batchRenderer->vertexBuffer, VERTEX_BUFFER_UPLOAD_MAP_UNSYNCHRONIZED);
+
+    batchRenderer->graphicsDevice = graphicsDevice;
+
+    return batchRenderer;
+}
+
+BatchRenderer *BatchRenderer_CreateRecorder(BatchRenderer *batchRenderer) {
+    assert(batchRenderer != NULL);
+    assert(!batchRenderer->recorder);
+
+    BatchRenderer *recorder = SDL_calloc(1, sizeof(BatchRenderer));
+    if (recorder == NULL) {
+        SDL_Log("SDL_calloc failed");
+        return NULL;
+    }
+
+    recorder->recorder = true;
+    recorder->owner = batchRenderer;
+    recorder->graphicsDevice = batchRenderer->graphicsDevice;
+    recorder->defaultShaderVariants = batchRenderer->defaultShaderVariants;
+    recorder->defaultShaderProgram = batchRenderer->defaultShaderProgram;
+    recorder->maximumVertices = batchRenderer->maximumVertices;
+    recorder->standardVertexFormat = batchRenderer->standardVertexFormat;
+    recorder->multiTextureVertexFormat = batchRenderer->multiTextureVertexFormat;
+    recorder->vertexFormat = batchRenderer->standardVertexFormat;
+
+    return recorder;
+}
+
+void BatchRenderer_Destroy(BatchRenderer *batchRenderer) {
+    assert(batchRenderer != NULL);
+
+    if (!batchRenderer->recorder) {
+        BatchRenderer_FlushVertices(batchRenderer);
+        COMMAND_CAPTURE_FORGET_OBJECT(batchRenderer->graphicsDevice, batchRenderer);
+    }
+
+#ifdef PINIM_CAPTURE
+    CommandCapture_DestroyStream(batchRenderer->captureStream);
+#endif
+    SDL_free(batchRenderer->segments);
+    SDL_free(batchRenderer->deferredShaders);
+    SDL_free(batchRenderer->deferredTextures);
+    SDL_free(batchRenderer->deferredSortScratch);
+    SDL_free(batchRenderer->deferredCommands);
+    SDL_free(batchRenderer->deferredVertices);
+
+    if (batchRenderer->recorder) {
+        SDL_free(batchRenderer);
+        return;
+    }
+
+    IndexBuffer_Destroy(batchRenderer->quadIndexBuffer);
+    VertexBuffer_Destroy(batchRenderer->vertexBuffer);
+    ShaderProgram_Destroy(batchRenderer->defaultMultiTextureShaderProgram);
+    ShaderVariants_Destroy(batchRenderer->defaultShaderVariants);
+    SDL_free(batchRenderer);
+}
+
+uint32_t BatchRenderer_GetMaximumTriangles(BatchRenderer *batchRenderer) {
+    assert(batchRenderer != NULL);
+
+    return batchRenderer->maximumVertices / 3;
+}
+
+VertexFormat BatchRenderer_GetVertexFormat(BatchRenderer *batchRenderer) {
+    assert(batchRenderer != NULL);
+
+    return batchRenderer->standardVertexFormat;
+}
+
+static void BatchRenderer_UpdateCullBounds(BatchRenderer *batchRenderer) {
+    if (!batchRenderer->culling) {
+        return;
+    }
+
+    Rectangle viewport;
+    GraphicsDevice_GetViewport(batchRenderer->graphicsDevice, &viewport);
+    batchRenderer->cullLeft = (float)viewport.x;
+    batchRenderer->cullTop = (float)viewport.y;
+    batchRenderer->cullRight = (float)(viewport.x + viewport.width);
+    batchRenderer->cullBottom = (float)(viewport.y + viewport.height);
+
+    float *m = batchRenderer->transformMatrix;
+    float scaleX = SDL_sqrtf(m[0] * m[0] + m[1] * m[1]);
+    float scaleY = SDL_sqrtf(m[4] * m[4] + m[5] * m[5]);
+    batchRenderer->cullScale = SDL_max(scaleX, scaleY);
+}
+
+// true, and counted, when a circle around x, y is entirely outside of the viewport
+static inline bool BatchRenderer_IsCulled(
+    BatchRenderer *batchRenderer, float x, float y, float radius) {
+    float *m = batchRenderer->transformMatrix;
+    float viewX = m[0] * x + m[4] * y + m[12];
+    float viewY = m[1] * x + m[5] * y + m[13];
+    float viewRadius = radius * batchRenderer->cullScale;
+
+    if (viewX + viewRadius < batchRenderer->cullLeft ||
+        viewX - viewRadius > batchRenderer->cullRight ||
+        viewY + viewRadius < batchRenderer->cullTop ||
+        viewY - viewRadius > batchRenderer->cullBottom) {
+        batchRenderer->culledSprites++;
+        return true;
+    }
+
+    return false;
+}
+
+// radius of the circle around the origin point that holds every corner, whatever the rotation
+static inline float BatchRenderer_GetCullRadius(
+    float width, float height, float originX, float originY) {
+    float extentX = SDL_max(SDL_fabsf(originX), SDL_fabsf(1 - originX)) * width;
+    float extentY = SDL_max(SDL_fabsf(originY), SDL_fabsf(1 - originY)) * height;
+    return SDL_sqrtf(extentX * extentX + extentY * extentY);
+}
+
+// picks the pending vertices back up when the new batch would draw them the same way, otherwise
+// draws them so the new batch starts empty
+static bool BatchRenderer_ResumePending(BatchRenderer *batchRenderer, BlendMode blendMode,
+    Texture *texture, ShaderProgram *shaderProgram, Matrix4 transformMatrix, bool multiTexture) {
+    if (!batchRenderer->pending) {
+        return false;
+    }
+
+    if (batchRenderer->blendMode != blendMode || batchRenderer->texture != texture ||
+        batchRenderer->currentShaderProgram != shaderProgram ||
+        batchRenderer->multiTexture != multiTexture ||
+        SDL_memcmp(batchRenderer->transformMatrix, transformMatrix, sizeof(Matrix4)) != 0) {
+        BatchRenderer_FlushVertices(batchRenderer);
+        return false;
+    }
+
+    batchRenderer->pending = false;
+    GraphicsDevice_CancelPendingFlush(batchRenderer->graphicsDevice, batchRenderer);
+
+    // the held back vertices are lost if the buffer can't be mapped again, start empty then
+    batchRenderer->vertices = VertexBuffer_ResumeWrite(batchRenderer->vertexBuffer);
+    if (batchRenderer->vertices == NULL) {
+        return false;
+    }
+
+    batchRenderer->batchStarted = true;
+    BatchRenderer_UpdateCullBounds(batchRenderer);
+    return true;
+}
+
+// forward declared, the deferred helpers live further down with the rest of deferred batching
+static bool BatchRenderer_Grow(
+    void **array, uint32_t *capacity, uint32_t required, size_t elementSize);
+
+// recorders keep everything from every Begin/End pair until the recording is submitted, so
+// unlike BeginDeferred nothing is reset here
+static void BatchRenderer_BeginSegment(
+    BatchRenderer *batchRenderer, Matrix4 transformMatrix, bool sorted) {
+    if (!BatchRenderer_Grow((void **)&batchRenderer->segments,
+            &batchRenderer->segmentCapacity,
+            batchRenderer->segmentCount + 1,
+            sizeof(RecordedSegment))) {
+        return;
+    }
+
+    RecordedSegment *segment = &batchRenderer->segments[batchRenderer->segmentCount++];
+    Matrix4_Copy(transformMatrix, segment->transformMatrix);
+    segment->firstCommand = batchRenderer->deferredCommandCount;
+    segment->commandCount = 0;
+    segment->sorted = sorted;
+
+    batchRenderer->vertices = batchRenderer->deferredVertices;
+    batchRenderer->batchStarted = true;
+    batchRenderer->deferred = true;
+    batchRenderer->primitive = BATCH_PRIMITIVE_QUADS;
+    batchRenderer->vertexFormat = batchRenderer->standardVertexFormat;
+    batchRenderer->multiTexture = false;
+    Matrix4_Copy(transformMatrix, batchRenderer->transformMatrix);
+}
+
+void BatchRenderer_Begin(BatchRenderer *batchRenderer, BlendMode blendMode, Texture *texture,
+    ShaderProgram *shaderProgram, Matrix4 transformMatrix) {
+    assert(batchRenderer != NULL);
+    BATCH_RENDERER_CAPTURE(batchRenderer,
+        batchRenderer->segmentCount == 0 && !batchRenderer->batchStarted,
+        CommandCapture_RecordBatchBegin,
+        blendMode,
+        texture,
+        shaderProgram,
+        transformMatrix);
+
+    if (batchRenderer->batchStarted) {
+        SDL_Log("BatchRenderer_Begin called on already started BatchRenderer");
+        return;
+    }
+
+    if (batchRenderer->recorder) {
+        BatchRenderer_BeginSegment(batchRenderer, transformMatrix, false);
+        BatchRenderer_SetSortState(batchRenderer, 0, blendMode, texture, shaderProgram, 0);
+        return;
+    }
+
+    if (BatchRenderer_ResumePending(batchRenderer,
+            blendMode,
+            texture,
+            (shaderProgram != NULL) ? shaderProgram : batchRenderer->defaultShaderProgram,
+            transformMatrix,
+            false)) {
+        return;
+    }
+
+    batchRenderer->activeVertices = 0;
+    batchRenderer->vertices = NULL;
+    batchRenderer->batchStarted = true;
+    batchRenderer->deferred = false;
+    batchRenderer->primitive = BATCH_PRIMITIVE_QUADS;
+    batchRenderer->vertexFormat = batchRenderer->standardVertexFormat;
+    batchRenderer->multiTexture = false;
+    batchRenderer->blendMode = blendMode;
+    batchRenderer->texture = texture;
+    batchRenderer->textureSlotCount = 0;
+    batchRenderer->currentTextureSlot = 0;
+    batchRenderer->currentShaderProgram =
+        (shaderProgram != NULL) ? shaderProgram : batchRenderer->defaultShaderProgram;
+
+    Matrix4_Copy(transformMatrix, batchRenderer->transformMatrix);
+    BatchRenderer_UpdateCullBounds(batchRenderer);
+}
+
+void BatchRenderer_BeginMultiTexture(BatchRenderer *batchRenderer, BlendMode blendMode,
+    ShaderProgram *shaderProgram, Matrix4 transformMatrix) {
+    assert(batchRenderer != NULL);
+    BATCH_RENDERER_CAPTURE(batchRenderer,
+        false,
+        CommandCapture_RecordBatchBeginMultiTexture,
+        blendMode,
+        shaderProgram,
+        transformMatrix);
+
+    if (batchRenderer->batchStarted) {
+        SDL_Log("BatchRenderer_BeginMultiTexture called on already started BatchRenderer");
+        return;
+    }
+
+    if (batchRenderer->recorder) {
+        SDL_Log("BatchRenderer_BeginMultiTexture is not supported by recorders");
+        return;
+    }
+
+    // the texture slots carry over, so textures keep the slots their vertices reference
+    if (BatchRenderer_ResumePending(batchRenderer,
+            blendMode,
+            batchRenderer->texture,
+            (shaderProgram != NULL) ? shaderProgram
+                                    : batchRenderer->defaultMultiTextureShaderProgram,
+            transformMatrix,
+            true)) {
+        return;
+    }
+
+    batchRenderer->activeVertices = 0;
+    batchRenderer->vertices = NULL;
+    batchRenderer->batchStarted = true;
+    batchRenderer->deferred = false;
+    batchRenderer->primitive = BATCH_PRIMITIVE_QUADS;
+    batchRenderer->vertexFormat = batchRenderer->multiTextureVertexFormat;
+    batchRenderer->multiTexture = true;
+    batchRenderer->blendMode = blendMode;
+    batchRenderer->texture = NULL;
+    batchRenderer->textureSlotCount = 0;
+    batchRenderer->currentTextureSlot = 0;
+    batchRenderer->currentShaderProgram =
+        (shaderProgram != NULL) ? shaderProgram : batchRenderer->defaultMultiTextureShaderProgram;
+
+    Matrix4_Copy(transformMatrix, batchRenderer->transformMatrix);
+    BatchRenderer_UpdateCullBounds(batchRenderer);
+}
+
+void BatchRenderer_SetTexture(BatchRenderer *batchRenderer, Texture *texture) {
+    assert(batchRenderer != NULL);
+    assert(texture != NULL);
+    BATCH_RENDERER_CAPTURE(batchRenderer, false, CommandCapture_RecordBatchSetTexture, texture);
+
+    if (!batchRenderer->batchStarted) {
+        SDL_Log("BatchRenderer_SetTexture called on unstarted batch");
+        return;
+    }
+
+    if (batchRenderer->deferred) {
+        BatchRenderer_SetSortState(batchRenderer,
+            batchRenderer->deferredSortKey >> SORT_KEY_LAYER_SHIFT,
+            batchRenderer->blendMode,
+            texture,
+            batchRenderer->currentShaderProgram,
+            (batchRenderer->deferredSortKey & ((1 << SORT_KEY_DEPTH_BITS) - 1)) /
+                (float)((1 << SORT_KEY_DEPTH_BITS) - 1));
+        return;
+    }
+
+    if (!batchRenderer->multiTexture) {
+        if (batchRenderer->texture != texture) {
+            BatchRenderer_Flush(batchRenderer);
+            batchRenderer->texture = texture;
+        }
+        return;
+    }
+
+    batchRenderer->texture = texture;
+
+    for (uint32_t slot = 0; slot < batchRenderer->textureSlotCount; slot++) {
+        if (batchRenderer->textureSlots[slot] == texture) {
+            batchRenderer->currentTextureSlot = slot;
+            return;
+        }
+    }
+
+    // every slot is taken by vertices already in the batch, draw them and start over
+    if (batchRenderer->textureSlotCount == batchRenderer->maximumTextureSlots) {
+        BatchRenderer_Flush(batchRenderer);
+        batchRenderer->textureSlotCount = 0;
+    }
+
+    batchRenderer->currentTextureSlot = batchRenderer->textureSlotCount;
+    batchRenderer->textureSlots[batchRenderer->textureSlotCount++] = texture;
+}
+
+uint32_t BatchRenderer_GetMaximumTextureSlots(BatchRenderer *batchRenderer) {
+    assert(batchRenderer != NULL);
+
+    return batchRenderer->maximumTextureSlots;
+}
+
+ShaderProgram *BatchRenderer_GetDefaultShaderProgram(
+    BatchRenderer *batchRenderer, uint32_t features) {
+    assert(batchRenderer != NULL);
+
+    return ShaderVariants_GetProgram(batchRenderer->defaultShaderVariants, features);
+}
+
+bool BatchRenderer_SetUploadStrategy(
+    BatchRenderer *batchRenderer, VertexBufferUploadStrategy uploadStrategy) {
+    assert(batchRenderer != NULL);
+    BATCH_RENDERER_CAPTURE(
+        batchRenderer, false, CommandCapture_RecordBatchSetUploadStrategy, uploadStrategy);
+
+    if (batchRenderer->batchStarted || batchRenderer->recorder) {
+        SDL_Log("BatchRenderer_SetUploadStrategy called on started batch or recorder");
+        return false;
+    }
+
+    BatchRenderer_FlushVertices(batchRenderer);
+
+    return VertexBuffer_SetUploadStrategy(batchRenderer->vertexBuffer, uploadStrategy);
+}
+
+VertexBufferUploadStrategy BatchRenderer_GetUploadStrategy(BatchRenderer *batchRenderer) {
+    assert(batchRenderer != NULL);
+
+    if (batchRenderer->recorder) {
+        return BatchRenderer_GetUploadStrategy(batchRenderer->owner);
+    }
+
+    return VertexBuffer_GetUploadStrategy(batchRenderer->vertexBuffer);
+}
+
+// points vertices at the vertex buffer memory the next flush draws from
+static bool BatchRenderer_BeginVertices(BatchRenderer *batchRenderer) {
+    if (batchRenderer->vertices == NULL) {
+        batchRenderer->vertices = VertexBuffer_BeginWrite(batchRenderer->vertexBuffer,
+            batchRenderer->vertexFormat,
+            batchRenderer->maximumVertices);
+    }
+
+    return batchRenderer->vertices != NULL;
+}
+
+// makes room for at least required elements, doubling so recording stays amortized O(1)
+static bool BatchRenderer_Grow(
+    void **array, uint32_t *capacity, uint32_t required, size_t elementSize) {
+    if (required <= *capacity) {
+        return true;
+    }
+
+    uint32_t newCapacity = (*capacity > 0) ? *capacity : 256;
+    while (newCapacity < required) {
+        newCapacity *= 2;
+    }
+
+    void *newArray = SDL_realloc(*array, newCapacity * elementSize);
+    if (newArray == NULL) {
+        SDL_Log("SDL_realloc failed");
+        return false;
+    }
+
+    *array = newArray;
+    *capacity = newCapacity;
+    return true;
+}
+
+// returns false when the table is full (the id has to fit its sort key bits) or can't grow
+static bool BatchRenderer_FindDeferredTexture(
+    BatchRenderer *batchRenderer, Texture *texture, uint32_t *textureId) {
+    for (uint32_t id = 0; id < batchRenderer->deferredTextureCount; id++) {
+        if (batchRenderer->deferredTextures[id] == texture) {
+            *textureId = id;
+            return true;
+        }
+    }
+
+    if (batchRenderer->deferredTextureCount == SORT_KEY_MAXIMUM_TEXTURES ||
+        !BatchRenderer_Grow((void **)&batchRenderer->deferredTextures,
+            &batchRenderer->deferredTextureCapacity,
+            batchRenderer->deferredTextureCount + 1,
+            sizeof(Texture *))) {
+        return false;
+    }
+
+    batchRenderer->deferredTextures[batchRenderer->deferredTextureCount] = texture;
+    *textureId = batchRenderer->deferredTextureCount++;
+    return true;
+}
+
+static bool BatchRenderer_FindDeferredShader(
+    BatchRenderer *batchRenderer, ShaderProgram *shaderProgram, uint32_t *shaderId) {
+    for (uint32_t id = 0; id < batchRenderer->deferredShaderCount; id++) {
+        if (batchRenderer->deferredShaders[id] == shaderProgram) {
+            *shaderId = id;
+            return true;
+        }
+    }
+
+    if (batchRenderer->deferredShaderCount == SORT_KEY_MAXIMUM_SHADERS ||
+        !BatchRenderer_Grow((void **)&batchRenderer->deferredShaders,
+            &batchRenderer->deferredShaderCapacity,
+            batchRenderer->deferredShaderCount + 1,
+            sizeof(ShaderProgram *))) {
+        return false;
+    }
+
+    batchRenderer->deferredShaders[batchRenderer->deferredShaderCount] = shaderProgram;
+    *shaderId = batchRenderer->deferredShaderCount++;
+    return true;
+}
+
+static void BatchRenderer_DrawDeferred(BatchRenderer *batchRenderer);
+
+void BatchRenderer_BeginDeferred(BatchRenderer *batchRenderer, Matrix4 transformMatrix) {
+    assert(batchRenderer != NULL);
+    BATCH_RENDERER_CAPTURE(batchRenderer,
+        batchRenderer->segmentCount == 0 && !batchRenderer->batchStarted,
+        CommandCapture_RecordBatchBeginDeferred,
+        transformMatrix);
+
+    if (batchRenderer->batchStarted) {
+        SDL_Log("BatchRenderer_BeginDeferred called on already started BatchRenderer");
+        return;
+    }
+
+    if (batchRenderer->recorder) {
+        BatchRenderer_BeginSegment(batchRenderer, transformMatrix, true);
+        BatchRenderer_SetSortState(
+            batchRenderer, 0, BLEND_MODE_PREMULTIPLIED_ALPHA, NULL, NULL, 0);
+        return;
+    }
+
+    BatchRenderer_FlushVertices(batchRenderer);
+
+    batchRenderer->activeVertices = 0;
+    batchRenderer->vertices = batchRenderer->deferredVertices;
+    batchRenderer->batchStarted = true;
+    batchRenderer->deferred = true;
+    batchRenderer->deferredCommandCount = 0;
+    batchRenderer->deferredTextureCount = 0;
+    batchRenderer->deferredShaderCount = 0;
+    batchRenderer->primitive = BATCH_PRIMITIVE_QUADS;
+    batchRenderer->vertexFormat = batchRenderer->standardVertexFormat;
+    batchRenderer->multiTexture = false;
+    batchRenderer->textureSlotCount = 0;
+    batchRenderer->currentTextureSlot = 0;
+
+    Matrix4_Copy(transformMatrix, batchRenderer->transformMatrix);
+    BatchRenderer_UpdateCullBounds(batchRenderer);
+
+    BatchRenderer_SetSortState(batchRenderer, 0, BLEND_MODE_PREMULTIPLIED_ALPHA, NULL, NULL, 0);
+}
+
+void BatchRenderer_SetSortState(BatchRenderer *batchRenderer, uint8_t layer, BlendMode blendMode,
+    Texture *texture, ShaderProgram *shaderProgram, float depth) {
+    assert(batchRenderer != NULL);
+    assert(blendMode >= BLEND_MODE_NONE && blendMode < 16);
+    BATCH_RENDERER_CAPTURE(batchRenderer,
+        false,
+        CommandCapture_RecordBatchSetSortState,
+        layer,
+        blendMode,
+        texture,
+        shaderProgram,
+        depth);
+
+    if (!batchRenderer->batchStarted || !batchRenderer->deferred) {
+        SDL_Log("BatchRenderer_SetSortState called outside of a deferred batch");
+        return;
+    }
+
+    if (shaderProgram == NULL) {
+        shaderProgram = batchRenderer->defaultShaderProgram;
+    }
+
+    uint32_t textureId;
+    uint32_t shaderId;
+    bool found = BatchRenderer_FindDeferredTexture(batchRenderer, texture, &textureId) &&
+                 BatchRenderer_FindDeferredShader(batchRenderer, shaderProgram, &shaderId);
+
+    // the id tables are full, draw what was recorded so far and start them over. a recorder's
+    // ids are used by every segment until it is submitted, so it can't
+    if (!found && !batchRenderer->recorder) {
+        BatchRenderer_DrawDeferred(batchRenderer);
+        batchRenderer->deferredTextureCount = 0;
+        batchRenderer->deferredShaderCount = 0;
+        found = BatchRenderer_FindDeferredTexture(batchRenderer, texture, &textureId) &&
+                BatchRenderer_FindDeferredShader(batchRenderer, shaderProgram, &shaderId);
+    }
+
+    batchRenderer->blendMode = blendMode;
+    batchRenderer->texture = texture;
+    batchRenderer->currentShaderProgram = shaderProgram;
+    batchRenderer->deferredSortKeyValid = found;
+
+    if (!found) {
+        SDL_Log("Couldn't add state to deferred batch, its vertices are dropped");
+        return;
+    }
+
+    uint64_t depthBits =
+        (uint64_t)(SDL_max(0.0f, SDL_min(depth, 1.0f)) * ((1 << SORT_KEY_DEPTH_BITS) - 1));
+
+    batchRenderer->deferredSortKey = ((uint64_t)layer << SORT_KEY_LAYER_SHIFT) |
+                                     ((uint64_t)blendMode << SORT_KEY_BLEND_MODE_SHIFT) |
+                                     ((uint64_t)shaderId << SORT_KEY_SHADER_SHIFT) |
+                                     ((uint64_t)textureId << SORT_KEY_TEXTURE_SHIFT) | depthBits;
+}
+
+// records the vertices just written to the deferred pool under the current sort key
+static void BatchRenderer_RecordCommand(BatchRenderer *batchRenderer, uint32_t vertexCount) {
+    uint32_t required = batchRenderer->deferredCommandCount + 1;
+    if (!batchRenderer->deferredSortKeyValid ||
+        !BatchRenderer_Grow((void **)&batchRenderer->deferredCommands,
+            &batchRenderer->deferredCommandCapacity,
+            required,
+            sizeof(BatchCommand)) ||
+        !BatchRenderer_Grow((void **)&batchRenderer->deferredSortScratch,
+            &batchRenderer->deferredSortScratchCapacity,
+            required,
+            sizeof(BatchCommand))) {
+        batchRenderer->activeVertices -= vertexCount;
+        return;
+    }
+
+    BatchCommand *command = &batchRenderer->deferredCommands[batchRenderer->deferredCommandCount++];
+    command->sortKey = batchRenderer->deferredSortKey |
+                       ((uint64_t)batchRenderer->primitive << SORT_KEY_PRIMITIVE_SHIFT);
+    command->firstVertex = batchRenderer->activeVertices - vertexCount;
+    command->vertexCount = vertexCount;
+}
+
+// stable LSD radix sort, one byte per pass. passes where every key has the same byte are
+// skipped, which is most of them when a frame only uses a few layers and states.
+static BatchCommand *BatchRenderer_SortCommands(
+    BatchCommand *commands, BatchCommand *scratch, uint32_t commandCount) {
+    for (uint32_t shift = 0; shift < 64; shift += 8) {
+        uint32_t histogram[256] = {0};
+        for (uint32_t index = 0; index < commandCount; index++) {
+            histogram[(commands[index].sortKey >> shift) & 0xFF]++;
+        }
+
+        if (histogram[(commands[0].sortKey >> shift) & 0xFF] == commandCount) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t bucket = 0; bucket < 256; bucket++) {
+            uint32_t count = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += count;
+        }
+
+        for (uint32_t index = 0; index < commandCount; index++) {
+            scratch[histogram[(commands[index].sortKey >> shift) & 0xFF]++] = commands[index];
+        }
+
+        BatchCommand *swap = commands;
+        commands = scratch;
+        scratch = swap;
+    }
+
+    return commands;
+}
+
+static void BatchRenderer_ApplyDrawState(BatchRenderer *batchRenderer);
+
+// draws commands in order through the regular batch, flushing only when the draw state changes or
+// the vertex buffer is full. source is the batch (or recorder) the commands were recorded in.
+static void BatchRenderer_DrawCommands(BatchRenderer *batchRenderer, BatchRenderer *source,
+    BatchCommand *commands, uint32_t commandCount) {
+    uint32_t vertexSize = VertexBuffer_GetVertexSize(batchRenderer->vertexFormat);
+    uint64_t currentState = UINT64_MAX;
+
+    batchRenderer->vertices = NULL;
+    batchRenderer->activeVertices = 0;
+
+    for (uint32_t index = 0; index < commandCount; index++) {
+        BatchCommand *command = &commands[index];
+        uint64_t state = command->sortKey >> SORT_KEY_DEPTH_BITS;
+
+        if (state != currentState) {
+            BatchRenderer_FlushVertices(batchRenderer);
+
+            uint64_t key = command->sortKey;
+            batchRenderer->blendMode = (BlendMode)((key >> SORT_KEY_BLEND_MODE_SHIFT) & 0xF);
+            batchRenderer->currentShaderProgram =
+                source->deferredShaders[(key >> SORT_KEY_SHADER_SHIFT) & 0xFFF];
+            batchRenderer->texture =
+                source->deferredTextures[(key >> SORT_KEY_TEXTURE_SHIFT) & 0xFFFF];
+            batchRenderer->primitive = (BatchPrimitive)((key >> SORT_KEY_PRIMITIVE_SHIFT) & 1);
+            currentState = state;
+        }
+
+        if (batchRenderer->activeVertices + command->vertexCount > batchRenderer->maximumVertices) {
+            BatchRenderer_FlushVertices(batchRenderer);
+        }
+
+        if (!BatchRenderer_BeginVertices(batchRenderer)) {
+            break;
+        }
+
+        SDL_memcpy(batchRenderer->vertices + batchRenderer->activeVertices * vertexSize,
+            source->deferredVertices + command->firstVertex * vertexSize,
+            command->vertexCount * vertexSize);
+        batchRenderer->activeVertices += command->vertexCount;
+    }
+
+    BatchRenderer_FlushVertices(batchRenderer);
+}
+
+// sorts everything recorded so far and draws it
+static void BatchRenderer_DrawDeferred(BatchRenderer *batchRenderer) {
+    uint32_t commandCount = batchRenderer->deferredCommandCount;
+    if (commandCount == 0) {
+        return;
+    }
+
+    BatchCommand *commands = BatchRenderer_SortCommands(
+        batchRenderer->deferredCommands, batchRenderer->deferredSortScratch, commandCount);
+
+    BatchRenderer_DrawCommands(batchRenderer, batchRenderer, commands, commandCount);
+
+    batchRenderer->vertices = batchRenderer->deferredVertices;
+    batchRenderer->activeVertices = 0;
+    batchRenderer->deferredCommandCount = 0;
+}
+
+void BatchRenderer_SubmitRecording(BatchRenderer *batchRenderer, BatchRenderer *recorder) {
+    assert(batchRenderer != NULL);
+    assert(recorder != NULL);
+    assert(!batchRenderer->recorder);
+    assert(recorder->recorder && recorder->owner == batchRenderer);
+    COMMAND_CAPTURE_CALL(batchRenderer->graphicsDevice,
+        CommandCapture_RecordBatchSubmitRecording,
+        batchRenderer,
+        recorder->captureStream,
+        recorder->segmentCount == 0);
+
+    if (batchRenderer->batchStarted || recorder->batchStarted) {
+        SDL_Log("BatchRenderer_SubmitRecording called during a batch or an unfinished recording");
+        return;
+    }
+
+    BatchRenderer_FlushVertices(batchRenderer);
+
+    batchRenderer->batchStarted = true;
+    batchRenderer->deferred = false;
+    batchRenderer->multiTexture = false;
+    batchRenderer->vertexFormat = batchRenderer->standardVertexFormat;
+    batchRenderer->vertices = NULL;
+    batchRenderer->activeVertices = 0;
+
+    for (uint32_t index = 0; index < recorder->segmentCount; index++) {
+        RecordedSegment *segment = &recorder->segments[index];
+        if (segment->commandCount == 0) {
+            continue;
+        }
+
+        BatchCommand *commands = &recorder->deferredCommands[segment->firstCommand];
+        if (segment->sorted) {
+            commands = BatchRenderer_SortCommands(commands,
+                &recorder->deferredSortScratch[segment->firstCommand],
+                segment->commandCount);
+        }
+
+        Matrix4_Copy(segment->transformMatrix, batchRenderer->transformMatrix);
+        BatchRenderer_DrawCommands(batchRenderer, recorder, commands, segment->commandCount);
+    }
+
+    batchRenderer->batchStarted = false;
+
+    recorder->segmentCount = 0;
+    recorder->activeVertices = 0;
+    recorder->deferredCommandCount = 0;
+    recorder->deferredTextureCount = 0;
+    recorder->deferredShaderCount = 0;
+#ifdef PINIM_CAPTURE
+    CommandCapture_ResetStream(recorder->captureStream);
+#endif
+}
+
+static int BatchRenderer_CompareStaticBatchCommands(const void *a, const void *b) {
+    const StaticBatchCommand *commandA = a;
+    const StaticBatchCommand *commandB = b;
+
+    if (commandA->run != commandB->run) {
+        return (commandA->run < commandB->run) ? -1 : 1;
+    }
+    if (commandA->cell != commandB->cell) {
+        return (commandA->cell < commandB->cell) ? -1 : 1;
+    }
+    if (commandA->order != commandB->order) {
+        return (commandA->order < commandB->order) ? -1 : 1;
+    }
+    return 0;
+}
+
+StaticBatch *BatchRenderer_CreateStaticBatch(
+    BatchRenderer *batchRenderer, BatchRenderer *recorder, float chunkSize) {
+    assert(batchRenderer != NULL);
+    assert(recorder != NULL);
+    assert(recorder->recorder && recorder->owner == batchRenderer);
+
+    if (recorder->batchStarted) {
+        SDL_Log("BatchRenderer_CreateStaticBatch called with an unfinished recording");
+        return NULL;
+    }
 
-    VertexShader *vertexShader = VertexShader_CreateFromBuffer(
-        graphicsDevice, defaultVertexShaderSource, sizeof(defaultVertexShaderSource));
-    if (vertexShader == NULL) {
-        SDL_Log("VertexShader_CreateFromBuffer failed");
-        SDL_free(batchRenderer);
+    uint32_t commandCount = recorder->deferredCommandCount;
+    if (commandCount == 0) {
+        SDL_Log("BatchRenderer_CreateStaticBatch called with an empty recording");
         return NULL;
     }
 
-    FragmentShader *fragmentShader = FragmentShader_CreateFromBuffer(
-        graphicsDevice, defaultFragmentShaderSource, sizeof(defaultFragmentShaderSource));
-    if (fragmentShader == NULL) {
-        SDL_Log("FragmentShader_CreateFromBuffer failed");
-        VertexShader_Destroy(vertexShader);
-        SDL_free(batchRenderer);
+    StaticBatch *staticBatch = SDL_calloc(1, sizeof(StaticBatch));
+    StaticBatchCommand *commands = SDL_malloc(commandCount * sizeof(StaticBatchCommand));
+    StaticBatchRange *ranges = SDL_malloc(commandCount * sizeof(StaticBatchRange));
+    uint32_t vertexSize = VertexBuffer_GetVertexSize(recorder->vertexFormat);
+    uint8_t *vertices = SDL_malloc((size_t)recorder->activeVertices * vertexSize);
+    if (staticBatch == NULL || commands == NULL || ranges == NULL || vertices == NULL) {
+        SDL_Log("SDL_malloc failed");
+        SDL_free(vertices);
+        SDL_free(ranges);
+        SDL_free(commands);
+        SDL_free(staticBatch);
         return NULL;
     }
 
-    batchRenderer->defaultShaderProgram =
-        ShaderProgram_Create(graphicsDevice, vertexShader, fragmentShader);
-    if (batchRenderer->defaultShaderProgram == NULL) {
-        SDL_Log("ShaderProgram_Create failed");
-        FragmentShader_Destroy(fragmentShader);
-        VertexShader_Destroy(vertexShader);
-        SDL_free(batchRenderer);
-        return NULL;
+    // the same order BatchRenderer_SubmitRecording would draw in
+    uint32_t count = 0;
+    uint32_t run = 0;
+    uint64_t currentState = UINT64_MAX;
+    for (uint32_t segmentIndex = 0; segmentIndex < recorder->segmentCount; segmentIndex++) {
+        RecordedSegment *segment = &recorder->segments[segmentIndex];
+        if (segment->commandCount == 0) {
+            continue;
+        }
+
+        BatchCommand *segmentCommands = &recorder->deferredCommands[segment->firstCommand];
+        if (segment->sorted) {
+            segmentCommands = BatchRenderer_SortCommands(segmentCommands,
+                &recorder->deferredSortScratch[segment->firstCommand],
+                segment->commandCount);
+        }
+
+        for (uint32_t index = 0; index < segment->commandCount; index++) {
+            BatchCommand *command = &segmentCommands[index];
+            uint64_t state = command->sortKey >> SORT_KEY_DEPTH_BITS;
+            if (state != currentState) {
+                run++;
+                currentState = state;
+            }
+
+            // cells are picked by the command's first vertex, which is close enough for quads
+            // and triangles that are small next to a chunk
+            float *position =
+                (float *)(recorder->deferredVertices + command->firstVertex * vertexSize);
+            float *m = segment->transformMatrix;
+            float x = m[0] * position[0] + m[4] * position[1] + m[12];
+            float y = m[1] * position[0] + m[5] * position[1] + m[13];
+
+            uint64_t cell = 0;
+            if (chunkSize > 0) {
+                uint32_t cellX = (uint32_t)(int32_t)SDL_floorf(x / chunkSize);
+                uint32_t cellY = (uint32_t)(int32_t)SDL_floorf(y / chunkSize);
+                cell = ((uint64_t)cellY << 32) | cellX;
+            }
+
+            commands[count] = (StaticBatchCommand){
+                .command = command, .segment = segment, .run = run, .order = count, .cell = cell};
+            count++;
+        }
     }
 
-    FragmentShader_Destroy(fragmentShader);
-    VertexShader_Destroy(vertexShader);
+    SDL_qsort(
+        commands, count, sizeof(StaticBatchCommand), BatchRenderer_CompareStaticBatchCommands);
+
+    // copy the vertices in their final order, baked by their segment's transform, and make a
+    // range for every run of commands with the same state in the same cell
+    uint32_t vertexCount = 0;
+    uint32_t rangeCount = 0;
+    for (uint32_t index = 0; index < count; index++) {
+        StaticBatchCommand *staticCommand = &commands[index];
+        BatchCommand *command = staticCommand->command;
+        float *m = staticCommand->segment->transformMatrix;
+
+        if (index == 0 || staticCommand->run != commands[index - 1].run ||
+            staticCommand->cell != commands[index - 1].cell) {
+            uint64_t key = command->sortKey;
+            StaticBatchRange *range = &ranges[rangeCount++];
+            range->blendMode = (BlendMode)((key >> SORT_KEY_BLEND_MODE_SHIFT) & 0xF);
+            range->shaderProgram =
+                recorder->deferredShaders[(key >> SORT_KEY_SHADER_SHIFT) & 0xFFF];
+            range->texture =
+                recorder->deferredTextures[(key >> SORT_KEY_TEXTURE_SHIFT) & 0xFFFF];
+            range->primitive = (BatchPrimitive)((key >> SORT_KEY_PRIMITIVE_SHIFT) & 1);
+            range->firstVertex = vertexCount;
+            range->vertexCount = 0;
+            range->left = FLT_MAX;
+            range->top = FLT_MAX;
+            range->right = -FLT_MAX;
+            range->bottom = -FLT_MAX;
+        }
 
-    batchRenderer->vertexBuffer =
-        VertexBuffer_Create(VERTEX_BUFFER_DYNAMIC, batchRenderer->maximumVertices);
-    if (batchRenderer->vertexBuffer == NULL) {
-        SDL_Log("VertexBuffer_Create failed");
-        ShaderProgram_Destroy(batchRenderer->defaultShaderProgram);
-        SDL_free(batchRenderer);
+        StaticBatchRange *range = &ranges[rangeCount - 1];
+        uint8_t *destination = vertices + vertexCount * vertexSize;
+        SDL_memcpy(destination,
+            recorder->deferredVertices + command->firstVertex * vertexSize,
+            command->vertexCount * vertexSize);
+
+        // every vertex format starts with float x, y
+        for (uint32_t vertex = 0; vertex < command->vertexCount; vertex++) {
+            float *position = (float *)(destination + vertex * vertexSize);
+            float x = m[0] * position[0] + m[4] * position[1] + m[12];
+            float y = m[1] * position[0] + m[5] * position[1] + m[13];
+            position[0] = x;
+            position[1] = y;
+            range->left = SDL_min(range->left, x);
+            range->top = SDL_min(range->top, y);
+            range->right = SDL_max(range->right, x);
+            range->bottom = SDL_max(range->bottom, y);
+        }
+
+        range->vertexCount += command->vertexCount;
+        vertexCount += command->vertexCount;
     }
 
-    batchRenderer->vertices = SDL_calloc(batchRenderer->maximumVertices, sizeof(Vertex2d));
-    if (batchRenderer->vertices == NULL) {
-        SDL_Log("SDL_calloc failed");
-        VertexBuffer_Destroy(batchRenderer->vertexBuffer);
-        ShaderProgram_Destroy(batchRenderer->defaultShaderProgram);
-        SDL_free(batchRenderer);
+    staticBatch->vertexFormat = recorder->vertexFormat;
+    staticBatch->vertexBuffer = VertexBuffer_Create(recorder->graphicsDevice,
+        VERTEX_BUFFER_STATIC,
+        staticBatch->vertexFormat,
+        vertexCount);
+    if (staticBatch->vertexBuffer == NULL) {
+        SDL_Log("VertexBuffer_Create failed");
+        SDL_free(vertices);
+        SDL_free(ranges);
+        SDL_free(commands);
+        SDL_free(staticBatch);
+        return NULL;
     }
 
-    batchRenderer->graphicsDevice = graphicsDevice;
+    VertexBuffer_SetVertexData(staticBatch->vertexBuffer,
+        batchRenderer->defaultShaderProgram,
+        staticBatch->vertexFormat,
+        vertices,
+        vertexCount);
+
+    staticBatch->ranges = ranges;
+    staticBatch->rangeCount = rangeCount;
+
+    SDL_free(vertices);
+    SDL_free(commands);
+
+    recorder->segmentCount = 0;
+    recorder->activeVertices = 0;
+    recorder->deferredCommandCount = 0;
+    recorder->deferredTextureCount = 0;
+    recorder->deferredShaderCount = 0;
+#ifdef PINIM_CAPTURE
+    // static batches aren't captured
+    CommandCapture_ResetStream(recorder->captureStream);
+#endif
+
+    return staticBatch;
+}
 
-    return batchRenderer;
+void BatchRenderer_DestroyStaticBatch(StaticBatch *staticBatch) {
+    assert(staticBatch != NULL);
+
+    VertexBuffer_Destroy(staticBatch->vertexBuffer);
+    SDL_free(staticBatch->ranges);
+    SDL_free(staticBatch);
 }
 
-void BatchRenderer_Destroy(BatchRenderer *batchRenderer) {
-    assert(batchRenderer != NULL);
+static void BatchRenderer_DrawStaticRange(BatchRenderer *batchRenderer, StaticBatch *staticBatch,
+    StaticBatchRange *range, uint32_t firstVertex, uint32_t vertexCount) {
+    batchRenderer->blendMode = range->blendMode;
+    batchRenderer->currentShaderProgram = range->shaderProgram;
+    batchRenderer->texture = range->texture;
+
+    BatchRenderer_ApplyDrawState(batchRenderer);
+    VertexBuffer_SetVertexFormat(
+        staticBatch->vertexBuffer, range->shaderProgram, staticBatch->vertexFormat);
+
+    if (range->primitive == BATCH_PRIMITIVE_TRIANGLES) {
+        GraphicsDevice_DrawPrimitives(batchRenderer->graphicsDevice,
+            staticBatch->vertexBuffer,
+            RENDER_PRIMITIVE_TRIANGLES,
+            firstVertex,
+            vertexCount / 3);
+        return;
+    }
 
-    SDL_free(batchRenderer->vertices);
-    VertexBuffer_Destroy(batchRenderer->vertexBuffer);
-    ShaderProgram_Destroy(batchRenderer->defaultShaderProgram);
-    SDL_free(batchRenderer);
+    // the shared quad indices only cover a batch's worth of quads, so larger ranges take a few
+    // draws with the base vertex moving along
+    uint32_t maximumQuads = batchRenderer->maximumVertices / 4;
+    for (uint32_t quad = 0; quad < vertexCount / 4; quad += maximumQuads) {
+        uint32_t quadCount = SDL_min(maximumQuads, vertexCount / 4 - quad);
+        GraphicsDevice_DrawIndexedPrimitives(batchRenderer->graphicsDevice,
+            staticBatch->vertexBuffer,
+            batchRenderer->quadIndexBuffer,
+            RENDER_PRIMITIVE_TRIANGLES,
+            firstVertex + quad * 4,
+            0,
+            quadCount * 2);
+    }
 }
 
-void BatchRenderer_Begin(BatchRenderer *batchRenderer, BlendMode blendMode, Texture *texture,
-    ShaderProgram *shaderProgram, Matrix4 transformMatrix) {
+void BatchRenderer_DrawStaticBatch(BatchRenderer *batchRenderer, StaticBatch *staticBatch,
+    Matrix4 transformMatrix, Rectangle *visibleArea) {
     assert(batchRenderer != NULL);
+    assert(staticBatch != NULL);
+    assert(!batchRenderer->recorder);
+    // static batches aren't captured, neither are the calls drawing one makes
+    COMMAND_CAPTURE_SCOPE(batchRenderer->graphicsDevice);
 
     if (batchRenderer->batchStarted) {
-        SDL_Log("BatchRenderer_Begin called on already started BatchRenderer");
+        SDL_Log("BatchRenderer_DrawStaticBatch called during a batch");
         return;
     }
 
-    batchRenderer->activeVertices = 0;
-    batchRenderer->batchStarted = true;
-    batchRenderer->blendMode = blendMode;
-    batchRenderer->texture = texture;
-    batchRenderer->currentShaderProgram =
-        (shaderProgram != NULL) ? shaderProgram : batchRenderer->defaultShaderProgram;
+    BatchRenderer_FlushVertices(batchRenderer);
 
     Matrix4_Copy(transformMatrix, batchRenderer->transformMatrix);
+    batchRenderer->multiTexture = false;
+
+    // visible ranges that follow each other with the same state are drawn together
+    StaticBatchRange *pending = NULL;
+    uint32_t pendingFirstVertex = 0;
+    uint32_t pendingVertexCount = 0;
+
+    for (uint32_t index = 0; index < staticBatch->rangeCount; index++) {
+        StaticBatchRange *range = &staticBatch->ranges[index];
+
+        if (visibleArea != NULL &&
+            (range->right < visibleArea->x || range->left > visibleArea->x + visibleArea->width ||
+                range->bottom < visibleArea->y ||
+                range->top > visibleArea->y + visibleArea->height)) {
+            continue;
+        }
+
+        if (pending != NULL && pendingFirstVertex + pendingVertexCount == range->firstVertex &&
+            pending->blendMode == range->blendMode &&
+            pending->shaderProgram == range->shaderProgram &&
+            pending->texture == range->texture && pending->primitive == range->primitive) {
+            pendingVertexCount += range->vertexCount;
+            continue;
+        }
+
+        if (pending != NULL) {
+            BatchRenderer_DrawStaticRange(
+                batchRenderer, staticBatch, pending, pendingFirstVertex, pendingVertexCount);
+        }
+
+        pending = range;
+        pendingFirstVertex = range->firstVertex;
+        pendingVertexCount = range->vertexCount;
+    }
+
+    if (pending != NULL) {
+        BatchRenderer_DrawStaticRange(
+            batchRenderer, staticBatch, pending, pendingFirstVertex, pendingVertexCount);
+    }
+}
+
+// called by the device before anything that would draw out of order with End's held back vertices
+static void BatchRenderer_FlushPending(void *userData) {
+    BatchRenderer_FlushVertices(userData);
 }
 
 void BatchRenderer_End(BatchRenderer *batchRenderer) {
     assert(batchRenderer != NULL);
+    BATCH_RENDERER_CAPTURE(batchRenderer, false, CommandCapture_RecordBatchEnd);
 
     if (!batchRenderer->batchStarted) {
         SDL_Log("BatchRenderer_End called on a not started BatchRenderer");
         return;
     }
 
-    BatchRenderer_Flush(batchRenderer);
+    if (batchRenderer->recorder) {
+        RecordedSegment *segment = &batchRenderer->segments[batchRenderer->segmentCount - 1];
+        segment->commandCount = batchRenderer->deferredCommandCount - segment->firstCommand;
+        batchRenderer->batchStarted = false;
+        return;
+    }
+
+    if (batchRenderer->deferred) {
+        BatchRenderer_DrawDeferred(batchRenderer);
+        batchRenderer->vertices = NULL;
+    } else if (batchRenderer->activeVertices > 0) {
+        // the buffer isn't left mapped, ResumePending maps it again
+        VertexBuffer_SuspendWrite(batchRenderer->vertexBuffer,
+            batchRenderer->vertexFormat,
+            batchRenderer->activeVertices);
+        batchRenderer->vertices = NULL;
+        batchRenderer->pending = true;
+        GraphicsDevice_SetPendingFlush(
+            batchRenderer->graphicsDevice, BatchRenderer_FlushPending, batchRenderer);
+    } else {
+        BatchRenderer_FlushVertices(batchRenderer);
+    }
 
     batchRenderer->batchStarted = false;
+    batchRenderer->deferred = false;
 }
 
 void BatchRenderer_Flush(BatchRenderer *batchRenderer) {
     assert(batchRenderer != NULL);
 
-    if (!batchRenderer->batchStarted || batchRenderer->activeVertices < 3) {
+    TRACE_ZONE("BatchRenderer_Flush");
+    BATCH_RENDERER_CAPTURE(batchRenderer, false, CommandCapture_RecordBatchFlush);
+
+    // recordings are only drawn by BatchRenderer_SubmitRecording
+    if (batchRenderer->recorder) {
         return;
     }
 
-    Matrix4 projectionMatrix;
-    Rectangle viewport;
+    if (batchRenderer->deferred) {
+        BatchRenderer_DrawDeferred(batchRenderer);
+        return;
+    }
 
-    GraphicsDevice_GetViewport(batchRenderer->graphicsDevice, &viewport);
+    BatchRenderer_FlushVertices(batchRenderer);
+}
 
-    if (GraphicsDevice_IsUsingRenderTarget(batchRenderer->graphicsDevice)) {
-        Matrix4_OrthoCamera(viewport.x,
-            (viewport.x + viewport.width),
-            viewport.y,
-            (viewport.y + viewport.height),
-            -1,
-            1000,
-            projectionMatrix);
-    } else {
-        Matrix4_OrthoCamera(viewport.x,
-            (viewport.x + viewport.width),
-            (viewport.y + viewport.height),
-            viewport.y,
-            -1,
-            1000,
-            projectionMatrix);
+// outside of a batch this draws whatever End left pending
+static void BatchRenderer_FlushVertices(BatchRenderer *batchRenderer) {
+    if (batchRenderer->vertices == NULL && !batchRenderer->pending) {
+        return;
     }
 
-    Matrix4_Multiply(projectionMatrix, batchRenderer->transformMatrix, projectionMatrix);
-
-    GraphicsDevice_SetBlendMode(batchRenderer->graphicsDevice, batchRenderer->blendMode);
-    GraphicsDevice_ApplyShaderProgram(
-        batchRenderer->graphicsDevice, batchRenderer->currentShaderProgram);
+    TRACE_ZONE("BatchRenderer_FlushVertices");
+    // held back vertices can be drawn by any later call, the shader and blend mode calls made
+    // here belong to whichever call drew them
+    COMMAND_CAPTURE_SCOPE(batchRenderer->graphicsDevice);
 
-    int32_t textureSamplerLocation =
-        ShaderProgram_GetParameterLocation(batchRenderer->currentShaderProgram, "TextureSampler");
-    if (textureSamplerLocation != -1 && batchRenderer->texture != NULL) {
-        ShaderProgram_SetParameterTexture2D(
-            batchRenderer->currentShaderProgram, "TextureSampler", batchRenderer->texture, 0);
+    if (batchRenderer->pending) {
+        batchRenderer->pending = false;
+        GraphicsDevice_CancelPendingFlush(batchRenderer->graphicsDevice, batchRenderer);
     }
 
-    int32_t projectionMatrixLocation =
-        ShaderProgram_GetParameterLocation(batchRenderer->currentShaderProgram, "ProjectionMatrix");
-    if (projectionMatrixLocation != -1) {
-        ShaderProgram_SetParameterMatrix4(
-            batchRenderer->currentShaderProgram, "ProjectionMatrix", projectionMatrix);
+    if (batchRenderer->activeVertices < 3) {
+        VertexBuffer_EndWrite(batchRenderer->vertexBuffer, NULL, batchRenderer->vertexFormat, 0);
+        batchRenderer->vertices = NULL;
+        batchRenderer->activeVertices = 0;
+        return;
     }
 
-    ShaderProgram_ApplyParameters(batchRenderer->currentShaderProgram);
+    BatchRenderer_ApplyDrawState(batchRenderer);
 
-    VertexBuffer_SetVertexData(batchRenderer->vertexBuffer,
+    VertexBuffer_EndWrite(batchRenderer->vertexBuffer,
         batchRenderer->currentShaderProgram,
-        batchRenderer->vertices,
+        batchRenderer->vertexFormat,
         batchRenderer->activeVertices);
-
-    GraphicsDevice_DrawPrimitives(batchRenderer->graphicsDevice,
-        batchRenderer->vertexBuffer,
-        RENDER_PRIMITIVE_TRIANGLES,
-        0,
-        batchRenderer->activeVertices / 3);
+    batchRenderer->vertices = NULL;
+
+    if (batchRenderer->primitive == BATCH_PRIMITIVE_QUADS) {
+        GraphicsDevice_DrawIndexedPrimitives(batchRenderer->graphicsDevice,
+            batchRenderer->vertexBuffer,
+            batchRenderer->quadIndexBuffer,
+            RENDER_PRIMITIVE_TRIANGLES,
+            0,
+            0,
+            batchRenderer->activeVertices / 4 * 2);
+    } else {
+        GraphicsDevice_DrawPrimitives(batchRenderer->graphicsDevice,
+            batchRenderer->vertexBuffer,
+            RENDER_PRIMITIVE_TRIANGLES,
+            0,
+            batchRenderer->activeVertices / 3);
+    }
 
     batchRenderer->activeVertices = 0;
 }
 
+// name lookups happen once per shader switch instead of on every flush
+static void BatchRenderer_FindParameterHandles(
+    BatchRenderer *batchRenderer, ShaderProgram *shaderProgram) {
+    batchRenderer->handleShaderProgram = shaderProgram;
+    batchRenderer->transformMatrixHandle =
+        ShaderProgram_GetParameterHandle(shaderProgram, "TransformMatrix");
+    batchRenderer->projectionMatrixHandle =
+        ShaderProgram_GetParameterHandle(shaderProgram, "ProjectionMatrix");
+    batchRenderer->textureSamplerHandle =
+        ShaderProgram_GetParameterHandle(shaderProgram, "TextureSampler");
+
+    for (uint32_t slot = 0; slot < batchRenderer->maximumTextureSlots; slot++) {
+        char samplerName[32];
+        SDL_snprintf(samplerName, sizeof(samplerName), "TextureSampler%u", slot);
+        batchRenderer->textureSamplerHandles[slot] =
+            ShaderProgram_GetParameterHandle(shaderProgram, samplerName);
+    }
+}
+
+// combined projection for shaders with a ProjectionMatrix instead of ViewConstants
+static void BatchRenderer_UpdateProjectionTransform(BatchRenderer *batchRenderer) {
+    uint32_t projectionVersion = GraphicsDevice_GetProjectionVersion(batchRenderer->graphicsDevice);
+    if (batchRenderer->projectionVersion != projectionVersion ||
+        SDL_memcmp(batchRenderer->projectionSourceTransform,
+            batchRenderer->transformMatrix,
+            sizeof(Matrix4)) != 0) {
+        Matrix4 projectionMatrix;
+        GraphicsDevice_GetProjectionMatrix(batchRenderer->graphicsDevice, projectionMatrix);
+        Matrix4_Multiply(projectionMatrix,
+            batchRenderer->transformMatrix,
+            batchRenderer->projectionTransform);
+        Matrix4_Copy(batchRenderer->transformMatrix, batchRenderer->projectionSourceTransform);
+        batchRenderer->projectionVersion = projectionVersion;
+    }
+}
+
+// sets the blend mode, shader program and its texture and transform parameters for a draw. the
+// projection comes from the device's ViewConstants block.
+static void BatchRenderer_ApplyDrawState(BatchRenderer *batchRenderer) {
+    // programs still compiling draw with the default shader instead of waiting on the driver
+    ShaderProgram *shaderProgram = batchRenderer->currentShaderProgram;
+    if (!ShaderProgram_IsReady(shaderProgram)) {
+        shaderProgram = batchRenderer->multiTexture
+                            ? batchRenderer->defaultMultiTextureShaderProgram
+                            : batchRenderer->defaultShaderProgram;
+    }
+
+    // untextured geometry doesn't need to sample anything
+    if (shaderProgram == batchRenderer->defaultShaderProgram && batchRenderer->texture == NULL) {
+        ShaderProgram *untexturedShaderProgram =
+            ShaderVariants_GetProgram(batchRenderer->defaultShaderVariants, 0);
+        if (untexturedShaderProgram != NULL) {
+            shaderProgram = untexturedShaderProgram;
+        }
+    }
+    if (batchRenderer->handleShaderProgram != shaderProgram) {
+        BatchRenderer_FindParameterHandles(batchRenderer, shaderProgram);
+    }
+
+    GraphicsDevice_SetBlendMode(batchRenderer->graphicsDevice, batchRenderer->blendMode);
+    GraphicsDevice_ApplyShaderProgram(batchRenderer->graphicsDevice, shaderProgram);
+
+    if (batchRenderer->multiTexture) {
+        for (uint32_t slot = 0; slot < batchRenderer->textureSlotCount; slot++) {
+            ShaderProgram_SetParameterTexture2DByHandle(shaderProgram,
+                batchRenderer->textureSamplerHandles[slot],
+                batchRenderer->textureSlots[slot],
+                slot);
+        }
+    } else if (batchRenderer->texture != NULL) {
+        ShaderProgram_SetParameterTexture2DByHandle(
+            shaderProgram, batchRenderer->textureSamplerHandle, batchRenderer->texture, 0);
+    }
+
+    ShaderProgram_SetParameterMatrix4ByHandle(
+        shaderProgram, batchRenderer->transformMatrixHandle, batchRenderer->transformMatrix);
+
+    if (batchRenderer->projectionMatrixHandle != -1) {
+        BatchRenderer_UpdateProjectionTransform(batchRenderer);
+        ShaderProgram_SetParameterMatrix4ByHandle(shaderProgram,
+            batchRenderer->projectionMatrixHandle,
+            batchRenderer->projectionTransform);
+    }
+
+    ShaderProgram_ApplyParameters(shaderProgram);
+}
+
 bool BatchRenderer_BatchActive(BatchRenderer *batchRenderer) {
     assert(batchRenderer != NULL);
     return batchRenderer->batchStarted;
 }
 
+void BatchRenderer_SetCulling(BatchRenderer *batchRenderer, bool enabled) {
+    assert(batchRenderer != NULL);
+    BATCH_RENDERER_CAPTURE(batchRenderer, false, CommandCapture_RecordBatchSetCulling, enabled);
+
+    if (batchRenderer->recorder) {
+        SDL_Log("BatchRenderer_SetCulling is not supported by recorders");
+        return;
+    }
+
+    if (batchRenderer->batchStarted) {
+        SDL_Log("BatchRenderer_SetCulling called during a batch");
+        return;
+    }
+
+    batchRenderer->culling = enabled;
+}
+
+bool BatchRenderer_GetCulling(BatchRenderer *batchRenderer) {
+    assert(batchRenderer != NULL);
+    return batchRenderer->culling;
+}
+
+uint32_t BatchRenderer_GetCulledSpriteCount(BatchRenderer *batchRenderer) {
+    assert(batchRenderer != NULL);
+    return batchRenderer->culledSprites;
+}
+
+void BatchRenderer_ResetCulledSpriteCount(BatchRenderer *batchRenderer) {
+    assert(batchRenderer != NULL);
+    batchRenderer->culledSprites = 0;
+}
+
+// flushes anything batched with the other primitive so quads and triangles never share a draw.
+// deferred batches keep the primitive in the sort key instead.
+static void BatchRenderer_SetPrimitive(BatchRenderer *batchRenderer, BatchPrimitive primitive) {
+    if (batchRenderer->primitive != primitive) {
+        if (!batchRenderer->deferred) {
+            BatchRenderer_Flush(batchRenderer);
+        }
+        batchRenderer->primitive = primitive;
+    }
+}
+
+// makes sure vertexCount more vertices fit, flushing a regular batch or growing the deferred pool
+static bool BatchRenderer_ReserveVertices(BatchRenderer *batchRenderer, uint32_t vertexCount) {
+    if (batchRenderer->deferred) {
+        if (!BatchRenderer_Grow((void **)&batchRenderer->deferredVertices,
+                &batchRenderer->deferredVertexCapacity,
+                batchRenderer->activeVertices + vertexCount,
+                VertexBuffer_GetVertexSize(batchRenderer->vertexFormat))) {
+            return false;
+        }
+        batchRenderer->vertices = batchRenderer->deferredVertices;
+        return true;
+    }
+
+    if (batchRenderer->activeVertices + vertexCount > batchRenderer->maximumVertices) {
+        BatchRenderer_Flush(batchRenderer);
+    }
+
+    return BatchRenderer_BeginVertices(batchRenderer);
+}
+
+// writes the four corners of a quad in the batch's vertex format
+static inline uint16_t BatchRenderer_PackUnorm16(float value) {
+    return (uint16_t)(SDL_clamp(value, 0.0f, 1.0f) * 65535.0f + 0.5f);
+}
+
+static inline uint8_t BatchRenderer_PackUnorm8(float value) {
+    return (uint8_t)(SDL_clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+static void BatchRenderer_WriteQuad(
+    BatchRenderer *batchRenderer, Vector2 positions[4], Vector2 uvs[4], Color *color) {
+    switch (batchRenderer->vertexFormat) {
+    case VERTEX_FORMAT_STANDARD: {
+        Vertex2d *vertices = (Vertex2d *)batchRenderer->vertices + batchRenderer->activeVertices;
+        for (int corner = 0; corner < 4; corner++) {
+            vertices->x = positions[corner][0];
+            vertices->y = positions[corner][1];
+            vertices->u = uvs[corner][0];
+            vertices->v = uvs[corner][1];
+            vertices->r = color->r;
+            vertices->g = color->g;
+            vertices->b = color->b;
+            vertices->a = color->a;
+            vertices++;
+        }
+        break;
+    }
+
+    case VERTEX_FORMAT_MULTITEXTURE: {
+        Vertex2dMultiTexture *vertices =
+            (Vertex2dMultiTexture *)batchRenderer->vertices + batchRenderer->activeVertices;
+        for (int corner = 0; corner < 4; corner++) {
+            vertices->x = positions[corner][0];
+            vertices->y = positions[corner][1];
+            vertices->u = uvs[corner][0];
+            vertices->v = uvs[corner][1];
+            vertices->r = color->r;
+            vertices->g = color->g;
+            vertices->b = color->b;
+            vertices->a = color->a;
+            vertices->textureIndex = (float)batchRenderer->currentTextureSlot;
+            vertices++;
+        }
+        break;
+    }
+
+    case VERTEX_FORMAT_COMPACT: {
+        uint8_t r = BatchRenderer_PackUnorm8(color->r);
+        uint8_t g = BatchRenderer_PackUnorm8(color->g);
+        uint8_t b = BatchRenderer_PackUnorm8(color->b);
+        uint8_t a = BatchRenderer_PackUnorm8(color->a);
+        Vertex2dCompact *vertices =
+            (Vertex2dCompact *)batchRenderer->vertices + batchRenderer->activeVertices;
+        for (int corner = 0; corner < 4; corner++) {
+            vertices->x = positions[corner][0];
+            vertices->y = positions[corner][1];
+            vertices->u = BatchRenderer_PackUnorm16(uvs[corner][0]);
+            vertices->v = BatchRenderer_PackUnorm16(uvs[corner][1]);
+            vertices->r = r;
+            vertices->g = g;
+            vertices->b = b;
+            vertices->a = a;
+            vertices++;
+        }
+        break;
+    }
+
+    case VERTEX_FORMAT_COMPACT_MULTITEXTURE: {
+        uint8_t r = BatchRenderer_PackUnorm8(color->r);
+        uint8_t g = BatchRenderer_PackUnorm8(color->g);
+        uint8_t b = BatchRenderer_PackUnorm8(color->b);
+        uint8_t a = BatchRenderer_PackUnorm8(color->a);
+        Vertex2dCompactMultiTexture *vertices =
+            (Vertex2dCompactMultiTexture *)batchRenderer->vertices + batchRenderer->activeVertices;
+        for (int corner = 0; corner < 4; corner++) {
+            vertices->x = positions[corner][0];
+            vertices->y = positions[corner][1];
+            vertices->u = BatchRenderer_PackUnorm16(uvs[corner][0]);
+            vertices->v = BatchRenderer_PackUnorm16(uvs[corner][1]);
+            vertices->r = r;
+            vertices->g = g;
+            vertices->b = b;
+            vertices->a = a;
+            vertices->textureIndex = (float)batchRenderer->currentTextureSlot;
+            vertices++;
+        }
+        break;
+    }
+
+    default:
+        SDL_Log("Unsupported VertexFormat: %d", batchRenderer->vertexFormat);
+        return;
+    }
+
+    batchRenderer->activeVertices += 4;
+
+    if (batchRenderer->deferred) {
+        BatchRenderer_RecordCommand(batchRenderer, 4);
+    }
+}
+
+// copies raw triangle vertices, converting them to the batch's vertex format
+static void BatchRenderer_WriteVertices(
+    BatchRenderer *batchRenderer, Vertex2d *sourceVertices, uint32_t vertexCount) {
+    switch (batchRenderer->vertexFormat) {
+    case VERTEX_FORMAT_STANDARD:
+        SDL_memcpy((Vertex2d *)batchRenderer->vertices + batchRenderer->activeVertices,
+            sourceVertices,
+            vertexCount * sizeof(Vertex2d));
+        break;
+
+    case VERTEX_FORMAT_MULTITEXTURE: {
+        Vertex2dMultiTexture *vertices =
+            (Vertex2dMultiTexture *)batchRenderer->vertices + batchRenderer->activeVertices;
+        for (uint32_t index = 0; index < vertexCount; index++) {
+            SDL_memcpy(&vertices[index], &sourceVertices[index], sizeof(Vertex2d));
+            vertices[index].textureIndex = (float)batchRenderer->currentTextureSlot;
+        }
+        break;
+    }
+
+    case VERTEX_FORMAT_COMPACT: {
+        Vertex2dCompact *vertices =
+            (Vertex2dCompact *)batchRenderer->vertices + batchRenderer->activeVertices;
+        for (uint32_t index = 0; index < vertexCount; index++) {
+            Vertex2d *source = &sourceVertices[index];
+            vertices[index].x = source->x;
+            vertices[index].y = source->y;
+            vertices[index].u = BatchRenderer_PackUnorm16(source->u);
+            vertices[index].v = BatchRenderer_PackUnorm16(source->v);
+            vertices[index].r = BatchRenderer_PackUnorm8(source->r);
+            vertices[index].g = BatchRenderer_PackUnorm8(source->g);
+            vertices[index].b = BatchRenderer_PackUnorm8(source->b);
+            vertices[index].a = BatchRenderer_PackUnorm8(source->a);
+        }
+        break;
+    }
+
+    case VERTEX_FORMAT_COMPACT_MULTITEXTURE: {
+        Vertex2dCompactMultiTexture *vertices =
+            (Vertex2dCompactMultiTexture *)batchRenderer->vertices + batchRenderer->activeVertices;
+        for (uint32_t index = 0; index < vertexCount; index++) {
+            Vertex2d *source = &sourceVertices[index];
+            vertices[index].x = source->x;
+            vertices[index].y = source->y;
+            vertices[index].u = BatchRenderer_PackUnorm16(source->u);
+            vertices[index].v = BatchRenderer_PackUnorm16(source->v);
+            vertices[index].r = BatchRenderer_PackUnorm8(source->r);
+            vertices[index].g = BatchRenderer_PackUnorm8(source->g);
+            vertices[index].b = BatchRenderer_PackUnorm8(source->b);
+            vertices[index].a = BatchRenderer_PackUnorm8(source->a);
+            vertices[index].textureIndex = (float)batchRenderer->currentTextureSlot;
+        }
+        break;
+    }
+
+    default:
+        SDL_Log("Unsupported VertexFormat: %d", batchRenderer->vertexFormat);
+        return;
+    }
+
+    batchRenderer->activeVertices += vertexCount;
+
+    if (batchRenderer->deferred) {
+        BatchRenderer_RecordCommand(batchRenderer, vertexCount);
+    }
+}
+
 void BatchRenderer_BatchQuad(BatchRenderer *batchRenderer, Rectangle *sourceRectangle,
     Vector2 position, float rotation, Vector2 scale, Vector2 origin, UVMode uvMode, Color *color) {
     assert(batchRenderer != NULL);
+    BATCH_RENDERER_CAPTURE(batchRenderer,
+        false,
+        CommandCapture_RecordBatchQuad,
+        sourceRectangle,
+        position,
+        rotation,
+        scale,
+        origin,
+        uvMode,
+        color);
 
     if (!batchRenderer->batchStarted) {
         SDL_Log("BatchRenderer_BatchQuad called on unstarted batch");
         return;
     }
 
-    if (batchRenderer->activeVertices + 6 > batchRenderer->maximumVertices) {
-        BatchRenderer_Flush(batchRenderer);
-    }
+    BatchRenderer_SetPrimitive(batchRenderer, BATCH_PRIMITIVE_QUADS);
 
     float destX = position[0];
     float destY = position[1];
@@ -288,6 +2040,18 @@ void BatchRenderer_BatchQuad(BatchRenderer *batchRenderer, Rectangle *sourceRect
         destH *= textureH;
     }
 
+    if (batchRenderer->culling &&
+        BatchRenderer_IsCulled(batchRenderer,
+            destX,
+            destY,
+            BatchRenderer_GetCullRadius(destW, destH, origin[0], origin[1]))) {
+        return;
+    }
+
+    if (!BatchRenderer_ReserveVertices(batchRenderer, 4)) {
+        return;
+    }
+
     Vector2 uvs[4];
     if ((uvMode & UVMODE_ROTATED_CW90) != 0) {
         uvs[0][0] = (source.x + source.height) / (float)textureW;
@@ -346,65 +2110,35 @@ void BatchRenderer_BatchQuad(BatchRenderer *batchRenderer, Rectangle *sourceRect
         c.a = 1;
     }
 
+    Vector2 positions[4];
     float cornerX = -origin[0] * destW;
     float cornerY = -origin[1] * destH;
-    Vertex2d *vertices = &batchRenderer->vertices[0] + batchRenderer->activeVertices;
-    vertices->x = cornerX * rotationCos - cornerY * rotationSin + destX;
-    vertices->y = cornerX * rotationSin + cornerY * rotationCos + destY;
-    vertices->u = uvs[0][0];
-    vertices->v = uvs[0][1];
-    vertices->r = c.r;
-    vertices->g = c.g;
-    vertices->b = c.b;
-    vertices->a = c.a;
-    vertices++;
+    positions[0][0] = cornerX * rotationCos - cornerY * rotationSin + destX;
+    positions[0][1] = cornerX * rotationSin + cornerY * rotationCos + destY;
 
     cornerX = (1.0f - origin[0]) * destW;
     cornerY = -origin[1] * destH;
-    vertices->x = cornerX * rotationCos - cornerY * rotationSin + destX;
-    vertices->y = cornerX * rotationSin + cornerY * rotationCos + destY;
-    vertices->u = uvs[1][0];
-    vertices->v = uvs[1][1];
-    vertices->r = c.r;
-    vertices->g = c.g;
-    vertices->b = c.b;
-    vertices->a = c.a;
-    vertices++;
+    positions[1][0] = cornerX * rotationCos - cornerY * rotationSin + destX;
+    positions[1][1] = cornerX * rotationSin + cornerY * rotationCos + destY;
 
     cornerX = (1.0f - origin[0]) * destW;
     cornerY = (1.0f - origin[1]) * destH;
-    vertices->x = cornerX * rotationCos - cornerY * rotationSin + destX;
-    vertices->y = cornerX * rotationSin + cornerY * rotationCos + destY;
-    vertices->u = uvs[2][0];
-    vertices->v = uvs[2][1];
-    vertices->r = c.r;
-    vertices->g = c.g;
-    vertices->b = c.b;
-    vertices->a = c.a;
-    vertices++;
-
-    *vertices = *(vertices - 3);
-    vertices++;
-    *vertices = *(vertices - 2);
-    vertices++;
+    positions[2][0] = cornerX * rotationCos - cornerY * rotationSin + destX;
+    positions[2][1] = cornerX * rotationSin + cornerY * rotationCos + destY;
 
     cornerX = -origin[0] * destW;
     cornerY = (1.0f - origin[1]) * destH;
-    vertices->x = cornerX * rotationCos - cornerY * rotationSin + destX;
-    vertices->y = cornerX * rotationSin + cornerY * rotationCos + destY;
-    vertices->u = uvs[3][0];
-    vertices->v = uvs[3][1];
-    vertices->r = c.r;
-    vertices->g = c.g;
-    vertices->b = c.b;
-    vertices->a = c.a;
+    positions[3][0] = cornerX * rotationCos - cornerY * rotationSin + destX;
+    positions[3][1] = cornerX * rotationSin + cornerY * rotationCos + destY;
 
-    batchRenderer->activeVertices += 6;
+    BatchRenderer_WriteQuad(batchRenderer, positions, uvs, &c);
 }
 
 void BatchRenderer_BatchQuadUV(BatchRenderer *batchRenderer, Vector2 uv0, Vector2 uv1, Vector2 xy0,
     Vector2 xy1, Color *color) {
     assert(batchRenderer != NULL);
+    BATCH_RENDERER_CAPTURE(
+        batchRenderer, false, CommandCapture_RecordBatchQuadUV, uv0, uv1, xy0, xy1, color);
 
     if (!batchRenderer->batchStarted) {
         SDL_Log("BatchRenderer_BatchQuadUV called on unstarted batch");
@@ -424,8 +2158,21 @@ void BatchRenderer_BatchQuadUV(BatchRenderer *batchRenderer, Vector2 uv0, Vector
         c.a = 1;
     }
 
-    if (batchRenderer->activeVertices + 6 > batchRenderer->maximumVertices) {
-        BatchRenderer_Flush(batchRenderer);
+    if (batchRenderer->culling) {
+        float halfW = (xy1[0] - xy0[0]) * 0.5f;
+        float halfH = (xy1[1] - xy0[1]) * 0.5f;
+        if (BatchRenderer_IsCulled(batchRenderer,
+                xy0[0] + halfW,
+                xy0[1] + halfH,
+                SDL_sqrtf(halfW * halfW + halfH * halfH))) {
+            return;
+        }
+    }
+
+    BatchRenderer_SetPrimitive(batchRenderer, BATCH_PRIMITIVE_QUADS);
+
+    if (!BatchRenderer_ReserveVertices(batchRenderer, 4)) {
+        return;
     }
 
     Vector2 uvs[4];
@@ -438,52 +2185,385 @@ void BatchRenderer_BatchQuadUV(BatchRenderer *batchRenderer, Vector2 uv0, Vector
     uvs[3][0] = uv0[0];
     uvs[3][1] = uv1[1];
 
-    Vertex2d *vertices = &batchRenderer->vertices[0] + batchRenderer->activeVertices;
-    vertices->x = xy0[0];
-    vertices->y = xy0[1];
-    vertices->u = uvs[0][0];
-    vertices->v = uvs[0][1];
-    vertices->r = c.r;
-    vertices->g = c.g;
-    vertices->b = c.b;
-    vertices->a = c.a;
-    vertices++;
-
-    vertices->x = xy1[0];
-    vertices->y = xy0[1];
-    vertices->u = uvs[1][0];
-    vertices->v = uvs[1][1];
-    vertices->r = c.r;
-    vertices->g = c.g;
-    vertices->b = c.b;
-    vertices->a = c.a;
-    vertices++;
-
-    vertices->x = xy1[0];
-    vertices->y = xy1[1];
-    vertices->u = uvs[2][0];
-    vertices->v = uvs[2][1];
-    vertices->r = c.r;
-    vertices->g = c.g;
-    vertices->b = c.b;
-    vertices->a = c.a;
-    vertices++;
-
-    *vertices = *(vertices - 3);
-    vertices++;
-    *vertices = *(vertices - 2);
-    vertices++;
-
-    vertices->x = xy0[0];
-    vertices->y = xy1[1];
-    vertices->u = uvs[3][0];
-    vertices->v = uvs[3][1];
-    vertices->r = c.r;
-    vertices->g = c.g;
-    vertices->b = c.b;
-    vertices->a = c.a;
-
-    batchRenderer->activeVertices += 6;
+    Vector2 positions[4];
+    positions[0][0] = xy0[0];
+    positions[0][1] = xy0[1];
+    positions[1][0] = xy1[0];
+    positions[1][1] = xy0[1];
+    positions[2][0] = xy1[0];
+    positions[2][1] = xy1[1];
+    positions[3][0] = xy0[0];
+    positions[3][1] = xy1[1];
+
+    BatchRenderer_WriteQuad(batchRenderer, positions, uvs, &c);
+}
+
+// fills the chunk's inputs for sprites, returns whether any of them are rotated.
+// culled sprites are left out, so the chunk can end up with fewer entries than spriteCount
+static bool BatchRenderer_PrepareQuadsChunk(BatchRenderer *batchRenderer, BatchQuadsChunk *chunk,
+    const SpriteDesc *sprites, uint32_t spriteCount, uint32_t *chunkCount) {
+    bool rotated = false;
+    uint32_t index = 0;
+    chunk->uvModeEntryCount = 0;
+
+    for (uint32_t spriteIndex = 0; spriteIndex < spriteCount; spriteIndex++) {
+        const SpriteDesc *sprite = &sprites[spriteIndex];
+        float width = sprite->scaleX * sprite->source.width;
+        float height = sprite->scaleY * sprite->source.height;
+
+        if (batchRenderer->culling &&
+            BatchRenderer_IsCulled(batchRenderer,
+                sprite->x,
+                sprite->y,
+                BatchRenderer_GetCullRadius(width, height, sprite->originX, sprite->originY))) {
+            continue;
+        }
+
+        chunk->x[index] = sprite->x;
+        chunk->y[index] = sprite->y;
+        chunk->rotation[index] = sprite->rotation;
+        chunk->width[index] = width;
+        chunk->height[index] = height;
+        chunk->originX[index] = sprite->originX;
+        chunk->originY[index] = sprite->originY;
+        chunk->sourceLeft[index] = (float)sprite->source.x;
+        chunk->sourceTop[index] = (float)sprite->source.y;
+        chunk->sourceRight[index] = (float)(sprite->source.x + sprite->source.width);
+        chunk->sourceBottom[index] = (float)(sprite->source.y + sprite->source.height);
+        chunk->sprites[index] = sprite;
+        rotated |= sprite->rotation != 0;
+
+        if (sprite->uvMode != UVMODE_NORMAL) {
+            chunk->uvModeEntries[chunk->uvModeEntryCount++] = (uint8_t)index;
+        }
+        index++;
+    }
+
+    *chunkCount = index;
+
+    // the last SIMD_WIDTH step can run past the chunk count, keep those lanes finite
+    uint32_t paddedCount = (index + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+    for (; index < paddedCount; index++) {
+        chunk->x[index] = 0;
+        chunk->y[index] = 0;
+        chunk->rotation[index] = 0;
+        chunk->width[index] = 0;
+        chunk->height[index] = 0;
+        chunk->originX[index] = 0;
+        chunk->originY[index] = 0;
+        chunk->sourceLeft[index] = 0;
+        chunk->sourceTop[index] = 0;
+        chunk->sourceRight[index] = 0;
+        chunk->sourceBottom[index] = 0;
+    }
+
+    return rotated;
+}
+
+// sin and cos to within about 1e-6 for angles up to 10000 radians, a SIMD_WIDTH at a time. the
+// angle is brought into [-pi, pi] by subtracting whole turns (adding and taking away 1.5 * 2^23
+// rounds to the nearest one), halved so short taylor series are enough, and the double angle
+// formulas put it back together. an angle of 0 gives exactly 0 and 1.
+static inline void BatchRenderer_SinCos(SimdFloat angle, SimdFloat *sin, SimdFloat *cos) {
+    SimdFloat roundingMagic = Simd_Set1(12582912.0f);
+    SimdFloat turns = Simd_Mul(angle, Simd_Set1(0.159154943f));
+    turns = Simd_Sub(Simd_Add(turns, roundingMagic), roundingMagic);
+
+    // two pi in two parts, the first times any turn count below 2^16 is exact
+    SimdFloat reduced = Simd_Sub(angle, Simd_Mul(turns, Simd_Set1(6.28125f)));
+    reduced = Simd_Sub(reduced, Simd_Mul(turns, Simd_Set1(0.00193530717958647692f)));
+
+    SimdFloat half = Simd_Mul(reduced, Simd_Set1(0.5f));
+    SimdFloat halfSquared = Simd_Mul(half, half);
+
+    SimdFloat halfSin = Simd_Set1(-1.0f / 39916800.0f);
+    halfSin = Simd_Add(Simd_Mul(halfSin, halfSquared), Simd_Set1(1.0f / 362880.0f));
+    halfSin = Simd_Add(Simd_Mul(halfSin, halfSquared), Simd_Set1(-1.0f / 5040.0f));
+    halfSin = Simd_Add(Simd_Mul(halfSin, halfSquared), Simd_Set1(1.0f / 120.0f));
+    halfSin = Simd_Add(Simd_Mul(halfSin, halfSquared), Simd_Set1(-1.0f / 6.0f));
+    halfSin = Simd_Add(Simd_Mul(halfSin, halfSquared), Simd_Set1(1.0f));
+    halfSin = Simd_Mul(halfSin, half);
+
+    SimdFloat halfCos = Simd_Set1(1.0f / 479001600.0f);
+    halfCos = Simd_Add(Simd_Mul(halfCos, halfSquared), Simd_Set1(-1.0f / 3628800.0f));
+    halfCos = Simd_Add(Simd_Mul(halfCos, halfSquared), Simd_Set1(1.0f / 40320.0f));
+    halfCos = Simd_Add(Simd_Mul(halfCos, halfSquared), Simd_Set1(-1.0f / 720.0f));
+    halfCos = Simd_Add(Simd_Mul(halfCos, halfSquared), Simd_Set1(1.0f / 24.0f));
+    halfCos = Simd_Add(Simd_Mul(halfCos, halfSquared), Simd_Set1(-0.5f));
+    halfCos = Simd_Add(Simd_Mul(halfCos, halfSquared), Simd_Set1(1.0f));
+
+    SimdFloat two = Simd_Set1(2.0f);
+    *sin = Simd_Mul(Simd_Mul(two, halfSin), halfCos);
+    *cos = Simd_Sub(Simd_Set1(1.0f), Simd_Mul(Simd_Mul(two, halfSin), halfSin));
+}
+
+// corners are 0: left top, 1: right top, 2: right bottom, 3: left bottom, relative to the origin.
+// uvs are the UVMODE_NORMAL ones, BatchRenderer_FixQuadsChunkUVs handles the rest
+static void BatchRenderer_TransformQuadsChunk(BatchRenderer *batchRenderer,
+    BatchQuadsChunk *chunk, uint32_t spriteCount, bool rotated) {
+    SimdFloat one = Simd_Set1(1.0f);
+    SimdFloat zero = Simd_Set1(0.0f);
+    // one reciprocal per call instead of a divide per uv
+    SimdFloat inverseTextureW = Simd_Set1(1.0f / (float)Texture_GetWidth(batchRenderer->texture));
+    SimdFloat inverseTextureH = Simd_Set1(1.0f / (float)Texture_GetHeight(batchRenderer->texture));
+
+    for (uint32_t index = 0; index < spriteCount; index += SIMD_WIDTH) {
+        SimdFloat uLeft = Simd_Mul(Simd_Load(&chunk->sourceLeft[index]), inverseTextureW);
+        SimdFloat vTop = Simd_Mul(Simd_Load(&chunk->sourceTop[index]), inverseTextureH);
+        SimdFloat uRight = Simd_Mul(Simd_Load(&chunk->sourceRight[index]), inverseTextureW);
+        SimdFloat vBottom = Simd_Mul(Simd_Load(&chunk->sourceBottom[index]), inverseTextureH);
+        Simd_Store(&chunk->u[0][index], uLeft);
+        Simd_Store(&chunk->v[0][index], vTop);
+        Simd_Store(&chunk->u[1][index], uRight);
+        Simd_Store(&chunk->v[1][index], vTop);
+        Simd_Store(&chunk->u[2][index], uRight);
+        Simd_Store(&chunk->v[2][index], vBottom);
+        Simd_Store(&chunk->u[3][index], uLeft);
+        Simd_Store(&chunk->v[3][index], vBottom);
+
+        SimdFloat x = Simd_Load(&chunk->x[index]);
+        SimdFloat y = Simd_Load(&chunk->y[index]);
+        SimdFloat width = Simd_Load(&chunk->width[index]);
+        SimdFloat height = Simd_Load(&chunk->height[index]);
+        SimdFloat originX = Simd_Load(&chunk->originX[index]);
+        SimdFloat originY = Simd_Load(&chunk->originY[index]);
+
+        SimdFloat left = Simd_Mul(Simd_Sub(zero, originX), width);
+        SimdFloat right = Simd_Mul(Simd_Sub(one, originX), width);
+        SimdFloat top = Simd_Mul(Simd_Sub(zero, originY), height);
+        SimdFloat bottom = Simd_Mul(Simd_Sub(one, originY), height);
+
+        if (!rotated) {
+            SimdFloat leftX = Simd_Add(left, x);
+            SimdFloat rightX = Simd_Add(right, x);
+            SimdFloat topY = Simd_Add(top, y);
+            SimdFloat bottomY = Simd_Add(bottom, y);
+            Simd_Store(&chunk->positionX[0][index], leftX);
+            Simd_Store(&chunk->positionY[0][index], topY);
+            Simd_Store(&chunk->positionX[1][index], rightX);
+            Simd_Store(&chunk->positionY[1][index], topY);
+            Simd_Store(&chunk->positionX[2][index], rightX);
+            Simd_Store(&chunk->positionY[2][index], bottomY);
+            Simd_Store(&chunk->positionX[3][index], leftX);
+            Simd_Store(&chunk->positionY[3][index], bottomY);
+            continue;
+        }
+
+        SimdFloat sin, cos;
+        BatchRenderer_SinCos(Simd_Load(&chunk->rotation[index]), &sin, &cos);
+        SimdFloat leftCos = Simd_Mul(left, cos);
+        SimdFloat leftSin = Simd_Mul(left, sin);
+        SimdFloat rightCos = Simd_Mul(right, cos);
+        SimdFloat rightSin = Simd_Mul(right, sin);
+        SimdFloat topCos = Simd_Mul(top, cos);
+        SimdFloat topSin = Simd_Mul(top, sin);
+        SimdFloat bottomCos = Simd_Mul(bottom, cos);
+        SimdFloat bottomSin = Simd_Mul(bottom, sin);
+
+        Simd_Store(&chunk->positionX[0][index], Simd_Add(Simd_Sub(leftCos, topSin), x));
+        Simd_Store(&chunk->positionY[0][index], Simd_Add(Simd_Add(leftSin, topCos), y));
+        Simd_Store(&chunk->positionX[1][index], Simd_Add(Simd_Sub(rightCos, topSin), x));
+        Simd_Store(&chunk->positionY[1][index], Simd_Add(Simd_Add(rightSin, topCos), y));
+        Simd_Store(&chunk->positionX[2][index], Simd_Add(Simd_Sub(rightCos, bottomSin), x));
+        Simd_Store(&chunk->positionY[2][index], Simd_Add(Simd_Add(rightSin, bottomCos), y));
+        Simd_Store(&chunk->positionX[3][index], Simd_Add(Simd_Sub(leftCos, bottomSin), x));
+        Simd_Store(&chunk->positionY[3][index], Simd_Add(Simd_Add(leftSin, bottomCos), y));
+    }
+}
+
+// redoes the uvs of sprites with a uvMode, in the corner order BatchRenderer_BatchQuad builds them
+// and then flipped the same way
+static void BatchRenderer_FixQuadsChunkUVs(BatchRenderer *batchRenderer, BatchQuadsChunk *chunk) {
+    float inverseTextureW = 1.0f / (float)Texture_GetWidth(batchRenderer->texture);
+    float inverseTextureH = 1.0f / (float)Texture_GetHeight(batchRenderer->texture);
+
+    for (uint32_t entry = 0; entry < chunk->uvModeEntryCount; entry++) {
+        uint32_t index = chunk->uvModeEntries[entry];
+        const SpriteDesc *sprite = chunk->sprites[index];
+        float left = sprite->source.x * inverseTextureW;
+        float top = sprite->source.y * inverseTextureH;
+
+        Vector2 uvs[4];
+        if ((sprite->uvMode & UVMODE_ROTATED_CW90) != 0) {
+            float right = (sprite->source.x + sprite->source.height) * inverseTextureW;
+            float bottom = (sprite->source.y + sprite->source.width) * inverseTextureH;
+            uvs[0][0] = right;
+            uvs[0][1] = top;
+            uvs[1][0] = right;
+            uvs[1][1] = bottom;
+            uvs[2][0] = left;
+            uvs[2][1] = bottom;
+            uvs[3][0] = left;
+            uvs[3][1] = top;
+        } else {
+            float right = (sprite->source.x + sprite->source.width) * inverseTextureW;
+            float bottom = (sprite->source.y + sprite->source.height) * inverseTextureH;
+            uvs[0][0] = left;
+            uvs[0][1] = top;
+            uvs[1][0] = right;
+            uvs[1][1] = top;
+            uvs[2][0] = right;
+            uvs[2][1] = bottom;
+            uvs[3][0] = left;
+            uvs[3][1] = bottom;
+        }
+
+        int horizontal = (sprite->uvMode & UVMODE_FLIP_HORIZONTAL) != 0 ? 1 : 0;
+        int vertical = (sprite->uvMode & UVMODE_FLIP_VERTICAL) != 0 ? 3 : 0;
+        for (int corner = 0; corner < 4; corner++) {
+            // horizontal swaps 0 with 1 and 2 with 3, vertical swaps 0 with 3 and 1 with 2
+            int source = corner ^ horizontal ^ vertical;
+            chunk->u[corner][index] = uvs[source][0];
+            chunk->v[corner][index] = uvs[source][1];
+        }
+    }
+}
+
+// writes the chunk's quads in the batch's vertex format, one switch for the whole chunk
+static void BatchRenderer_WriteQuadsChunk(
+    BatchRenderer *batchRenderer, BatchQuadsChunk *chunk, uint32_t spriteCount) {
+    switch (batchRenderer->vertexFormat) {
+    case VERTEX_FORMAT_STANDARD: {
+        Vertex2d *vertices = (Vertex2d *)batchRenderer->vertices + batchRenderer->activeVertices;
+        for (uint32_t index = 0; index < spriteCount; index++) {
+            const Color *color = &chunk->sprites[index]->color;
+            for (int corner = 0; corner < 4; corner++) {
+                vertices->x = chunk->positionX[corner][index];
+                vertices->y = chunk->positionY[corner][index];
+                vertices->u = chunk->u[corner][index];
+                vertices->v = chunk->v[corner][index];
+                vertices->r = color->r;
+                vertices->g = color->g;
+                vertices->b = color->b;
+                vertices->a = color->a;
+                vertices++;
+            }
+        }
+        break;
+    }
+
+    case VERTEX_FORMAT_MULTITEXTURE: {
+        float textureIndex = (float)batchRenderer->currentTextureSlot;
+        Vertex2dMultiTexture *vertices =
+            (Vertex2dMultiTexture *)batchRenderer->vertices + batchRenderer->activeVertices;
+        for (uint32_t index = 0; index < spriteCount; index++) {
+            const Color *color = &chunk->sprites[index]->color;
+            for (int corner = 0; corner < 4; corner++) {
+                vertices->x = chunk->positionX[corner][index];
+                vertices->y = chunk->positionY[corner][index];
+                vertices->u = chunk->u[corner][index];
+                vertices->v = chunk->v[corner][index];
+                vertices->r = color->r;
+                vertices->g = color->g;
+                vertices->b = color->b;
+                vertices->a = color->a;
+                vertices->textureIndex = textureIndex;
+                vertices++;
+            }
+        }
+        break;
+    }
+
+    case VERTEX_FORMAT_COMPACT: {
+        Vertex2dCompact *vertices =
+            (Vertex2dCompact *)batchRenderer->vertices + batchRenderer->activeVertices;
+        for (uint32_t index = 0; index < spriteCount; index++) {
+            const Color *color = &chunk->sprites[index]->color;
+            uint8_t r = BatchRenderer_PackUnorm8(color->r);
+            uint8_t g = BatchRenderer_PackUnorm8(color->g);
+            uint8_t b = BatchRenderer_PackUnorm8(color->b);
+            uint8_t a = BatchRenderer_PackUnorm8(color->a);
+            for (int corner = 0; corner < 4; corner++) {
+                vertices->x = chunk->positionX[corner][index];
+                vertices->y = chunk->positionY[corner][index];
+                vertices->u = BatchRenderer_PackUnorm16(chunk->u[corner][index]);
+                vertices->v = BatchRenderer_PackUnorm16(chunk->v[corner][index]);
+                vertices->r = r;
+                vertices->g = g;
+                vertices->b = b;
+                vertices->a = a;
+                vertices++;
+            }
+        }
+        break;
+    }
+
+    case VERTEX_FORMAT_COMPACT_MULTITEXTURE: {
+        float textureIndex = (float)batchRenderer->currentTextureSlot;
+        Vertex2dCompactMultiTexture *vertices =
+            (Vertex2dCompactMultiTexture *)batchRenderer->vertices + batchRenderer->activeVertices;
+        for (uint32_t index = 0; index < spriteCount; index++) {
+            const Color *color = &chunk->sprites[index]->color;
+            uint8_t r = BatchRenderer_PackUnorm8(color->r);
+            uint8_t g = BatchRenderer_PackUnorm8(color->g);
+            uint8_t b = BatchRenderer_PackUnorm8(color->b);
+            uint8_t a = BatchRenderer_PackUnorm8(color->a);
+            for (int corner = 0; corner < 4; corner++) {
+                vertices->x = chunk->positionX[corner][index];
+                vertices->y = chunk->positionY[corner][index];
+                vertices->u = BatchRenderer_PackUnorm16(chunk->u[corner][index]);
+                vertices->v = BatchRenderer_PackUnorm16(chunk->v[corner][index]);
+                vertices->r = r;
+                vertices->g = g;
+                vertices->b = b;
+                vertices->a = a;
+                vertices->textureIndex = textureIndex;
+                vertices++;
+            }
+        }
+        break;
+    }
+
+    default:
+        SDL_Log("Unsupported VertexFormat: %d", batchRenderer->vertexFormat);
+        return;
+    }
+
+    batchRenderer->activeVertices += spriteCount * 4;
+
+    // every quad of the chunk has the same sort state, one command keeps them together
+    if (batchRenderer->deferred) {
+        BatchRenderer_RecordCommand(batchRenderer, spriteCount * 4);
+    }
+}
+
+void BatchRenderer_BatchQuads(
+    BatchRenderer *batchRenderer, const SpriteDesc *sprites, uint32_t spriteCount) {
+    assert(batchRenderer != NULL);
+    assert(sprites != NULL || spriteCount == 0);
+    BATCH_RENDERER_CAPTURE(
+        batchRenderer, false, CommandCapture_RecordBatchQuads, sprites, spriteCount);
+
+    if (!batchRenderer->batchStarted) {
+        SDL_Log("BatchRenderer_BatchQuads called on unstarted batch");
+        return;
+    }
+
+    BatchRenderer_SetPrimitive(batchRenderer, BATCH_PRIMITIVE_QUADS);
+
+    uint32_t chunkSize = SDL_min(BATCH_QUADS_CHUNK_SIZE, batchRenderer->maximumVertices / 4);
+    BatchQuadsChunk chunk;
+
+    while (spriteCount > 0) {
+        uint32_t count = SDL_min(chunkSize, spriteCount);
+
+        // one capacity check per chunk instead of per sprite
+        if (!BatchRenderer_ReserveVertices(batchRenderer, count * 4)) {
+            return;
+        }
+
+        uint32_t chunkCount;
+        bool rotated =
+            BatchRenderer_PrepareQuadsChunk(batchRenderer, &chunk, sprites, count, &chunkCount);
+        if (chunkCount > 0) {
+            BatchRenderer_TransformQuadsChunk(batchRenderer, &chunk, chunkCount, rotated);
+            BatchRenderer_FixQuadsChunkUVs(batchRenderer, &chunk);
+            BatchRenderer_WriteQuadsChunk(batchRenderer, &chunk, chunkCount);
+        }
+
+        sprites += count;
+        spriteCount -= count;
+    }
 }
 
 void BatchRenderer_BatchTriangles(
@@ -491,23 +2571,27 @@ void BatchRenderer_BatchTriangles(
     assert(batchRenderer != NULL);
     assert(triangleVertices != NULL);
     assert(triangleCount > 0);
+    BATCH_RENDERER_CAPTURE(batchRenderer,
+        false,
+        CommandCapture_RecordBatchTriangles,
+        triangleVertices,
+        triangleCount);
 
     if (!batchRenderer->batchStarted) {
         SDL_Log("BatchRenderer_BatchTriangles called on unstarted batch");
         return;
     }
 
+    BatchRenderer_SetPrimitive(batchRenderer, BATCH_PRIMITIVE_TRIANGLES);
+
     Vertex2d *currentTriangleVertex = triangleVertices;
 
     for (int index = 0; index < triangleCount * 3; index += 3) {
-        if (batchRenderer->activeVertices + 3 > batchRenderer->maximumVertices) {
-            BatchRenderer_Flush(batchRenderer);
+        if (!BatchRenderer_ReserveVertices(batchRenderer, 3)) {
+            return;
         }
 
-        Vertex2d *vertex = &batchRenderer->vertices[batchRenderer->activeVertices];
-        *vertex++ = *currentTriangleVertex++;
-        *vertex++ = *currentTriangleVertex++;
-        *vertex++ = *currentTriangleVertex++;
-        batchRenderer->activeVertices += 3;
+        BatchRenderer_WriteVertices(batchRenderer, currentTriangleVertex, 3);
+        currentTriangleVertex += 3;
     }
 }
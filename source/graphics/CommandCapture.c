@@ -0,0 +1,1698 @@
+#include <assert.h>
+
+#include <glad/gl.h>
+#include <SDL3/SDL.h>
+
+#include <BatchRenderer.h>
+#include <CommandCapture.h>
+#include <GraphicsDevice.h>
+#include <ShaderProgram.h>
+#include <Texture.h>
+
+#define COMMAND_CAPTURE_MAGIC "PINIMCAP"
+#define COMMAND_CAPTURE_VERSION 1
+
+// a capture file is the header, the objects (objectBytes of records describing them) and then
+// every frame as its size followed by its records. records are an op followed by the op's
+// fields, every field is 4 bytes and strings and pixels are padded to 4, so the arrays in a
+// loaded file can be handed to the engine where they are. objects are numbered from 1 in the
+// order they were described, 0 stands for null (and for the recorder in a recording).
+typedef struct CommandCaptureHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t objectCount;
+    uint32_t objectBytes;
+    uint32_t frameCount;
+} CommandCaptureHeader;
+
+typedef enum CaptureOp {
+    // objects
+    CAPTURE_OP_BATCH_RENDERER = 1,
+    CAPTURE_OP_TEXTURE,
+    CAPTURE_OP_SHADER_PROGRAM,
+    // GraphicsDevice
+    CAPTURE_OP_BEGIN_FRAME,
+    CAPTURE_OP_END_FRAME,
+    CAPTURE_OP_PRESENT,
+    CAPTURE_OP_CLEAR_SCREEN,
+    CAPTURE_OP_SET_VIEWPORT,
+    CAPTURE_OP_SET_BLEND_MODE,
+    CAPTURE_OP_ENABLE_SCISSORS_RECTANGLE,
+    CAPTURE_OP_DISABLE_SCISSORS_RECTANGLE,
+    CAPTURE_OP_BIND_RENDER_TARGET,
+    CAPTURE_OP_UNBIND_RENDER_TARGET,
+    CAPTURE_OP_READ_PIXELS,
+    CAPTURE_OP_INVALIDATE_STATE,
+    // Texture and ShaderProgram
+    CAPTURE_OP_SET_TEXTURE_DATA,
+    CAPTURE_OP_SET_PARAMETER,
+    CAPTURE_OP_SET_PARAMETER_TEXTURE,
+    CAPTURE_OP_CLEAR_PARAMETER,
+    // BatchRenderer
+    CAPTURE_OP_BATCH_BEGIN,
+    CAPTURE_OP_BATCH_BEGIN_MULTI_TEXTURE,
+    CAPTURE_OP_BATCH_SET_TEXTURE,
+    CAPTURE_OP_BATCH_BEGIN_DEFERRED,
+    CAPTURE_OP_BATCH_SET_SORT_STATE,
+    CAPTURE_OP_BATCH_END,
+    CAPTURE_OP_BATCH_FLUSH,
+    CAPTURE_OP_BATCH_SET_CULLING,
+    CAPTURE_OP_BATCH_SET_UPLOAD_STRATEGY,
+    CAPTURE_OP_BATCH_QUAD,
+    CAPTURE_OP_BATCH_QUAD_UV,
+    CAPTURE_OP_BATCH_QUADS,
+    CAPTURE_OP_BATCH_TRIANGLES,
+    CAPTURE_OP_BATCH_SUBMIT_RECORDING,
+} CaptureOp;
+
+// flags of CAPTURE_OP_BATCH_QUAD and CAPTURE_OP_BATCH_QUAD_UV, the optional fields follow only
+// when they are set
+#define CAPTURE_QUAD_SOURCE_RECTANGLE 1
+#define CAPTURE_QUAD_COLOR 2
+
+#ifdef PINIM_CAPTURE
+
+typedef enum CaptureState {
+    CAPTURE_STATE_WAITING,  // for the first BeginFrame
+    CAPTURE_STATE_FRAME,    // between BeginFrame and EndFrame
+    CAPTURE_STATE_TAIL,     // after a kept frame's EndFrame, calls until the next BeginFrame
+    CAPTURE_STATE_SKIPPING, // after a frame that was left out, until the next BeginFrame
+    CAPTURE_STATE_FINISHED,
+} CaptureState;
+
+// an object id a recorder stream couldn't look up on its thread, filled in at the submit
+typedef struct CaptureReference {
+    size_t offset;
+    const void *object;
+    CaptureOp kind;
+} CaptureReference;
+
+struct CommandCaptureStream {
+    // null for a recorder's stream
+    CommandCapture *commandCapture;
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+    bool failed;
+
+    // recorder streams only
+    bool started;
+    uint32_t depth;
+    CaptureReference *references;
+    uint32_t referenceCount;
+    uint32_t referenceCapacity;
+};
+
+typedef struct CaptureObject {
+    const void *object;
+    uint32_t id;
+} CaptureObject;
+
+struct CommandCapture {
+    GraphicsDevice *graphicsDevice;
+    char *fileName;
+    uint32_t width;
+    uint32_t height;
+    CaptureState state;
+    SDL_AtomicInt finished;
+    uint32_t depth;
+
+    CommandCaptureStream objects;
+    uint32_t objectCount;
+    // described objects still alive, lastObject is checked first
+    CaptureObject *liveObjects;
+    uint32_t liveObjectCount;
+    uint32_t liveObjectCapacity;
+    uint32_t lastObject;
+
+    CommandCaptureStream frames;
+    // where each kept frame starts in frames, the one being recorded included
+    size_t *frameOffsets;
+    uint32_t frameCount;
+    uint32_t keptFrames;
+    bool frameIncomplete;
+};
+
+// room for size more bytes, null (and the stream failed) when there isn't any
+static uint8_t *CommandCapture_Reserve(CommandCaptureStream *stream, size_t size) {
+    if (stream->failed) {
+        return NULL;
+    }
+
+    if (stream->size + size > stream->capacity) {
+        size_t capacity = (stream->capacity > 0) ? stream->capacity : 65536;
+        while (capacity < stream->size + size) {
+            capacity *= 2;
+        }
+
+        uint8_t *data = SDL_realloc(stream->data, capacity);
+        if (data == NULL) {
+            SDL_Log("SDL_realloc failed, the capture is incomplete");
+            stream->failed = true;
+            return NULL;
+        }
+        stream->data = data;
+        stream->capacity = capacity;
+    }
+
+    uint8_t *reserved = stream->data + stream->size;
+    stream->size += size;
+    return reserved;
+}
+
+static void CommandCapture_WriteU32(CommandCaptureStream *stream, uint32_t value) {
+    uint8_t *reserved = CommandCapture_Reserve(stream, sizeof(value));
+    if (reserved != NULL) {
+        SDL_memcpy(reserved, &value, sizeof(value));
+    }
+}
+
+static void CommandCapture_WriteFloats(
+    CommandCaptureStream *stream, const float *values, uint32_t count) {
+    uint8_t *reserved = CommandCapture_Reserve(stream, count * sizeof(float));
+    if (reserved != NULL) {
+        SDL_memcpy(reserved, values, count * sizeof(float));
+    }
+}
+
+// the bytes padded with zeros to a multiple of 4
+static void CommandCapture_WriteBytes(CommandCaptureStream *stream, const void *data, size_t size) {
+    size_t paddedSize = (size + 3) & ~(size_t)3;
+    uint8_t *reserved = CommandCapture_Reserve(stream, paddedSize);
+    if (reserved != NULL) {
+        SDL_memcpy(reserved, data, size);
+        SDL_memset(reserved + size, 0, paddedSize - size);
+    }
+}
+
+// length and the string with its terminator, so a replay can use it in place
+static void CommandCapture_WriteString(CommandCaptureStream *stream, const char *string) {
+    uint32_t length = (uint32_t)SDL_strlen(string) + 1;
+    CommandCapture_WriteU32(stream, length);
+    CommandCapture_WriteBytes(stream, string, length);
+}
+
+static void CommandCapture_WriteRectangle(CommandCaptureStream *stream, Rectangle *rectangle) {
+    CommandCapture_WriteU32(stream, (uint32_t)rectangle->x);
+    CommandCapture_WriteU32(stream, (uint32_t)rectangle->y);
+    CommandCapture_WriteU32(stream, (uint32_t)rectangle->width);
+    CommandCapture_WriteU32(stream, (uint32_t)rectangle->height);
+}
+
+static void CommandCapture_WriteColor(CommandCaptureStream *stream, Color *color) {
+    CommandCapture_WriteFloats(stream, &color->r, 4);
+}
+
+static uint32_t CommandCapture_FindObject(CommandCapture *commandCapture, const void *object) {
+    if (commandCapture->lastObject < commandCapture->liveObjectCount &&
+        commandCapture->liveObjects[commandCapture->lastObject].object == object) {
+        return commandCapture->liveObjects[commandCapture->lastObject].id;
+    }
+
+    for (uint32_t index = 0; index < commandCapture->liveObjectCount; index++) {
+        if (commandCapture->liveObjects[index].object == object) {
+            commandCapture->lastObject = index;
+            return commandCapture->liveObjects[index].id;
+        }
+    }
+
+    return 0;
+}
+
+// the object's id, describing it first if it hasn't been yet
+static uint32_t CommandCapture_DescribeObject(
+    CommandCapture *commandCapture, const void *object, CaptureOp kind) {
+    if (object == NULL) {
+        return 0;
+    }
+
+    uint32_t id = CommandCapture_FindObject(commandCapture, object);
+    if (id != 0) {
+        return id;
+    }
+
+    if (commandCapture->liveObjectCount == commandCapture->liveObjectCapacity) {
+        uint32_t capacity =
+            (commandCapture->liveObjectCapacity > 0) ? commandCapture->liveObjectCapacity * 2 : 64;
+        CaptureObject *liveObjects =
+            SDL_realloc(commandCapture->liveObjects, capacity * sizeof(CaptureObject));
+        if (liveObjects == NULL) {
+            SDL_Log("SDL_realloc failed, the capture is incomplete");
+            commandCapture->objects.failed = true;
+            return 0;
+        }
+        commandCapture->liveObjects = liveObjects;
+        commandCapture->liveObjectCapacity = capacity;
+    }
+
+    id = ++commandCapture->objectCount;
+    commandCapture->lastObject = commandCapture->liveObjectCount;
+    commandCapture->liveObjects[commandCapture->liveObjectCount++] =
+        (CaptureObject){.object = object, .id = id};
+
+    CommandCaptureStream *objects = &commandCapture->objects;
+    CommandCapture_WriteU32(objects, kind);
+    CommandCapture_WriteU32(objects, id);
+
+    switch (kind) {
+    case CAPTURE_OP_BATCH_RENDERER: {
+        BatchRenderer *batchRenderer = (BatchRenderer *)object;
+        CommandCapture_WriteU32(objects, BatchRenderer_GetMaximumTriangles(batchRenderer));
+        CommandCapture_WriteU32(objects, BatchRenderer_GetVertexFormat(batchRenderer));
+        CommandCapture_WriteU32(objects, BatchRenderer_GetCulling(batchRenderer));
+        CommandCapture_WriteU32(objects, BatchRenderer_GetUploadStrategy(batchRenderer));
+        break;
+    }
+    case CAPTURE_OP_TEXTURE: {
+        Texture *texture = (Texture *)object;
+        CommandCapture_WriteU32(objects, Texture_GetWidth(texture));
+        CommandCapture_WriteU32(objects, Texture_GetHeight(texture));
+        CommandCapture_WriteU32(objects, Texture_GetTextureFilter(texture));
+        CommandCapture_WriteU32(objects, Texture_GetTextureType(texture));
+        break;
+    }
+    case CAPTURE_OP_SHADER_PROGRAM: {
+        const char *vertexSource;
+        const char *fragmentSource;
+        uint32_t vertexLength;
+        uint32_t fragmentLength;
+        ShaderProgram_GetSources((ShaderProgram *)object,
+            &vertexSource,
+            &vertexLength,
+            &fragmentSource,
+            &fragmentLength);
+        CommandCapture_WriteU32(objects, vertexLength);
+        CommandCapture_WriteBytes(objects, vertexSource, vertexLength);
+        CommandCapture_WriteU32(objects, fragmentLength);
+        CommandCapture_WriteBytes(objects, fragmentSource, fragmentLength);
+        break;
+    }
+    default:
+        assert(false);
+        break;
+    }
+
+    return id;
+}
+
+// recorder streams can't look the object up on their thread, the id is filled in at the submit
+static void CommandCapture_WriteObject(
+    CommandCaptureStream *stream, const void *object, CaptureOp kind) {
+    if (stream->commandCapture != NULL) {
+        CommandCapture_WriteU32(
+            stream, CommandCapture_DescribeObject(stream->commandCapture, object, kind));
+        return;
+    }
+
+    if (object != NULL) {
+        if (stream->referenceCount == stream->referenceCapacity) {
+            uint32_t capacity =
+                (stream->referenceCapacity > 0) ? stream->referenceCapacity * 2 : 256;
+            CaptureReference *references =
+                SDL_realloc(stream->references, capacity * sizeof(CaptureReference));
+            if (references == NULL) {
+                SDL_Log("SDL_realloc failed, the capture is incomplete");
+                stream->failed = true;
+                return;
+            }
+            stream->references = references;
+            stream->referenceCapacity = capacity;
+        }
+
+        stream->references[stream->referenceCount++] =
+            (CaptureReference){.offset = stream->size, .object = object, .kind = kind};
+    }
+    CommandCapture_WriteU32(stream, 0);
+}
+
+// a recorder's calls all go to the recorder being submitted, which is 0
+static void CommandCapture_WriteBatchRenderer(
+    CommandCaptureStream *stream, BatchRenderer *batchRenderer) {
+    if (stream->commandCapture == NULL) {
+        CommandCapture_WriteU32(stream, 0);
+        return;
+    }
+    CommandCapture_WriteObject(stream, batchRenderer, CAPTURE_OP_BATCH_RENDERER);
+}
+
+static void CommandCapture_WriteFile(CommandCapture *commandCapture) {
+    CommandCaptureHeader header = {
+        .version = COMMAND_CAPTURE_VERSION,
+        .width = commandCapture->width,
+        .height = commandCapture->height,
+        .objectCount = commandCapture->objectCount,
+        .objectBytes = (uint32_t)commandCapture->objects.size,
+        .frameCount = commandCapture->keptFrames,
+    };
+    SDL_memcpy(header.magic, COMMAND_CAPTURE_MAGIC, sizeof(header.magic));
+
+    SDL_IOStream *file = SDL_IOFromFile(commandCapture->fileName, "wb");
+    if (file == NULL) {
+        SDL_Log("SDL_IOFromFile failed %s: %s", commandCapture->fileName, SDL_GetError());
+        return;
+    }
+
+    bool written = SDL_WriteIO(file, &header, sizeof(header)) == sizeof(header) &&
+                   SDL_WriteIO(file, commandCapture->objects.data, commandCapture->objects.size) ==
+                       commandCapture->objects.size;
+
+    for (uint32_t frame = 0; frame < commandCapture->keptFrames && written; frame++) {
+        size_t start = commandCapture->frameOffsets[frame];
+        size_t end = (frame + 1 < commandCapture->keptFrames)
+                         ? commandCapture->frameOffsets[frame + 1]
+                         : commandCapture->frames.size;
+        uint32_t size = (uint32_t)(end - start);
+        written = SDL_WriteIO(file, &size, sizeof(size)) == sizeof(size) &&
+                  SDL_WriteIO(file, commandCapture->frames.data + start, size) == size;
+    }
+
+    if (!written) {
+        SDL_Log("SDL_WriteIO failed %s: %s", commandCapture->fileName, SDL_GetError());
+    }
+    if (!SDL_CloseIO(file)) {
+        SDL_Log("SDL_CloseIO failed %s: %s", commandCapture->fileName, SDL_GetError());
+    }
+    if (written) {
+        SDL_Log("Captured %u frames to %s", commandCapture->keptFrames, commandCapture->fileName);
+    }
+}
+
+// writes the file, detaches from the device and lets go of the recorded frames
+static void CommandCapture_Finish(CommandCapture *commandCapture) {
+    if (commandCapture->state == CAPTURE_STATE_FINISHED) {
+        return;
+    }
+
+    // a frame that didn't reach its EndFrame is left out
+    if (commandCapture->state == CAPTURE_STATE_FRAME) {
+        commandCapture->frames.size = commandCapture->frameOffsets[commandCapture->keptFrames];
+    }
+
+    if (commandCapture->objects.failed || commandCapture->frames.failed) {
+        SDL_Log("The capture ran out of memory, nothing was written");
+    } else if (commandCapture->keptFrames == 0) {
+        SDL_Log("No frames were captured, nothing was written");
+    } else {
+        CommandCapture_WriteFile(commandCapture);
+    }
+
+    commandCapture->state = CAPTURE_STATE_FINISHED;
+    if (GraphicsDevice_GetCommandCapture(commandCapture->graphicsDevice) == commandCapture) {
+        GraphicsDevice_SetCommandCapture(commandCapture->graphicsDevice, NULL);
+    }
+
+    SDL_free(commandCapture->frames.data);
+    SDL_free(commandCapture->objects.data);
+    SDL_free(commandCapture->liveObjects);
+    commandCapture->frames = (CommandCaptureStream){0};
+    commandCapture->objects = (CommandCaptureStream){0};
+    commandCapture->liveObjects = NULL;
+
+    SDL_SetAtomicInt(&commandCapture->finished, 1);
+}
+
+CommandCapture *CommandCapture_Create(
+    GraphicsDevice *graphicsDevice, const char *fileName, uint32_t frameCount) {
+    assert(graphicsDevice != NULL);
+    assert(fileName != NULL);
+    assert(frameCount > 0);
+
+    if (GraphicsDevice_GetCommandCapture(graphicsDevice) != NULL) {
+        SDL_Log("CommandCapture_Create called while another capture is running");
+        return NULL;
+    }
+
+    CommandCapture *commandCapture = SDL_calloc(1, sizeof(CommandCapture));
+    if (commandCapture == NULL) {
+        SDL_Log("SDL_calloc failed");
+        return NULL;
+    }
+
+    commandCapture->graphicsDevice = graphicsDevice;
+    commandCapture->width = GraphicsDevice_GetWindowWidth(graphicsDevice);
+    commandCapture->height = GraphicsDevice_GetWindowHeight(graphicsDevice);
+    commandCapture->frameCount = frameCount;
+    commandCapture->state = CAPTURE_STATE_WAITING;
+    commandCapture->objects.commandCapture = commandCapture;
+    commandCapture->frames.commandCapture = commandCapture;
+    commandCapture->fileName = SDL_strdup(fileName);
+    commandCapture->frameOffsets = SDL_malloc(frameCount * sizeof(size_t));
+    if (commandCapture->fileName == NULL || commandCapture->frameOffsets == NULL) {
+        SDL_Log("SDL_malloc failed");
+        SDL_free(commandCapture->fileName);
+        SDL_free(commandCapture->frameOffsets);
+        SDL_free(commandCapture);
+        return NULL;
+    }
+
+    // published last, the device's thread and recorders pick it up from here
+    GraphicsDevice_SetCommandCapture(graphicsDevice, commandCapture);
+
+    return commandCapture;
+}
+
+void CommandCapture_Destroy(CommandCapture *commandCapture) {
+    assert(commandCapture != NULL);
+
+    CommandCapture_Finish(commandCapture);
+
+    SDL_free(commandCapture->frameOffsets);
+    SDL_free(commandCapture->fileName);
+    SDL_free(commandCapture);
+}
+
+bool CommandCapture_IsFinished(CommandCapture *commandCapture) {
+    assert(commandCapture != NULL);
+
+    return SDL_GetAtomicInt(&commandCapture->finished) != 0;
+}
+
+CommandCaptureCall CommandCapture_BeginCall(GraphicsDevice *graphicsDevice) {
+    CommandCapture *commandCapture = GraphicsDevice_GetCommandCapture(graphicsDevice);
+    if (commandCapture == NULL || (commandCapture->state != CAPTURE_STATE_FRAME &&
+                                      commandCapture->state != CAPTURE_STATE_TAIL)) {
+        return (CommandCaptureCall){0};
+    }
+
+    CommandCaptureCall call = {
+        .stream = (commandCapture->depth == 0) ? &commandCapture->frames : NULL,
+        .depth = &commandCapture->depth,
+    };
+    commandCapture->depth++;
+    return call;
+}
+
+CommandCaptureCall CommandCapture_BeginRecorderCall(
+    GraphicsDevice *graphicsDevice, CommandCaptureStream **stream, bool startable) {
+    // only the pointer is read on this thread, the capture itself belongs to the device's thread
+    if (GraphicsDevice_GetCommandCapture(graphicsDevice) == NULL) {
+        // a later capture has to start from a fresh recording
+        if (*stream != NULL && (*stream)->started) {
+            CommandCapture_ResetStream(*stream);
+        }
+        return (CommandCaptureCall){0};
+    }
+
+    if (*stream == NULL) {
+        *stream = SDL_calloc(1, sizeof(CommandCaptureStream));
+        if (*stream == NULL) {
+            SDL_Log("SDL_calloc failed");
+            return (CommandCaptureCall){0};
+        }
+    }
+
+    CommandCaptureStream *recording = *stream;
+    if (!recording->started) {
+        if (!startable) {
+            return (CommandCaptureCall){0};
+        }
+        recording->started = true;
+    }
+
+    CommandCaptureCall call = {
+        .stream = (recording->depth == 0) ? recording : NULL,
+        .depth = &recording->depth,
+    };
+    recording->depth++;
+    return call;
+}
+
+void CommandCapture_EndCall(CommandCaptureCall *call) {
+    if (call->depth != NULL) {
+        (*call->depth)--;
+    }
+}
+
+void CommandCapture_DestroyStream(CommandCaptureStream *stream) {
+    if (stream == NULL) {
+        return;
+    }
+
+    SDL_free(stream->references);
+    SDL_free(stream->data);
+    SDL_free(stream);
+}
+
+void CommandCapture_ResetStream(CommandCaptureStream *stream) {
+    if (stream == NULL) {
+        return;
+    }
+
+    // depth is left alone, the reset can happen while a call is running
+    stream->size = 0;
+    stream->referenceCount = 0;
+    stream->failed = false;
+    stream->started = false;
+}
+
+void CommandCapture_ForgetObject(GraphicsDevice *graphicsDevice, const void *object) {
+    CommandCapture *commandCapture = GraphicsDevice_GetCommandCapture(graphicsDevice);
+    if (commandCapture == NULL) {
+        return;
+    }
+
+    for (uint32_t index = 0; index < commandCapture->liveObjectCount; index++) {
+        if (commandCapture->liveObjects[index].object == object) {
+            commandCapture->liveObjects[index] =
+                commandCapture->liveObjects[--commandCapture->liveObjectCount];
+            commandCapture->lastObject = 0;
+            return;
+        }
+    }
+}
+
+void CommandCapture_BeginFrame(GraphicsDevice *graphicsDevice) {
+    CommandCapture *commandCapture = GraphicsDevice_GetCommandCapture(graphicsDevice);
+    if (commandCapture == NULL || commandCapture->depth != 0) {
+        return;
+    }
+
+    if (commandCapture->keptFrames == commandCapture->frameCount ||
+        commandCapture->objects.failed || commandCapture->frames.failed) {
+        CommandCapture_Finish(commandCapture);
+        return;
+    }
+
+    // the previous frame never ended
+    if (commandCapture->state == CAPTURE_STATE_FRAME) {
+        commandCapture->frames.size = commandCapture->frameOffsets[commandCapture->keptFrames];
+    }
+
+    commandCapture->frameOffsets[commandCapture->keptFrames] = commandCapture->frames.size;
+    commandCapture->state = CAPTURE_STATE_FRAME;
+    commandCapture->frameIncomplete = false;
+
+    // the viewport the frame starts with, so frames replay the same in any order
+    Rectangle viewport;
+    GraphicsDevice_GetViewport(graphicsDevice, &viewport);
+    CommandCapture_WriteU32(&commandCapture->frames, CAPTURE_OP_BEGIN_FRAME);
+    CommandCapture_WriteRectangle(&commandCapture->frames, &viewport);
+}
+
+void CommandCapture_RecordEndFrame(CommandCaptureStream *stream) {
+    CommandCapture *commandCapture = stream->commandCapture;
+    CommandCapture_WriteU32(stream, CAPTURE_OP_END_FRAME);
+
+    if (commandCapture->state != CAPTURE_STATE_FRAME) {
+        return;
+    }
+
+    if (commandCapture->frameIncomplete) {
+        SDL_Log("Frame left out of the capture, a recorder it submits started before the capture");
+        commandCapture->frames.size = commandCapture->frameOffsets[commandCapture->keptFrames];
+        commandCapture->state = CAPTURE_STATE_SKIPPING;
+        return;
+    }
+
+    commandCapture->keptFrames++;
+    commandCapture->state = CAPTURE_STATE_TAIL;
+}
+
+void CommandCapture_RecordPresent(CommandCaptureStream *stream) {
+    CommandCapture_WriteU32(stream, CAPTURE_OP_PRESENT);
+}
+
+void CommandCapture_RecordClearScreen(CommandCaptureStream *stream, Color *color) {
+    CommandCapture_WriteU32(stream, CAPTURE_OP_CLEAR_SCREEN);
+    CommandCapture_WriteColor(stream, color);
+}
+
+void CommandCapture_RecordSetViewport(CommandCaptureStream *stream, Rectangle *viewport) {
+    CommandCapture_WriteU32(stream, CAPTURE_OP_SET_VIEWPORT);
+    CommandCapture_WriteRectangle(stream, viewport);
+}
+
+void CommandCapture_RecordSetBlendMode(CommandCaptureStream *stream, BlendMode blendMode) {
+    CommandCapture_WriteU32(stream, CAPTURE_OP_SET_BLEND_MODE);
+    CommandCapture_WriteU32(stream, (uint32_t)blendMode);
+}
+
+void CommandCapture_RecordEnableScissorsRectangle(
+    CommandCaptureStream *stream, Rectangle *scissorsRectangle) {
+    CommandCapture_WriteU32(stream, CAPTURE_OP_ENABLE_SCISSORS_RECTANGLE);
+    CommandCapture_WriteRectangle(stream, scissorsRectangle);
+}
+
+void CommandCapture_RecordDisableScissorsRectangle(CommandCaptureStream *stream) {
+    CommandCapture_WriteU32(stream, CAPTURE_OP_DISABLE_SCISSORS_RECTANGLE);
+}
+
+void CommandCapture_RecordBindRenderTarget(
+    CommandCaptureStream *stream, Texture *renderTarget, bool setViewport) {
+    CommandCapture_WriteU32(stream, CAPTURE_OP_BIND_RENDER_TARGET);
+    CommandCapture_WriteObject(stream, renderTarget, CAPTURE_OP_TEXTURE);
+    CommandCapture_WriteU32(stream, setViewport);
+}
+
+void CommandCapture_RecordUnbindRenderTarget(CommandCaptureStream *stream, bool resetViewport) {
+    CommandCapture_WriteU32(stream, CAPTURE_OP_UNBIND_RENDER_TARGET);
+    CommandCapture_WriteU32(stream, resetViewport);
+}
+
+void CommandCapture_RecordReadPixels(
+    CommandCaptureStream *stream, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+    CommandCapture_WriteU32(stream, CAPTURE_OP_READ_PIXELS);
+    CommandCapture_WriteU32(stream, x);
+    CommandCapture_WriteU32(stream, y);
+    CommandCapture_WriteU32(stream, width);
+    CommandCapture_WriteU32(stream, height);
+}
+
+void CommandCapture_RecordInvalidateState(CommandCaptureStream *stream) {
+    CommandCapture_WriteU32(stream, CAPTURE_OP_INVALIDATE_STATE);
+}
+
+void CommandCapture_RecordSetTextureData(CommandCaptureStream *stream, Texture *texture,
+    uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint8_t *pixelData, uint32_t dataLength) {
+    CommandCapture_WriteU32(stream, CAPTURE_OP_SET_TEXTURE_DATA);
+    CommandCapture_WriteObject(stream, texture, CAPTURE_OP_TEXTURE);
+    CommandCapture_WriteU32(stream, x);
+    CommandCapture_WriteU32(stream, y);
+    CommandCapture_WriteU32(stream, w);
+    CommandCapture_WriteU32(stream, h);
+    CommandCapture_WriteU32(stream, dataLength);
+    CommandCapture_WriteBytes(stream, pixelData, dataLength);
+}
+
+void CommandCapture_RecordSetParameter(CommandCaptureStream *stream,
+    ShaderProgram *shaderProgram, const char *name, uint32_t type, const void *value,
+    uint32_t size) {
+    assert(size % 4 == 0);
+
+    CommandCapture_WriteU32(stream, CAPTURE_OP_SET_PARAMETER);
+    CommandCapture_WriteObject(stream, shaderProgram, CAPTURE_OP_SHADER_PROGRAM);
+    CommandCapture_WriteU32(stream, type);
+    CommandCapture_WriteU32(stream, size);
+    CommandCapture_WriteBytes(stream, value, size);
+    CommandCapture_WriteString(stream, name);
+}
+
+void CommandCapture_RecordSetParameterTexture(CommandCaptureStream *stream,
+    ShaderProgram *shaderProgram, const char *name, Texture *texture, int32_t slotNumber) {
+    CommandCapture_WriteU32(stream, CAPTURE_OP_SET_PARAMETER_TEXTURE);
+    CommandCapture_WriteObject(stream, shaderProgram, CAPTURE_OP_SHADER_PROGRAM);
+    CommandCapture_WriteObject(stream, texture, CAPTURE_OP_TEXTURE);
+    CommandCapture_WriteU32(stream, (uint32_t)slotNumber);
+    CommandCapture_WriteString(stream, name);
+}
+
+void CommandCapture_RecordClearParameter(
+    CommandCaptureStream *stream, ShaderProgram *shaderProgram, const char *name) {
+    CommandCapture_WriteU32(stream, CAPTURE_OP_CLEAR_PARAMETER);
+    CommandCapture_WriteObject(stream, shaderProgram, CAPTURE_OP_SHADER_PROGRAM);
+    CommandCapture_WriteString(stream, name);
+}
+
+void CommandCapture_RecordBatchBegin(CommandCaptureStream *stream, BatchRenderer *batchRenderer,
+    BlendMode blendMode, Texture *texture, ShaderProgram *shaderProgram,
+    Matrix4 transformMatrix) {
+    CommandCapture_WriteU32(stream, CAPTURE_OP_BATCH_BEGIN);
+    CommandCapture_WriteBatchRenderer(stream, batchRenderer);
+    CommandCapture_WriteU32(stream, (uint32_t)blendMode);
+    CommandCapture_WriteObject(stream, texture, CAPTURE_OP_TEXTURE);
+    CommandCapture_WriteObject(stream, shaderProgram, CAPTURE_OP_SHADER_PROGRAM);
+    CommandCapture_WriteFloats(stream, transformMatrix, 16);
+}
+
+void CommandCapture_RecordBatchBeginMultiTexture(CommandCaptureStream *stream,
+    BatchRenderer *batchRenderer, BlendMode blendMode, ShaderProgram *shaderProgram,
+    Matrix4 transformMatrix) {
+    CommandCapture_WriteU32(stream, CAPTURE_OP_BATCH_BEGIN_MULTI_TEXTURE);
+    CommandCapture_WriteBatchRenderer(stream, batchRenderer);
+    CommandCapture_WriteU32(stream, (uint32_t)blendMode);
+    CommandCapture_WriteObject(stream, shaderProgram, CAPTURE_OP_SHADER_PROGRAM);
+    CommandCapture_WriteFloats(stream, transformMatrix, 16);
+}
+
+void CommandCapture_RecordBatchSetTexture(
+    CommandCaptureStream *stream, BatchRenderer *batchRenderer, Texture *texture) {
+    CommandCapture_WriteU32(stream, CAPTURE_OP_BATCH_SET_TEXTURE);
+    CommandCapture_WriteBatchRenderer(stream, batchRenderer);
+    CommandCapture_WriteObject(stream, texture, CAPTURE_OP_TEXTURE);
+}
+
+void CommandCapture_RecordBatchBeginDeferred(
+    CommandCaptureStream *stream, BatchRenderer *batchRenderer, Matrix4 transformMatrix) {
+    CommandCapture_WriteU32(stream, CAPTURE_OP_BATCH_BEGIN_DEFERRED);
+    CommandCapture_WriteBatchRenderer(stream, batchRenderer);
+    CommandCapture_WriteFloats(stream, transformMatrix, 16);
+}
+
+void CommandCapture_RecordBatchSetSortState(CommandCaptureStream *stream,
+    BatchRenderer *batchRenderer, uint8_t layer, BlendMode blendMode, Texture *texture,
+    ShaderProgram *shaderProgram, float depth) {
+    CommandCapture_WriteU32(stream, CAPTURE_OP_BATCH_SET_SORT_STATE);
+    CommandCapture_WriteBatchRenderer(stream, batchRenderer);
+    CommandCapture_WriteU32(stream, layer);
+    CommandCapture_WriteU32(stream, (uint32_t)blendMode);
+    CommandCapture_WriteObject(stream, texture, CAPTURE_OP_TEXTURE);
+    CommandCapture_WriteObject(stream, shaderProgram, CAPTURE_OP_SHADER_PROGRAM);
+    CommandCapture_WriteFloats(stream, &depth, 1);
+}
+
+void CommandCapture_RecordBatchEnd(CommandCaptureStream *stream, BatchRenderer *batchRenderer) {
+    CommandCapture_WriteU32(stream, CAPTURE_OP_BATCH_END);
+    CommandCapture_WriteBatchRenderer(stream, batchRenderer);
+}
+
+void CommandCapture_RecordBatchFlush(CommandCaptureStream *stream, BatchRenderer *batchRenderer) {
+    CommandCapture_WriteU32(stream, CAPTURE_OP_BATCH_FLUSH);
+    CommandCapture_WriteBatchRenderer(stream, batchRenderer);
+}
+
+void CommandCapture_RecordBatchSetCulling(
+    CommandCaptureStream *stream, BatchRenderer *batchRenderer, bool enabled) {
+    CommandCapture_WriteU32(stream, CAPTURE_OP_BATCH_SET_CULLING);
+    CommandCapture_WriteBatchRenderer(stream, batchRenderer);
+    CommandCapture_WriteU32(stream, enabled);
+}
+
+void CommandCapture_RecordBatchSetUploadStrategy(CommandCaptureStream *stream,
+    BatchRenderer *batchRenderer, VertexBufferUploadStrategy uploadStrategy) {
+    CommandCapture_WriteU32(stream, CAPTURE_OP_BATCH_SET_UPLOAD_STRATEGY);
+    CommandCapture_WriteBatchRenderer(stream, batchRenderer);
+    CommandCapture_WriteU32(stream, (uint32_t)uploadStrategy);
+}
+
+void CommandCapture_RecordBatchQuad(CommandCaptureStream *stream, BatchRenderer *batchRenderer,
+    Rectangle *sourceRectangle, Vector2 position, float rotation, Vector2 scale, Vector2 origin,
+    UVMode uvMode, Color *color) {
+    uint32_t flags = ((sourceRectangle != NULL) ? CAPTURE_QUAD_SOURCE_RECTANGLE : 0) |
+                     ((color != NULL) ? CAPTURE_QUAD_COLOR : 0);
+
+    CommandCapture_WriteU32(stream, CAPTURE_OP_BATCH_QUAD);
+    CommandCapture_WriteBatchRenderer(stream, batchRenderer);
+    CommandCapture_WriteU32(stream, flags);
+    CommandCapture_WriteFloats(stream, position, 2);
+    CommandCapture_WriteFloats(stream, &rotation, 1);
+    CommandCapture_WriteFloats(stream, scale, 2);
+    CommandCapture_WriteFloats(stream, origin, 2);
+    CommandCapture_WriteU32(stream, (uint32_t)uvMode);
+    if (sourceRectangle != NULL) {
+        CommandCapture_WriteRectangle(stream, sourceRectangle);
+    }
+    if (color != NULL) {
+        CommandCapture_WriteColor(stream, color);
+    }
+}
+
+void CommandCapture_RecordBatchQuadUV(CommandCaptureStream *stream,
+    BatchRenderer *batchRenderer, Vector2 uv0, Vector2 uv1, Vector2 xy0, Vector2 xy1,
+    Color *color) {
+    CommandCapture_WriteU32(stream, CAPTURE_OP_BATCH_QUAD_UV);
+    CommandCapture_WriteBatchRenderer(stream, batchRenderer);
+    CommandCapture_WriteU32(stream, (color != NULL) ? CAPTURE_QUAD_COLOR : 0);
+    CommandCapture_WriteFloats(stream, uv0, 2);
+    CommandCapture_WriteFloats(stream, uv1, 2);
+    CommandCapture_WriteFloats(stream, xy0, 2);
+    CommandCapture_WriteFloats(stream, xy1, 2);
+    if (color != NULL) {
+        CommandCapture_WriteColor(stream, color);
+    }
+}
+
+void CommandCapture_RecordBatchQuads(CommandCaptureStream *stream, BatchRenderer *batchRenderer,
+    const SpriteDesc *sprites, uint32_t spriteCount) {
+    CommandCapture_WriteU32(stream, CAPTURE_OP_BATCH_QUADS);
+    CommandCapture_WriteBatchRenderer(stream, batchRenderer);
+    CommandCapture_WriteU32(stream, spriteCount);
+    if (spriteCount > 0) {
+        CommandCapture_WriteBytes(stream, sprites, (size_t)spriteCount * sizeof(SpriteDesc));
+    }
+}
+
+void CommandCapture_RecordBatchTriangles(CommandCaptureStream *stream,
+    BatchRenderer *batchRenderer, Vertex2d *triangleVertices, int triangleCount) {
+    CommandCapture_WriteU32(stream, CAPTURE_OP_BATCH_TRIANGLES);
+    CommandCapture_WriteBatchRenderer(stream, batchRenderer);
+    CommandCapture_WriteU32(stream, (uint32_t)triangleCount);
+    CommandCapture_WriteBytes(
+        stream, triangleVertices, (size_t)triangleCount * 3 * sizeof(Vertex2d));
+}
+
+void CommandCapture_RecordBatchSubmitRecording(CommandCaptureStream *stream,
+    BatchRenderer *batchRenderer, CommandCaptureStream *recording, bool recordingEmpty) {
+    CommandCapture *commandCapture = stream->commandCapture;
+
+    // batches from before the recording's stream started would be missing from the replay
+    if (!recordingEmpty && (recording == NULL || !recording->started || recording->failed)) {
+        commandCapture->frameIncomplete = true;
+        return;
+    }
+
+    size_t size = 0;
+    if (recording != NULL && recording->started) {
+        for (uint32_t index = 0; index < recording->referenceCount; index++) {
+            CaptureReference *reference = &recording->references[index];
+            uint32_t id =
+                CommandCapture_DescribeObject(commandCapture, reference->object, reference->kind);
+            SDL_memcpy(recording->data + reference->offset, &id, sizeof(id));
+        }
+        size = recording->size;
+    }
+
+    CommandCapture_WriteU32(stream, CAPTURE_OP_BATCH_SUBMIT_RECORDING);
+    CommandCapture_WriteBatchRenderer(stream, batchRenderer);
+    CommandCapture_WriteU32(stream, (uint32_t)size);
+    if (size > 0) {
+        CommandCapture_WriteBytes(stream, recording->data, size);
+    }
+}
+
+#else
+
+CommandCapture *CommandCapture_Create(
+    GraphicsDevice *graphicsDevice, const char *fileName, uint32_t frameCount) {
+    SDL_Log("CommandCapture_Create failed, captures need a build with -Dcapture=true");
+    return NULL;
+}
+
+void CommandCapture_Destroy(CommandCapture *commandCapture) {
+}
+
+bool CommandCapture_IsFinished(CommandCapture *commandCapture) {
+    return true;
+}
+
+#endif
+
+typedef struct CommandReader {
+    uint8_t *data;
+    size_t size;
+    size_t offset;
+    bool failed;
+} CommandReader;
+
+struct CommandReplay {
+    uint8_t *data;
+    CommandCaptureHeader header;
+    CommandReader objectReader;
+    uint8_t **frames;
+    uint32_t *frameSizes;
+
+    GraphicsDevice *graphicsDevice;
+    // indexed by object id, kinds are CAPTURE_OP_BATCH_RENDERER, _TEXTURE or _SHADER_PROGRAM
+    uint32_t *objectKinds;
+    void **objects;
+    // made from the batch renderer with the same id the first time it submits a recording
+    BatchRenderer **recorders;
+
+    uint8_t *pixels;
+    size_t pixelCapacity;
+};
+
+// the next size bytes (padded to 4) in place, null once the reader is out of data
+static uint8_t *CommandReplay_ReadBytes(CommandReader *reader, size_t size) {
+    size_t paddedSize = (size + 3) & ~(size_t)3;
+    if (reader->failed || paddedSize < size || paddedSize > reader->size - reader->offset) {
+        reader->failed = true;
+        return NULL;
+    }
+
+    uint8_t *bytes = reader->data + reader->offset;
+    reader->offset += paddedSize;
+    return bytes;
+}
+
+static uint32_t CommandReplay_ReadU32(CommandReader *reader) {
+    uint32_t value = 0;
+    uint8_t *bytes = CommandReplay_ReadBytes(reader, sizeof(value));
+    if (bytes != NULL) {
+        SDL_memcpy(&value, bytes, sizeof(value));
+    }
+    return value;
+}
+
+static float CommandReplay_ReadFloat(CommandReader *reader) {
+    float value = 0;
+    uint8_t *bytes = CommandReplay_ReadBytes(reader, sizeof(value));
+    if (bytes != NULL) {
+        SDL_memcpy(&value, bytes, sizeof(value));
+    }
+    return value;
+}
+
+static void CommandReplay_ReadFloats(CommandReader *reader, float *values, uint32_t count) {
+    uint8_t *bytes = CommandReplay_ReadBytes(reader, count * sizeof(float));
+    if (bytes != NULL) {
+        SDL_memcpy(values, bytes, count * sizeof(float));
+    } else {
+        SDL_memset(values, 0, count * sizeof(float));
+    }
+}
+
+static Rectangle CommandReplay_ReadRectangle(CommandReader *reader) {
+    Rectangle rectangle;
+    rectangle.x = (int)CommandReplay_ReadU32(reader);
+    rectangle.y = (int)CommandReplay_ReadU32(reader);
+    rectangle.width = (int)CommandReplay_ReadU32(reader);
+    rectangle.height = (int)CommandReplay_ReadU32(reader);
+    return rectangle;
+}
+
+static Color CommandReplay_ReadColor(CommandReader *reader) {
+    Color color;
+    CommandReplay_ReadFloats(reader, &color.r, 4);
+    return color;
+}
+
+static BlendMode CommandReplay_ReadBlendMode(CommandReader *reader) {
+    uint32_t blendMode = CommandReplay_ReadU32(reader);
+    if (blendMode > BLEND_MODE_PREMULTIPLIED_ALPHA) {
+        reader->failed = true;
+        return BLEND_MODE_NONE;
+    }
+    return (BlendMode)blendMode;
+}
+
+static VertexBufferUploadStrategy CommandReplay_ReadUploadStrategy(CommandReader *reader) {
+    uint32_t uploadStrategy = CommandReplay_ReadU32(reader);
+    if (uploadStrategy > VERTEX_BUFFER_UPLOAD_PERSISTENT) {
+        reader->failed = true;
+        return VERTEX_BUFFER_UPLOAD_SUBDATA;
+    }
+    return (VertexBufferUploadStrategy)uploadStrategy;
+}
+
+static char *CommandReplay_ReadString(CommandReader *reader) {
+    uint32_t length = CommandReplay_ReadU32(reader);
+    char *string = (char *)CommandReplay_ReadBytes(reader, length);
+    if (string == NULL || length == 0 || string[length - 1] != '\0') {
+        reader->failed = true;
+        return NULL;
+    }
+    return string;
+}
+
+// the object with the id read next, which has to be of the given kind. 0 is null
+static void *CommandReplay_ReadObject(
+    CommandReplay *commandReplay, CommandReader *reader, CaptureOp kind) {
+    uint32_t id = CommandReplay_ReadU32(reader);
+    if (id == 0) {
+        return NULL;
+    }
+
+    if (id > commandReplay->header.objectCount || commandReplay->objectKinds[id] != kind ||
+        commandReplay->objects[id] == NULL) {
+        reader->failed = true;
+        return NULL;
+    }
+    return commandReplay->objects[id];
+}
+
+// the batch renderer read next, 0 is the recorder when playing a recording
+static BatchRenderer *CommandReplay_ReadBatchRenderer(
+    CommandReplay *commandReplay, CommandReader *reader, BatchRenderer *recorder) {
+    size_t offset = reader->offset;
+    if (CommandReplay_ReadU32(reader) == 0) {
+        if (recorder == NULL) {
+            reader->failed = true;
+        }
+        return recorder;
+    }
+
+    reader->offset = offset;
+    return CommandReplay_ReadObject(commandReplay, reader, CAPTURE_OP_BATCH_RENDERER);
+}
+
+static bool CommandReplay_SetParameter(ShaderProgram *shaderProgram, char *name, uint32_t type,
+    uint8_t *value, uint32_t size) {
+    // the values are 4 byte aligned in the file
+    float *f = (float *)value;
+    int *i = (int *)value;
+
+    switch (type) {
+    case GL_FLOAT_MAT4:
+        return size == 16 * sizeof(float) &&
+               ShaderProgram_SetParameterMatrix4(shaderProgram, name, f);
+    case GL_FLOAT:
+        return size == sizeof(float) && ShaderProgram_SetParameterFloat(shaderProgram, name, f[0]);
+    case GL_FLOAT_VEC2:
+        return size == 2 * sizeof(float) &&
+               ShaderProgram_SetParameterFloat2(shaderProgram, name, f);
+    case GL_FLOAT_VEC3:
+        return size == 3 * sizeof(float) &&
+               ShaderProgram_SetParameterFloat3(shaderProgram, name, f);
+    case GL_FLOAT_VEC4:
+        return size == 4 * sizeof(float) &&
+               ShaderProgram_SetParameterFloat4(shaderProgram, name, f);
+    case GL_INT:
+        return size == sizeof(int) && ShaderProgram_SetParameterInt(shaderProgram, name, i[0]);
+    case GL_INT_VEC2:
+        return size == 2 * sizeof(int) && ShaderProgram_SetParameterInt2(shaderProgram, name, i);
+    case GL_INT_VEC3:
+        return size == 3 * sizeof(int) && ShaderProgram_SetParameterInt3(shaderProgram, name, i);
+    case GL_INT_VEC4:
+        return size == 4 * sizeof(int) && ShaderProgram_SetParameterInt4(shaderProgram, name, i);
+    default:
+        return false;
+    }
+}
+
+// plays records until the reader runs out. recorder is the recorder a submitted recording plays
+// into, null for a frame
+static bool CommandReplay_PlayRecords(
+    CommandReplay *commandReplay, CommandReader *reader, BatchRenderer *recorder) {
+    GraphicsDevice *graphicsDevice = commandReplay->graphicsDevice;
+
+    while (!reader->failed && reader->offset < reader->size) {
+        CaptureOp op = (CaptureOp)CommandReplay_ReadU32(reader);
+
+        switch (op) {
+        case CAPTURE_OP_BEGIN_FRAME: {
+            Rectangle viewport = CommandReplay_ReadRectangle(reader);
+            GraphicsDevice_SetViewport(graphicsDevice, &viewport);
+            GraphicsDevice_BeginFrame(graphicsDevice);
+            break;
+        }
+        case CAPTURE_OP_END_FRAME:
+            GraphicsDevice_EndFrame(graphicsDevice);
+            break;
+        case CAPTURE_OP_PRESENT:
+            GraphicsDevice_Present(graphicsDevice);
+            break;
+        case CAPTURE_OP_CLEAR_SCREEN: {
+            Color color = CommandReplay_ReadColor(reader);
+            GraphicsDevice_ClearScreen(graphicsDevice, &color);
+            break;
+        }
+        case CAPTURE_OP_SET_VIEWPORT: {
+            Rectangle viewport = CommandReplay_ReadRectangle(reader);
+            GraphicsDevice_SetViewport(graphicsDevice, &viewport);
+            break;
+        }
+        case CAPTURE_OP_SET_BLEND_MODE: {
+            BlendMode blendMode = CommandReplay_ReadBlendMode(reader);
+            if (!reader->failed) {
+                GraphicsDevice_SetBlendMode(graphicsDevice, blendMode);
+            }
+            break;
+        }
+        case CAPTURE_OP_ENABLE_SCISSORS_RECTANGLE: {
+            Rectangle scissorsRectangle = CommandReplay_ReadRectangle(reader);
+            GraphicsDevice_EnableScissorsRectangle(graphicsDevice, &scissorsRectangle);
+            break;
+        }
+        case CAPTURE_OP_DISABLE_SCISSORS_RECTANGLE:
+            GraphicsDevice_DisableScissorsRectangle(graphicsDevice);
+            break;
+        case CAPTURE_OP_BIND_RENDER_TARGET: {
+            Texture *renderTarget =
+                CommandReplay_ReadObject(commandReplay, reader, CAPTURE_OP_TEXTURE);
+            bool setViewport = CommandReplay_ReadU32(reader) != 0;
+            if (renderTarget == NULL ||
+                Texture_GetTextureType(renderTarget) != TEXTURE_TYPE_RENDERTARGET) {
+                reader->failed = true;
+                break;
+            }
+            GraphicsDevice_BindRenderTarget(graphicsDevice, renderTarget, setViewport);
+            break;
+        }
+        case CAPTURE_OP_UNBIND_RENDER_TARGET:
+            GraphicsDevice_UnbindRenderTarget(graphicsDevice, CommandReplay_ReadU32(reader) != 0);
+            break;
+        case CAPTURE_OP_READ_PIXELS: {
+            uint32_t x = CommandReplay_ReadU32(reader);
+            uint32_t y = CommandReplay_ReadU32(reader);
+            uint32_t width = CommandReplay_ReadU32(reader);
+            uint32_t height = CommandReplay_ReadU32(reader);
+            size_t size = (size_t)width * height * 4;
+            if (size > commandReplay->pixelCapacity) {
+                uint8_t *pixels = SDL_realloc(commandReplay->pixels, size);
+                if (pixels == NULL) {
+                    SDL_Log("SDL_realloc failed");
+                    return false;
+                }
+                commandReplay->pixels = pixels;
+                commandReplay->pixelCapacity = size;
+            }
+            GraphicsDevice_ReadPixels(graphicsDevice, x, y, width, height, commandReplay->pixels);
+            break;
+        }
+        case CAPTURE_OP_INVALIDATE_STATE:
+            GraphicsDevice_InvalidateState(graphicsDevice);
+            break;
+        case CAPTURE_OP_SET_TEXTURE_DATA: {
+            Texture *texture = CommandReplay_ReadObject(commandReplay, reader, CAPTURE_OP_TEXTURE);
+            uint32_t x = CommandReplay_ReadU32(reader);
+            uint32_t y = CommandReplay_ReadU32(reader);
+            uint32_t w = CommandReplay_ReadU32(reader);
+            uint32_t h = CommandReplay_ReadU32(reader);
+            uint32_t dataLength = CommandReplay_ReadU32(reader);
+            uint8_t *pixelData = CommandReplay_ReadBytes(reader, dataLength);
+            if (texture == NULL || pixelData == NULL || dataLength != (uint64_t)w * h * 4 ||
+                (uint64_t)x + w > Texture_GetWidth(texture) ||
+                (uint64_t)y + h > Texture_GetHeight(texture)) {
+                reader->failed = true;
+                break;
+            }
+            Texture_SetTextureData(texture, x, y, w, h, pixelData, dataLength);
+            break;
+        }
+        case CAPTURE_OP_SET_PARAMETER: {
+            ShaderProgram *shaderProgram =
+                CommandReplay_ReadObject(commandReplay, reader, CAPTURE_OP_SHADER_PROGRAM);
+            uint32_t type = CommandReplay_ReadU32(reader);
+            uint32_t size = CommandReplay_ReadU32(reader);
+            uint8_t *value = CommandReplay_ReadBytes(reader, size);
+            char *name = CommandReplay_ReadString(reader);
+            if (shaderProgram == NULL || value == NULL || name == NULL) {
+                reader->failed = true;
+                break;
+            }
+            CommandReplay_SetParameter(shaderProgram, name, type, value, size);
+            break;
+        }
+        case CAPTURE_OP_SET_PARAMETER_TEXTURE: {
+            ShaderProgram *shaderProgram =
+                CommandReplay_ReadObject(commandReplay, reader, CAPTURE_OP_SHADER_PROGRAM);
+            Texture *texture = CommandReplay_ReadObject(commandReplay, reader, CAPTURE_OP_TEXTURE);
+            int32_t slotNumber = (int32_t)CommandReplay_ReadU32(reader);
+            char *name = CommandReplay_ReadString(reader);
+            if (shaderProgram == NULL || texture == NULL || name == NULL) {
+                reader->failed = true;
+                break;
+            }
+            ShaderProgram_SetParameterTexture2D(shaderProgram, name, texture, slotNumber);
+            break;
+        }
+        case CAPTURE_OP_CLEAR_PARAMETER: {
+            ShaderProgram *shaderProgram =
+                CommandReplay_ReadObject(commandReplay, reader, CAPTURE_OP_SHADER_PROGRAM);
+            char *name = CommandReplay_ReadString(reader);
+            if (shaderProgram == NULL || name == NULL) {
+                reader->failed = true;
+                break;
+            }
+            ShaderProgram_ClearParameter(shaderProgram, name);
+            break;
+        }
+        case CAPTURE_OP_BATCH_BEGIN: {
+            BatchRenderer *batchRenderer =
+                CommandReplay_ReadBatchRenderer(commandReplay, reader, recorder);
+            BlendMode blendMode = CommandReplay_ReadBlendMode(reader);
+            Texture *texture = CommandReplay_ReadObject(commandReplay, reader, CAPTURE_OP_TEXTURE);
+            ShaderProgram *shaderProgram =
+                CommandReplay_ReadObject(commandReplay, reader, CAPTURE_OP_SHADER_PROGRAM);
+            Matrix4 transformMatrix;
+            CommandReplay_ReadFloats(reader, transformMatrix, 16);
+            if (!reader->failed) {
+                BatchRenderer_Begin(
+                    batchRenderer, blendMode, texture, shaderProgram, transformMatrix);
+            }
+            break;
+        }
+        case CAPTURE_OP_BATCH_BEGIN_MULTI_TEXTURE: {
+            BatchRenderer *batchRenderer =
+                CommandReplay_ReadBatchRenderer(commandReplay, reader, recorder);
+            BlendMode blendMode = CommandReplay_ReadBlendMode(reader);
+            ShaderProgram *shaderProgram =
+                CommandReplay_ReadObject(commandReplay, reader, CAPTURE_OP_SHADER_PROGRAM);
+            Matrix4 transformMatrix;
+            CommandReplay_ReadFloats(reader, transformMatrix, 16);
+            if (!reader->failed) {
+                BatchRenderer_BeginMultiTexture(
+                    batchRenderer, blendMode, shaderProgram, transformMatrix);
+            }
+            break;
+        }
+        case CAPTURE_OP_BATCH_SET_TEXTURE: {
+            BatchRenderer *batchRenderer =
+                CommandReplay_ReadBatchRenderer(commandReplay, reader, recorder);
+            Texture *texture = CommandReplay_ReadObject(commandReplay, reader, CAPTURE_OP_TEXTURE);
+            if (texture == NULL) {
+                reader->failed = true;
+            }
+            if (!reader->failed) {
+                BatchRenderer_SetTexture(batchRenderer, texture);
+            }
+            break;
+        }
+        case CAPTURE_OP_BATCH_BEGIN_DEFERRED: {
+            BatchRenderer *batchRenderer =
+                CommandReplay_ReadBatchRenderer(commandReplay, reader, recorder);
+            Matrix4 transformMatrix;
+            CommandReplay_ReadFloats(reader, transformMatrix, 16);
+            if (!reader->failed) {
+                BatchRenderer_BeginDeferred(batchRenderer, transformMatrix);
+            }
+            break;
+        }
+        case CAPTURE_OP_BATCH_SET_SORT_STATE: {
+            BatchRenderer *batchRenderer =
+                CommandReplay_ReadBatchRenderer(commandReplay, reader, recorder);
+            uint8_t layer = (uint8_t)CommandReplay_ReadU32(reader);
+            BlendMode blendMode = CommandReplay_ReadBlendMode(reader);
+            Texture *texture = CommandReplay_ReadObject(commandReplay, reader, CAPTURE_OP_TEXTURE);
+            ShaderProgram *shaderProgram =
+                CommandReplay_ReadObject(commandReplay, reader, CAPTURE_OP_SHADER_PROGRAM);
+            float depth = CommandReplay_ReadFloat(reader);
+            if (!reader->failed) {
+                BatchRenderer_SetSortState(
+                    batchRenderer, layer, blendMode, texture, shaderProgram, depth);
+            }
+            break;
+        }
+        case CAPTURE_OP_BATCH_END: {
+            BatchRenderer *batchRenderer =
+                CommandReplay_ReadBatchRenderer(commandReplay, reader, recorder);
+            if (!reader->failed) {
+                BatchRenderer_End(batchRenderer);
+            }
+            break;
+        }
+        case CAPTURE_OP_BATCH_FLUSH: {
+            BatchRenderer *batchRenderer =
+                CommandReplay_ReadBatchRenderer(commandReplay, reader, recorder);
+            if (!reader->failed) {
+                BatchRenderer_Flush(batchRenderer);
+            }
+            break;
+        }
+        case CAPTURE_OP_BATCH_SET_CULLING: {
+            BatchRenderer *batchRenderer =
+                CommandReplay_ReadBatchRenderer(commandReplay, reader, recorder);
+            bool enabled = CommandReplay_ReadU32(reader) != 0;
+            if (!reader->failed) {
+                BatchRenderer_SetCulling(batchRenderer, enabled);
+            }
+            break;
+        }
+        case CAPTURE_OP_BATCH_SET_UPLOAD_STRATEGY: {
+            BatchRenderer *batchRenderer =
+                CommandReplay_ReadBatchRenderer(commandReplay, reader, recorder);
+            VertexBufferUploadStrategy uploadStrategy = CommandReplay_ReadUploadStrategy(reader);
+            if (!reader->failed) {
+                BatchRenderer_SetUploadStrategy(batchRenderer, uploadStrategy);
+            }
+            break;
+        }
+        case CAPTURE_OP_BATCH_QUAD: {
+            BatchRenderer *batchRenderer =
+                CommandReplay_ReadBatchRenderer(commandReplay, reader, recorder);
+            uint32_t flags = CommandReplay_ReadU32(reader);
+            Vector2 position, scale, origin;
+            CommandReplay_ReadFloats(reader, position, 2);
+            float rotation = CommandReplay_ReadFloat(reader);
+            CommandReplay_ReadFloats(reader, scale, 2);
+            CommandReplay_ReadFloats(reader, origin, 2);
+            UVMode uvMode = (UVMode)CommandReplay_ReadU32(reader);
+            Rectangle sourceRectangle;
+            Color color;
+            if (flags & CAPTURE_QUAD_SOURCE_RECTANGLE) {
+                sourceRectangle = CommandReplay_ReadRectangle(reader);
+            }
+            if (flags & CAPTURE_QUAD_COLOR) {
+                color = CommandReplay_ReadColor(reader);
+            }
+            if (!reader->failed) {
+                BatchRenderer_BatchQuad(batchRenderer,
+                    (flags & CAPTURE_QUAD_SOURCE_RECTANGLE) ? &sourceRectangle : NULL,
+                    position,
+                    rotation,
+                    scale,
+                    origin,
+                    uvMode,
+                    (flags & CAPTURE_QUAD_COLOR) ? &color : NULL);
+            }
+            break;
+        }
+        case CAPTURE_OP_BATCH_QUAD_UV: {
+            BatchRenderer *batchRenderer =
+                CommandReplay_ReadBatchRenderer(commandReplay, reader, recorder);
+            uint32_t flags = CommandReplay_ReadU32(reader);
+            Vector2 uv0, uv1, xy0, xy1;
+            CommandReplay_ReadFloats(reader, uv0, 2);
+            CommandReplay_ReadFloats(reader, uv1, 2);
+            CommandReplay_ReadFloats(reader, xy0, 2);
+            CommandReplay_ReadFloats(reader, xy1, 2);
+            Color color;
+            if (flags & CAPTURE_QUAD_COLOR) {
+                color = CommandReplay_ReadColor(reader);
+            }
+            if (!reader->failed) {
+                BatchRenderer_BatchQuadUV(batchRenderer,
+                    uv0,
+                    uv1,
+                    xy0,
+                    xy1,
+                    (flags & CAPTURE_QUAD_COLOR) ? &color : NULL);
+            }
+            break;
+        }
+        case CAPTURE_OP_BATCH_QUADS: {
+            BatchRenderer *batchRenderer =
+                CommandReplay_ReadBatchRenderer(commandReplay, reader, recorder);
+            uint32_t spriteCount = CommandReplay_ReadU32(reader);
+            uint8_t *sprites =
+                CommandReplay_ReadBytes(reader, (size_t)spriteCount * sizeof(SpriteDesc));
+            if (!reader->failed) {
+                BatchRenderer_BatchQuads(batchRenderer, (SpriteDesc *)sprites, spriteCount);
+            }
+            break;
+        }
+        case CAPTURE_OP_BATCH_TRIANGLES: {
+            BatchRenderer *batchRenderer =
+                CommandReplay_ReadBatchRenderer(commandReplay, reader, recorder);
+            uint32_t triangleCount = CommandReplay_ReadU32(reader);
+            uint8_t *triangleVertices =
+                CommandReplay_ReadBytes(reader, (size_t)triangleCount * 3 * sizeof(Vertex2d));
+            if (triangleCount == 0 || triangleCount > INT32_MAX) {
+                reader->failed = true;
+            }
+            if (!reader->failed) {
+                BatchRenderer_BatchTriangles(
+                    batchRenderer, (Vertex2d *)triangleVertices, (int)triangleCount);
+            }
+            break;
+        }
+        case CAPTURE_OP_BATCH_SUBMIT_RECORDING: {
+            uint32_t id = CommandReplay_ReadU32(reader);
+            uint32_t size = CommandReplay_ReadU32(reader);
+            uint8_t *records = CommandReplay_ReadBytes(reader, size);
+            if (recorder != NULL || id == 0 || id > commandReplay->header.objectCount ||
+                commandReplay->objectKinds[id] != CAPTURE_OP_BATCH_RENDERER || records == NULL) {
+                reader->failed = true;
+                break;
+            }
+
+            BatchRenderer *batchRenderer = commandReplay->objects[id];
+            if (commandReplay->recorders[id] == NULL) {
+                commandReplay->recorders[id] = BatchRenderer_CreateRecorder(batchRenderer);
+                if (commandReplay->recorders[id] == NULL) {
+                    SDL_Log("BatchRenderer_CreateRecorder failed");
+                    return false;
+                }
+            }
+
+            CommandReader recordingReader = {.data = records, .size = size};
+            if (!CommandReplay_PlayRecords(
+                    commandReplay, &recordingReader, commandReplay->recorders[id])) {
+                return false;
+            }
+            BatchRenderer_SubmitRecording(batchRenderer, commandReplay->recorders[id]);
+            break;
+        }
+        default:
+            reader->failed = true;
+            break;
+        }
+    }
+
+    if (reader->failed) {
+        SDL_Log("The capture is damaged at byte %zu of a %s",
+            reader->offset,
+            (recorder != NULL) ? "recording" : "frame");
+        return false;
+    }
+    return true;
+}
+
+CommandReplay *CommandReplay_Load(const char *fileName) {
+    assert(fileName != NULL);
+
+    size_t size;
+    uint8_t *data = SDL_LoadFile(fileName, &size);
+    if (data == NULL) {
+        SDL_Log("SDL_LoadFile failed %s", fileName);
+        return NULL;
+    }
+
+    CommandReplay *commandReplay = SDL_calloc(1, sizeof(CommandReplay));
+    if (commandReplay == NULL) {
+        SDL_Log("SDL_calloc failed");
+        SDL_free(data);
+        return NULL;
+    }
+    commandReplay->data = data;
+
+    CommandReader reader = {.data = data, .size = size};
+    uint8_t *header = CommandReplay_ReadBytes(&reader, sizeof(CommandCaptureHeader));
+    if (header == NULL) {
+        SDL_Log("%s is not a capture", fileName);
+        CommandReplay_Destroy(commandReplay);
+        return NULL;
+    }
+    SDL_memcpy(&commandReplay->header, header, sizeof(CommandCaptureHeader));
+
+    CommandCaptureHeader *captureHeader = &commandReplay->header;
+    if (SDL_memcmp(captureHeader->magic, COMMAND_CAPTURE_MAGIC, sizeof(captureHeader->magic)) !=
+            0 ||
+        captureHeader->version != COMMAND_CAPTURE_VERSION) {
+        SDL_Log("%s is not a capture of this version", fileName);
+        CommandReplay_Destroy(commandReplay);
+        return NULL;
+    }
+
+    uint8_t *objects = CommandReplay_ReadBytes(&reader, captureHeader->objectBytes);
+    commandReplay->objectReader =
+        (CommandReader){.data = objects, .size = captureHeader->objectBytes};
+
+    // every object takes at least its kind and id, every frame at least its size, so counts the
+    // file can't hold are damage and mustn't size the tables
+    size_t objectCount = captureHeader->objectCount;
+    size_t frameCount = captureHeader->frameCount;
+    if (reader.failed || objectCount > captureHeader->objectBytes / (2 * sizeof(uint32_t)) ||
+        frameCount > (reader.size - reader.offset) / sizeof(uint32_t)) {
+        SDL_Log("%s is cut short or damaged", fileName);
+        CommandReplay_Destroy(commandReplay);
+        return NULL;
+    }
+
+    commandReplay->objectKinds = SDL_calloc(objectCount + 1, sizeof(uint32_t));
+    commandReplay->objects = SDL_calloc(objectCount + 1, sizeof(void *));
+    commandReplay->recorders = SDL_calloc(objectCount + 1, sizeof(BatchRenderer *));
+    commandReplay->frames = SDL_calloc(frameCount + 1, sizeof(uint8_t *));
+    commandReplay->frameSizes = SDL_calloc(frameCount + 1, sizeof(uint32_t));
+    if (commandReplay->objectKinds == NULL || commandReplay->objects == NULL ||
+        commandReplay->recorders == NULL || commandReplay->frames == NULL ||
+        commandReplay->frameSizes == NULL) {
+        SDL_Log("SDL_calloc failed");
+        CommandReplay_Destroy(commandReplay);
+        return NULL;
+    }
+
+    for (size_t frame = 0; frame < frameCount; frame++) {
+        commandReplay->frameSizes[frame] = CommandReplay_ReadU32(&reader);
+        commandReplay->frames[frame] =
+            CommandReplay_ReadBytes(&reader, commandReplay->frameSizes[frame]);
+    }
+
+    if (reader.failed || reader.offset != reader.size) {
+        SDL_Log("%s is cut short or damaged", fileName);
+        CommandReplay_Destroy(commandReplay);
+        return NULL;
+    }
+
+    return commandReplay;
+}
+
+static void CommandReplay_DestroyObjects(CommandReplay *commandReplay) {
+    // a load that failed part way may have any of the tables
+    if (commandReplay->objects == NULL || commandReplay->recorders == NULL ||
+        commandReplay->objectKinds == NULL) {
+        return;
+    }
+
+    // recorders before their batch renderers, and batch renderers before the shaders and
+    // textures they may still hold
+    for (uint32_t id = 1; id <= commandReplay->header.objectCount; id++) {
+        if (commandReplay->recorders[id] != NULL) {
+            BatchRenderer_Destroy(commandReplay->recorders[id]);
+            commandReplay->recorders[id] = NULL;
+        }
+    }
+
+    CaptureOp order[] = {
+        CAPTURE_OP_BATCH_RENDERER, CAPTURE_OP_SHADER_PROGRAM, CAPTURE_OP_TEXTURE};
+    for (size_t kind = 0; kind < SDL_arraysize(order); kind++) {
+        for (uint32_t id = 1; id <= commandReplay->header.objectCount; id++) {
+            void *object = commandReplay->objects[id];
+            if (object == NULL || commandReplay->objectKinds[id] != order[kind]) {
+                continue;
+            }
+
+            switch (order[kind]) {
+            case CAPTURE_OP_BATCH_RENDERER:
+                BatchRenderer_Destroy(object);
+                break;
+            case CAPTURE_OP_SHADER_PROGRAM:
+                ShaderProgram_Destroy(object);
+                break;
+            case CAPTURE_OP_TEXTURE:
+                Texture_Destroy(object);
+                break;
+            default:
+                break;
+            }
+            commandReplay->objects[id] = NULL;
+        }
+    }
+
+    // the kinds are filled again by the next CreateObjects
+    SDL_memset(commandReplay->objectKinds,
+        0,
+        ((size_t)commandReplay->header.objectCount + 1) * sizeof(uint32_t));
+}
+
+void CommandReplay_Destroy(CommandReplay *commandReplay) {
+    assert(commandReplay != NULL);
+
+    CommandReplay_DestroyObjects(commandReplay);
+
+    SDL_free(commandReplay->pixels);
+    SDL_free(commandReplay->frameSizes);
+    SDL_free(commandReplay->frames);
+    SDL_free(commandReplay->recorders);
+    SDL_free(commandReplay->objects);
+    SDL_free(commandReplay->objectKinds);
+    SDL_free(commandReplay->data);
+    SDL_free(commandReplay);
+}
+
+uint32_t CommandReplay_GetFrameCount(CommandReplay *commandReplay) {
+    assert(commandReplay != NULL);
+
+    return commandReplay->header.frameCount;
+}
+
+void CommandReplay_GetSize(CommandReplay *commandReplay, uint32_t *width, uint32_t *height) {
+    assert(commandReplay != NULL);
+
+    *width = commandReplay->header.width;
+    *height = commandReplay->header.height;
+}
+
+static ShaderProgram *CommandReplay_CreateShaderProgram(GraphicsDevice *graphicsDevice,
+    uint8_t *vertexSource, uint32_t vertexLength, uint8_t *fragmentSource,
+    uint32_t fragmentLength) {
+    VertexShader *vertexShader =
+        VertexShader_CreateFromBuffer(graphicsDevice, vertexSource, vertexLength);
+    FragmentShader *fragmentShader =
+        FragmentShader_CreateFromBuffer(graphicsDevice, fragmentSource, fragmentLength);
+
+    ShaderProgram *shaderProgram = NULL;
+    if (vertexShader != NULL && fragmentShader != NULL) {
+        shaderProgram = ShaderProgram_Create(graphicsDevice, vertexShader, fragmentShader);
+    }
+
+    if (vertexShader != NULL) {
+        VertexShader_Destroy(vertexShader);
+    }
+    if (fragmentShader != NULL) {
+        FragmentShader_Destroy(fragmentShader);
+    }
+    return shaderProgram;
+}
+
+bool CommandReplay_CreateObjects(CommandReplay *commandReplay, GraphicsDevice *graphicsDevice) {
+    assert(commandReplay != NULL);
+    assert(graphicsDevice != NULL);
+
+    CommandReplay_DestroyObjects(commandReplay);
+    commandReplay->graphicsDevice = graphicsDevice;
+
+    CommandReader reader = commandReplay->objectReader;
+    while (!reader.failed && reader.offset < reader.size) {
+        CaptureOp kind = (CaptureOp)CommandReplay_ReadU32(&reader);
+        uint32_t id = CommandReplay_ReadU32(&reader);
+        if (id == 0 || id > commandReplay->header.objectCount ||
+            commandReplay->objectKinds[id] != 0) {
+            reader.failed = true;
+            break;
+        }
+        commandReplay->objectKinds[id] = kind;
+
+        void *object = NULL;
+        switch (kind) {
+        case CAPTURE_OP_BATCH_RENDERER: {
+            uint32_t maximumTriangles = CommandReplay_ReadU32(&reader);
+            VertexFormat vertexFormat = (VertexFormat)CommandReplay_ReadU32(&reader);
+            bool culling = CommandReplay_ReadU32(&reader) != 0;
+            VertexBufferUploadStrategy uploadStrategy = CommandReplay_ReadUploadStrategy(&reader);
+            if (reader.failed || maximumTriangles < 2) {
+                reader.failed = true;
+                break;
+            }
+
+            BatchRenderer *batchRenderer = BatchRenderer_CreateWithVertexFormat(
+                graphicsDevice, maximumTriangles, vertexFormat);
+            if (batchRenderer != NULL) {
+                BatchRenderer_SetCulling(batchRenderer, culling);
+                if (BatchRenderer_GetUploadStrategy(batchRenderer) != uploadStrategy) {
+                    BatchRenderer_SetUploadStrategy(batchRenderer, uploadStrategy);
+                }
+            }
+            object = batchRenderer;
+            break;
+        }
+        case CAPTURE_OP_TEXTURE: {
+            uint32_t width = CommandReplay_ReadU32(&reader);
+            uint32_t height = CommandReplay_ReadU32(&reader);
+            TextureFilter textureFilter = (TextureFilter)CommandReplay_ReadU32(&reader);
+            TextureType textureType = (TextureType)CommandReplay_ReadU32(&reader);
+            if (reader.failed || width == 0 || height == 0) {
+                reader.failed = true;
+                break;
+            }
+
+            // the pixels weren't captured, a blank texture costs the same to draw
+            object = Texture_CreateFromPixelData(
+                graphicsDevice, width, height, NULL, 0, textureFilter, textureType);
+            break;
+        }
+        case CAPTURE_OP_SHADER_PROGRAM: {
+            uint32_t vertexLength = CommandReplay_ReadU32(&reader);
+            uint8_t *vertexSource = CommandReplay_ReadBytes(&reader, vertexLength);
+            uint32_t fragmentLength = CommandReplay_ReadU32(&reader);
+            uint8_t *fragmentSource = CommandReplay_ReadBytes(&reader, fragmentLength);
+            if (reader.failed || vertexLength == 0 || fragmentLength == 0) {
+                reader.failed = true;
+                break;
+            }
+
+            object = CommandReplay_CreateShaderProgram(
+                graphicsDevice, vertexSource, vertexLength, fragmentSource, fragmentLength);
+            break;
+        }
+        default:
+            reader.failed = true;
+            break;
+        }
+
+        if (reader.failed) {
+            break;
+        }
+        if (object == NULL) {
+            SDL_Log("Creating object %u of the capture failed", id);
+            return false;
+        }
+        commandReplay->objects[id] = object;
+    }
+
+    if (reader.failed) {
+        SDL_Log("The capture's objects are damaged at byte %zu", reader.offset);
+        return false;
+    }
+    return true;
+}
+
+bool CommandReplay_PlayFrame(CommandReplay *commandReplay, uint32_t frameIndex) {
+    assert(commandReplay != NULL);
+    assert(commandReplay->graphicsDevice != NULL);
+
+    if (frameIndex >= commandReplay->header.frameCount) {
+        SDL_Log("CommandReplay_PlayFrame called with frame %u of %u",
+            frameIndex,
+            commandReplay->header.frameCount);
+        return false;
+    }
+
+    CommandReader reader = {
+        .data = commandReplay->frames[frameIndex],
+        .size = commandReplay->frameSizes[frameIndex],
+    };
+    return CommandReplay_PlayRecords(commandReplay, &reader, NULL);
+}
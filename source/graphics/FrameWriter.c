@@ -0,0 +1,402 @@
+#include <assert.h>
+
+#include <SDL3/SDL.h>
+
+#include <FrameWriter.h>
+#include <Trace.h>
+
+// longest run a stored deflate block can hold
+#define FRAME_WRITER_STORED_BLOCK 65535
+// the adler-32 modulus, and the most bytes that can be summed before the sums have to be reduced
+// by it without overflowing 32 bits
+#define FRAME_WRITER_ADLER_MODULUS 65521
+#define FRAME_WRITER_ADLER_RUN 5552
+// the largest frame queued, its png data chunk still fits the 31 bit chunk length
+#define FRAME_WRITER_MAXIMUM_FRAME_SIZE (1u << 30)
+
+typedef struct QueuedFrame {
+    uint8_t *pixels;
+    uint32_t capacity;
+    uint32_t width;
+    uint32_t height;
+    // set on the frame that tells the worker to stop
+    bool quit;
+} QueuedFrame;
+
+struct FrameWriter {
+    char *directory;
+    FrameWriterFormat format;
+    SDL_Thread *thread;
+
+    // the same handover as the render thread: each side only touches the frame at its own index
+    QueuedFrame *frames;
+    uint32_t frameCount;
+    SDL_Semaphore *freeFrames;
+    SDL_Semaphore *queuedFrames;
+    uint32_t queueIndex;
+    uint32_t writeIndex;
+
+    SDL_AtomicInt writtenFrames;
+    SDL_AtomicInt droppedFrames;
+
+    // the worker's
+    uint32_t crcTable[256];
+    uint8_t *encoded;
+    size_t encodedCapacity;
+    SDL_IOStream *rawStream;
+    uint32_t rawWidth;
+    uint32_t rawHeight;
+};
+
+static bool FrameWriter_Reserve(FrameWriter *frameWriter, size_t size) {
+    if (size <= frameWriter->encodedCapacity) {
+        return true;
+    }
+
+    uint8_t *encoded = SDL_realloc(frameWriter->encoded, size);
+    if (encoded == NULL) {
+        SDL_Log("SDL_realloc failed");
+        return false;
+    }
+
+    frameWriter->encoded = encoded;
+    frameWriter->encodedCapacity = size;
+    return true;
+}
+
+static uint8_t *FrameWriter_PutUint32(uint8_t *output, uint32_t value) {
+    output[0] = (uint8_t)(value >> 24);
+    output[1] = (uint8_t)(value >> 16);
+    output[2] = (uint8_t)(value >> 8);
+    output[3] = (uint8_t)value;
+    return output + 4;
+}
+
+static uint32_t FrameWriter_Crc(FrameWriter *frameWriter, const uint8_t *data, size_t length) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t index = 0; index < length; index++) {
+        crc = frameWriter->crcTable[(crc ^ data[index]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+// continues an adler-32 over data, the two sums are only reduced once per run of bytes
+static uint32_t FrameWriter_Adler(uint32_t adler, const uint8_t *data, size_t length) {
+    uint32_t a = adler & 0xFFFF;
+    uint32_t b = adler >> 16;
+    while (length > 0) {
+        size_t run = SDL_min(length, FRAME_WRITER_ADLER_RUN);
+        length -= run;
+        for (size_t index = 0; index < run; index++) {
+            a += data[index];
+            b += a;
+        }
+        data += run;
+        a %= FRAME_WRITER_ADLER_MODULUS;
+        b %= FRAME_WRITER_ADLER_MODULUS;
+    }
+    return (b << 16) | a;
+}
+
+// a png chunk around the length bytes already at data + 8, returns the end of the chunk
+static uint8_t *FrameWriter_FinishChunk(
+    FrameWriter *frameWriter, uint8_t *chunk, const char *type, uint32_t length) {
+    FrameWriter_PutUint32(chunk, length);
+    SDL_memcpy(chunk + 4, type, 4);
+    uint32_t crc = FrameWriter_Crc(frameWriter, chunk + 4, length + 4);
+    return FrameWriter_PutUint32(chunk + 8 + length, crc);
+}
+
+// an uncompressed png: the image data is zlib made of stored deflate blocks, so writing the file
+// costs a copy and the checksums. flips the rows to put the top one first
+static bool FrameWriter_WritePng(FrameWriter *frameWriter, QueuedFrame *frame, uint32_t number) {
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+    size_t rowSize = (size_t)frame->width * 4 + 1;
+    size_t rawSize = rowSize * frame->height;
+    size_t blockCount = (rawSize + FRAME_WRITER_STORED_BLOCK - 1) / FRAME_WRITER_STORED_BLOCK;
+    size_t dataSize = 2 + blockCount * 5 + rawSize + 4;
+    // signature, then chunks of 12 bytes around IHDR (13), IDAT and IEND (0)
+    size_t fileSize = 8 + (12 + 13) + (12 + dataSize) + 12;
+    if (dataSize > UINT32_MAX || !FrameWriter_Reserve(frameWriter, fileSize + rowSize)) {
+        return false;
+    }
+
+    uint8_t *output = frameWriter->encoded;
+    SDL_memcpy(output, signature, sizeof(signature));
+    output += sizeof(signature);
+
+    uint8_t *header = output + 8;
+    header = FrameWriter_PutUint32(header, frame->width);
+    header = FrameWriter_PutUint32(header, frame->height);
+    // 8 bit rgba, deflate, adaptive filtering, no interlace
+    SDL_memcpy(header, (uint8_t[]){8, 6, 0, 0, 0}, 5);
+    output = FrameWriter_FinishChunk(frameWriter, output, "IHDR", 13);
+
+    uint8_t *chunk = output;
+    output += 8;
+    *output++ = 0x78;
+    *output++ = 0x01;
+
+    // the rows are written out with their filter byte into the spare row past the file, then
+    // split into blocks along with the rest of the stream
+    uint32_t adler = 1;
+    size_t blockRemaining = 0;
+    size_t written = 0;
+    uint8_t *row = frameWriter->encoded + fileSize;
+    for (uint32_t y = 0; y < frame->height; y++) {
+        row[0] = 0;
+        SDL_memcpy(row + 1, frame->pixels + (size_t)(frame->height - 1 - y) * (rowSize - 1),
+            rowSize - 1);
+        adler = FrameWriter_Adler(adler, row, rowSize);
+
+        for (size_t offset = 0; offset < rowSize;) {
+            if (blockRemaining == 0) {
+                blockRemaining = SDL_min(rawSize - written, FRAME_WRITER_STORED_BLOCK);
+                *output++ = (written + blockRemaining == rawSize) ? 1 : 0;
+                *output++ = (uint8_t)blockRemaining;
+                *output++ = (uint8_t)(blockRemaining >> 8);
+                *output++ = (uint8_t)~blockRemaining;
+                *output++ = (uint8_t)(~blockRemaining >> 8);
+            }
+
+            size_t count = SDL_min(rowSize - offset, blockRemaining);
+            SDL_memcpy(output, row + offset, count);
+            output += count;
+            offset += count;
+            written += count;
+            blockRemaining -= count;
+        }
+    }
+    FrameWriter_PutUint32(output, adler);
+    output = FrameWriter_FinishChunk(frameWriter, chunk, "IDAT", (uint32_t)dataSize);
+
+    output = FrameWriter_FinishChunk(frameWriter, output, "IEND", 0);
+
+    char path[1024];
+    SDL_snprintf(path,
+        sizeof(path),
+        "%sframe%06u.png",
+        (frameWriter->directory != NULL) ? frameWriter->directory : "",
+        number);
+    if (!SDL_SaveFile(path, frameWriter->encoded, output - frameWriter->encoded)) {
+        SDL_Log("SDL_SaveFile failed %s: %s", path, SDL_GetError());
+        return false;
+    }
+    return true;
+}
+
+static bool FrameWriter_WriteRaw(FrameWriter *frameWriter, QueuedFrame *frame) {
+    if (frameWriter->rawStream == NULL) {
+        char path[1024];
+        SDL_snprintf(path,
+            sizeof(path),
+            "%sframes.rgba",
+            (frameWriter->directory != NULL) ? frameWriter->directory : "");
+        frameWriter->rawStream = SDL_IOFromFile(path, "wb");
+        if (frameWriter->rawStream == NULL) {
+            SDL_Log("SDL_IOFromFile failed %s: %s", path, SDL_GetError());
+            return false;
+        }
+        frameWriter->rawWidth = frame->width;
+        frameWriter->rawHeight = frame->height;
+    }
+
+    // raw video has no way to change size part way
+    if (frame->width != frameWriter->rawWidth || frame->height != frameWriter->rawHeight) {
+        SDL_Log("FrameWriter got a %ux%u frame for %ux%u raw video",
+            frame->width,
+            frame->height,
+            frameWriter->rawWidth,
+            frameWriter->rawHeight);
+        return false;
+    }
+
+    size_t rowSize = (size_t)frame->width * 4;
+    for (uint32_t y = 0; y < frame->height; y++) {
+        const uint8_t *row = frame->pixels + (size_t)(frame->height - 1 - y) * rowSize;
+        if (SDL_WriteIO(frameWriter->rawStream, row, rowSize) != rowSize) {
+            SDL_Log("SDL_WriteIO failed: %s", SDL_GetError());
+            return false;
+        }
+    }
+    return true;
+}
+
+static int FrameWriter_Run(void *userData) {
+    FrameWriter *frameWriter = userData;
+    uint32_t number = 0;
+
+    TRACE_THREAD_NAME("frame writer");
+
+    for (;;) {
+        SDL_WaitSemaphore(frameWriter->queuedFrames);
+
+        QueuedFrame *frame = &frameWriter->frames[frameWriter->writeIndex];
+        frameWriter->writeIndex = (frameWriter->writeIndex + 1) % frameWriter->frameCount;
+        if (frame->quit) {
+            break;
+        }
+
+        TRACE_BEGIN("FrameWriter_WriteFrame");
+        bool written = (frameWriter->format == FRAME_WRITER_FORMAT_PNG)
+                           ? FrameWriter_WritePng(frameWriter, frame, number)
+                           : FrameWriter_WriteRaw(frameWriter, frame);
+        TRACE_END();
+
+        if (written) {
+            number++;
+            SDL_AddAtomicInt(&frameWriter->writtenFrames, 1);
+        } else {
+            SDL_AddAtomicInt(&frameWriter->droppedFrames, 1);
+        }
+        SDL_SignalSemaphore(frameWriter->freeFrames);
+    }
+
+    if (frameWriter->rawStream != NULL) {
+        SDL_CloseIO(frameWriter->rawStream);
+    }
+    return 0;
+}
+
+static void FrameWriter_Free(FrameWriter *frameWriter) {
+    if (frameWriter->frames != NULL) {
+        for (uint32_t index = 0; index < frameWriter->frameCount; index++) {
+            SDL_free(frameWriter->frames[index].pixels);
+        }
+        SDL_free(frameWriter->frames);
+    }
+    if (frameWriter->queuedFrames != NULL) {
+        SDL_DestroySemaphore(frameWriter->queuedFrames);
+    }
+    if (frameWriter->freeFrames != NULL) {
+        SDL_DestroySemaphore(frameWriter->freeFrames);
+    }
+    SDL_free(frameWriter->encoded);
+    SDL_free(frameWriter->directory);
+    SDL_free(frameWriter);
+}
+
+FrameWriter *FrameWriter_Create(
+    const char *directory, FrameWriterFormat format, uint32_t maximumQueuedFrames) {
+    assert(maximumQueuedFrames > 0);
+
+    FrameWriter *frameWriter = SDL_calloc(1, sizeof(FrameWriter));
+    if (frameWriter == NULL) {
+        SDL_Log("SDL_calloc failed");
+        return NULL;
+    }
+
+    frameWriter->format = format;
+    // one more than can be queued, for the quit frame
+    frameWriter->frameCount = maximumQueuedFrames + 1;
+    frameWriter->frames = SDL_calloc(frameWriter->frameCount, sizeof(QueuedFrame));
+    if (frameWriter->frames == NULL) {
+        SDL_Log("SDL_calloc failed");
+        FrameWriter_Free(frameWriter);
+        return NULL;
+    }
+
+    if (directory != NULL) {
+        frameWriter->directory = SDL_strdup(directory);
+        if (frameWriter->directory == NULL) {
+            SDL_Log("SDL_strdup failed");
+            FrameWriter_Free(frameWriter);
+            return NULL;
+        }
+    }
+
+    for (uint32_t index = 0; index < 256; index++) {
+        uint32_t crc = index;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+        }
+        frameWriter->crcTable[index] = crc;
+    }
+
+    frameWriter->freeFrames = SDL_CreateSemaphore(maximumQueuedFrames);
+    frameWriter->queuedFrames = SDL_CreateSemaphore(0);
+    if (frameWriter->freeFrames == NULL || frameWriter->queuedFrames == NULL) {
+        SDL_Log("SDL_CreateSemaphore failed");
+        FrameWriter_Free(frameWriter);
+        return NULL;
+    }
+
+    frameWriter->thread = SDL_CreateThread(FrameWriter_Run, "frame writer", frameWriter);
+    if (frameWriter->thread == NULL) {
+        SDL_Log("SDL_CreateThread failed");
+        FrameWriter_Free(frameWriter);
+        return NULL;
+    }
+
+    return frameWriter;
+}
+
+void FrameWriter_Destroy(FrameWriter *frameWriter) {
+    assert(frameWriter != NULL);
+
+    // the quit frame has a slot of its own, so this never waits for the queue
+    QueuedFrame *frame = &frameWriter->frames[frameWriter->queueIndex];
+    frame->quit = true;
+    SDL_SignalSemaphore(frameWriter->queuedFrames);
+    SDL_WaitThread(frameWriter->thread, NULL);
+
+    FrameWriter_Free(frameWriter);
+}
+
+bool FrameWriter_QueueFrame(
+    FrameWriter *frameWriter, const uint8_t *pixels, uint32_t width, uint32_t height) {
+    assert(frameWriter != NULL);
+    assert(pixels != NULL);
+    assert(width > 0 && height > 0);
+
+    uint64_t size = (uint64_t)width * height * 4;
+    if (size > FRAME_WRITER_MAXIMUM_FRAME_SIZE) {
+        SDL_Log("FrameWriter frame of %ux%u is too large", width, height);
+        SDL_AddAtomicInt(&frameWriter->droppedFrames, 1);
+        return false;
+    }
+
+    if (!SDL_TryWaitSemaphore(frameWriter->freeFrames)) {
+        SDL_AddAtomicInt(&frameWriter->droppedFrames, 1);
+        return false;
+    }
+
+    QueuedFrame *frame = &frameWriter->frames[frameWriter->queueIndex];
+    if (frame->capacity < size) {
+        uint8_t *newPixels = SDL_realloc(frame->pixels, size);
+        if (newPixels == NULL) {
+            SDL_Log("SDL_realloc failed");
+            SDL_SignalSemaphore(frameWriter->freeFrames);
+            SDL_AddAtomicInt(&frameWriter->droppedFrames, 1);
+            return false;
+        }
+        frame->pixels = newPixels;
+        frame->capacity = (uint32_t)size;
+    }
+
+    SDL_memcpy(frame->pixels, pixels, size);
+    frame->width = width;
+    frame->height = height;
+
+    frameWriter->queueIndex = (frameWriter->queueIndex + 1) % frameWriter->frameCount;
+    SDL_SignalSemaphore(frameWriter->queuedFrames);
+    return true;
+}
+
+void FrameWriter_QueueReadback(
+    const uint8_t *pixels, uint32_t width, uint32_t height, void *userData) {
+    FrameWriter_QueueFrame((FrameWriter *)userData, pixels, width, height);
+}
+
+uint32_t FrameWriter_GetWrittenFrameCount(FrameWriter *frameWriter) {
+    assert(frameWriter != NULL);
+
+    return (uint32_t)SDL_GetAtomicInt(&frameWriter->writtenFrames);
+}
+
+uint32_t FrameWriter_GetDroppedFrameCount(FrameWriter *frameWriter) {
+    assert(frameWriter != NULL);
+
+    return (uint32_t)SDL_GetAtomicInt(&frameWriter->droppedFrames);
+}
@@ -3,15 +3,51 @@
 #include <glad/gl.h>
 #include <SDL3/SDL.h>
 
+#include <CommandCapture.h>
+#include <GameMath.h>
 #include <GraphicsDevice.h>
+#include <IndexBuffer.h>
+#include <NullDriver.h>
+#include <Profiler.h>
 #include <ShaderProgram.h>
 #include <Texture.h>
 #include <VertexBuffer.h>
 
+// texture units with a shadowed binding, higher units are always bound
+#define GRAPHICS_DEVICE_TEXTURE_SLOTS 32
+// shadowed binding that doesn't match anything, so the next bind is always issued
+#define GRAPHICS_DEVICE_UNKNOWN_BINDING 0xFFFFFFFF
+// asynchronous readbacks in flight at once
+#define GRAPHICS_DEVICE_READBACK_BUFFERS 4
+
+static const GLenum bufferTargets[BUFFER_TARGET_COUNT] = {
+    GL_ARRAY_BUFFER,
+    GL_ELEMENT_ARRAY_BUFFER,
+    GL_UNIFORM_BUFFER,
+    GL_COPY_WRITE_BUFFER,
+    GL_PIXEL_PACK_BUFFER,
+};
+
+// a pixel pack buffer for GraphicsDevice_ReadPixelsAsync, free while ticket is 0
+typedef struct GraphicsDeviceReadback {
+    uint32_t ticket;
+    uint32_t bufferId;
+    uint32_t capacity;
+    uint32_t width;
+    uint32_t height;
+    GLsync fence;
+    bool ready;
+    GraphicsDeviceReadbackCallback callback;
+    void *userData;
+} GraphicsDeviceReadback;
+
 struct GraphicsDevice {
     Rectangle viewport;
     Color clearColor;
 
+    GraphicsAPI api;
+    // the null api has no context, and with CreateHeadless no window either
+    SDL_Window *window;
     SDL_GLContext openglContext;
     BlendMode blendMode;
 
@@ -23,8 +59,94 @@ struct GraphicsDevice {
 
     uint32_t defaultFramebufferObject;
     uint32_t currentFramebufferObject;
+
+    // a headless device owns its hidden window and draws into this framebuffer instead
+    bool headless;
+    uint32_t headlessFramebuffer;
+    uint32_t headlessRenderbuffer;
+
+    uint32_t maximumTextureSlots;
+
+    // what gl has bound, as opposed to the logical state above
+    uint32_t activeTextureSlot;
+    uint32_t boundTextures[GRAPHICS_DEVICE_TEXTURE_SLOTS];
+    uint32_t boundProgram;
+    uint32_t boundVertexArray;
+    uint32_t boundBuffers[BUFFER_TARGET_COUNT];
+    uint32_t boundFramebuffer;
+    bool scissorTestEnabled;
+    Rectangle appliedScissorsRectangle;
+
+    uint64_t issuedStateCalls;
+    uint64_t elidedStateCalls;
+    uint64_t drawCalls;
+    uint64_t uploadedBytes;
+    uint64_t fenceWaits;
+    uint64_t fenceStalls;
+
+    // rebuilt lazily after the viewport or render target changes
+    Matrix4 projectionMatrix;
+    uint32_t projectionVersion;
+    bool projectionValid;
+
+    GraphicsDevicePendingFlush pendingFlush;
+    void *pendingFlushUserData;
+
+    // uniform buffers bound at UNIFORM_BLOCK_FRAME_CONSTANTS and UNIFORM_BLOCK_VIEW_CONSTANTS
+    uint32_t frameConstantsBufferId;
+    uint32_t viewConstantsBufferId;
+    FrameConstants frameConstants;
+    uint64_t startCounter;
+    uint64_t frameCounter;
+    // the projectionVersion the view constants were built from
+    uint32_t viewConstantsVersion;
+
+    char *shaderCacheDirectory;
+
+    Profiler *profiler;
+    // a CommandCapture, recorders check it from their own threads
+    void *commandCapture;
+
+    GraphicsDeviceReadback readbacks[GRAPHICS_DEVICE_READBACK_BUFFERS];
+    uint32_t lastReadbackTicket;
 };
 
+// true when value is different from the shadowed binding, which then takes it
+static bool GraphicsDevice_ChangeState(
+    GraphicsDevice *graphicsDevice, uint32_t *shadow, uint32_t value) {
+    if (*shadow == value) {
+        graphicsDevice->elidedStateCalls++;
+        return false;
+    }
+
+    *shadow = value;
+    graphicsDevice->issuedStateCalls++;
+    return true;
+}
+
+static void GraphicsDevice_SetScissorTest(GraphicsDevice *graphicsDevice, bool enabled) {
+    uint32_t shadow = graphicsDevice->scissorTestEnabled;
+    if (GraphicsDevice_ChangeState(graphicsDevice, &shadow, enabled)) {
+        graphicsDevice->scissorTestEnabled = enabled;
+        if (enabled) {
+            glEnable(GL_SCISSOR_TEST);
+        } else {
+            glDisable(GL_SCISSOR_TEST);
+        }
+    }
+}
+
+// creates a uniform buffer and binds it at its block's binding point for good
+static uint32_t GraphicsDevice_CreateUniformBuffer(GraphicsDevice *graphicsDevice,
+    UniformBlockBinding binding, const void *data, size_t size) {
+    uint32_t bufferId;
+    glGenBuffers(1, &bufferId);
+    GraphicsDevice_BindBuffer(graphicsDevice, BUFFER_TARGET_UNIFORM, bufferId);
+    glBufferData(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, bufferId);
+    return bufferId;
+}
+
 uint32_t GraphicsDevice_PrepareSDLWindowAttributes(GraphicsAPI api) {
     switch (api) {
     case GRAPHICS_API_OPENGL:
@@ -38,19 +160,18 @@ uint32_t GraphicsDevice_PrepareSDLWindowAttributes(GraphicsAPI api) {
         SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 0);
         return SDL_WINDOW_OPENGL;
 
+    case GRAPHICS_API_NULL:
+        return 0;
+
     default:
         SDL_Log("Unsupported GraphicsAPI type.");
         return 0;
     }
 }
 
-GraphicsDevice *GraphicsDevice_Create(
-    GraphicsAPI api, SDL_Window *window, VerticalSyncType vsyncType) {
-    assert(api == GRAPHICS_API_OPENGL);
-    assert(window != NULL);
-
-    GraphicsDevice *graphicsDevice = SDL_malloc(sizeof(GraphicsDevice));
-
+// makes the window's context current and loads gl through it
+static bool GraphicsDevice_CreateContext(
+    GraphicsDevice *graphicsDevice, SDL_Window *window, VerticalSyncType vsyncType) {
     graphicsDevice->openglContext = SDL_GL_CreateContext(window);
     SDL_GL_MakeCurrent(window, graphicsDevice->openglContext);
 
@@ -72,6 +193,24 @@ GraphicsDevice *GraphicsDevice_Create(
 
     if (!gladLoadGL((GLADloadfunc)SDL_GL_GetProcAddress)) {
         SDL_Log("gladLoadGL failed");
+        return false;
+    }
+
+    return true;
+}
+
+GraphicsDevice *GraphicsDevice_Create(
+    GraphicsAPI api, SDL_Window *window, VerticalSyncType vsyncType) {
+    assert(api == GRAPHICS_API_OPENGL || api == GRAPHICS_API_NULL);
+    assert(window != NULL || api == GRAPHICS_API_NULL);
+
+    GraphicsDevice *graphicsDevice = SDL_calloc(1, sizeof(GraphicsDevice));
+
+    graphicsDevice->api = api;
+    graphicsDevice->window = window;
+    if (api == GRAPHICS_API_NULL) {
+        NullDriver_Install();
+    } else if (!GraphicsDevice_CreateContext(graphicsDevice, window, vsyncType)) {
         SDL_free(graphicsDevice);
         return NULL;
     }
@@ -79,12 +218,16 @@ GraphicsDevice *GraphicsDevice_Create(
     glEnable(GL_BLEND);
     glDisable(GL_CULL_FACE);
 
-    SDL_GetWindowSizeInPixels(window, &graphicsDevice->windowWidth, &graphicsDevice->windowHeight);
+    if (window != NULL) {
+        SDL_GetWindowSizeInPixels(
+            window, &graphicsDevice->windowWidth, &graphicsDevice->windowHeight);
+    }
     glViewport(0, 0, graphicsDevice->windowWidth, graphicsDevice->windowHeight);
     graphicsDevice->viewport.x = 0;
     graphicsDevice->viewport.y = 0;
     graphicsDevice->viewport.width = graphicsDevice->windowWidth;
     graphicsDevice->viewport.height = graphicsDevice->windowHeight;
+    graphicsDevice->projectionVersion = 1;
 
     glClearColor(0, 0, 0, 1);
     graphicsDevice->clearColor = (Color){.r = 0, .g = 0, .b = 0, .a = 0};
@@ -96,6 +239,25 @@ GraphicsDevice *GraphicsDevice_Create(
 
     glGetIntegerv(GL_FRAMEBUFFER_BINDING, (int32_t *)&graphicsDevice->defaultFramebufferObject);
     graphicsDevice->currentFramebufferObject = graphicsDevice->defaultFramebufferObject;
+    graphicsDevice->boundFramebuffer = graphicsDevice->defaultFramebufferObject;
+
+    int32_t maximumTextureSlots;
+    glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &maximumTextureSlots);
+    graphicsDevice->maximumTextureSlots = maximumTextureSlots;
+
+    graphicsDevice->startCounter = SDL_GetPerformanceCounter();
+    graphicsDevice->frameCounter = graphicsDevice->startCounter;
+    graphicsDevice->frameConstants.resolution[0] = (float)graphicsDevice->windowWidth;
+    graphicsDevice->frameConstants.resolution[1] = (float)graphicsDevice->windowHeight;
+    graphicsDevice->frameConstantsBufferId =
+        GraphicsDevice_CreateUniformBuffer(graphicsDevice,
+            UNIFORM_BLOCK_FRAME_CONSTANTS,
+            &graphicsDevice->frameConstants,
+            sizeof(FrameConstants));
+    graphicsDevice->viewConstantsBufferId = GraphicsDevice_CreateUniformBuffer(graphicsDevice,
+        UNIFORM_BLOCK_VIEW_CONSTANTS,
+        NULL,
+        sizeof(ViewConstants));
 
     SDL_Log("GL: OpenGL device information:");
     SDL_Log("  Vendor:   %s", (const char *)glGetString(GL_VENDOR));
@@ -106,17 +268,215 @@ GraphicsDevice *GraphicsDevice_Create(
     return graphicsDevice;
 }
 
+GraphicsDevice *GraphicsDevice_CreateHeadless(GraphicsAPI api, uint32_t width, uint32_t height) {
+    assert(api == GRAPHICS_API_OPENGL || api == GRAPHICS_API_NULL);
+    assert(width > 0 && height > 0);
+
+    // the window is only there for the context, its size doesn't matter
+    SDL_Window *window = NULL;
+    if (api == GRAPHICS_API_OPENGL) {
+        uint32_t windowFlags = GraphicsDevice_PrepareSDLWindowAttributes(api);
+        window = SDL_CreateWindow("pinim headless", 1, 1, windowFlags | SDL_WINDOW_HIDDEN);
+        if (window == NULL) {
+            SDL_Log("SDL_CreateWindow failed: %s", SDL_GetError());
+            return NULL;
+        }
+    }
+
+    GraphicsDevice *graphicsDevice = GraphicsDevice_Create(api, window, VERTICAL_SYNC_DISABLED);
+    if (graphicsDevice == NULL) {
+        if (window != NULL) {
+            SDL_DestroyWindow(window);
+        }
+        return NULL;
+    }
+    graphicsDevice->headless = true;
+
+    glGenRenderbuffers(1, &graphicsDevice->headlessRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, graphicsDevice->headlessRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glGenFramebuffers(1, &graphicsDevice->headlessFramebuffer);
+    GraphicsDevice_BindFramebuffer(graphicsDevice, graphicsDevice->headlessFramebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER,
+        GL_COLOR_ATTACHMENT0,
+        GL_RENDERBUFFER,
+        graphicsDevice->headlessRenderbuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        SDL_Log("GraphicsDevice_CreateHeadless framebuffer isn't complete");
+        GraphicsDevice_Destroy(graphicsDevice);
+        return NULL;
+    }
+
+    // everything that would go to the window goes to the framebuffer
+    graphicsDevice->defaultFramebufferObject = graphicsDevice->headlessFramebuffer;
+    graphicsDevice->currentFramebufferObject = graphicsDevice->headlessFramebuffer;
+    graphicsDevice->windowWidth = width;
+    graphicsDevice->windowHeight = height;
+    graphicsDevice->frameConstants.resolution[0] = (float)width;
+    graphicsDevice->frameConstants.resolution[1] = (float)height;
+    GraphicsDevice_SetViewport(
+        graphicsDevice, &(Rectangle){.x = 0, .y = 0, .width = width, .height = height});
+
+    return graphicsDevice;
+}
+
+bool GraphicsDevice_IsHeadless(GraphicsDevice *graphicsDevice) {
+    assert(graphicsDevice != NULL);
+
+    return graphicsDevice->headless;
+}
+
+GraphicsAPI GraphicsDevice_GetGraphicsAPI(GraphicsDevice *graphicsDevice) {
+    assert(graphicsDevice != NULL);
+
+    return graphicsDevice->api;
+}
+
+void GraphicsDevice_GetNullDriverCounters(
+    GraphicsDevice *graphicsDevice, NullDriverCounters *counters) {
+    assert(graphicsDevice != NULL);
+    assert(counters != NULL);
+
+    if (graphicsDevice->api != GRAPHICS_API_NULL) {
+        SDL_memset(counters, 0, sizeof(NullDriverCounters));
+        return;
+    }
+
+    // held back draws count as handed over
+    GraphicsDevice_NotifyStateChange(graphicsDevice);
+    NullDriver_GetCounters(counters);
+}
+
+void GraphicsDevice_ResetNullDriverCounters(GraphicsDevice *graphicsDevice) {
+    assert(graphicsDevice != NULL);
+
+    if (graphicsDevice->api == GRAPHICS_API_NULL) {
+        GraphicsDevice_NotifyStateChange(graphicsDevice);
+        NullDriver_ResetCounters();
+    }
+}
+
 void GraphicsDevice_Destroy(GraphicsDevice *device) {
     assert(device != NULL);
 
+    GraphicsDevice_NotifyStateChange(device);
+    for (uint32_t index = 0; index < GRAPHICS_DEVICE_READBACK_BUFFERS; index++) {
+        GraphicsDeviceReadback *readback = &device->readbacks[index];
+        if (readback->fence != NULL) {
+            glDeleteSync(readback->fence);
+        }
+        if (readback->bufferId != 0) {
+            glDeleteBuffers(1, &readback->bufferId);
+        }
+    }
+    glDeleteBuffers(1, &device->frameConstantsBufferId);
+    glDeleteBuffers(1, &device->viewConstantsBufferId);
+    SDL_free(device->shaderCacheDirectory);
+
+    if (device->headless) {
+        glDeleteFramebuffers(1, &device->headlessFramebuffer);
+        glDeleteRenderbuffers(1, &device->headlessRenderbuffer);
+        if (device->api == GRAPHICS_API_OPENGL) {
+            SDL_GL_DestroyContext(device->openglContext);
+            SDL_DestroyWindow(device->window);
+        }
+    }
+    if (device->api == GRAPHICS_API_NULL) {
+        NullDriver_Uninstall();
+    }
     SDL_free(device);
 }
 
+bool GraphicsDevice_AcquireContext(GraphicsDevice *graphicsDevice) {
+    assert(graphicsDevice != NULL);
+
+    if (graphicsDevice->api == GRAPHICS_API_NULL) {
+        return true;
+    }
+
+    if (!SDL_GL_MakeCurrent(graphicsDevice->window, graphicsDevice->openglContext)) {
+        SDL_Log("SDL_GL_MakeCurrent failed: %s", SDL_GetError());
+        return false;
+    }
+    return true;
+}
+
+void GraphicsDevice_ReleaseContext(GraphicsDevice *graphicsDevice) {
+    assert(graphicsDevice != NULL);
+
+    // held back draws have to reach this context before another thread takes it
+    GraphicsDevice_NotifyStateChange(graphicsDevice);
+    glFlush();
+    if (graphicsDevice->api == GRAPHICS_API_OPENGL) {
+        SDL_GL_MakeCurrent(graphicsDevice->window, NULL);
+    }
+}
+
+void GraphicsDevice_Present(GraphicsDevice *graphicsDevice) {
+    assert(graphicsDevice != NULL);
+    COMMAND_CAPTURE_CALL(graphicsDevice, CommandCapture_RecordPresent);
+
+    GraphicsDevice_NotifyStateChange(graphicsDevice);
+
+    // nothing is shown, the frame is done once it's drawn
+    if (graphicsDevice->headless || graphicsDevice->api == GRAPHICS_API_NULL) {
+        return;
+    }
+
+    uint64_t start = SDL_GetPerformanceCounter();
+    SDL_GL_SwapWindow(graphicsDevice->window);
+    if (graphicsDevice->profiler != NULL) {
+        Profiler_AddPresentTime(graphicsDevice->profiler, SDL_GetPerformanceCounter() - start);
+    }
+}
+
+void GraphicsDevice_SetProfiler(GraphicsDevice *graphicsDevice, Profiler *profiler) {
+    assert(graphicsDevice != NULL);
+
+    graphicsDevice->profiler = profiler;
+}
+
+Profiler *GraphicsDevice_GetProfiler(GraphicsDevice *graphicsDevice) {
+    assert(graphicsDevice != NULL);
+
+    return graphicsDevice->profiler;
+}
+
+void GraphicsDevice_SetCommandCapture(
+    GraphicsDevice *graphicsDevice, CommandCapture *commandCapture) {
+    assert(graphicsDevice != NULL);
+
+    SDL_SetAtomicPointer(&graphicsDevice->commandCapture, commandCapture);
+}
+
+CommandCapture *GraphicsDevice_GetCommandCapture(GraphicsDevice *graphicsDevice) {
+    assert(graphicsDevice != NULL);
+
+    return SDL_GetAtomicPointer(&graphicsDevice->commandCapture);
+}
+
+// for viewport and render target changes, the held back draw goes out with the old projection
+static void GraphicsDevice_InvalidateProjection(GraphicsDevice *graphicsDevice) {
+    GraphicsDevice_NotifyStateChange(graphicsDevice);
+    graphicsDevice->projectionValid = false;
+    graphicsDevice->projectionVersion++;
+}
+
 void GraphicsDevice_SetViewport(GraphicsDevice *graphicsDevice, Rectangle *viewport) {
     assert(graphicsDevice != NULL);
     assert(viewport != NULL);
+    COMMAND_CAPTURE_CALL(graphicsDevice, CommandCapture_RecordSetViewport, viewport);
 
+    // the same viewport again changes nothing, not even the projection
+    if (SDL_memcmp(&graphicsDevice->viewport, viewport, sizeof(Rectangle)) == 0) {
+        graphicsDevice->elidedStateCalls++;
+        return;
+    }
+
+    GraphicsDevice_InvalidateProjection(graphicsDevice);
     graphicsDevice->viewport = *viewport;
+    graphicsDevice->issuedStateCalls++;
     glViewport(viewport->x, viewport->y, viewport->width, viewport->height);
 }
 
@@ -139,26 +499,42 @@ uint32_t GraphicsDevice_GetWindowHeight(GraphicsDevice *graphicsDevice) {
     return graphicsDevice->windowHeight;
 }
 
+uint32_t GraphicsDevice_GetMaximumTextureSlots(GraphicsDevice *graphicsDevice) {
+    assert(graphicsDevice != NULL);
+
+    return graphicsDevice->maximumTextureSlots;
+}
+
 void GraphicsDevice_ClearScreen(GraphicsDevice *graphicsDevice, Color *color) {
-    if (graphicsDevice->scissorsEnabled) {
-        glDisable(GL_SCISSOR_TEST);
-    }
+    COMMAND_CAPTURE_CALL(graphicsDevice, CommandCapture_RecordClearScreen, color);
+
+    GraphicsDevice_NotifyStateChange(graphicsDevice);
+
+    // clears ignore the scissors rectangle
+    GraphicsDevice_SetScissorTest(graphicsDevice, false);
 
     if (color->r != graphicsDevice->clearColor.r || color->g != graphicsDevice->clearColor.g ||
         color->b != graphicsDevice->clearColor.b || color->a != graphicsDevice->clearColor.a) {
         glClearColor(color->r, color->g, color->b, color->a);
         graphicsDevice->clearColor = *color;
+        graphicsDevice->issuedStateCalls++;
+    } else {
+        graphicsDevice->elidedStateCalls++;
     }
 
     glClear(GL_COLOR_BUFFER_BIT);
 
-    if (graphicsDevice->scissorsEnabled) {
-        glEnable(GL_SCISSOR_TEST);
-    }
+    GraphicsDevice_SetScissorTest(graphicsDevice, graphicsDevice->scissorsEnabled);
 }
 
 void GraphicsDevice_SetBlendMode(GraphicsDevice *graphicsDevice, BlendMode blendMode) {
+    COMMAND_CAPTURE_CALL(graphicsDevice, CommandCapture_RecordSetBlendMode, blendMode);
+
+    // before the early out, the held back draw may have left a different blend mode behind
+    GraphicsDevice_NotifyStateChange(graphicsDevice);
+
     if (graphicsDevice->blendMode == blendMode) {
+        graphicsDevice->elidedStateCalls++;
         return;
     }
 
@@ -185,12 +561,16 @@ void GraphicsDevice_SetBlendMode(GraphicsDevice *graphicsDevice, BlendMode blend
     }
 
     graphicsDevice->blendMode = blendMode;
+    graphicsDevice->issuedStateCalls++;
 }
 
 void GraphicsDevice_EnableScissorsRectangle(
     GraphicsDevice *graphicsDevice, Rectangle *scissorsRectangle) {
     assert(graphicsDevice != NULL);
+    COMMAND_CAPTURE_CALL(
+        graphicsDevice, CommandCapture_RecordEnableScissorsRectangle, scissorsRectangle);
 
+    GraphicsDevice_NotifyStateChange(graphicsDevice);
     graphicsDevice->scissorsEnabled = true;
     graphicsDevice->scissorsRectangle = *scissorsRectangle;
 
@@ -200,7 +580,17 @@ void GraphicsDevice_EnableScissorsRectangle(
                                               graphicsDevice->scissorsRectangle.height;
     }
 
-    glEnable(GL_SCISSOR_TEST);
+    GraphicsDevice_SetScissorTest(graphicsDevice, true);
+
+    if (SDL_memcmp(&graphicsDevice->appliedScissorsRectangle,
+            scissorsRectangle,
+            sizeof(Rectangle)) == 0) {
+        graphicsDevice->elidedStateCalls++;
+        return;
+    }
+
+    graphicsDevice->appliedScissorsRectangle = *scissorsRectangle;
+    graphicsDevice->issuedStateCalls++;
     glScissor(scissorsRectangle->x,
         scissorsRectangle->y,
         scissorsRectangle->width,
@@ -209,8 +599,10 @@ void GraphicsDevice_EnableScissorsRectangle(
 
 void GraphicsDevice_DisableScissorsRectangle(GraphicsDevice *graphicsDevice) {
     assert(graphicsDevice != NULL);
+    COMMAND_CAPTURE_CALL(graphicsDevice, CommandCapture_RecordDisableScissorsRectangle);
 
-    glDisable(GL_SCISSOR_TEST);
+    GraphicsDevice_NotifyStateChange(graphicsDevice);
+    GraphicsDevice_SetScissorTest(graphicsDevice, false);
     graphicsDevice->scissorsEnabled = false;
 }
 
@@ -219,9 +611,12 @@ void GraphicsDevice_BindRenderTarget(
     assert(graphicsDevice != NULL);
     assert(renderTarget != NULL);
     assert(Texture_GetTextureType(renderTarget) == TEXTURE_TYPE_RENDERTARGET);
+    COMMAND_CAPTURE_CALL(
+        graphicsDevice, CommandCapture_RecordBindRenderTarget, renderTarget, setViewport);
 
+    GraphicsDevice_InvalidateProjection(graphicsDevice);
     graphicsDevice->currentFramebufferObject = Texture_GetFramebufferId(renderTarget);
-    glBindFramebuffer(GL_FRAMEBUFFER, graphicsDevice->currentFramebufferObject);
+    GraphicsDevice_BindFramebuffer(graphicsDevice, graphicsDevice->currentFramebufferObject);
 
     if (setViewport) {
         GraphicsDevice_SetViewport(graphicsDevice,
@@ -234,9 +629,11 @@ void GraphicsDevice_BindRenderTarget(
 
 void GraphicsDevice_UnbindRenderTarget(GraphicsDevice *graphicsDevice, bool resetViewport) {
     assert(graphicsDevice != NULL);
+    COMMAND_CAPTURE_CALL(graphicsDevice, CommandCapture_RecordUnbindRenderTarget, resetViewport);
 
+    GraphicsDevice_InvalidateProjection(graphicsDevice);
     graphicsDevice->currentFramebufferObject = graphicsDevice->defaultFramebufferObject;
-    glBindFramebuffer(GL_FRAMEBUFFER, graphicsDevice->defaultFramebufferObject);
+    GraphicsDevice_BindFramebuffer(graphicsDevice, graphicsDevice->defaultFramebufferObject);
 
     if (resetViewport) {
         GraphicsDevice_SetViewport(graphicsDevice,
@@ -247,6 +644,45 @@ void GraphicsDevice_UnbindRenderTarget(GraphicsDevice *graphicsDevice, bool rese
     }
 }
 
+void GraphicsDevice_GetProjectionMatrix(GraphicsDevice *graphicsDevice, Matrix4 projectionMatrix) {
+    assert(graphicsDevice != NULL);
+
+    if (graphicsDevice->projectionValid) {
+        Matrix4_Copy(graphicsDevice->projectionMatrix, projectionMatrix);
+        return;
+    }
+
+    Rectangle viewport = graphicsDevice->viewport;
+
+    // render targets are stored bottom up, so they get a flipped projection to come out upright
+    if (graphicsDevice->currentFramebufferObject != graphicsDevice->defaultFramebufferObject) {
+        Matrix4_OrthoCamera(viewport.x,
+            (viewport.x + viewport.width),
+            viewport.y,
+            (viewport.y + viewport.height),
+            -1,
+            1000,
+            graphicsDevice->projectionMatrix);
+    } else {
+        Matrix4_OrthoCamera(viewport.x,
+            (viewport.x + viewport.width),
+            (viewport.y + viewport.height),
+            viewport.y,
+            -1,
+            1000,
+            graphicsDevice->projectionMatrix);
+    }
+
+    graphicsDevice->projectionValid = true;
+    Matrix4_Copy(graphicsDevice->projectionMatrix, projectionMatrix);
+}
+
+uint32_t GraphicsDevice_GetProjectionVersion(GraphicsDevice *graphicsDevice) {
+    assert(graphicsDevice != NULL);
+
+    return graphicsDevice->projectionVersion;
+}
+
 bool GraphicsDevice_IsUsingRenderTarget(GraphicsDevice *graphicsDevice) {
     assert(graphicsDevice != NULL);
 
@@ -259,62 +695,628 @@ void GraphicsDevice_ReadPixels(GraphicsDevice *graphicsDevice, uint32_t x, uint3
     assert(width > 0);
     assert(height > 0);
     assert(pixels != NULL);
+    COMMAND_CAPTURE_CALL(graphicsDevice, CommandCapture_RecordReadPixels, x, y, width, height);
 
+    GraphicsDevice_NotifyStateChange(graphicsDevice);
+    // with a pixel pack buffer bound the pixels would go into it instead
+    GraphicsDevice_BindBuffer(graphicsDevice, BUFFER_TARGET_PIXEL_PACK, 0);
     glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
 }
 
+uint32_t GraphicsDevice_ReadPixelsAsync(GraphicsDevice *graphicsDevice, uint32_t x, uint32_t y,
+    uint32_t width, uint32_t height, GraphicsDeviceReadbackCallback callback, void *userData) {
+    assert(graphicsDevice != NULL);
+    assert(width > 0);
+    assert(height > 0);
+
+    GraphicsDeviceReadback *readback = NULL;
+    for (uint32_t index = 0; index < GRAPHICS_DEVICE_READBACK_BUFFERS; index++) {
+        if (graphicsDevice->readbacks[index].ticket == 0) {
+            readback = &graphicsDevice->readbacks[index];
+            break;
+        }
+    }
+    if (readback == NULL) {
+        SDL_Log("GraphicsDevice_ReadPixelsAsync has all %d buffers in flight",
+            GRAPHICS_DEVICE_READBACK_BUFFERS);
+        return 0;
+    }
+
+    GraphicsDevice_NotifyStateChange(graphicsDevice);
+
+    if (readback->bufferId == 0) {
+        glGenBuffers(1, &readback->bufferId);
+    }
+    GraphicsDevice_BindBuffer(graphicsDevice, BUFFER_TARGET_PIXEL_PACK, readback->bufferId);
+
+    // buffers only grow, the same size every frame reuses the storage
+    uint32_t size = width * height * 4;
+    if (readback->capacity < size) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+        readback->capacity = size;
+    }
+
+    glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    readback->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    readback->width = width;
+    readback->height = height;
+    readback->ready = false;
+    readback->callback = callback;
+    readback->userData = userData;
+
+    // 0 is never a ticket
+    graphicsDevice->lastReadbackTicket++;
+    if (graphicsDevice->lastReadbackTicket == 0) {
+        graphicsDevice->lastReadbackTicket++;
+    }
+    readback->ticket = graphicsDevice->lastReadbackTicket;
+    return readback->ticket;
+}
+
+static GraphicsDeviceReadback *GraphicsDevice_FindReadback(
+    GraphicsDevice *graphicsDevice, uint32_t ticket) {
+    if (ticket == 0) {
+        return NULL;
+    }
+
+    for (uint32_t index = 0; index < GRAPHICS_DEVICE_READBACK_BUFFERS; index++) {
+        if (graphicsDevice->readbacks[index].ticket == ticket) {
+            return &graphicsDevice->readbacks[index];
+        }
+    }
+    return NULL;
+}
+
+// checks the readback's fence without waiting, or waits for it
+static bool GraphicsDevice_CheckReadback(GraphicsDeviceReadback *readback, bool wait) {
+    if (readback->ready) {
+        return true;
+    }
+
+    // the first check flushes so the fence is sure to reach the gpu
+    GLenum result = glClientWaitSync(readback->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    while (wait && result == GL_TIMEOUT_EXPIRED) {
+        result = glClientWaitSync(readback->fence, 0, 1000000);
+    }
+
+    if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+        if (result == GL_WAIT_FAILED) {
+            SDL_Log("glClientWaitSync failed for readback %u", readback->ticket);
+        }
+        return false;
+    }
+
+    glDeleteSync(readback->fence);
+    readback->fence = NULL;
+    readback->ready = true;
+    return true;
+}
+
+// maps a ready readback and hands its pixels to the callback, or copies them to pixels, then
+// frees the buffer for the next readback
+static bool GraphicsDevice_FinishReadback(
+    GraphicsDevice *graphicsDevice, GraphicsDeviceReadback *readback, uint8_t *pixels) {
+    uint32_t size = readback->width * readback->height * 4;
+    bool result = true;
+
+    GraphicsDevice_BindBuffer(graphicsDevice, BUFFER_TARGET_PIXEL_PACK, readback->bufferId);
+    const uint8_t *memory = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    if (memory == NULL) {
+        SDL_Log("glMapBufferRange failed for readback %u", readback->ticket);
+        result = false;
+    } else {
+        if (pixels != NULL) {
+            SDL_memcpy(pixels, memory, size);
+        } else {
+            readback->callback(memory, readback->width, readback->height, readback->userData);
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+
+    readback->ticket = 0;
+    readback->callback = NULL;
+    readback->userData = NULL;
+    return result;
+}
+
+ReadbackStatus GraphicsDevice_GetReadbackStatus(GraphicsDevice *graphicsDevice, uint32_t ticket) {
+    assert(graphicsDevice != NULL);
+
+    GraphicsDeviceReadback *readback = GraphicsDevice_FindReadback(graphicsDevice, ticket);
+    if (readback == NULL) {
+        return READBACK_STATUS_INVALID;
+    }
+
+    return GraphicsDevice_CheckReadback(readback, false) ? READBACK_STATUS_READY
+                                                         : READBACK_STATUS_PENDING;
+}
+
+bool GraphicsDevice_TakeReadback(GraphicsDevice *graphicsDevice, uint32_t ticket, uint8_t *pixels) {
+    assert(graphicsDevice != NULL);
+    assert(pixels != NULL);
+
+    GraphicsDeviceReadback *readback = GraphicsDevice_FindReadback(graphicsDevice, ticket);
+    if (readback == NULL || readback->callback != NULL) {
+        SDL_Log("GraphicsDevice_TakeReadback called with unknown ticket %u", ticket);
+        return false;
+    }
+
+    GraphicsDevice_NotifyStateChange(graphicsDevice);
+    if (!GraphicsDevice_CheckReadback(readback, true)) {
+        glDeleteSync(readback->fence);
+        readback->fence = NULL;
+        readback->ticket = 0;
+        return false;
+    }
+    return GraphicsDevice_FinishReadback(graphicsDevice, readback, pixels);
+}
+
+void GraphicsDevice_PollReadbacks(GraphicsDevice *graphicsDevice) {
+    assert(graphicsDevice != NULL);
+
+    for (uint32_t index = 0; index < GRAPHICS_DEVICE_READBACK_BUFFERS; index++) {
+        GraphicsDeviceReadback *readback = &graphicsDevice->readbacks[index];
+        if (readback->ticket == 0 || readback->callback == NULL) {
+            continue;
+        }
+
+        if (GraphicsDevice_CheckReadback(readback, false)) {
+            GraphicsDevice_NotifyStateChange(graphicsDevice);
+            GraphicsDevice_FinishReadback(graphicsDevice, readback, NULL);
+        }
+    }
+}
+
 void GraphicsDevice_ApplyShaderProgram(
     GraphicsDevice *graphicsDevice, ShaderProgram *shaderProgram) {
     assert(graphicsDevice != NULL);
     assert(shaderProgram != NULL);
 
-    glUseProgram(ShaderProgram_GetShaderId(shaderProgram));
+    GraphicsDevice_NotifyStateChange(graphicsDevice);
+    GraphicsDevice_UseProgram(graphicsDevice, ShaderProgram_GetShaderId(shaderProgram));
+
+    // once per viewport or render target change, however many programs draw with it
+    if (graphicsDevice->viewConstantsVersion != graphicsDevice->projectionVersion) {
+        ViewConstants viewConstants;
+        GraphicsDevice_GetProjectionMatrix(graphicsDevice, viewConstants.viewProjectionMatrix);
+        viewConstants.viewportSize[0] = (float)graphicsDevice->viewport.width;
+        viewConstants.viewportSize[1] = (float)graphicsDevice->viewport.height;
+        viewConstants.viewportOffset[0] = (float)graphicsDevice->viewport.x;
+        viewConstants.viewportOffset[1] = (float)graphicsDevice->viewport.y;
+
+        GraphicsDevice_BindBuffer(
+            graphicsDevice, BUFFER_TARGET_UNIFORM, graphicsDevice->viewConstantsBufferId);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(ViewConstants), &viewConstants);
+        graphicsDevice->uploadedBytes += sizeof(ViewConstants);
+        graphicsDevice->viewConstantsVersion = graphicsDevice->projectionVersion;
+    }
+}
+
+void GraphicsDevice_GetFrameConstants(GraphicsDevice *graphicsDevice, FrameConstants *constants) {
+    assert(graphicsDevice != NULL);
+    assert(constants != NULL);
+
+    *constants = graphicsDevice->frameConstants;
+}
+
+void GraphicsDevice_SetShaderCacheDirectory(GraphicsDevice *graphicsDevice, const char *directory) {
+    assert(graphicsDevice != NULL);
+
+    SDL_free(graphicsDevice->shaderCacheDirectory);
+    graphicsDevice->shaderCacheDirectory = (directory != NULL) ? SDL_strdup(directory) : NULL;
+}
+
+const char *GraphicsDevice_GetShaderCacheDirectory(GraphicsDevice *graphicsDevice) {
+    assert(graphicsDevice != NULL);
+
+    return graphicsDevice->shaderCacheDirectory;
+}
+
+void GraphicsDevice_UseProgram(GraphicsDevice *graphicsDevice, uint32_t programId) {
+    assert(graphicsDevice != NULL);
+
+    if (GraphicsDevice_ChangeState(graphicsDevice, &graphicsDevice->boundProgram, programId)) {
+        glUseProgram(programId);
+    }
+}
+
+void GraphicsDevice_BindVertexArray(GraphicsDevice *graphicsDevice, uint32_t vertexArrayId) {
+    assert(graphicsDevice != NULL);
+
+    if (GraphicsDevice_ChangeState(
+            graphicsDevice, &graphicsDevice->boundVertexArray, vertexArrayId)) {
+        glBindVertexArray(vertexArrayId);
+        // the element buffer comes with the vertex array, whatever it was bound to last
+        graphicsDevice->boundBuffers[BUFFER_TARGET_ELEMENT_ARRAY] = GRAPHICS_DEVICE_UNKNOWN_BINDING;
+    }
+}
+
+void GraphicsDevice_BindBuffer(
+    GraphicsDevice *graphicsDevice, BufferTarget target, uint32_t bufferId) {
+    assert(graphicsDevice != NULL);
+    assert(target < BUFFER_TARGET_COUNT);
+
+    if (GraphicsDevice_ChangeState(
+            graphicsDevice, &graphicsDevice->boundBuffers[target], bufferId)) {
+        glBindBuffer(bufferTargets[target], bufferId);
+    }
+}
+
+void GraphicsDevice_BindTexture(GraphicsDevice *graphicsDevice, uint32_t slot, uint32_t textureId) {
+    assert(graphicsDevice != NULL);
+
+    if (slot < GRAPHICS_DEVICE_TEXTURE_SLOTS && graphicsDevice->boundTextures[slot] == textureId) {
+        graphicsDevice->elidedStateCalls++;
+        return;
+    }
+
+    if (GraphicsDevice_ChangeState(graphicsDevice, &graphicsDevice->activeTextureSlot, slot)) {
+        glActiveTexture(GL_TEXTURE0 + slot);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, textureId);
+    graphicsDevice->issuedStateCalls++;
+
+    if (slot < GRAPHICS_DEVICE_TEXTURE_SLOTS) {
+        graphicsDevice->boundTextures[slot] = textureId;
+    }
+}
+
+void GraphicsDevice_BindTextureForUpdate(GraphicsDevice *graphicsDevice, uint32_t textureId) {
+    assert(graphicsDevice != NULL);
+
+    // before the first bind there is no active unit yet
+    uint32_t slot = graphicsDevice->activeTextureSlot;
+    if (slot == GRAPHICS_DEVICE_UNKNOWN_BINDING) {
+        slot = 0;
+    }
+
+    GraphicsDevice_BindTexture(graphicsDevice, slot, textureId);
+}
+
+void GraphicsDevice_BindFramebuffer(GraphicsDevice *graphicsDevice, uint32_t framebufferId) {
+    assert(graphicsDevice != NULL);
+
+    if (GraphicsDevice_ChangeState(
+            graphicsDevice, &graphicsDevice->boundFramebuffer, framebufferId)) {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebufferId);
+    }
+}
+
+void GraphicsDevice_RestoreFramebuffer(GraphicsDevice *graphicsDevice) {
+    GraphicsDevice_BindFramebuffer(graphicsDevice, graphicsDevice->currentFramebufferObject);
+}
+
+void GraphicsDevice_ForgetProgram(GraphicsDevice *graphicsDevice, uint32_t programId) {
+    assert(graphicsDevice != NULL);
+
+    // a deleted program stays in use until another one is, and its id can come back for a new one
+    if (graphicsDevice->boundProgram == programId) {
+        graphicsDevice->boundProgram = GRAPHICS_DEVICE_UNKNOWN_BINDING;
+    }
+}
+
+void GraphicsDevice_ForgetVertexArray(GraphicsDevice *graphicsDevice, uint32_t vertexArrayId) {
+    assert(graphicsDevice != NULL);
+
+    if (graphicsDevice->boundVertexArray == vertexArrayId) {
+        graphicsDevice->boundVertexArray = 0;
+        graphicsDevice->boundBuffers[BUFFER_TARGET_ELEMENT_ARRAY] = GRAPHICS_DEVICE_UNKNOWN_BINDING;
+    }
+}
+
+void GraphicsDevice_ForgetBuffer(GraphicsDevice *graphicsDevice, uint32_t bufferId) {
+    assert(graphicsDevice != NULL);
+
+    for (uint32_t target = 0; target < BUFFER_TARGET_COUNT; target++) {
+        if (graphicsDevice->boundBuffers[target] == bufferId) {
+            graphicsDevice->boundBuffers[target] = 0;
+        }
+    }
+}
+
+void GraphicsDevice_ForgetTexture(GraphicsDevice *graphicsDevice, uint32_t textureId) {
+    assert(graphicsDevice != NULL);
+
+    for (uint32_t slot = 0; slot < GRAPHICS_DEVICE_TEXTURE_SLOTS; slot++) {
+        if (graphicsDevice->boundTextures[slot] == textureId) {
+            graphicsDevice->boundTextures[slot] = 0;
+        }
+    }
+}
+
+void GraphicsDevice_ForgetFramebuffer(GraphicsDevice *graphicsDevice, uint32_t framebufferId) {
+    assert(graphicsDevice != NULL);
+
+    if (graphicsDevice->boundFramebuffer == framebufferId) {
+        graphicsDevice->boundFramebuffer = 0;
+    }
+}
+
+void GraphicsDevice_InvalidateState(GraphicsDevice *graphicsDevice) {
+    assert(graphicsDevice != NULL);
+    COMMAND_CAPTURE_CALL(graphicsDevice, CommandCapture_RecordInvalidateState);
+
+    GraphicsDevice_NotifyStateChange(graphicsDevice);
+
+    graphicsDevice->activeTextureSlot = GRAPHICS_DEVICE_UNKNOWN_BINDING;
+    for (uint32_t slot = 0; slot < GRAPHICS_DEVICE_TEXTURE_SLOTS; slot++) {
+        graphicsDevice->boundTextures[slot] = GRAPHICS_DEVICE_UNKNOWN_BINDING;
+    }
+    for (uint32_t target = 0; target < BUFFER_TARGET_COUNT; target++) {
+        graphicsDevice->boundBuffers[target] = GRAPHICS_DEVICE_UNKNOWN_BINDING;
+    }
+    graphicsDevice->boundProgram = GRAPHICS_DEVICE_UNKNOWN_BINDING;
+    graphicsDevice->boundVertexArray = GRAPHICS_DEVICE_UNKNOWN_BINDING;
+    graphicsDevice->boundFramebuffer = GRAPHICS_DEVICE_UNKNOWN_BINDING;
+    GraphicsDevice_RestoreFramebuffer(graphicsDevice);
+
+    Rectangle *viewport = &graphicsDevice->viewport;
+    glViewport(viewport->x, viewport->y, viewport->width, viewport->height);
+
+    if (graphicsDevice->scissorsEnabled) {
+        Rectangle *scissorsRectangle = &graphicsDevice->appliedScissorsRectangle;
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(scissorsRectangle->x,
+            scissorsRectangle->y,
+            scissorsRectangle->width,
+            scissorsRectangle->height);
+    } else {
+        glDisable(GL_SCISSOR_TEST);
+    }
+    graphicsDevice->scissorTestEnabled = graphicsDevice->scissorsEnabled;
+
+    BlendMode blendMode = graphicsDevice->blendMode;
+    graphicsDevice->blendMode = BLEND_MODE_INVALID;
+    GraphicsDevice_SetBlendMode(graphicsDevice, blendMode);
+
+    Color *clearColor = &graphicsDevice->clearColor;
+    glClearColor(clearColor->r, clearColor->g, clearColor->b, clearColor->a);
+}
+
+void GraphicsDevice_GetStateCallCounts(
+    GraphicsDevice *graphicsDevice, uint64_t *issuedCalls, uint64_t *elidedCalls) {
+    assert(graphicsDevice != NULL);
+
+    if (issuedCalls != NULL) {
+        *issuedCalls = graphicsDevice->issuedStateCalls;
+    }
+    if (elidedCalls != NULL) {
+        *elidedCalls = graphicsDevice->elidedStateCalls;
+    }
+}
+
+void GraphicsDevice_ResetStateCallCounts(GraphicsDevice *graphicsDevice) {
+    assert(graphicsDevice != NULL);
+
+    graphicsDevice->issuedStateCalls = 0;
+    graphicsDevice->elidedStateCalls = 0;
+}
+
+void GraphicsDevice_GetWorkCounts(
+    GraphicsDevice *graphicsDevice, uint64_t *drawCalls, uint64_t *uploadedBytes) {
+    assert(graphicsDevice != NULL);
+
+    // held back draws count as issued
+    GraphicsDevice_NotifyStateChange(graphicsDevice);
+
+    if (drawCalls != NULL) {
+        *drawCalls = graphicsDevice->drawCalls;
+    }
+    if (uploadedBytes != NULL) {
+        *uploadedBytes = graphicsDevice->uploadedBytes;
+    }
+}
+
+void GraphicsDevice_ResetWorkCounts(GraphicsDevice *graphicsDevice) {
+    assert(graphicsDevice != NULL);
+
+    GraphicsDevice_NotifyStateChange(graphicsDevice);
+    graphicsDevice->drawCalls = 0;
+    graphicsDevice->uploadedBytes = 0;
+    graphicsDevice->fenceWaits = 0;
+    graphicsDevice->fenceStalls = 0;
+}
+
+void GraphicsDevice_AddUploadedBytes(GraphicsDevice *graphicsDevice, uint64_t bytes) {
+    assert(graphicsDevice != NULL);
+
+    graphicsDevice->uploadedBytes += bytes;
+}
+
+void GraphicsDevice_GetFenceWaits(
+    GraphicsDevice *graphicsDevice, uint64_t *fenceWaits, uint64_t *fenceStalls) {
+    assert(graphicsDevice != NULL);
+
+    if (fenceWaits != NULL) {
+        *fenceWaits = graphicsDevice->fenceWaits;
+    }
+    if (fenceStalls != NULL) {
+        *fenceStalls = graphicsDevice->fenceStalls;
+    }
+}
+
+void GraphicsDevice_AddFenceWait(GraphicsDevice *graphicsDevice, bool stalled) {
+    assert(graphicsDevice != NULL);
+
+    graphicsDevice->fenceWaits++;
+    if (stalled) {
+        graphicsDevice->fenceStalls++;
+    }
 }
 
 void GraphicsDevice_BeginFrame(GraphicsDevice *graphicsDevice) {
     assert(graphicsDevice != NULL);
+
+    // draws held back from the last frame still belong to it
+    GraphicsDevice_NotifyStateChange(graphicsDevice);
+
+    COMMAND_CAPTURE_BEGIN_FRAME(graphicsDevice);
+
+    if (graphicsDevice->profiler != NULL) {
+        Profiler_BeginFrame(graphicsDevice->profiler);
+    }
+
+    uint64_t counter = SDL_GetPerformanceCounter();
+    double frequency = (double)SDL_GetPerformanceFrequency();
+    FrameConstants *frameConstants = &graphicsDevice->frameConstants;
+    frameConstants->time = (float)((counter - graphicsDevice->startCounter) / frequency);
+    frameConstants->deltaTime = (float)((counter - graphicsDevice->frameCounter) / frequency);
+    frameConstants->frameIndex++;
+    frameConstants->resolution[0] = (float)graphicsDevice->windowWidth;
+    frameConstants->resolution[1] = (float)graphicsDevice->windowHeight;
+    graphicsDevice->frameCounter = counter;
+
+    GraphicsDevice_BindBuffer(
+        graphicsDevice, BUFFER_TARGET_UNIFORM, graphicsDevice->frameConstantsBufferId);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameConstants), frameConstants);
+    graphicsDevice->uploadedBytes += sizeof(FrameConstants);
 }
 void GraphicsDevice_EndFrame(GraphicsDevice *graphicsDevice) {
     assert(graphicsDevice != NULL);
+    COMMAND_CAPTURE_CALL(graphicsDevice, CommandCapture_RecordEndFrame);
+
+    GraphicsDevice_NotifyStateChange(graphicsDevice);
+
+    if (graphicsDevice->profiler != NULL) {
+        Profiler_EndFrame(graphicsDevice->profiler);
+    }
+
+    GraphicsDevice_PollReadbacks(graphicsDevice);
 }
 
-void GraphicsDevice_DrawPrimitives(GraphicsDevice *graphicsDevice, VertexBuffer *vertexBuffer,
-    RenderPrimitiveType primitiveType, uint32_t vertexStart, uint32_t primitiveCount) {
+void GraphicsDevice_SetPendingFlush(
+    GraphicsDevice *graphicsDevice, GraphicsDevicePendingFlush flush, void *userData) {
     assert(graphicsDevice != NULL);
-    assert(vertexBuffer != NULL);
-    assert(primitiveCount > 0);
+    assert(flush != NULL);
+
+    if (graphicsDevice->pendingFlushUserData != userData) {
+        GraphicsDevice_NotifyStateChange(graphicsDevice);
+    }
 
-    glBindVertexArray(VertexBuffer_GetArrayId(vertexBuffer));
-    glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer_GetBufferId(vertexBuffer));
+    graphicsDevice->pendingFlush = flush;
+    graphicsDevice->pendingFlushUserData = userData;
+}
 
-    int vertexCount;
-    GLenum mode;
+void GraphicsDevice_CancelPendingFlush(GraphicsDevice *graphicsDevice, void *userData) {
+    assert(graphicsDevice != NULL);
 
+    if (graphicsDevice->pendingFlushUserData == userData) {
+        graphicsDevice->pendingFlush = NULL;
+        graphicsDevice->pendingFlushUserData = NULL;
+    }
+}
+
+void GraphicsDevice_NotifyStateChange(GraphicsDevice *graphicsDevice) {
+    GraphicsDevicePendingFlush flush = graphicsDevice->pendingFlush;
+    if (flush == NULL) {
+        return;
+    }
+
+    // cleared first, the flush itself goes through the device calls that end up back here
+    void *userData = graphicsDevice->pendingFlushUserData;
+    graphicsDevice->pendingFlush = NULL;
+    graphicsDevice->pendingFlushUserData = NULL;
+    flush(userData);
+}
+
+// converts a primitive count to the GL mode and the number of vertices (or indices) it takes
+static bool GraphicsDevice_GetPrimitiveMode(RenderPrimitiveType primitiveType,
+    uint32_t primitiveCount, GLenum *mode, int *vertexCount) {
     switch (primitiveType) {
     case RENDER_PRIMITIVE_TRIANGLES:
-        vertexCount = primitiveCount * 3;
-        mode = GL_TRIANGLES;
-        break;
+        *vertexCount = primitiveCount * 3;
+        *mode = GL_TRIANGLES;
+        return true;
     case RENDER_PRIMITIVE_TRIANGLE_STRIP:
-        vertexCount = primitiveCount + 2;
-        mode = GL_TRIANGLE_STRIP;
-        break;
+        *vertexCount = primitiveCount + 2;
+        *mode = GL_TRIANGLE_STRIP;
+        return true;
     case RENDER_PRIMITIVE_LINES:
-        vertexCount = primitiveCount * 2;
-        mode = GL_LINES;
-        break;
+        *vertexCount = primitiveCount * 2;
+        *mode = GL_LINES;
+        return true;
     case RENDER_PRIMITIVE_LINE_STRIP:
-        vertexCount = primitiveCount + 1;
-        mode = GL_LINE_STRIP;
-        break;
+        *vertexCount = primitiveCount + 1;
+        *mode = GL_LINE_STRIP;
+        return true;
     case RENDER_PRIMITIVE_POINTS:
-        vertexCount = primitiveCount;
-        mode = GL_POINTS;
-        break;
+        *vertexCount = primitiveCount;
+        *mode = GL_POINTS;
+        return true;
     default:
         SDL_Log("Unsupported PrimitiveType: %d", primitiveType);
+        return false;
+    }
+}
+
+void GraphicsDevice_DrawPrimitives(GraphicsDevice *graphicsDevice, VertexBuffer *vertexBuffer,
+    RenderPrimitiveType primitiveType, uint32_t vertexStart, uint32_t primitiveCount) {
+    assert(graphicsDevice != NULL);
+    assert(vertexBuffer != NULL);
+    assert(primitiveCount > 0);
+
+    GraphicsDevice_NotifyStateChange(graphicsDevice);
+    GraphicsDevice_BindVertexArray(graphicsDevice, VertexBuffer_GetArrayId(vertexBuffer));
+
+    int vertexCount;
+    GLenum mode;
+
+    if (!GraphicsDevice_GetPrimitiveMode(primitiveType, primitiveCount, &mode, &vertexCount)) {
         return;
     }
 
     glDrawArrays(mode, vertexStart, vertexCount);
+    graphicsDevice->drawCalls++;
+}
+
+void GraphicsDevice_DrawIndexedPrimitives(GraphicsDevice *graphicsDevice,
+    VertexBuffer *vertexBuffer, IndexBuffer *indexBuffer, RenderPrimitiveType primitiveType,
+    uint32_t baseVertex, uint32_t indexStart, uint32_t primitiveCount) {
+    assert(graphicsDevice != NULL);
+    assert(vertexBuffer != NULL);
+    assert(indexBuffer != NULL);
+    assert(primitiveCount > 0);
+
+    GraphicsDevice_NotifyStateChange(graphicsDevice);
+    GraphicsDevice_BindVertexArray(graphicsDevice, VertexBuffer_GetArrayId(vertexBuffer));
+    GraphicsDevice_BindBuffer(
+        graphicsDevice, BUFFER_TARGET_ELEMENT_ARRAY, IndexBuffer_GetBufferId(indexBuffer));
+
+    int indexCount;
+    GLenum mode;
+
+    if (!GraphicsDevice_GetPrimitiveMode(primitiveType, primitiveCount, &mode, &indexCount)) {
+        return;
+    }
+
+    glDrawElementsBaseVertex(mode,
+        indexCount,
+        GL_UNSIGNED_INT,
+        (void *)(uintptr_t)(indexStart * sizeof(uint32_t)),
+        baseVertex);
+    graphicsDevice->drawCalls++;
+}
+
+void GraphicsDevice_DrawInstancedPrimitives(GraphicsDevice *graphicsDevice,
+    VertexBuffer *vertexBuffer, RenderPrimitiveType primitiveType, uint32_t vertexStart,
+    uint32_t primitiveCount, uint32_t instanceCount) {
+    assert(graphicsDevice != NULL);
+    assert(vertexBuffer != NULL);
+    assert(primitiveCount > 0);
+    assert(instanceCount > 0);
+
+    GraphicsDevice_NotifyStateChange(graphicsDevice);
+    GraphicsDevice_BindVertexArray(graphicsDevice, VertexBuffer_GetArrayId(vertexBuffer));
+
+    int vertexCount;
+    GLenum mode;
+
+    if (!GraphicsDevice_GetPrimitiveMode(primitiveType, primitiveCount, &mode, &vertexCount)) {
+        return;
+    }
+
+    glDrawArraysInstanced(mode, vertexStart, vertexCount, instanceCount);
+    graphicsDevice->drawCalls++;
 }
@@ -0,0 +1,63 @@
+#include <assert.h>
+#include <glad/gl.h>
+#include <SDL3/SDL.h>
+
+#include <GraphicsDevice.h>
+#include <IndexBuffer.h>
+
+struct IndexBuffer {
+    GraphicsDevice *graphicsDevice;
+    uint32_t indexBufferId;
+    uint32_t maximumIndices;
+};
+
+IndexBuffer *IndexBuffer_Create(
+    GraphicsDevice *graphicsDevice, IndexBufferType bufferType, uint32_t maximumIndices) {
+    assert(graphicsDevice != NULL);
+    assert(maximumIndices > 0);
+
+    IndexBuffer *indexBuffer = SDL_malloc(sizeof(IndexBuffer));
+    if (indexBuffer == NULL) {
+        SDL_Log("SDL_malloc failed");
+        return NULL;
+    }
+
+    indexBuffer->graphicsDevice = graphicsDevice;
+    indexBuffer->maximumIndices = maximumIndices;
+
+    glGenBuffers(1, &indexBuffer->indexBufferId);
+
+    GLenum bufferUsage = (bufferType == INDEX_BUFFER_STATIC) ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW;
+
+    // the element array binding belongs to whatever vertex array is bound, so upload through
+    // the copy target instead of attaching this buffer to someone else's vertex array
+    GraphicsDevice_BindBuffer(
+        indexBuffer->graphicsDevice, BUFFER_TARGET_COPY_WRITE, indexBuffer->indexBufferId);
+    glBufferData(GL_COPY_WRITE_BUFFER, maximumIndices * sizeof(uint32_t), NULL, bufferUsage);
+
+    return indexBuffer;
+}
+
+void IndexBuffer_Destroy(IndexBuffer *indexBuffer) {
+    assert(indexBuffer != NULL);
+
+    glDeleteBuffers(1, &indexBuffer->indexBufferId);
+    GraphicsDevice_ForgetBuffer(indexBuffer->graphicsDevice, indexBuffer->indexBufferId);
+    SDL_free(indexBuffer);
+}
+
+void IndexBuffer_SetIndexData(IndexBuffer *indexBuffer, uint32_t *indices, uint32_t indexCount) {
+    assert(indexBuffer != NULL);
+    assert(indices != NULL);
+    assert(indexCount > 0);
+    assert(indexCount <= indexBuffer->maximumIndices);
+
+    GraphicsDevice_BindBuffer(
+        indexBuffer->graphicsDevice, BUFFER_TARGET_COPY_WRITE, indexBuffer->indexBufferId);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, 0, indexCount * sizeof(uint32_t), indices);
+    GraphicsDevice_AddUploadedBytes(indexBuffer->graphicsDevice, indexCount * sizeof(uint32_t));
+}
+
+uint32_t IndexBuffer_GetBufferId(IndexBuffer *indexBuffer) {
+    return indexBuffer->indexBufferId;
+}
@@ -0,0 +1,1008 @@
+#include <assert.h>
+
+#include <glad/gl.h>
+#include <SDL3/SDL.h>
+
+#include <NullDriver.h>
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// targets the engine binds buffers to, see bufferTargets in GraphicsDevice.c
+#define NULL_DRIVER_BUFFER_TARGETS 5
+
+typedef enum NullObjectType {
+    NULL_OBJECT_FREE,
+    NULL_OBJECT_BUFFER,
+    NULL_OBJECT_TEXTURE,
+    NULL_OBJECT_SHADER,
+    NULL_OBJECT_PROGRAM,
+    NULL_OBJECT_VERTEX_ARRAY,
+    NULL_OBJECT_FRAMEBUFFER,
+    NULL_OBJECT_RENDERBUFFER,
+    NULL_OBJECT_QUERY,
+} NullObjectType;
+
+// a uniform, attribute or uniform block found in a program's sources, its index is its location
+typedef struct NullVariable {
+    char name[256];
+    GLenum type;
+    GLint size;
+} NullVariable;
+
+typedef struct NullVariableList {
+    NullVariable *variables;
+    uint32_t count;
+} NullVariableList;
+
+// every kind of object shares one id space, ids are indices into the object table
+typedef struct NullObject {
+    NullObjectType type;
+
+    // buffers keep real storage so mapping and reading back work
+    uint8_t *data;
+    size_t size;
+
+    // shaders keep their source for the program to reflect when it links
+    GLenum shaderType;
+    char *source;
+
+    GLuint attachedShaders[2];
+    NullVariableList uniforms;
+    NullVariableList attributes;
+    NullVariableList blocks;
+
+    GLuint64 timestamp;
+} NullObject;
+
+static NullObject *objects;
+static uint32_t objectCapacity;
+
+static GLuint boundBuffers[NULL_DRIVER_BUFFER_TARGETS];
+static NullDriverCounters counters;
+
+// glFenceSync hands out the address, every fence is signaled as soon as it is made
+static int fence;
+
+static const GLenum bufferTargets[NULL_DRIVER_BUFFER_TARGETS] = {
+    GL_ARRAY_BUFFER,
+    GL_ELEMENT_ARRAY_BUFFER,
+    GL_UNIFORM_BUFFER,
+    GL_COPY_WRITE_BUFFER,
+    GL_PIXEL_PACK_BUFFER,
+};
+
+static GLuint *NullDriver_GetBufferBinding(GLenum target) {
+    for (int i = 0; i < NULL_DRIVER_BUFFER_TARGETS; i++) {
+        if (bufferTargets[i] == target) {
+            return &boundBuffers[i];
+        }
+    }
+
+    SDL_Log("NullDriver: unknown buffer target 0x%x", target);
+    return NULL;
+}
+
+static NullObject *NullDriver_GetObject(GLuint id, NullObjectType type) {
+    if (id == 0 || id >= objectCapacity || objects[id].type != type) {
+        return NULL;
+    }
+    return &objects[id];
+}
+
+static NullObject *NullDriver_GetBoundBuffer(GLenum target) {
+    GLuint *binding = NullDriver_GetBufferBinding(target);
+    return (binding != NULL) ? NullDriver_GetObject(*binding, NULL_OBJECT_BUFFER) : NULL;
+}
+
+static GLuint NullDriver_CreateObject(NullObjectType type) {
+    // id 0 means no object, so the table starts at 1
+    for (uint32_t id = 1; id < objectCapacity; id++) {
+        if (objects[id].type == NULL_OBJECT_FREE) {
+            objects[id].type = type;
+            return id;
+        }
+    }
+
+    uint32_t capacity = (objectCapacity == 0) ? 256 : objectCapacity * 2;
+    NullObject *newObjects = SDL_realloc(objects, capacity * sizeof(NullObject));
+    if (newObjects == NULL) {
+        SDL_Log("SDL_realloc failed");
+        return 0;
+    }
+    SDL_memset(&newObjects[objectCapacity], 0, (capacity - objectCapacity) * sizeof(NullObject));
+
+    GLuint id = (objectCapacity == 0) ? 1 : objectCapacity;
+    objects = newObjects;
+    objectCapacity = capacity;
+    objects[id].type = type;
+    return id;
+}
+
+static void NullDriver_FreeVariables(NullVariableList *list) {
+    SDL_free(list->variables);
+    list->variables = NULL;
+    list->count = 0;
+}
+
+static void NullDriver_DeleteObject(GLuint id, NullObjectType type) {
+    NullObject *object = NullDriver_GetObject(id, type);
+    if (object == NULL) {
+        return;
+    }
+
+    SDL_free(object->data);
+    SDL_free(object->source);
+    NullDriver_FreeVariables(&object->uniforms);
+    NullDriver_FreeVariables(&object->attributes);
+    NullDriver_FreeVariables(&object->blocks);
+    SDL_memset(object, 0, sizeof(NullObject));
+
+    for (int i = 0; i < NULL_DRIVER_BUFFER_TARGETS; i++) {
+        if (type == NULL_OBJECT_BUFFER && boundBuffers[i] == id) {
+            boundBuffers[i] = 0;
+        }
+    }
+}
+
+static void NullDriver_GenerateObjects(GLsizei n, GLuint *ids, NullObjectType type) {
+    for (GLsizei i = 0; i < n; i++) {
+        ids[i] = NullDriver_CreateObject(type);
+    }
+}
+
+static void NullDriver_DeleteObjects(GLsizei n, const GLuint *ids, NullObjectType type) {
+    for (GLsizei i = 0; i < n; i++) {
+        NullDriver_DeleteObject(ids[i], type);
+    }
+}
+
+// the next identifier, number or punctuation character of a glsl source. comments and
+// preprocessor lines are skipped, so both sides of an #ifdef are seen. false at the end
+static bool NullDriver_NextToken(const char **cursor, char *token, size_t tokenSize) {
+    const char *c = *cursor;
+    for (;;) {
+        while (*c != '\0' && SDL_isspace(*c)) {
+            c++;
+        }
+
+        if (c[0] == '/' && c[1] == '/') {
+            while (*c != '\0' && *c != '\n') {
+                c++;
+            }
+        } else if (c[0] == '/' && c[1] == '*') {
+            const char *end = SDL_strstr(c + 2, "*/");
+            c = (end != NULL) ? end + 2 : c + SDL_strlen(c);
+        } else if (c[0] == '#') {
+            while (*c != '\0' && *c != '\n') {
+                c++;
+            }
+        } else {
+            break;
+        }
+    }
+
+    if (*c == '\0') {
+        *cursor = c;
+        return false;
+    }
+
+    size_t length = 0;
+    if (SDL_isalnum(*c) || *c == '_') {
+        while (SDL_isalnum(*c) || *c == '_') {
+            if (length + 1 < tokenSize) {
+                token[length++] = *c;
+            }
+            c++;
+        }
+    } else {
+        token[length++] = *c++;
+    }
+    token[length] = '\0';
+
+    *cursor = c;
+    return true;
+}
+
+static GLenum NullDriver_GetVariableType(const char *typeName) {
+    static const struct {
+        const char *name;
+        GLenum type;
+    } types[] = {
+        {"float", GL_FLOAT},
+        {"vec2", GL_FLOAT_VEC2},
+        {"vec3", GL_FLOAT_VEC3},
+        {"vec4", GL_FLOAT_VEC4},
+        {"int", GL_INT},
+        {"ivec2", GL_INT_VEC2},
+        {"ivec3", GL_INT_VEC3},
+        {"ivec4", GL_INT_VEC4},
+        {"uint", GL_UNSIGNED_INT},
+        {"bool", GL_BOOL},
+        {"mat2", GL_FLOAT_MAT2},
+        {"mat3", GL_FLOAT_MAT3},
+        {"mat4", GL_FLOAT_MAT4},
+        {"sampler2D", GL_SAMPLER_2D},
+    };
+
+    for (size_t i = 0; i < SDL_arraysize(types); i++) {
+        if (SDL_strcmp(types[i].name, typeName) == 0) {
+            return types[i].type;
+        }
+    }
+
+    SDL_Log("NullDriver: unknown glsl type %s, reflected as float", typeName);
+    return GL_FLOAT;
+}
+
+static GLint NullDriver_FindVariable(NullVariableList *list, const char *name) {
+    for (uint32_t i = 0; i < list->count; i++) {
+        if (SDL_strcmp(list->variables[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// variables declared by both shaders, or on both sides of an #ifdef, are only added once
+static void NullDriver_AddVariable(
+    NullVariableList *list, const char *name, GLenum type, GLint size) {
+    if (NullDriver_FindVariable(list, name) != -1) {
+        return;
+    }
+
+    NullVariable *variables =
+        SDL_realloc(list->variables, (list->count + 1) * sizeof(NullVariable));
+    if (variables == NULL) {
+        SDL_Log("SDL_realloc failed");
+        return;
+    }
+
+    list->variables = variables;
+    NullVariable *variable = &list->variables[list->count++];
+    SDL_strlcpy(variable->name, name, sizeof(variable->name));
+    variable->type = type;
+    variable->size = size;
+}
+
+// finds the top level uniforms, uniform blocks and (in vertex shaders) inputs, which is what a
+// driver would report for a program that uses everything it declares
+static void NullDriver_ReflectSource(NullObject *program, const char *source, bool vertexShader) {
+    const char *cursor = source;
+    char token[256];
+    char typeName[256];
+    char name[256];
+    int braceDepth = 0;
+    int parenthesisDepth = 0;
+
+    while (NullDriver_NextToken(&cursor, token, sizeof(token))) {
+        if (token[0] == '{') {
+            braceDepth++;
+        } else if (token[0] == '}') {
+            braceDepth--;
+        } else if (token[0] == '(') {
+            parenthesisDepth++;
+        } else if (token[0] == ')') {
+            parenthesisDepth--;
+        }
+
+        if (braceDepth != 0 || parenthesisDepth != 0) {
+            continue;
+        }
+
+        bool isUniform = SDL_strcmp(token, "uniform") == 0;
+        bool isInput = vertexShader && SDL_strcmp(token, "in") == 0;
+        if (!isUniform && !isInput) {
+            continue;
+        }
+
+        // precision qualifiers come between the storage qualifier and the type
+        do {
+            if (!NullDriver_NextToken(&cursor, typeName, sizeof(typeName))) {
+                return;
+            }
+        } while (SDL_strcmp(typeName, "lowp") == 0 || SDL_strcmp(typeName, "mediump") == 0 ||
+                 SDL_strcmp(typeName, "highp") == 0);
+
+        if (!NullDriver_NextToken(&cursor, name, sizeof(name))) {
+            return;
+        }
+
+        // uniform BlockName { ... }, the brace is counted so the members are skipped
+        if (isUniform && name[0] == '{') {
+            NullDriver_AddVariable(&program->blocks, typeName, 0, 1);
+            braceDepth++;
+            continue;
+        }
+
+        GLint size = 1;
+        if (!NullDriver_NextToken(&cursor, token, sizeof(token))) {
+            return;
+        }
+        if (token[0] == '[') {
+            // gl reports arrays by their first element
+            if (NullDriver_NextToken(&cursor, token, sizeof(token))) {
+                size = SDL_atoi(token);
+            }
+            SDL_strlcat(name, "[0]", sizeof(name));
+        }
+
+        GLenum type = NullDriver_GetVariableType(typeName);
+        NullDriver_AddVariable(
+            isUniform ? &program->uniforms : &program->attributes, name, type, size);
+    }
+}
+
+static void GLAD_API_PTR NullDriver_GenBuffers(GLsizei n, GLuint *buffers) {
+    NullDriver_GenerateObjects(n, buffers, NULL_OBJECT_BUFFER);
+}
+
+static void GLAD_API_PTR NullDriver_DeleteBuffers(GLsizei n, const GLuint *buffers) {
+    NullDriver_DeleteObjects(n, buffers, NULL_OBJECT_BUFFER);
+}
+
+static void GLAD_API_PTR NullDriver_BindBuffer(GLenum target, GLuint buffer) {
+    GLuint *binding = NullDriver_GetBufferBinding(target);
+    if (binding != NULL) {
+        *binding = buffer;
+    }
+    counters.stateChanges++;
+}
+
+static void GLAD_API_PTR NullDriver_BindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+    NullDriver_BindBuffer(target, buffer);
+}
+
+static void GLAD_API_PTR NullDriver_BufferData(
+    GLenum target, GLsizeiptr size, const void *data, GLenum usage) {
+    NullObject *buffer = NullDriver_GetBoundBuffer(target);
+    if (buffer == NULL) {
+        return;
+    }
+
+    uint8_t *storage = SDL_realloc(buffer->data, (size > 0) ? size : 1);
+    if (storage == NULL) {
+        SDL_Log("SDL_realloc failed");
+        return;
+    }
+    buffer->data = storage;
+    buffer->size = size;
+
+    if (data != NULL) {
+        SDL_memcpy(buffer->data, data, size);
+        counters.uploadedBytes += size;
+    }
+}
+
+static void GLAD_API_PTR NullDriver_BufferSubData(
+    GLenum target, GLintptr offset, GLsizeiptr size, const void *data) {
+    NullObject *buffer = NullDriver_GetBoundBuffer(target);
+    if (buffer == NULL || offset + size > (GLsizeiptr)buffer->size) {
+        return;
+    }
+
+    SDL_memcpy(buffer->data + offset, data, size);
+    counters.uploadedBytes += size;
+}
+
+static void *GLAD_API_PTR NullDriver_MapBufferRange(
+    GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+    NullObject *buffer = NullDriver_GetBoundBuffer(target);
+    if (buffer == NULL || offset + length > (GLsizeiptr)buffer->size) {
+        return NULL;
+    }
+
+    // explicitly flushed ranges are counted as they are flushed
+    if ((access & GL_MAP_WRITE_BIT) && !(access & GL_MAP_FLUSH_EXPLICIT_BIT)) {
+        counters.uploadedBytes += length;
+    }
+    return buffer->data + offset;
+}
+
+static void GLAD_API_PTR NullDriver_FlushMappedBufferRange(
+    GLenum target, GLintptr offset, GLsizeiptr length) {
+    counters.uploadedBytes += length;
+}
+
+static GLboolean GLAD_API_PTR NullDriver_UnmapBuffer(GLenum target) {
+    return GL_TRUE;
+}
+
+static void GLAD_API_PTR NullDriver_GenVertexArrays(GLsizei n, GLuint *arrays) {
+    NullDriver_GenerateObjects(n, arrays, NULL_OBJECT_VERTEX_ARRAY);
+}
+
+static void GLAD_API_PTR NullDriver_DeleteVertexArrays(GLsizei n, const GLuint *arrays) {
+    NullDriver_DeleteObjects(n, arrays, NULL_OBJECT_VERTEX_ARRAY);
+}
+
+static void GLAD_API_PTR NullDriver_BindVertexArray(GLuint array) {
+    counters.stateChanges++;
+}
+
+static void GLAD_API_PTR NullDriver_EnableVertexAttribArray(GLuint index) {
+}
+
+static void GLAD_API_PTR NullDriver_VertexAttribPointer(GLuint index, GLint size, GLenum type,
+    GLboolean normalized, GLsizei stride, const void *pointer) {
+}
+
+static void GLAD_API_PTR NullDriver_VertexAttribDivisor(GLuint index, GLuint divisor) {
+}
+
+static void GLAD_API_PTR NullDriver_GenTextures(GLsizei n, GLuint *textures) {
+    NullDriver_GenerateObjects(n, textures, NULL_OBJECT_TEXTURE);
+}
+
+static void GLAD_API_PTR NullDriver_DeleteTextures(GLsizei n, const GLuint *textures) {
+    NullDriver_DeleteObjects(n, textures, NULL_OBJECT_TEXTURE);
+}
+
+static void GLAD_API_PTR NullDriver_ActiveTexture(GLenum texture) {
+    counters.stateChanges++;
+}
+
+static void GLAD_API_PTR NullDriver_BindTexture(GLenum target, GLuint texture) {
+    counters.stateChanges++;
+}
+
+static void GLAD_API_PTR NullDriver_TexParameteri(GLenum target, GLenum pname, GLint param) {
+}
+
+// the engine's textures are all rgba with a byte per channel
+static void GLAD_API_PTR NullDriver_TexImage2D(GLenum target, GLint level, GLint internalformat,
+    GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels) {
+    if (pixels != NULL) {
+        counters.uploadedBytes += (uint64_t)width * height * 4;
+    }
+}
+
+static void GLAD_API_PTR NullDriver_TexSubImage2D(GLenum target, GLint level, GLint xoffset,
+    GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels) {
+    counters.uploadedBytes += (uint64_t)width * height * 4;
+}
+
+static void GLAD_API_PTR NullDriver_GenFramebuffers(GLsizei n, GLuint *framebuffers) {
+    NullDriver_GenerateObjects(n, framebuffers, NULL_OBJECT_FRAMEBUFFER);
+}
+
+static void GLAD_API_PTR NullDriver_DeleteFramebuffers(GLsizei n, const GLuint *framebuffers) {
+    NullDriver_DeleteObjects(n, framebuffers, NULL_OBJECT_FRAMEBUFFER);
+}
+
+static void GLAD_API_PTR NullDriver_BindFramebuffer(GLenum target, GLuint framebuffer) {
+    counters.stateChanges++;
+}
+
+static void GLAD_API_PTR NullDriver_FramebufferTexture2D(
+    GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level) {
+}
+
+static void GLAD_API_PTR NullDriver_FramebufferRenderbuffer(
+    GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer) {
+}
+
+static GLenum GLAD_API_PTR NullDriver_CheckFramebufferStatus(GLenum target) {
+    return GL_FRAMEBUFFER_COMPLETE;
+}
+
+static void GLAD_API_PTR NullDriver_GenRenderbuffers(GLsizei n, GLuint *renderbuffers) {
+    NullDriver_GenerateObjects(n, renderbuffers, NULL_OBJECT_RENDERBUFFER);
+}
+
+static void GLAD_API_PTR NullDriver_DeleteRenderbuffers(GLsizei n, const GLuint *renderbuffers) {
+    NullDriver_DeleteObjects(n, renderbuffers, NULL_OBJECT_RENDERBUFFER);
+}
+
+static void GLAD_API_PTR NullDriver_BindRenderbuffer(GLenum target, GLuint renderbuffer) {
+}
+
+static void GLAD_API_PTR NullDriver_RenderbufferStorage(
+    GLenum target, GLenum internalformat, GLsizei width, GLsizei height) {
+}
+
+static GLuint GLAD_API_PTR NullDriver_CreateShader(GLenum type) {
+    GLuint id = NullDriver_CreateObject(NULL_OBJECT_SHADER);
+    if (id != 0) {
+        objects[id].shaderType = type;
+    }
+    return id;
+}
+
+static void GLAD_API_PTR NullDriver_DeleteShader(GLuint shader) {
+    NullDriver_DeleteObject(shader, NULL_OBJECT_SHADER);
+}
+
+static void GLAD_API_PTR NullDriver_ShaderSource(
+    GLuint shader, GLsizei count, const GLchar *const *string, const GLint *length) {
+    NullObject *object = NullDriver_GetObject(shader, NULL_OBJECT_SHADER);
+    if (object == NULL) {
+        return;
+    }
+
+    size_t totalLength = 0;
+    for (GLsizei i = 0; i < count; i++) {
+        totalLength += (length != NULL && length[i] >= 0) ? length[i] : SDL_strlen(string[i]);
+    }
+
+    char *source = SDL_malloc(totalLength + 1);
+    if (source == NULL) {
+        SDL_Log("SDL_malloc failed");
+        return;
+    }
+
+    size_t offset = 0;
+    for (GLsizei i = 0; i < count; i++) {
+        size_t partLength =
+            (length != NULL && length[i] >= 0) ? length[i] : SDL_strlen(string[i]);
+        SDL_memcpy(source + offset, string[i], partLength);
+        offset += partLength;
+    }
+    source[offset] = '\0';
+
+    SDL_free(object->source);
+    object->source = source;
+}
+
+static void GLAD_API_PTR NullDriver_CompileShader(GLuint shader) {
+}
+
+// every shader compiles and every program links
+static void GLAD_API_PTR NullDriver_GetShaderiv(GLuint shader, GLenum pname, GLint *params) {
+    *params = (pname == GL_COMPILE_STATUS) ? GL_TRUE : 0;
+}
+
+static void GLAD_API_PTR NullDriver_GetShaderInfoLog(
+    GLuint shader, GLsizei bufSize, GLsizei *length, GLchar *infoLog) {
+    if (length != NULL) {
+        *length = 0;
+    }
+    if (bufSize > 0) {
+        infoLog[0] = '\0';
+    }
+}
+
+static GLuint GLAD_API_PTR NullDriver_CreateProgram(void) {
+    return NullDriver_CreateObject(NULL_OBJECT_PROGRAM);
+}
+
+static void GLAD_API_PTR NullDriver_DeleteProgram(GLuint program) {
+    NullDriver_DeleteObject(program, NULL_OBJECT_PROGRAM);
+}
+
+static void GLAD_API_PTR NullDriver_AttachShader(GLuint program, GLuint shader) {
+    NullObject *object = NullDriver_GetObject(program, NULL_OBJECT_PROGRAM);
+    NullObject *shaderObject = NullDriver_GetObject(shader, NULL_OBJECT_SHADER);
+    if (object == NULL || shaderObject == NULL) {
+        return;
+    }
+
+    int slot = (shaderObject->shaderType == GL_VERTEX_SHADER) ? 0 : 1;
+    object->attachedShaders[slot] = shader;
+}
+
+static void GLAD_API_PTR NullDriver_LinkProgram(GLuint program) {
+    NullObject *object = NullDriver_GetObject(program, NULL_OBJECT_PROGRAM);
+    if (object == NULL) {
+        return;
+    }
+
+    NullDriver_FreeVariables(&object->uniforms);
+    NullDriver_FreeVariables(&object->attributes);
+    NullDriver_FreeVariables(&object->blocks);
+
+    for (int slot = 0; slot < 2; slot++) {
+        NullObject *shader =
+            NullDriver_GetObject(object->attachedShaders[slot], NULL_OBJECT_SHADER);
+        if (shader != NULL && shader->source != NULL) {
+            NullDriver_ReflectSource(object, shader->source, slot == 0);
+        }
+    }
+}
+
+static void GLAD_API_PTR NullDriver_GetProgramiv(GLuint program, GLenum pname, GLint *params) {
+    NullObject *object = NullDriver_GetObject(program, NULL_OBJECT_PROGRAM);
+
+    switch (pname) {
+    case GL_LINK_STATUS:
+    case GL_VALIDATE_STATUS:
+    case GL_COMPLETION_STATUS_KHR:
+        *params = GL_TRUE;
+        break;
+
+    case GL_ACTIVE_UNIFORMS:
+        *params = (object != NULL) ? (GLint)object->uniforms.count : 0;
+        break;
+
+    case GL_ACTIVE_ATTRIBUTES:
+        *params = (object != NULL) ? (GLint)object->attributes.count : 0;
+        break;
+
+    default:
+        *params = 0;
+        break;
+    }
+}
+
+static void GLAD_API_PTR NullDriver_GetProgramInfoLog(
+    GLuint program, GLsizei bufSize, GLsizei *length, GLchar *infoLog) {
+    NullDriver_GetShaderInfoLog(program, bufSize, length, infoLog);
+}
+
+static void NullDriver_GetActiveVariable(NullVariableList *list, GLuint index, GLsizei bufSize,
+    GLsizei *length, GLint *size, GLenum *type, GLchar *name) {
+    if (index >= list->count) {
+        return;
+    }
+
+    NullVariable *variable = &list->variables[index];
+    SDL_strlcpy(name, variable->name, bufSize);
+    if (length != NULL) {
+        *length = SDL_strlen(name);
+    }
+    *size = variable->size;
+    *type = variable->type;
+}
+
+static void GLAD_API_PTR NullDriver_GetActiveUniform(GLuint program, GLuint index,
+    GLsizei bufSize, GLsizei *length, GLint *size, GLenum *type, GLchar *name) {
+    NullObject *object = NullDriver_GetObject(program, NULL_OBJECT_PROGRAM);
+    if (object != NULL) {
+        NullDriver_GetActiveVariable(&object->uniforms, index, bufSize, length, size, type, name);
+    }
+}
+
+static void GLAD_API_PTR NullDriver_GetActiveAttrib(GLuint program, GLuint index,
+    GLsizei bufSize, GLsizei *length, GLint *size, GLenum *type, GLchar *name) {
+    NullObject *object = NullDriver_GetObject(program, NULL_OBJECT_PROGRAM);
+    if (object != NULL) {
+        NullDriver_GetActiveVariable(&object->attributes, index, bufSize, length, size, type, name);
+    }
+}
+
+// members of uniform blocks are never reported as uniforms, so none of them are in a block
+static void GLAD_API_PTR NullDriver_GetActiveUniformsiv(GLuint program, GLsizei uniformCount,
+    const GLuint *uniformIndices, GLenum pname, GLint *params) {
+    for (GLsizei i = 0; i < uniformCount; i++) {
+        params[i] = (pname == GL_UNIFORM_BLOCK_INDEX) ? -1 : 0;
+    }
+}
+
+static GLint NullDriver_GetVariableLocation(GLuint program, const GLchar *name, bool uniform) {
+    NullObject *object = NullDriver_GetObject(program, NULL_OBJECT_PROGRAM);
+    if (object == NULL) {
+        return -1;
+    }
+
+    NullVariableList *list = uniform ? &object->uniforms : &object->attributes;
+    GLint location = NullDriver_FindVariable(list, name);
+    if (location == -1) {
+        // arrays are found by their name without the [0] too
+        char arrayName[256];
+        SDL_snprintf(arrayName, sizeof(arrayName), "%s[0]", name);
+        location = NullDriver_FindVariable(list, arrayName);
+    }
+    return location;
+}
+
+static GLint GLAD_API_PTR NullDriver_GetUniformLocation(GLuint program, const GLchar *name) {
+    return NullDriver_GetVariableLocation(program, name, true);
+}
+
+static GLint GLAD_API_PTR NullDriver_GetAttribLocation(GLuint program, const GLchar *name) {
+    return NullDriver_GetVariableLocation(program, name, false);
+}
+
+static GLuint GLAD_API_PTR NullDriver_GetUniformBlockIndex(
+    GLuint program, const GLchar *uniformBlockName) {
+    NullObject *object = NullDriver_GetObject(program, NULL_OBJECT_PROGRAM);
+    if (object == NULL) {
+        return GL_INVALID_INDEX;
+    }
+
+    GLint index = NullDriver_FindVariable(&object->blocks, uniformBlockName);
+    return (index != -1) ? (GLuint)index : GL_INVALID_INDEX;
+}
+
+// a size of 0 fits any buffer the device binds to the block
+static void GLAD_API_PTR NullDriver_GetActiveUniformBlockiv(
+    GLuint program, GLuint uniformBlockIndex, GLenum pname, GLint *params) {
+    *params = 0;
+}
+
+static void GLAD_API_PTR NullDriver_UniformBlockBinding(
+    GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding) {
+}
+
+static void GLAD_API_PTR NullDriver_UseProgram(GLuint program) {
+    counters.stateChanges++;
+}
+
+static void GLAD_API_PTR NullDriver_Uniform1f(GLint location, GLfloat v0) {
+    counters.uniformUpdates++;
+}
+
+static void GLAD_API_PTR NullDriver_Uniform2f(GLint location, GLfloat v0, GLfloat v1) {
+    counters.uniformUpdates++;
+}
+
+static void GLAD_API_PTR NullDriver_Uniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) {
+    counters.uniformUpdates++;
+}
+
+static void GLAD_API_PTR NullDriver_Uniform4f(
+    GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) {
+    counters.uniformUpdates++;
+}
+
+static void GLAD_API_PTR NullDriver_Uniform1i(GLint location, GLint v0) {
+    counters.uniformUpdates++;
+}
+
+static void GLAD_API_PTR NullDriver_Uniform2i(GLint location, GLint v0, GLint v1) {
+    counters.uniformUpdates++;
+}
+
+static void GLAD_API_PTR NullDriver_Uniform3i(GLint location, GLint v0, GLint v1, GLint v2) {
+    counters.uniformUpdates++;
+}
+
+static void GLAD_API_PTR NullDriver_Uniform4i(
+    GLint location, GLint v0, GLint v1, GLint v2, GLint v3) {
+    counters.uniformUpdates++;
+}
+
+static void GLAD_API_PTR NullDriver_UniformMatrix4fv(
+    GLint location, GLsizei count, GLboolean transpose, const GLfloat *value) {
+    counters.uniformUpdates++;
+}
+
+static void GLAD_API_PTR NullDriver_Enable(GLenum cap) {
+    counters.stateChanges++;
+}
+
+static void GLAD_API_PTR NullDriver_Disable(GLenum cap) {
+    counters.stateChanges++;
+}
+
+static void GLAD_API_PTR NullDriver_BlendEquationSeparate(GLenum modeRGB, GLenum modeAlpha) {
+    counters.stateChanges++;
+}
+
+static void GLAD_API_PTR NullDriver_BlendFuncSeparate(
+    GLenum sfactorRGB, GLenum dfactorRGB, GLenum sfactorAlpha, GLenum dfactorAlpha) {
+    counters.stateChanges++;
+}
+
+static void GLAD_API_PTR NullDriver_Viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    counters.stateChanges++;
+}
+
+static void GLAD_API_PTR NullDriver_Scissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+    counters.stateChanges++;
+}
+
+static void GLAD_API_PTR NullDriver_ClearColor(
+    GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+    counters.stateChanges++;
+}
+
+static void GLAD_API_PTR NullDriver_Clear(GLbitfield mask) {
+    counters.clears++;
+}
+
+static void GLAD_API_PTR NullDriver_DrawArrays(GLenum mode, GLint first, GLsizei count) {
+    counters.drawCalls++;
+    counters.drawnVertices += count;
+}
+
+static void GLAD_API_PTR NullDriver_DrawArraysInstanced(
+    GLenum mode, GLint first, GLsizei count, GLsizei instancecount) {
+    counters.drawCalls++;
+    counters.drawnVertices += (uint64_t)count * instancecount;
+}
+
+static void GLAD_API_PTR NullDriver_DrawElementsBaseVertex(
+    GLenum mode, GLsizei count, GLenum type, const void *indices, GLint basevertex) {
+    counters.drawCalls++;
+    counters.drawnVertices += count;
+}
+
+// reads back transparent black, into the pixel pack buffer when one is bound
+static void GLAD_API_PTR NullDriver_ReadPixels(GLint x, GLint y, GLsizei width, GLsizei height,
+    GLenum format, GLenum type, void *pixels) {
+    size_t size = (size_t)width * height * 4;
+
+    NullObject *packBuffer = NullDriver_GetBoundBuffer(GL_PIXEL_PACK_BUFFER);
+    if (packBuffer != NULL) {
+        size_t offset = (size_t)pixels;
+        if (offset + size <= packBuffer->size) {
+            SDL_memset(packBuffer->data + offset, 0, size);
+        }
+        return;
+    }
+
+    SDL_memset(pixels, 0, size);
+}
+
+static GLsync GLAD_API_PTR NullDriver_FenceSync(GLenum condition, GLbitfield flags) {
+    return (GLsync)&fence;
+}
+
+static GLenum GLAD_API_PTR NullDriver_ClientWaitSync(
+    GLsync sync, GLbitfield flags, GLuint64 timeout) {
+    return GL_ALREADY_SIGNALED;
+}
+
+static void GLAD_API_PTR NullDriver_DeleteSync(GLsync sync) {
+}
+
+static void GLAD_API_PTR NullDriver_Flush(void) {
+}
+
+static void GLAD_API_PTR NullDriver_GenQueries(GLsizei n, GLuint *ids) {
+    NullDriver_GenerateObjects(n, ids, NULL_OBJECT_QUERY);
+}
+
+static void GLAD_API_PTR NullDriver_DeleteQueries(GLsizei n, const GLuint *ids) {
+    NullDriver_DeleteObjects(n, ids, NULL_OBJECT_QUERY);
+}
+
+// with nothing on a gpu, timestamps are taken on the cpu when the query is issued
+static void GLAD_API_PTR NullDriver_QueryCounter(GLuint id, GLenum target) {
+    NullObject *query = NullDriver_GetObject(id, NULL_OBJECT_QUERY);
+    if (query != NULL) {
+        query->timestamp =
+            SDL_GetPerformanceCounter() * 1000000000.0 / SDL_GetPerformanceFrequency();
+    }
+}
+
+static void GLAD_API_PTR NullDriver_GetQueryObjectuiv(GLuint id, GLenum pname, GLuint *params) {
+    *params = (pname == GL_QUERY_RESULT_AVAILABLE) ? GL_TRUE : 0;
+}
+
+static void GLAD_API_PTR NullDriver_GetQueryObjectui64v(
+    GLuint id, GLenum pname, GLuint64 *params) {
+    NullObject *query = NullDriver_GetObject(id, NULL_OBJECT_QUERY);
+    *params = (query != NULL) ? query->timestamp : 0;
+}
+
+// the framebuffer bound at startup is 0, and program binaries aren't offered
+static void GLAD_API_PTR NullDriver_GetIntegerv(GLenum pname, GLint *data) {
+    switch (pname) {
+    case GL_MAX_TEXTURE_IMAGE_UNITS:
+        *data = 16;
+        break;
+
+    default:
+        *data = 0;
+        break;
+    }
+}
+
+static const GLubyte *GLAD_API_PTR NullDriver_GetString(GLenum name) {
+    switch (name) {
+    case GL_VENDOR:
+        return (const GLubyte *)"pinim";
+    case GL_RENDERER:
+        return (const GLubyte *)"null driver";
+    case GL_VERSION:
+        return (const GLubyte *)"4.1 null";
+    case GL_SHADING_LANGUAGE_VERSION:
+        return (const GLubyte *)"4.10";
+    default:
+        return NULL;
+    }
+}
+
+void NullDriver_Install(void) {
+    glad_glActiveTexture = NullDriver_ActiveTexture;
+    glad_glAttachShader = NullDriver_AttachShader;
+    glad_glBindBuffer = NullDriver_BindBuffer;
+    glad_glBindBufferBase = NullDriver_BindBufferBase;
+    glad_glBindFramebuffer = NullDriver_BindFramebuffer;
+    glad_glBindRenderbuffer = NullDriver_BindRenderbuffer;
+    glad_glBindTexture = NullDriver_BindTexture;
+    glad_glBindVertexArray = NullDriver_BindVertexArray;
+    glad_glBlendEquationSeparate = NullDriver_BlendEquationSeparate;
+    glad_glBlendFuncSeparate = NullDriver_BlendFuncSeparate;
+    glad_glBufferData = NullDriver_BufferData;
+    glad_glBufferSubData = NullDriver_BufferSubData;
+    glad_glCheckFramebufferStatus = NullDriver_CheckFramebufferStatus;
+    glad_glClear = NullDriver_Clear;
+    glad_glClearColor = NullDriver_ClearColor;
+    glad_glClientWaitSync = NullDriver_ClientWaitSync;
+    glad_glCompileShader = NullDriver_CompileShader;
+    glad_glCreateProgram = NullDriver_CreateProgram;
+    glad_glCreateShader = NullDriver_CreateShader;
+    glad_glDeleteBuffers = NullDriver_DeleteBuffers;
+    glad_glDeleteFramebuffers = NullDriver_DeleteFramebuffers;
+    glad_glDeleteProgram = NullDriver_DeleteProgram;
+    glad_glDeleteQueries = NullDriver_DeleteQueries;
+    glad_glDeleteRenderbuffers = NullDriver_DeleteRenderbuffers;
+    glad_glDeleteShader = NullDriver_DeleteShader;
+    glad_glDeleteSync = NullDriver_DeleteSync;
+    glad_glDeleteTextures = NullDriver_DeleteTextures;
+    glad_glDeleteVertexArrays = NullDriver_DeleteVertexArrays;
+    glad_glDisable = NullDriver_Disable;
+    glad_glDrawArrays = NullDriver_DrawArrays;
+    glad_glDrawArraysInstanced = NullDriver_DrawArraysInstanced;
+    glad_glDrawElementsBaseVertex = NullDriver_DrawElementsBaseVertex;
+    glad_glEnable = NullDriver_Enable;
+    glad_glEnableVertexAttribArray = NullDriver_EnableVertexAttribArray;
+    glad_glFenceSync = NullDriver_FenceSync;
+    glad_glFlush = NullDriver_Flush;
+    glad_glFlushMappedBufferRange = NullDriver_FlushMappedBufferRange;
+    glad_glFramebufferRenderbuffer = NullDriver_FramebufferRenderbuffer;
+    glad_glFramebufferTexture2D = NullDriver_FramebufferTexture2D;
+    glad_glGenBuffers = NullDriver_GenBuffers;
+    glad_glGenFramebuffers = NullDriver_GenFramebuffers;
+    glad_glGenQueries = NullDriver_GenQueries;
+    glad_glGenRenderbuffers = NullDriver_GenRenderbuffers;
+    glad_glGenTextures = NullDriver_GenTextures;
+    glad_glGenVertexArrays = NullDriver_GenVertexArrays;
+    glad_glGetActiveAttrib = NullDriver_GetActiveAttrib;
+    glad_glGetActiveUniform = NullDriver_GetActiveUniform;
+    glad_glGetActiveUniformBlockiv = NullDriver_GetActiveUniformBlockiv;
+    glad_glGetActiveUniformsiv = NullDriver_GetActiveUniformsiv;
+    glad_glGetAttribLocation = NullDriver_GetAttribLocation;
+    glad_glGetIntegerv = NullDriver_GetIntegerv;
+    glad_glGetProgramInfoLog = NullDriver_GetProgramInfoLog;
+    glad_glGetProgramiv = NullDriver_GetProgramiv;
+    glad_glGetQueryObjectui64v = NullDriver_GetQueryObjectui64v;
+    glad_glGetQueryObjectuiv = NullDriver_GetQueryObjectuiv;
+    glad_glGetShaderInfoLog = NullDriver_GetShaderInfoLog;
+    glad_glGetShaderiv = NullDriver_GetShaderiv;
+    glad_glGetString = NullDriver_GetString;
+    glad_glGetUniformBlockIndex = NullDriver_GetUniformBlockIndex;
+    glad_glGetUniformLocation = NullDriver_GetUniformLocation;
+    glad_glLinkProgram = NullDriver_LinkProgram;
+    glad_glMapBufferRange = NullDriver_MapBufferRange;
+    glad_glQueryCounter = NullDriver_QueryCounter;
+    glad_glReadPixels = NullDriver_ReadPixels;
+    glad_glRenderbufferStorage = NullDriver_RenderbufferStorage;
+    glad_glScissor = NullDriver_Scissor;
+    glad_glShaderSource = NullDriver_ShaderSource;
+    glad_glTexImage2D = NullDriver_TexImage2D;
+    glad_glTexParameteri = NullDriver_TexParameteri;
+    glad_glTexSubImage2D = NullDriver_TexSubImage2D;
+    glad_glUniform1f = NullDriver_Uniform1f;
+    glad_glUniform1i = NullDriver_Uniform1i;
+    glad_glUniform2f = NullDriver_Uniform2f;
+    glad_glUniform2i = NullDriver_Uniform2i;
+    glad_glUniform3f = NullDriver_Uniform3f;
+    glad_glUniform3i = NullDriver_Uniform3i;
+    glad_glUniform4f = NullDriver_Uniform4f;
+    glad_glUniform4i = NullDriver_Uniform4i;
+    glad_glUniformBlockBinding = NullDriver_UniformBlockBinding;
+    glad_glUniformMatrix4fv = NullDriver_UniformMatrix4fv;
+    glad_glUnmapBuffer = NullDriver_UnmapBuffer;
+    glad_glUseProgram = NullDriver_UseProgram;
+    glad_glVertexAttribDivisor = NullDriver_VertexAttribDivisor;
+    glad_glVertexAttribPointer = NullDriver_VertexAttribPointer;
+    glad_glViewport = NullDriver_Viewport;
+
+    SDL_memset(&counters, 0, sizeof(NullDriverCounters));
+}
+
+void NullDriver_Uninstall(void) {
+    for (uint32_t id = 1; id < objectCapacity; id++) {
+        NullDriver_DeleteObject(id, objects[id].type);
+    }
+
+    SDL_free(objects);
+    objects = NULL;
+    objectCapacity = 0;
+    SDL_memset(boundBuffers, 0, sizeof(boundBuffers));
+}
+
+void NullDriver_GetCounters(NullDriverCounters *driverCounters) {
+    assert(driverCounters != NULL);
+
+    *driverCounters = counters;
+}
+
+void NullDriver_ResetCounters(void) {
+    SDL_memset(&counters, 0, sizeof(NullDriverCounters));
+}
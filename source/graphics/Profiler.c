@@ -0,0 +1,408 @@
+#include <assert.h>
+
+#include <glad/gl.h>
+#include <SDL3/SDL.h>
+
+#include <BatchRenderer.h>
+#include <GameMath.h>
+#include <GraphicsDevice.h>
+#include <Profiler.h>
+
+#define PROFILER_MAXIMUM_SCOPES 32
+#define PROFILER_MAXIMUM_DEPTH 16
+// frames in flight before their queries are read, a slot still unread when its turn comes again
+// waits for the gpu
+#define PROFILER_FRAME_LATENCY 4
+#define PROFILER_HISTORY 256
+// begin and end timestamps for the frame, then for each scope
+#define PROFILER_QUERIES (2 + 2 * PROFILER_MAXIMUM_SCOPES)
+
+typedef struct ProfilerSlot {
+    ProfilerFrame frame;
+    ProfilerScopeTiming scopes[PROFILER_MAXIMUM_SCOPES];
+    uint32_t scopeCount;
+    uint32_t queries[PROFILER_QUERIES];
+    uint64_t frameStart;
+    // the frame's queries are issued and not yet read
+    bool pending;
+} ProfilerSlot;
+
+struct Profiler {
+    GraphicsDevice *graphicsDevice;
+
+    ProfilerSlot slots[PROFILER_FRAME_LATENCY];
+    uint32_t slotIndex;
+    uint32_t frameIndex;
+    bool inFrame;
+    // the frame before the current one, still waiting for its frame time
+    ProfilerSlot *previousSlot;
+
+    // the open scopes, -1 for ones that weren't timed
+    int32_t scopeStack[PROFILER_MAXIMUM_DEPTH];
+    uint32_t scopeDepth;
+    uint64_t scopeStarts[PROFILER_MAXIMUM_SCOPES];
+
+    // the newest reported frame
+    bool hasFrame;
+    ProfilerFrame frame;
+    ProfilerScopeTiming scopes[PROFILER_MAXIMUM_SCOPES];
+    uint32_t scopeCount;
+
+    // ring of reported frames, historyCount grows until it wraps
+    ProfilerFrame history[PROFILER_HISTORY];
+    uint32_t historyIndex;
+    uint32_t historyCount;
+};
+
+static float Profiler_TicksToMilliseconds(uint64_t ticks) {
+    return (float)(ticks * 1000.0 / (double)SDL_GetPerformanceFrequency());
+}
+
+static float Profiler_GpuMilliseconds(ProfilerSlot *slot, uint32_t beginQuery) {
+    uint64_t begin, end;
+    glGetQueryObjectui64v(slot->queries[beginQuery], GL_QUERY_RESULT, &begin);
+    glGetQueryObjectui64v(slot->queries[beginQuery + 1], GL_QUERY_RESULT, &end);
+    return (end > begin) ? (float)((end - begin) / 1000000.0) : 0;
+}
+
+// reads a slot's queries back and reports its frame. unless wait is set it gives up when the gpu
+// hasn't reached the end of the frame yet, the end timestamp is the last one to arrive
+static bool Profiler_ResolveSlot(Profiler *profiler, ProfilerSlot *slot, bool wait) {
+    if (!slot->pending) {
+        return true;
+    }
+
+    if (!wait) {
+        uint32_t available = 0;
+        glGetQueryObjectuiv(slot->queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            return false;
+        }
+    }
+
+    slot->frame.gpuMilliseconds = Profiler_GpuMilliseconds(slot, 0);
+    for (uint32_t index = 0; index < slot->scopeCount; index++) {
+        slot->scopes[index].gpuMilliseconds = Profiler_GpuMilliseconds(slot, 2 + 2 * index);
+    }
+    slot->pending = false;
+
+    profiler->hasFrame = true;
+    profiler->frame = slot->frame;
+    SDL_memcpy(profiler->scopes, slot->scopes, slot->scopeCount * sizeof(ProfilerScopeTiming));
+    profiler->scopeCount = slot->scopeCount;
+
+    profiler->history[profiler->historyIndex] = slot->frame;
+    profiler->historyIndex = (profiler->historyIndex + 1) % PROFILER_HISTORY;
+    if (profiler->historyCount < PROFILER_HISTORY) {
+        profiler->historyCount++;
+    }
+    return true;
+}
+
+Profiler *Profiler_Create(GraphicsDevice *graphicsDevice) {
+    assert(graphicsDevice != NULL);
+
+    Profiler *profiler = SDL_calloc(1, sizeof(Profiler));
+    if (profiler == NULL) {
+        SDL_Log("SDL_calloc failed");
+        return NULL;
+    }
+
+    profiler->graphicsDevice = graphicsDevice;
+    for (uint32_t index = 0; index < PROFILER_FRAME_LATENCY; index++) {
+        glGenQueries(PROFILER_QUERIES, profiler->slots[index].queries);
+    }
+
+    GraphicsDevice_SetProfiler(graphicsDevice, profiler);
+    return profiler;
+}
+
+void Profiler_Destroy(Profiler *profiler) {
+    assert(profiler != NULL);
+
+    GraphicsDevice_SetProfiler(profiler->graphicsDevice, NULL);
+    for (uint32_t index = 0; index < PROFILER_FRAME_LATENCY; index++) {
+        glDeleteQueries(PROFILER_QUERIES, profiler->slots[index].queries);
+    }
+    SDL_free(profiler);
+}
+
+void Profiler_BeginScope(Profiler *profiler, const char *name) {
+    assert(profiler != NULL);
+    assert(name != NULL);
+
+    if (profiler->scopeDepth == PROFILER_MAXIMUM_DEPTH) {
+        SDL_Log("Profiler_BeginScope nested more than %d deep", PROFILER_MAXIMUM_DEPTH);
+        return;
+    }
+
+    ProfilerSlot *slot = &profiler->slots[profiler->slotIndex];
+    if (!profiler->inFrame || slot->scopeCount == PROFILER_MAXIMUM_SCOPES) {
+        profiler->scopeStack[profiler->scopeDepth++] = -1;
+        return;
+    }
+
+    // draws held back from before the scope belong outside of it
+    GraphicsDevice_NotifyStateChange(profiler->graphicsDevice);
+
+    uint32_t index = slot->scopeCount++;
+    slot->scopes[index] = (ProfilerScopeTiming){.name = name, .depth = profiler->scopeDepth};
+    profiler->scopeStack[profiler->scopeDepth++] = index;
+    profiler->scopeStarts[index] = SDL_GetPerformanceCounter();
+    glQueryCounter(slot->queries[2 + 2 * index], GL_TIMESTAMP);
+}
+
+void Profiler_EndScope(Profiler *profiler) {
+    assert(profiler != NULL);
+
+    if (profiler->scopeDepth == 0) {
+        SDL_Log("Profiler_EndScope called without Profiler_BeginScope");
+        return;
+    }
+
+    int32_t index = profiler->scopeStack[--profiler->scopeDepth];
+    if (index < 0) {
+        return;
+    }
+
+    GraphicsDevice_NotifyStateChange(profiler->graphicsDevice);
+
+    ProfilerSlot *slot = &profiler->slots[profiler->slotIndex];
+    glQueryCounter(slot->queries[2 + 2 * index + 1], GL_TIMESTAMP);
+    slot->scopes[index].cpuMilliseconds =
+        Profiler_TicksToMilliseconds(SDL_GetPerformanceCounter() - profiler->scopeStarts[index]);
+}
+
+void Profiler_BeginFrame(Profiler *profiler) {
+    assert(profiler != NULL);
+
+    uint64_t counter = SDL_GetPerformanceCounter();
+
+    if (profiler->inFrame) {
+        SDL_Log("Profiler_BeginFrame called before the last frame was ended");
+        return;
+    }
+
+    // the frame time is only known now, before the slot can be reported
+    if (profiler->previousSlot != NULL) {
+        profiler->previousSlot->frame.frameMilliseconds =
+            Profiler_TicksToMilliseconds(counter - profiler->previousSlot->frameStart);
+    }
+
+    // report what the gpu has finished, oldest first (ending with the frame that just ended) and
+    // stopping at the first frame it hasn't
+    for (uint32_t offset = 1; offset <= PROFILER_FRAME_LATENCY; offset++) {
+        uint32_t index = (profiler->slotIndex + offset) % PROFILER_FRAME_LATENCY;
+        if (!Profiler_ResolveSlot(profiler, &profiler->slots[index], false)) {
+            break;
+        }
+    }
+
+    profiler->slotIndex = (profiler->slotIndex + 1) % PROFILER_FRAME_LATENCY;
+    ProfilerSlot *slot = &profiler->slots[profiler->slotIndex];
+    Profiler_ResolveSlot(profiler, slot, true);
+
+    slot->frame = (ProfilerFrame){.frameIndex = profiler->frameIndex++};
+    slot->scopeCount = 0;
+    slot->frameStart = counter;
+    slot->pending = true;
+    profiler->inFrame = true;
+    profiler->scopeDepth = 0;
+
+    glQueryCounter(slot->queries[0], GL_TIMESTAMP);
+}
+
+void Profiler_EndFrame(Profiler *profiler) {
+    assert(profiler != NULL);
+
+    if (!profiler->inFrame) {
+        return;
+    }
+
+    if (profiler->scopeDepth > 0) {
+        SDL_Log("Profiler_EndFrame called with %u scopes still open", profiler->scopeDepth);
+        while (profiler->scopeDepth > 0) {
+            Profiler_EndScope(profiler);
+        }
+    }
+
+    ProfilerSlot *slot = &profiler->slots[profiler->slotIndex];
+    glQueryCounter(slot->queries[1], GL_TIMESTAMP);
+    slot->frame.cpuMilliseconds =
+        Profiler_TicksToMilliseconds(SDL_GetPerformanceCounter() - slot->frameStart);
+
+    profiler->inFrame = false;
+    profiler->previousSlot = slot;
+}
+
+void Profiler_AddPresentTime(Profiler *profiler, uint64_t counterTicks) {
+    assert(profiler != NULL);
+
+    if (profiler->previousSlot != NULL) {
+        profiler->previousSlot->frame.presentMilliseconds +=
+            Profiler_TicksToMilliseconds(counterTicks);
+    }
+}
+
+bool Profiler_GetFrame(Profiler *profiler, ProfilerFrame *frame) {
+    assert(profiler != NULL);
+    assert(frame != NULL);
+
+    if (!profiler->hasFrame) {
+        return false;
+    }
+
+    *frame = profiler->frame;
+    return true;
+}
+
+uint32_t Profiler_GetScopes(Profiler *profiler, ProfilerScopeTiming *scopes, uint32_t maximum) {
+    assert(profiler != NULL);
+    assert(scopes != NULL || maximum == 0);
+
+    uint32_t count = SDL_min(maximum, profiler->scopeCount);
+    SDL_memcpy(scopes, profiler->scopes, count * sizeof(ProfilerScopeTiming));
+    return profiler->scopeCount;
+}
+
+static float Profiler_GetMetric(ProfilerFrame *frame, ProfilerMetric metric) {
+    switch (metric) {
+    case PROFILER_METRIC_FRAME:
+        return frame->frameMilliseconds;
+    case PROFILER_METRIC_CPU:
+        return frame->cpuMilliseconds;
+    case PROFILER_METRIC_GPU:
+        return frame->gpuMilliseconds;
+    case PROFILER_METRIC_PRESENT:
+        return frame->presentMilliseconds;
+    default:
+        return 0;
+    }
+}
+
+static int Profiler_CompareFloats(const void *a, const void *b) {
+    float floatA = *(const float *)a;
+    float floatB = *(const float *)b;
+    return (floatA < floatB) ? -1 : (floatA > floatB) ? 1 : 0;
+}
+
+// nearest rank, the same formula the benches use
+static float Profiler_GetPercentile(float *sorted, uint32_t count, double percentile) {
+    uint32_t rank = (uint32_t)SDL_ceilf((float)(percentile / 100.0 * count));
+    return sorted[SDL_clamp(rank, 1, count) - 1];
+}
+
+void Profiler_GetPercentiles(
+    Profiler *profiler, ProfilerMetric metric, float *p50, float *p95, float *p99) {
+    assert(profiler != NULL);
+    assert(metric < PROFILER_METRIC_COUNT);
+    assert(p50 != NULL && p95 != NULL && p99 != NULL);
+
+    if (profiler->historyCount == 0) {
+        *p50 = *p95 = *p99 = 0;
+        return;
+    }
+
+    float values[PROFILER_HISTORY];
+    for (uint32_t index = 0; index < profiler->historyCount; index++) {
+        values[index] = Profiler_GetMetric(&profiler->history[index], metric);
+    }
+    SDL_qsort(values, profiler->historyCount, sizeof(float), Profiler_CompareFloats);
+
+    *p50 = Profiler_GetPercentile(values, profiler->historyCount, 50);
+    *p95 = Profiler_GetPercentile(values, profiler->historyCount, 95);
+    *p99 = Profiler_GetPercentile(values, profiler->historyCount, 99);
+}
+
+void Profiler_Reset(Profiler *profiler) {
+    assert(profiler != NULL);
+
+    profiler->hasFrame = false;
+    profiler->scopeCount = 0;
+    profiler->historyIndex = 0;
+    profiler->historyCount = 0;
+}
+
+void Profiler_DrawOverlay(Profiler *profiler, BatchRenderer *batchRenderer, Vector2 position) {
+    assert(profiler != NULL);
+    assert(batchRenderer != NULL);
+
+    // pixels per millisecond, so 33ms frames fill the graph
+    const float scale = 3;
+    const float barWidth = 2;
+    const float height = 100;
+    const float width = PROFILER_HISTORY * barWidth;
+    float left = position[0];
+    float bottom = position[1] + height;
+
+    Color background = {.r = 0, .g = 0, .b = 0, .a = 0.5f};
+    Color cpu = {.r = 0.2f, .g = 0.8f, .b = 0.2f, .a = 1};
+    Color other = {.r = 0.5f, .g = 0.5f, .b = 0.5f, .a = 1};
+    Color present = {.r = 0.2f, .g = 0.4f, .b = 0.9f, .a = 1};
+    Color gpu = {.r = 0.9f, .g = 0.2f, .b = 0.2f, .a = 1};
+    Color line = {.r = 0.5f, .g = 0.5f, .b = 0.5f, .a = 0.5f};
+
+    BatchRenderer_Begin(
+        batchRenderer, BLEND_MODE_PREMULTIPLIED_ALPHA, NULL, NULL, MATRIX4_IDENTITY);
+
+    BatchRenderer_BatchQuadUV(batchRenderer,
+        (Vector2){0, 0},
+        (Vector2){1, 1},
+        (Vector2){left, position[1]},
+        (Vector2){left + width, bottom},
+        &background);
+
+    // the history ring starts at the oldest frame once it has wrapped
+    uint32_t first = (profiler->historyCount < PROFILER_HISTORY) ? 0 : profiler->historyIndex;
+    for (uint32_t bar = 0; bar < profiler->historyCount; bar++) {
+        ProfilerFrame *frame = &profiler->history[(first + bar) % PROFILER_HISTORY];
+        float x = left + bar * barWidth;
+
+        // in the order they happen: submission, present, then whatever runs until the next frame
+        float otherMilliseconds =
+            frame->frameMilliseconds - frame->cpuMilliseconds - frame->presentMilliseconds;
+        float cpuTop = bottom - SDL_min(frame->cpuMilliseconds * scale, height);
+        float presentTop = SDL_max(cpuTop - frame->presentMilliseconds * scale, position[1]);
+        float otherTop = SDL_max(presentTop - SDL_max(otherMilliseconds, 0) * scale, position[1]);
+        float gpuTop = bottom - SDL_min(frame->gpuMilliseconds * scale, height);
+
+        BatchRenderer_BatchQuadUV(batchRenderer,
+            (Vector2){0, 0},
+            (Vector2){1, 1},
+            (Vector2){x, cpuTop},
+            (Vector2){x + barWidth, bottom},
+            &cpu);
+        BatchRenderer_BatchQuadUV(batchRenderer,
+            (Vector2){0, 0},
+            (Vector2){1, 1},
+            (Vector2){x, presentTop},
+            (Vector2){x + barWidth, cpuTop},
+            &present);
+        BatchRenderer_BatchQuadUV(batchRenderer,
+            (Vector2){0, 0},
+            (Vector2){1, 1},
+            (Vector2){x, otherTop},
+            (Vector2){x + barWidth, presentTop},
+            &other);
+        BatchRenderer_BatchQuadUV(batchRenderer,
+            (Vector2){0, 0},
+            (Vector2){1, 1},
+            (Vector2){x, gpuTop},
+            (Vector2){x + barWidth, gpuTop + 1},
+            &gpu);
+    }
+
+    // 60 and 30 fps
+    const float budgets[] = {1000.0f / 60, 1000.0f / 30};
+    for (uint32_t index = 0; index < SDL_arraysize(budgets); index++) {
+        float y = bottom - budgets[index] * scale;
+        BatchRenderer_BatchQuadUV(batchRenderer,
+            (Vector2){0, 0},
+            (Vector2){1, 1},
+            (Vector2){left, y},
+            (Vector2){left + width, y + 1},
+            &line);
+    }
+
+    BatchRenderer_End(batchRenderer);
+}
@@ -0,0 +1,375 @@
+#include <assert.h>
+
+#include <SDL3/SDL.h>
+
+#include <BatchRenderer.h>
+#include <GraphicsDevice.h>
+#include <RenderThread.h>
+#include <Trace.h>
+
+// one frame drawing, one waiting and one recording
+#define RENDER_THREAD_FRAME_COUNT 3
+
+typedef enum FrameCommandType {
+    FRAME_COMMAND_DRAW_RECORDING,
+    FRAME_COMMAND_CLEAR_SCREEN,
+    FRAME_COMMAND_SET_VIEWPORT,
+    FRAME_COMMAND_BIND_RENDER_TARGET,
+    FRAME_COMMAND_UNBIND_RENDER_TARGET,
+    FRAME_COMMAND_CALL,
+} FrameCommandType;
+
+typedef struct FrameCommand {
+    FrameCommandType type;
+    BatchRenderer *recorder;
+    Color color;
+    Rectangle viewport;
+    Texture *renderTarget;
+    bool setViewport;
+    FrameCommandCallback callback;
+    void *userData;
+} FrameCommand;
+
+struct FrameCommandList {
+    BatchRenderer *batchRenderer;
+    FrameCommand *commands;
+    uint32_t commandCount;
+    uint32_t commandCapacity;
+
+    // recorders are kept from frame to frame, the first usedRecorders belong to this frame
+    BatchRenderer **recorders;
+    uint32_t recorderCount;
+    uint32_t usedRecorders;
+
+    // set on the list that tells the render thread to stop
+    bool quit;
+};
+
+struct RenderThread {
+    GraphicsDevice *graphicsDevice;
+    BatchRenderer *batchRenderer;
+    SDL_Thread *thread;
+
+    FrameCommandList frames[RENDER_THREAD_FRAME_COUNT];
+    // count the lists that can be recorded into and the ones handed over. each side only touches
+    // the list at its own index, so nothing else guards the lists
+    SDL_Semaphore *freeFrames;
+    SDL_Semaphore *queuedFrames;
+    uint32_t recordIndex;
+    uint32_t drawIndex;
+    bool recording;
+
+    // signalled once the render thread has (or failed to get) the context
+    SDL_Semaphore *started;
+    bool startFailed;
+};
+
+static FrameCommand *FrameCommandList_AddCommand(
+    FrameCommandList *frameCommandList, FrameCommandType type) {
+    if (frameCommandList->commandCount == frameCommandList->commandCapacity) {
+        uint32_t newCapacity =
+            (frameCommandList->commandCapacity > 0) ? frameCommandList->commandCapacity * 2 : 64;
+        FrameCommand *newCommands =
+            SDL_realloc(frameCommandList->commands, newCapacity * sizeof(FrameCommand));
+        if (newCommands == NULL) {
+            SDL_Log("SDL_realloc failed");
+            return NULL;
+        }
+        frameCommandList->commands = newCommands;
+        frameCommandList->commandCapacity = newCapacity;
+    }
+
+    FrameCommand *command = &frameCommandList->commands[frameCommandList->commandCount++];
+    SDL_memset(command, 0, sizeof(FrameCommand));
+    command->type = type;
+    return command;
+}
+
+BatchRenderer *FrameCommandList_GetRecorder(FrameCommandList *frameCommandList) {
+    assert(frameCommandList != NULL);
+
+    // batches recorded back to back share a recorder
+    if (frameCommandList->commandCount > 0) {
+        FrameCommand *last = &frameCommandList->commands[frameCommandList->commandCount - 1];
+        if (last->type == FRAME_COMMAND_DRAW_RECORDING) {
+            return last->recorder;
+        }
+    }
+
+    if (frameCommandList->usedRecorders == frameCommandList->recorderCount) {
+        BatchRenderer **newRecorders = SDL_realloc(frameCommandList->recorders,
+            (frameCommandList->recorderCount + 1) * sizeof(BatchRenderer *));
+        if (newRecorders == NULL) {
+            SDL_Log("SDL_realloc failed");
+            return NULL;
+        }
+        frameCommandList->recorders = newRecorders;
+
+        BatchRenderer *recorder = BatchRenderer_CreateRecorder(frameCommandList->batchRenderer);
+        if (recorder == NULL) {
+            SDL_Log("BatchRenderer_CreateRecorder failed");
+            return NULL;
+        }
+        frameCommandList->recorders[frameCommandList->recorderCount++] = recorder;
+    }
+
+    FrameCommand *command =
+        FrameCommandList_AddCommand(frameCommandList, FRAME_COMMAND_DRAW_RECORDING);
+    if (command == NULL) {
+        return NULL;
+    }
+    command->recorder = frameCommandList->recorders[frameCommandList->usedRecorders++];
+    return command->recorder;
+}
+
+void FrameCommandList_ClearScreen(FrameCommandList *frameCommandList, Color *color) {
+    assert(frameCommandList != NULL);
+    assert(color != NULL);
+
+    FrameCommand *command =
+        FrameCommandList_AddCommand(frameCommandList, FRAME_COMMAND_CLEAR_SCREEN);
+    if (command != NULL) {
+        command->color = *color;
+    }
+}
+
+void FrameCommandList_SetViewport(FrameCommandList *frameCommandList, Rectangle *viewport) {
+    assert(frameCommandList != NULL);
+    assert(viewport != NULL);
+
+    FrameCommand *command =
+        FrameCommandList_AddCommand(frameCommandList, FRAME_COMMAND_SET_VIEWPORT);
+    if (command != NULL) {
+        command->viewport = *viewport;
+    }
+}
+
+void FrameCommandList_BindRenderTarget(
+    FrameCommandList *frameCommandList, Texture *renderTarget, bool setViewport) {
+    assert(frameCommandList != NULL);
+    assert(renderTarget != NULL);
+
+    FrameCommand *command =
+        FrameCommandList_AddCommand(frameCommandList, FRAME_COMMAND_BIND_RENDER_TARGET);
+    if (command != NULL) {
+        command->renderTarget = renderTarget;
+        command->setViewport = setViewport;
+    }
+}
+
+void FrameCommandList_UnbindRenderTarget(FrameCommandList *frameCommandList, bool resetViewport) {
+    assert(frameCommandList != NULL);
+
+    FrameCommand *command =
+        FrameCommandList_AddCommand(frameCommandList, FRAME_COMMAND_UNBIND_RENDER_TARGET);
+    if (command != NULL) {
+        command->setViewport = resetViewport;
+    }
+}
+
+void FrameCommandList_Call(
+    FrameCommandList *frameCommandList, FrameCommandCallback callback, void *userData) {
+    assert(frameCommandList != NULL);
+    assert(callback != NULL);
+
+    FrameCommand *command = FrameCommandList_AddCommand(frameCommandList, FRAME_COMMAND_CALL);
+    if (command != NULL) {
+        command->callback = callback;
+        command->userData = userData;
+    }
+}
+
+static void RenderThread_DrawFrame(RenderThread *renderThread, FrameCommandList *frame) {
+    TRACE_ZONE("RenderThread_DrawFrame");
+
+    GraphicsDevice *graphicsDevice = renderThread->graphicsDevice;
+
+    GraphicsDevice_BeginFrame(graphicsDevice);
+
+    for (uint32_t index = 0; index < frame->commandCount; index++) {
+        FrameCommand *command = &frame->commands[index];
+        switch (command->type) {
+        case FRAME_COMMAND_DRAW_RECORDING:
+            BatchRenderer_SubmitRecording(renderThread->batchRenderer, command->recorder);
+            break;
+
+        case FRAME_COMMAND_CLEAR_SCREEN:
+            GraphicsDevice_ClearScreen(graphicsDevice, &command->color);
+            break;
+
+        case FRAME_COMMAND_SET_VIEWPORT:
+            GraphicsDevice_SetViewport(graphicsDevice, &command->viewport);
+            break;
+
+        case FRAME_COMMAND_BIND_RENDER_TARGET:
+            GraphicsDevice_BindRenderTarget(
+                graphicsDevice, command->renderTarget, command->setViewport);
+            break;
+
+        case FRAME_COMMAND_UNBIND_RENDER_TARGET:
+            GraphicsDevice_UnbindRenderTarget(graphicsDevice, command->setViewport);
+            break;
+
+        case FRAME_COMMAND_CALL:
+            command->callback(graphicsDevice, command->userData);
+            break;
+        }
+    }
+
+    GraphicsDevice_EndFrame(graphicsDevice);
+
+    TRACE_BEGIN("GraphicsDevice_Present");
+    GraphicsDevice_Present(graphicsDevice);
+    TRACE_END();
+
+    frame->commandCount = 0;
+    frame->usedRecorders = 0;
+}
+
+static int RenderThread_Run(void *userData) {
+    RenderThread *renderThread = userData;
+
+    TRACE_THREAD_NAME("render");
+
+    renderThread->startFailed = !GraphicsDevice_AcquireContext(renderThread->graphicsDevice);
+    SDL_SignalSemaphore(renderThread->started);
+    if (renderThread->startFailed) {
+        return 1;
+    }
+
+    for (;;) {
+        SDL_WaitSemaphore(renderThread->queuedFrames);
+
+        FrameCommandList *frame = &renderThread->frames[renderThread->drawIndex];
+        renderThread->drawIndex = (renderThread->drawIndex + 1) % RENDER_THREAD_FRAME_COUNT;
+        if (frame->quit) {
+            break;
+        }
+
+        RenderThread_DrawFrame(renderThread, frame);
+        SDL_SignalSemaphore(renderThread->freeFrames);
+    }
+
+    GraphicsDevice_ReleaseContext(renderThread->graphicsDevice);
+    return 0;
+}
+
+static void RenderThread_Free(RenderThread *renderThread) {
+    for (uint32_t index = 0; index < RENDER_THREAD_FRAME_COUNT; index++) {
+        FrameCommandList *frame = &renderThread->frames[index];
+        for (uint32_t recorder = 0; recorder < frame->recorderCount; recorder++) {
+            BatchRenderer_Destroy(frame->recorders[recorder]);
+        }
+        SDL_free(frame->recorders);
+        SDL_free(frame->commands);
+    }
+
+    if (renderThread->started != NULL) {
+        SDL_DestroySemaphore(renderThread->started);
+    }
+    if (renderThread->queuedFrames != NULL) {
+        SDL_DestroySemaphore(renderThread->queuedFrames);
+    }
+    if (renderThread->freeFrames != NULL) {
+        SDL_DestroySemaphore(renderThread->freeFrames);
+    }
+    SDL_free(renderThread);
+}
+
+RenderThread *RenderThread_Create(GraphicsDevice *graphicsDevice, BatchRenderer *batchRenderer) {
+    assert(graphicsDevice != NULL);
+    assert(batchRenderer != NULL);
+
+    RenderThread *renderThread = SDL_calloc(1, sizeof(RenderThread));
+    if (renderThread == NULL) {
+        SDL_Log("SDL_calloc failed");
+        return NULL;
+    }
+
+    renderThread->graphicsDevice = graphicsDevice;
+    renderThread->batchRenderer = batchRenderer;
+    for (uint32_t index = 0; index < RENDER_THREAD_FRAME_COUNT; index++) {
+        renderThread->frames[index].batchRenderer = batchRenderer;
+    }
+
+    renderThread->freeFrames = SDL_CreateSemaphore(RENDER_THREAD_FRAME_COUNT);
+    renderThread->queuedFrames = SDL_CreateSemaphore(0);
+    renderThread->started = SDL_CreateSemaphore(0);
+    if (renderThread->freeFrames == NULL || renderThread->queuedFrames == NULL ||
+        renderThread->started == NULL) {
+        SDL_Log("SDL_CreateSemaphore failed");
+        RenderThread_Free(renderThread);
+        return NULL;
+    }
+
+    GraphicsDevice_ReleaseContext(graphicsDevice);
+
+    renderThread->thread = SDL_CreateThread(RenderThread_Run, "render", renderThread);
+    if (renderThread->thread == NULL) {
+        SDL_Log("SDL_CreateThread failed");
+        GraphicsDevice_AcquireContext(graphicsDevice);
+        RenderThread_Free(renderThread);
+        return NULL;
+    }
+
+    SDL_WaitSemaphore(renderThread->started);
+    if (renderThread->startFailed) {
+        SDL_Log("RenderThread_Create couldn't make the context current on the render thread");
+        SDL_WaitThread(renderThread->thread, NULL);
+        GraphicsDevice_AcquireContext(graphicsDevice);
+        RenderThread_Free(renderThread);
+        return NULL;
+    }
+
+    return renderThread;
+}
+
+void RenderThread_Destroy(RenderThread *renderThread) {
+    assert(renderThread != NULL);
+    assert(!renderThread->recording);
+
+    FrameCommandList *frame = RenderThread_BeginFrame(renderThread);
+    frame->quit = true;
+    RenderThread_EndFrame(renderThread);
+    SDL_WaitThread(renderThread->thread, NULL);
+
+    GraphicsDevice_AcquireContext(renderThread->graphicsDevice);
+    RenderThread_Free(renderThread);
+}
+
+FrameCommandList *RenderThread_BeginFrame(RenderThread *renderThread) {
+    assert(renderThread != NULL);
+
+    if (renderThread->recording) {
+        SDL_Log("RenderThread_BeginFrame called before the last frame was ended");
+        return &renderThread->frames[renderThread->recordIndex];
+    }
+
+    TRACE_BEGIN("RenderThread_WaitForFrame");
+    SDL_WaitSemaphore(renderThread->freeFrames);
+    TRACE_END();
+    renderThread->recording = true;
+    return &renderThread->frames[renderThread->recordIndex];
+}
+
+void RenderThread_EndFrame(RenderThread *renderThread) {
+    assert(renderThread != NULL);
+
+    if (!renderThread->recording) {
+        SDL_Log("RenderThread_EndFrame called without RenderThread_BeginFrame");
+        return;
+    }
+
+    renderThread->recording = false;
+    renderThread->recordIndex = (renderThread->recordIndex + 1) % RENDER_THREAD_FRAME_COUNT;
+    SDL_SignalSemaphore(renderThread->queuedFrames);
+}
+
+uint32_t RenderThread_GetQueuedFrameCount(RenderThread *renderThread) {
+    assert(renderThread != NULL);
+
+    // every list that is neither free nor being recorded is queued or drawing
+    uint32_t busyFrames =
+        RENDER_THREAD_FRAME_COUNT - SDL_GetSemaphoreValue(renderThread->freeFrames);
+    return renderThread->recording ? busyFrames - 1 : busyFrames;
+}
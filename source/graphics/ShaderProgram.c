@@ -2,8 +2,10 @@
 #include <glad/gl.h>
 #include <SDL3/SDL.h>
 
+#include <CommandCapture.h>
 #include <ShaderProgram.h>
 #include <Texture.h>
+#include <Trace.h>
 
 typedef enum ShaderParameterType {
     SHADER_PARAMETER_INVALID = 0,
@@ -37,14 +39,24 @@ typedef struct ShaderParameterValue {
     };
 
     ShaderParameterType type;
+    // set since the last ShaderProgram_ApplyParameters
+    bool dirty;
 } ShaderParameterValue;
 
+// the source is kept for the program binary cache key. with the cache enabled, compiling waits
+// until a program misses the cache, so warm launches never compile at all.
 struct VertexShader {
     uint32_t id;
+    char *source;
+    uint32_t length;
+    uint64_t hash;
 };
 
 struct FragmentShader {
     uint32_t id;
+    char *source;
+    uint32_t length;
+    uint64_t hash;
 };
 
 typedef struct ShaderDetail {
@@ -53,13 +65,183 @@ typedef struct ShaderDetail {
     ShaderParameterType type;
 } ShaderDetail;
 
+// program binaries need gl 4.1 (or ARB_get_program_binary), which glad isn't generated for
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+typedef void(GLAD_API_PTR *PFNGLGETPROGRAMBINARYPROC)(
+    GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void(GLAD_API_PTR *PFNGLPROGRAMBINARYPROC)(
+    GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void(GLAD_API_PTR *PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+
+static PFNGLGETPROGRAMBINARYPROC glGetProgramBinary_ = NULL;
+static PFNGLPROGRAMBINARYPROC glProgramBinary_ = NULL;
+static PFNGLPROGRAMPARAMETERIPROC glProgramParameteri_ = NULL;
+
+// KHR_parallel_shader_compile (or the ARB version with the same enums) lets the driver compile on
+// its own threads and be polled for completion
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef void(GLAD_API_PTR *PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+static PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glMaxShaderCompilerThreadsKHR_ = NULL;
+
+// 'PSBN', followed by length bytes of the driver's binary
+#define SHADER_BINARY_MAGIC 0x4E425350
+
+typedef struct ShaderBinaryHeader {
+    uint32_t magic;
+    uint32_t format;
+    uint32_t length;
+} ShaderBinaryHeader;
+
+// 64 bit FNV-1a
+#define SHADER_PROGRAM_HASH_SEED 0xCBF29CE484222325ull
+
+static uint64_t ShaderProgram_Hash(uint64_t hash, const void *data, size_t length) {
+    const uint8_t *bytes = data;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+// loads the entry points on first use, false if the driver can't hand out program binaries
+static bool ShaderProgram_IsBinaryCacheSupported(void) {
+    static int supported = -1;
+    if (supported != -1) {
+        return supported == 1;
+    }
+
+    glGetProgramBinary_ = (PFNGLGETPROGRAMBINARYPROC)SDL_GL_GetProcAddress("glGetProgramBinary");
+    glProgramBinary_ = (PFNGLPROGRAMBINARYPROC)SDL_GL_GetProcAddress("glProgramBinary");
+    glProgramParameteri_ =
+        (PFNGLPROGRAMPARAMETERIPROC)SDL_GL_GetProcAddress("glProgramParameteri");
+
+    int formatCount = 0;
+    if (glGetProgramBinary_ != NULL && glProgramBinary_ != NULL && glProgramParameteri_ != NULL) {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    }
+
+    supported = (formatCount > 0) ? 1 : 0;
+    if (supported == 0) {
+        SDL_Log("Program binaries aren't supported, the shader cache is disabled");
+    }
+
+    return supported == 1;
+}
+
+// loads the entry point and asks for as many compiler threads as the driver wants on first use
+static bool ShaderProgram_IsParallelCompileSupported(void) {
+    static int supported = -1;
+    if (supported != -1) {
+        return supported == 1;
+    }
+
+    const char *functionName = NULL;
+    if (SDL_GL_ExtensionSupported("GL_KHR_parallel_shader_compile")) {
+        functionName = "glMaxShaderCompilerThreadsKHR";
+    } else if (SDL_GL_ExtensionSupported("GL_ARB_parallel_shader_compile")) {
+        functionName = "glMaxShaderCompilerThreadsARB";
+    }
+
+    if (functionName != NULL) {
+        glMaxShaderCompilerThreadsKHR_ =
+            (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)SDL_GL_GetProcAddress(functionName);
+    }
+
+    supported = (glMaxShaderCompilerThreadsKHR_ != NULL) ? 1 : 0;
+    if (supported == 1) {
+        glMaxShaderCompilerThreadsKHR_(0xFFFFFFFF);
+    }
+
+    return supported == 1;
+}
+
+// keeps a copy of a shader's source and its hash
+static char *ShaderProgram_CopySource(void *buffer, uint32_t length, uint64_t *hash) {
+    char *source = SDL_malloc(length);
+    if (source == NULL) {
+        SDL_Log("SDL_malloc failed");
+        return NULL;
+    }
+
+    SDL_memcpy(source, buffer, length);
+    *hash = ShaderProgram_Hash(SHADER_PROGRAM_HASH_SEED, source, length);
+    return source;
+}
+
+// logs the compiler output when the shader failed to compile. this waits for the compile.
+static bool ShaderProgram_CheckShader(uint32_t id, const char *typeName) {
+    int status;
+    glGetShaderiv(id, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE) {
+        char infoLog[1024];
+        int logLength;
+        glGetShaderInfoLog(id, 1024, &logLength, infoLog);
+        SDL_Log("%s compilation failed. Compiler output:\n%s", typeName, infoLog);
+        return false;
+    }
+
+    return true;
+}
+
+// returns the shader id, or 0 with the compiler output logged. without wait the compile is only
+// submitted and errors show up when a program using the shader is linked.
+static uint32_t ShaderProgram_CompileShader(
+    GLenum type, char *source, uint32_t length, bool wait) {
+    const char *typeName = (type == GL_VERTEX_SHADER) ? "VertexShader" : "FragmentShader";
+
+    uint32_t id = glCreateShader(type);
+    if (id == 0) {
+        SDL_Log("glCreateShader(%s) failed", typeName);
+        return 0;
+    }
+
+    glShaderSource(id, 1, (const GLchar *const *)&source, (GLint *)&length);
+    glCompileShader(id);
+
+    if (wait && !ShaderProgram_CheckShader(id, typeName)) {
+        glDeleteShader(id);
+        return 0;
+    }
+
+    return id;
+}
+
 struct ShaderProgram {
+    GraphicsDevice *graphicsDevice;
     uint32_t id;
     ShaderDetail *attributes;
     ShaderDetail *parameters;
     ShaderParameterValue *parameterValues;
     int attributeCount;
     int parameterCount;
+
+    ShaderProgramStatus status;
+    // set while the link is pending, for error output and saving the binary when it's done
+    uint32_t vertexShaderId;
+    uint32_t fragmentShaderId;
+    char *cachePath;
+
+#ifdef PINIM_CAPTURE
+    // a capture describes the program by these
+    char *vertexSource;
+    uint32_t vertexLength;
+    char *fragmentSource;
+    uint32_t fragmentLength;
+#endif
 };
 
 VertexShader *VertexShader_Create(GraphicsDevice *graphicsDevice, char *fileName) {
@@ -78,47 +260,53 @@ VertexShader *VertexShader_Create(GraphicsDevice *graphicsDevice, char *fileName
     return vertexShader;
 }
 
-VertexShader *VertexShader_CreateFromBuffer(
-    GraphicsDevice *graphicsDevice, void *buffer, uint32_t length) {
+static VertexShader *VertexShader_CreateFromSource(
+    GraphicsDevice *graphicsDevice, void *buffer, uint32_t length, bool wait) {
     assert(graphicsDevice != NULL);
     assert(buffer != NULL);
     assert(length > 0);
 
-    VertexShader *vertexShader = SDL_malloc(sizeof(VertexShader));
+    VertexShader *vertexShader = SDL_calloc(1, sizeof(VertexShader));
     if (vertexShader == NULL) {
-        SDL_Log("SDL_malloc failed");
+        SDL_Log("SDL_calloc failed");
         return NULL;
     }
 
-    vertexShader->id = glCreateShader(GL_VERTEX_SHADER);
-    if (vertexShader->id == 0) {
-        SDL_Log("glCreateShader(GL_VERTEX_SHADER) failed");
+    vertexShader->source = ShaderProgram_CopySource(buffer, length, &vertexShader->hash);
+    vertexShader->length = length;
+    if (vertexShader->source == NULL) {
         SDL_free(vertexShader);
         return NULL;
     }
 
-    glShaderSource(vertexShader->id, 1, (const GLchar *const *)&buffer, (GLint *)&length);
-    glCompileShader(vertexShader->id);
-
-    int status;
-    glGetShaderiv(vertexShader->id, GL_COMPILE_STATUS, &status);
-    if (status != GL_TRUE) {
-        char infoLog[1024];
-        int logLength;
-        glGetShaderInfoLog(vertexShader->id, 1024, &logLength, infoLog);
-        SDL_Log("VertexShader compilation failed. Compiler output:\n%s", infoLog);
-        glDeleteShader(vertexShader->id);
-        SDL_free(vertexShader);
-        return NULL;
+    if (GraphicsDevice_GetShaderCacheDirectory(graphicsDevice) == NULL) {
+        vertexShader->id =
+            ShaderProgram_CompileShader(GL_VERTEX_SHADER, vertexShader->source, length, wait);
+        if (vertexShader->id == 0) {
+            SDL_free(vertexShader->source);
+            SDL_free(vertexShader);
+            return NULL;
+        }
     }
 
     return vertexShader;
 }
 
+VertexShader *VertexShader_CreateFromBuffer(
+    GraphicsDevice *graphicsDevice, void *buffer, uint32_t length) {
+    return VertexShader_CreateFromSource(graphicsDevice, buffer, length, true);
+}
+
+VertexShader *VertexShader_CreateFromBufferAsync(
+    GraphicsDevice *graphicsDevice, void *buffer, uint32_t length) {
+    return VertexShader_CreateFromSource(graphicsDevice, buffer, length, false);
+}
+
 void VertexShader_Destroy(VertexShader *vertexShader) {
     assert(vertexShader != NULL);
 
     glDeleteShader(vertexShader->id);
+    SDL_free(vertexShader->source);
     SDL_free(vertexShader);
 }
 
@@ -139,110 +327,183 @@ FragmentShader *FragmentShader_Create(GraphicsDevice *graphicsDevice, char *file
     return fragmentShader;
 }
 
-FragmentShader *FragmentShader_CreateFromBuffer(
-    GraphicsDevice *graphicsDevice, void *buffer, uint32_t length) {
+static FragmentShader *FragmentShader_CreateFromSource(
+    GraphicsDevice *graphicsDevice, void *buffer, uint32_t length, bool wait) {
     assert(graphicsDevice != NULL);
     assert(buffer != NULL);
     assert(length > 0);
 
-    FragmentShader *fragmentShader = SDL_malloc(sizeof(FragmentShader));
+    FragmentShader *fragmentShader = SDL_calloc(1, sizeof(FragmentShader));
     if (fragmentShader == NULL) {
-        SDL_Log("SDL_malloc failed");
+        SDL_Log("SDL_calloc failed");
         return NULL;
     }
 
-    fragmentShader->id = glCreateShader(GL_FRAGMENT_SHADER);
-    if (fragmentShader->id == 0) {
-        SDL_Log("glCreateShader(GL_FRAGMENT_SHADER) failed");
+    fragmentShader->source = ShaderProgram_CopySource(buffer, length, &fragmentShader->hash);
+    fragmentShader->length = length;
+    if (fragmentShader->source == NULL) {
         SDL_free(fragmentShader);
         return NULL;
     }
 
-    glShaderSource(fragmentShader->id, 1, (const GLchar *const *)&buffer, (GLint *)&length);
-    glCompileShader(fragmentShader->id);
-
-    int status;
-    glGetShaderiv(fragmentShader->id, GL_COMPILE_STATUS, &status);
-    if (status != GL_TRUE) {
-        char infoLog[1024];
-        int logLength;
-        glGetShaderInfoLog(fragmentShader->id, 1024, &logLength, infoLog);
-        SDL_Log("FragmentShader compilation failed. Compiler output:\n%s", infoLog);
-        glDeleteShader(fragmentShader->id);
-        SDL_free(fragmentShader);
-        return NULL;
+    if (GraphicsDevice_GetShaderCacheDirectory(graphicsDevice) == NULL) {
+        fragmentShader->id =
+            ShaderProgram_CompileShader(GL_FRAGMENT_SHADER, fragmentShader->source, length, wait);
+        if (fragmentShader->id == 0) {
+            SDL_free(fragmentShader->source);
+            SDL_free(fragmentShader);
+            return NULL;
+        }
     }
 
     return fragmentShader;
 }
 
+FragmentShader *FragmentShader_CreateFromBuffer(
+    GraphicsDevice *graphicsDevice, void *buffer, uint32_t length) {
+    return FragmentShader_CreateFromSource(graphicsDevice, buffer, length, true);
+}
+
+FragmentShader *FragmentShader_CreateFromBufferAsync(
+    GraphicsDevice *graphicsDevice, void *buffer, uint32_t length) {
+    return FragmentShader_CreateFromSource(graphicsDevice, buffer, length, false);
+}
+
 void FragmentShader_Destroy(FragmentShader *fragmentShader) {
     assert(fragmentShader != NULL);
 
     glDeleteShader(fragmentShader->id);
+    SDL_free(fragmentShader->source);
     SDL_free(fragmentShader);
 }
 
-ShaderProgram *ShaderProgram_Create(
-    GraphicsDevice *graphicsDevice, VertexShader *vertexShader, FragmentShader *fragmentShader) {
-    assert(graphicsDevice != NULL);
-    assert(vertexShader != NULL);
-    assert(fragmentShader != NULL);
+// cached binaries are keyed by both sources and the driver, any driver update invalidates them
+static void ShaderProgram_GetCachePath(GraphicsDevice *graphicsDevice, VertexShader *vertexShader,
+    FragmentShader *fragmentShader, char *path, size_t pathSize) {
+    uint64_t hash = SHADER_PROGRAM_HASH_SEED;
+    hash = ShaderProgram_Hash(hash, &vertexShader->hash, sizeof(uint64_t));
+    hash = ShaderProgram_Hash(hash, &fragmentShader->hash, sizeof(uint64_t));
+
+    GLenum driverStrings[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+    for (int i = 0; i < 3; i++) {
+        const char *driverString = (const char *)glGetString(driverStrings[i]);
+        if (driverString != NULL) {
+            hash = ShaderProgram_Hash(hash, driverString, SDL_strlen(driverString));
+        }
+    }
 
-    ShaderProgram *shaderProgram = SDL_malloc(sizeof(ShaderProgram));
-    if (shaderProgram == NULL) {
+    SDL_snprintf(path,
+        pathSize,
+        "%s%016llx.shader",
+        GraphicsDevice_GetShaderCacheDirectory(graphicsDevice),
+        (unsigned long long)hash);
+}
+
+// false if there is no usable binary, the program is then compiled and linked from source
+static bool ShaderProgram_LoadBinary(uint32_t programId, const char *path) {
+    size_t dataSize;
+    uint8_t *data = SDL_LoadFile(path, &dataSize);
+    if (data == NULL) {
+        return false;
+    }
+
+    ShaderBinaryHeader header;
+    bool linked = false;
+
+    if (dataSize >= sizeof(header)) {
+        SDL_memcpy(&header, data, sizeof(header));
+    }
+
+    if (dataSize >= sizeof(header) && header.magic == SHADER_BINARY_MAGIC &&
+        header.length == dataSize - sizeof(header)) {
+        glProgramBinary_(programId, header.format, data + sizeof(header), header.length);
+
+        int status;
+        glGetProgramiv(programId, GL_LINK_STATUS, &status);
+        linked = (status == GL_TRUE);
+    }
+
+    if (!linked) {
+        SDL_Log("Ignoring stale shader binary %s", path);
+    }
+
+    SDL_free(data);
+    return linked;
+}
+
+static void ShaderProgram_SaveBinary(uint32_t programId, const char *path) {
+    int length = 0;
+    glGetProgramiv(programId, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    uint8_t *data = SDL_malloc(sizeof(ShaderBinaryHeader) + length);
+    if (data == NULL) {
         SDL_Log("SDL_malloc failed");
-        return NULL;
+        return;
     }
 
-    shaderProgram->attributes = NULL;
-    shaderProgram->attributeCount = 0;
-    shaderProgram->parameters = NULL;
-    shaderProgram->parameterValues = NULL;
-    shaderProgram->parameterCount = 0;
+    ShaderBinaryHeader header = {.magic = SHADER_BINARY_MAGIC};
+    glGetProgramBinary_(
+        programId, length, &length, &header.format, data + sizeof(ShaderBinaryHeader));
+    header.length = length;
+    SDL_memcpy(data, &header, sizeof(header));
 
-    shaderProgram->id = glCreateProgram();
-    if (shaderProgram->id == 0) {
-        SDL_Log("glCreateProgram failed");
-        SDL_free(shaderProgram);
-        return NULL;
+    if (!SDL_SaveFile(path, data, sizeof(header) + length)) {
+        SDL_Log("SDL_SaveFile failed %s: %s", path, SDL_GetError());
     }
 
-    glAttachShader(shaderProgram->id, vertexShader->id);
-    glAttachShader(shaderProgram->id, fragmentShader->id);
-    glLinkProgram(shaderProgram->id);
+    SDL_free(data);
+}
 
-    int status;
-    glGetProgramiv(shaderProgram->id, GL_LINK_STATUS, &status);
-    if (status != GL_TRUE) {
-        char infoLog[1024];
-        int logLength;
-        glGetProgramInfoLog(shaderProgram->id, 1024, &logLength, infoLog);
-        glDeleteProgram(shaderProgram->id);
-        SDL_Log("ShaderProgram linking failed. Linker output:\n%s", infoLog);
-        glDeleteShader(shaderProgram->id);
-        SDL_free(shaderProgram);
-        return NULL;
+// the device's blocks live at fixed binding points, a program that declares one is pointed at it
+static void ShaderProgram_BindUniformBlock(ShaderProgram *shaderProgram, char *blockName,
+    UniformBlockBinding binding, size_t bufferSize) {
+    uint32_t blockIndex = glGetUniformBlockIndex(shaderProgram->id, blockName);
+    if (blockIndex == GL_INVALID_INDEX) {
+        return;
+    }
+
+    int blockSize;
+    glGetActiveUniformBlockiv(
+        shaderProgram->id, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+    if ((size_t)blockSize > bufferSize) {
+        SDL_Log("Shader program has an invalid layout for uniform block: %s", blockName);
+        return;
     }
 
+    glUniformBlockBinding(shaderProgram->id, blockIndex, binding);
+}
+
+// queries the uniforms and attributes of a linked program
+static bool ShaderProgram_Reflect(ShaderProgram *shaderProgram) {
     int uniformCount;
     glGetProgramiv(shaderProgram->id, GL_ACTIVE_UNIFORMS, &uniformCount);
 
     shaderProgram->parameters = SDL_calloc(uniformCount, sizeof(ShaderDetail));
     if (shaderProgram->parameters == NULL) {
         SDL_Log("SDL_calloc failed");
-        return NULL;
+        return false;
     }
 
     shaderProgram->parameterValues = SDL_malloc(uniformCount * sizeof(ShaderParameterValue));
     if (shaderProgram->parameterValues == NULL) {
         SDL_Log("SDL_calloc failed");
-        return NULL;
+        return false;
     }
 
-    shaderProgram->parameterCount = uniformCount;
-
     for (int i = 0; i < uniformCount; i++) {
+        // members of uniform blocks are filled from the block's buffer, they aren't parameters
+        uint32_t uniformIndex = i;
+        int blockIndex;
+        glGetActiveUniformsiv(
+            shaderProgram->id, 1, &uniformIndex, GL_UNIFORM_BLOCK_INDEX, &blockIndex);
+        if (blockIndex != -1) {
+            continue;
+        }
+
+        int index = shaderProgram->parameterCount++;
         int size;
 
         glGetActiveUniform(shaderProgram->id,
@@ -250,20 +511,26 @@ ShaderProgram *ShaderProgram_Create(
             256,
             NULL,
             &size,
-            &shaderProgram->parameters[i].type,
-            shaderProgram->parameters[i].name);
-        shaderProgram->parameters[i].location =
-            glGetUniformLocation(shaderProgram->id, shaderProgram->parameters[i].name);
-        shaderProgram->parameterValues[i].type = SHADER_PARAMETER_INVALID;
+            &shaderProgram->parameters[index].type,
+            shaderProgram->parameters[index].name);
+        shaderProgram->parameters[index].location =
+            glGetUniformLocation(shaderProgram->id, shaderProgram->parameters[index].name);
+        shaderProgram->parameterValues[index].type = SHADER_PARAMETER_INVALID;
+        shaderProgram->parameterValues[index].dirty = false;
     }
 
+    ShaderProgram_BindUniformBlock(
+        shaderProgram, "FrameConstants", UNIFORM_BLOCK_FRAME_CONSTANTS, sizeof(FrameConstants));
+    ShaderProgram_BindUniformBlock(
+        shaderProgram, "ViewConstants", UNIFORM_BLOCK_VIEW_CONSTANTS, sizeof(ViewConstants));
+
     int attributeCount;
     glGetProgramiv(shaderProgram->id, GL_ACTIVE_ATTRIBUTES, &attributeCount);
 
     shaderProgram->attributes = SDL_calloc(attributeCount, sizeof(ShaderDetail));
     if (shaderProgram->attributes == NULL) {
         SDL_Log("SDL_calloc failed");
-        return NULL;
+        return false;
     }
 
     shaderProgram->attributeCount = attributeCount;
@@ -297,6 +564,11 @@ ShaderProgram *ShaderProgram_Create(
         SDL_Log("Shader program has an invalid type for attribute: texcoord");
     }
 
+    uint32_t textureIndexType = ShaderProgram_GetAttributeType(shaderProgram, "textureIndex");
+    if (textureIndexType != 0 && textureIndexType != GL_FLOAT) {
+        SDL_Log("Shader program has an invalid type for attribute: textureIndex");
+    }
+
     uint32_t projectionMatrixType =
         ShaderProgram_GetParameterType(shaderProgram, "ProjectionMatrix");
     if (projectionMatrixType != 0 && projectionMatrixType != GL_FLOAT_MAT4) {
@@ -308,16 +580,191 @@ ShaderProgram *ShaderProgram_Create(
         SDL_Log("Shader program has an invalid type for uniform: TextureSampler");
     }
 
+    return true;
+}
+
+// checks the link and reflects the program once the driver is done with it. this waits for the
+// compile and link when they are still running.
+static void ShaderProgram_Finish(ShaderProgram *shaderProgram) {
+    int status;
+    glGetProgramiv(shaderProgram->id, GL_LINK_STATUS, &status);
+
+    if (status != GL_TRUE) {
+        // compile errors only show up here for shaders that were created async
+        if (shaderProgram->vertexShaderId != 0) {
+            ShaderProgram_CheckShader(shaderProgram->vertexShaderId, "VertexShader");
+        }
+        if (shaderProgram->fragmentShaderId != 0) {
+            ShaderProgram_CheckShader(shaderProgram->fragmentShaderId, "FragmentShader");
+        }
+
+        char infoLog[1024];
+        int logLength;
+        glGetProgramInfoLog(shaderProgram->id, 1024, &logLength, infoLog);
+        SDL_Log("ShaderProgram linking failed. Linker output:\n%s", infoLog);
+        shaderProgram->status = SHADER_PROGRAM_STATUS_FAILED;
+    } else {
+        if (shaderProgram->cachePath != NULL) {
+            ShaderProgram_SaveBinary(shaderProgram->id, shaderProgram->cachePath);
+        }
+
+        shaderProgram->status = ShaderProgram_Reflect(shaderProgram)
+                                    ? SHADER_PROGRAM_STATUS_READY
+                                    : SHADER_PROGRAM_STATUS_FAILED;
+    }
+
+    SDL_free(shaderProgram->cachePath);
+    shaderProgram->cachePath = NULL;
+}
+
+#ifdef PINIM_CAPTURE
+static void ShaderProgram_KeepSources(
+    ShaderProgram *shaderProgram, VertexShader *vertexShader, FragmentShader *fragmentShader) {
+    uint64_t hash;
+    shaderProgram->vertexSource =
+        ShaderProgram_CopySource(vertexShader->source, vertexShader->length, &hash);
+    shaderProgram->fragmentSource =
+        ShaderProgram_CopySource(fragmentShader->source, fragmentShader->length, &hash);
+    shaderProgram->vertexLength = (shaderProgram->vertexSource != NULL) ? vertexShader->length : 0;
+    shaderProgram->fragmentLength =
+        (shaderProgram->fragmentSource != NULL) ? fragmentShader->length : 0;
+}
+#endif
+
+ShaderProgram *ShaderProgram_CreateAsync(
+    GraphicsDevice *graphicsDevice, VertexShader *vertexShader, FragmentShader *fragmentShader) {
+    assert(graphicsDevice != NULL);
+    assert(vertexShader != NULL);
+    assert(fragmentShader != NULL);
+
+    ShaderProgram *shaderProgram = SDL_calloc(1, sizeof(ShaderProgram));
+    if (shaderProgram == NULL) {
+        SDL_Log("SDL_calloc failed");
+        return NULL;
+    }
+
+    shaderProgram->graphicsDevice = graphicsDevice;
+    shaderProgram->status = SHADER_PROGRAM_STATUS_PENDING;
+
+    shaderProgram->id = glCreateProgram();
+    if (shaderProgram->id == 0) {
+        SDL_Log("glCreateProgram failed");
+        SDL_free(shaderProgram);
+        return NULL;
+    }
+
+    ShaderProgram_IsParallelCompileSupported();
+
+    char cachePath[1024];
+    bool cacheEnabled = GraphicsDevice_GetShaderCacheDirectory(graphicsDevice) != NULL &&
+                        ShaderProgram_IsBinaryCacheSupported();
+    if (cacheEnabled) {
+        ShaderProgram_GetCachePath(
+            graphicsDevice, vertexShader, fragmentShader, cachePath, sizeof(cachePath));
+
+        // loading a binary is quick, the program is ready straight away
+        if (ShaderProgram_LoadBinary(shaderProgram->id, cachePath)) {
+            ShaderProgram_Finish(shaderProgram);
+#ifdef PINIM_CAPTURE
+            ShaderProgram_KeepSources(shaderProgram, vertexShader, fragmentShader);
+#endif
+            return shaderProgram;
+        }
+    }
+
+    // shaders created with the cache enabled haven't been compiled yet
+    if (vertexShader->id == 0) {
+        vertexShader->id = ShaderProgram_CompileShader(
+            GL_VERTEX_SHADER, vertexShader->source, vertexShader->length, false);
+    }
+    if (fragmentShader->id == 0) {
+        fragmentShader->id = ShaderProgram_CompileShader(
+            GL_FRAGMENT_SHADER, fragmentShader->source, fragmentShader->length, false);
+    }
+    if (vertexShader->id == 0 || fragmentShader->id == 0) {
+        glDeleteProgram(shaderProgram->id);
+        SDL_free(shaderProgram);
+        return NULL;
+    }
+
+    if (cacheEnabled) {
+        glProgramParameteri_(shaderProgram->id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        shaderProgram->cachePath = SDL_strdup(cachePath);
+    }
+
+    // the shader objects may be destroyed before the link is done, but gl keeps them alive for
+    // as long as they're attached
+    shaderProgram->vertexShaderId = vertexShader->id;
+    shaderProgram->fragmentShaderId = fragmentShader->id;
+
+    glAttachShader(shaderProgram->id, vertexShader->id);
+    glAttachShader(shaderProgram->id, fragmentShader->id);
+    glLinkProgram(shaderProgram->id);
+
+#ifdef PINIM_CAPTURE
+    ShaderProgram_KeepSources(shaderProgram, vertexShader, fragmentShader);
+#endif
     return shaderProgram;
 }
 
+ShaderProgram *ShaderProgram_Create(
+    GraphicsDevice *graphicsDevice, VertexShader *vertexShader, FragmentShader *fragmentShader) {
+    ShaderProgram *shaderProgram =
+        ShaderProgram_CreateAsync(graphicsDevice, vertexShader, fragmentShader);
+    if (shaderProgram == NULL) {
+        return NULL;
+    }
+
+    if (shaderProgram->status == SHADER_PROGRAM_STATUS_PENDING) {
+        ShaderProgram_Finish(shaderProgram);
+    }
+
+    if (shaderProgram->status != SHADER_PROGRAM_STATUS_READY) {
+        ShaderProgram_Destroy(shaderProgram);
+        return NULL;
+    }
+
+    return shaderProgram;
+}
+
+ShaderProgramStatus ShaderProgram_GetStatus(ShaderProgram *shaderProgram) {
+    assert(shaderProgram != NULL);
+
+    if (shaderProgram->status == SHADER_PROGRAM_STATUS_PENDING) {
+        // without the extension there is no way to ask, so this finishes the program
+        if (ShaderProgram_IsParallelCompileSupported()) {
+            int completed;
+            glGetProgramiv(shaderProgram->id, GL_COMPLETION_STATUS_KHR, &completed);
+            if (completed != GL_TRUE) {
+                return SHADER_PROGRAM_STATUS_PENDING;
+            }
+        }
+
+        ShaderProgram_Finish(shaderProgram);
+    }
+
+    return shaderProgram->status;
+}
+
+bool ShaderProgram_IsReady(ShaderProgram *shaderProgram) {
+    return ShaderProgram_GetStatus(shaderProgram) == SHADER_PROGRAM_STATUS_READY;
+}
+
 void ShaderProgram_Destroy(ShaderProgram *shaderProgram) {
     assert(shaderProgram != NULL);
 
+    GraphicsDevice_NotifyStateChange(shaderProgram->graphicsDevice);
     SDL_free(shaderProgram->attributes);
     SDL_free(shaderProgram->parameterValues);
     SDL_free(shaderProgram->parameters);
-    glDeleteShader(shaderProgram->id);
+    SDL_free(shaderProgram->cachePath);
+#ifdef PINIM_CAPTURE
+    SDL_free(shaderProgram->vertexSource);
+    SDL_free(shaderProgram->fragmentSource);
+#endif
+    glDeleteProgram(shaderProgram->id);
+    GraphicsDevice_ForgetProgram(shaderProgram->graphicsDevice, shaderProgram->id);
+    COMMAND_CAPTURE_FORGET_OBJECT(shaderProgram->graphicsDevice, shaderProgram);
     SDL_free(shaderProgram);
 }
 
@@ -347,199 +794,245 @@ int ShaderProgram_FindParameterIndex(ShaderProgram *shaderProgram, char *paramet
     return -1;
 }
 
-bool ShaderProgram_SetParameterTexture2D(
-    ShaderProgram *shaderProgram, char *parameterName, Texture *texture, int slotNumber) {
-    assert(shaderProgram != NULL);
-    assert(parameterName != NULL);
-    assert(texture != NULL);
-
-    int index = ShaderProgram_FindParameterIndex(shaderProgram, parameterName);
-    if (index == -1) {
+// stores value for the next apply when handle is a parameter of the given type. unchanged values
+// are left alone, so they are neither uploaded again nor flush a held back draw.
+static bool ShaderProgram_StoreParameterValue(ShaderProgram *shaderProgram, int32_t handle,
+    ShaderParameterType type, ShaderParameterValue *value, size_t valueSize) {
+    // a pending program has no parameters yet, the value would be lost without a word
+    if (shaderProgram->status == SHADER_PROGRAM_STATUS_PENDING) {
+        SDL_Log("ShaderProgram parameters can't be set before ShaderProgram_IsReady");
         return false;
     }
 
-    ShaderDetail *parameter = &shaderProgram->parameters[index];
-    ShaderParameterValue *value = &shaderProgram->parameterValues[index];
+    if (handle < 0 || handle >= shaderProgram->parameterCount) {
+        return false;
+    }
 
-    if (parameter->type != SHADER_PARAMETER_TEXTURE2D) {
+    if (shaderProgram->parameters[handle].type != type) {
         return false;
     }
 
-    value->type = parameter->type;
-    value->slot = slotNumber;
-    value->textureId = Texture_GetTextureId(texture);
+    // textures are recorded by the setter, the value only has the texture's id
+    if (type != SHADER_PARAMETER_TEXTURE2D) {
+        COMMAND_CAPTURE_CALL(shaderProgram->graphicsDevice,
+            CommandCapture_RecordSetParameter,
+            shaderProgram,
+            shaderProgram->parameters[handle].name,
+            type,
+            value,
+            (uint32_t)valueSize);
+    }
+
+    ShaderParameterValue *storedValue = &shaderProgram->parameterValues[handle];
+    if (storedValue->type == type && SDL_memcmp(storedValue, value, valueSize) == 0) {
+        return true;
+    }
+
+    GraphicsDevice_NotifyStateChange(shaderProgram->graphicsDevice);
+    SDL_memcpy(storedValue, value, valueSize);
+    storedValue->type = type;
+    storedValue->dirty = true;
 
     return true;
 }
 
-bool ShaderProgram_SetParameterMatrix4(
-    ShaderProgram *shaderProgram, char *parameterName, float parameterValue[16]) {
+int32_t ShaderProgram_GetParameterHandle(ShaderProgram *shaderProgram, char *parameterName) {
     assert(shaderProgram != NULL);
-    assert(parameterName != NULL);
 
-    int index = ShaderProgram_FindParameterIndex(shaderProgram, parameterName);
-    if (index == -1) {
-        return false;
+    if (shaderProgram->status == SHADER_PROGRAM_STATUS_PENDING) {
+        SDL_Log("ShaderProgram parameter handles can't be resolved before ShaderProgram_IsReady");
+        return -1;
     }
 
-    ShaderDetail *parameter = &shaderProgram->parameters[index];
-    ShaderParameterValue *value = &shaderProgram->parameterValues[index];
+    return ShaderProgram_FindParameterIndex(shaderProgram, parameterName);
+}
 
-    if (parameter->type != SHADER_PARAMETER_FLOAT_MAT4) {
-        return false;
-    }
+bool ShaderProgram_SetParameterTexture2DByHandle(
+    ShaderProgram *shaderProgram, int32_t handle, Texture *texture, int32_t slotNumber) {
+    assert(shaderProgram != NULL);
+    assert(texture != NULL);
 
-    value->type = parameter->type;
-    for (int i = 0; i < 16; i++) {
-        value->matrix[i] = parameterValue[i];
+    ShaderParameterValue value = {.textureId = Texture_GetTextureId(texture), .slot = slotNumber};
+    bool stored = ShaderProgram_StoreParameterValue(shaderProgram,
+        handle,
+        SHADER_PARAMETER_TEXTURE2D,
+        &value,
+        sizeof(value.textureId) + sizeof(value.slot));
+    if (stored) {
+        COMMAND_CAPTURE_CALL(shaderProgram->graphicsDevice,
+            CommandCapture_RecordSetParameterTexture,
+            shaderProgram,
+            shaderProgram->parameters[handle].name,
+            texture,
+            slotNumber);
     }
 
-    return true;
+    return stored;
 }
 
-bool ShaderProgram_SetParameterFloat(
-    ShaderProgram *shaderProgram, char *parameterName, float parameterValue) {
+bool ShaderProgram_SetParameterMatrix4ByHandle(
+    ShaderProgram *shaderProgram, int32_t handle, float parameterValue[16]) {
     assert(shaderProgram != NULL);
-    assert(parameterName != NULL);
 
-    int index = ShaderProgram_FindParameterIndex(shaderProgram, parameterName);
-    if (index == -1) {
-        return false;
-    }
+    ShaderParameterValue value;
+    SDL_memcpy(value.matrix, parameterValue, 16 * sizeof(float));
+    return ShaderProgram_StoreParameterValue(
+        shaderProgram, handle, SHADER_PARAMETER_FLOAT_MAT4, &value, 16 * sizeof(float));
+}
 
-    ShaderDetail *parameter = &shaderProgram->parameters[index];
-    ShaderParameterValue *value = &shaderProgram->parameterValues[index];
+bool ShaderProgram_SetParameterFloatByHandle(
+    ShaderProgram *shaderProgram, int32_t handle, float parameterValue) {
+    assert(shaderProgram != NULL);
 
-    if (parameter->type != SHADER_PARAMETER_FLOAT) {
-        return false;
-    }
+    ShaderParameterValue value = {.f = {parameterValue}};
+    return ShaderProgram_StoreParameterValue(
+        shaderProgram, handle, SHADER_PARAMETER_FLOAT, &value, sizeof(float));
+}
 
-    value->type = parameter->type;
-    value->f[0] = parameterValue;
+bool ShaderProgram_SetParameterFloat2ByHandle(
+    ShaderProgram *shaderProgram, int32_t handle, float parameterValue[2]) {
+    assert(shaderProgram != NULL);
 
-    return true;
+    ShaderParameterValue value = {.f = {parameterValue[0], parameterValue[1]}};
+    return ShaderProgram_StoreParameterValue(
+        shaderProgram, handle, SHADER_PARAMETER_FLOAT_VEC2, &value, 2 * sizeof(float));
 }
 
-bool ShaderProgram_SetParameterFloat2(
-    ShaderProgram *shaderProgram, char *parameterName, float parameterValue[2]) {
+bool ShaderProgram_SetParameterFloat3ByHandle(
+    ShaderProgram *shaderProgram, int32_t handle, float parameterValue[3]) {
     assert(shaderProgram != NULL);
-    assert(parameterName != NULL);
 
-    int index = ShaderProgram_FindParameterIndex(shaderProgram, parameterName);
-    if (index == -1) {
-        return false;
-    }
+    ShaderParameterValue value = {.f = {parameterValue[0], parameterValue[1], parameterValue[2]}};
+    return ShaderProgram_StoreParameterValue(
+        shaderProgram, handle, SHADER_PARAMETER_FLOAT_VEC3, &value, 3 * sizeof(float));
+}
 
-    ShaderDetail *parameter = &shaderProgram->parameters[index];
-    ShaderParameterValue *value = &shaderProgram->parameterValues[index];
+bool ShaderProgram_SetParameterFloat4ByHandle(
+    ShaderProgram *shaderProgram, int32_t handle, float parameterValue[4]) {
+    assert(shaderProgram != NULL);
 
-    if (parameter->type != SHADER_PARAMETER_FLOAT_VEC2) {
-        return false;
-    }
+    ShaderParameterValue value;
+    SDL_memcpy(value.f, parameterValue, 4 * sizeof(float));
+    return ShaderProgram_StoreParameterValue(
+        shaderProgram, handle, SHADER_PARAMETER_FLOAT_VEC4, &value, 4 * sizeof(float));
+}
 
-    value->type = parameter->type;
-    value->f[0] = parameterValue[0];
-    value->f[1] = parameterValue[1];
+bool ShaderProgram_SetParameterIntByHandle(
+    ShaderProgram *shaderProgram, int32_t handle, int parameterValue) {
+    assert(shaderProgram != NULL);
 
-    return true;
+    ShaderParameterValue value = {.i = {parameterValue}};
+    return ShaderProgram_StoreParameterValue(
+        shaderProgram, handle, SHADER_PARAMETER_INT, &value, sizeof(int));
 }
 
-bool ShaderProgram_SetParameterFloat3(
-    ShaderProgram *shaderProgram, char *parameterName, float parameterValue[3]) {
+bool ShaderProgram_SetParameterInt2ByHandle(
+    ShaderProgram *shaderProgram, int32_t handle, int parameterValue[2]) {
     assert(shaderProgram != NULL);
-    assert(parameterName != NULL);
 
-    int index = ShaderProgram_FindParameterIndex(shaderProgram, parameterName);
-    if (index == -1) {
-        return false;
-    }
+    ShaderParameterValue value = {.i = {parameterValue[0], parameterValue[1]}};
+    return ShaderProgram_StoreParameterValue(
+        shaderProgram, handle, SHADER_PARAMETER_INT_VEC2, &value, 2 * sizeof(int));
+}
 
-    ShaderDetail *parameter = &shaderProgram->parameters[index];
-    ShaderParameterValue *value = &shaderProgram->parameterValues[index];
+bool ShaderProgram_SetParameterInt3ByHandle(
+    ShaderProgram *shaderProgram, int32_t handle, int parameterValue[3]) {
+    assert(shaderProgram != NULL);
 
-    if (parameter->type != SHADER_PARAMETER_FLOAT_VEC3) {
-        return false;
-    }
+    ShaderParameterValue value = {.i = {parameterValue[0], parameterValue[1], parameterValue[2]}};
+    return ShaderProgram_StoreParameterValue(
+        shaderProgram, handle, SHADER_PARAMETER_INT_VEC3, &value, 3 * sizeof(int));
+}
 
-    value->type = parameter->type;
-    value->f[0] = parameterValue[0];
-    value->f[1] = parameterValue[1];
-    value->f[2] = parameterValue[2];
+bool ShaderProgram_SetParameterInt4ByHandle(
+    ShaderProgram *shaderProgram, int32_t handle, int parameterValue[4]) {
+    assert(shaderProgram != NULL);
 
-    return true;
+    ShaderParameterValue value;
+    SDL_memcpy(value.i, parameterValue, 4 * sizeof(int));
+    return ShaderProgram_StoreParameterValue(
+        shaderProgram, handle, SHADER_PARAMETER_INT_VEC4, &value, 4 * sizeof(int));
 }
 
-bool ShaderProgram_SetParameterFloat4(
-    ShaderProgram *shaderProgram, char *parameterName, float parameterValue[4]) {
+bool ShaderProgram_SetParameterTexture2D(
+    ShaderProgram *shaderProgram, char *parameterName, Texture *texture, int slotNumber) {
     assert(shaderProgram != NULL);
     assert(parameterName != NULL);
 
-    int index = ShaderProgram_FindParameterIndex(shaderProgram, parameterName);
-    if (index == -1) {
-        return false;
-    }
-
-    ShaderDetail *parameter = &shaderProgram->parameters[index];
-    ShaderParameterValue *value = &shaderProgram->parameterValues[index];
-
-    if (parameter->type != SHADER_PARAMETER_FLOAT_VEC4) {
-        return false;
-    }
+    return ShaderProgram_SetParameterTexture2DByHandle(shaderProgram,
+        ShaderProgram_FindParameterIndex(shaderProgram, parameterName),
+        texture,
+        slotNumber);
+}
 
-    value->type = parameter->type;
-    value->f[0] = parameterValue[0];
-    value->f[1] = parameterValue[1];
-    value->f[2] = parameterValue[2];
-    value->f[3] = parameterValue[3];
+bool ShaderProgram_SetParameterMatrix4(
+    ShaderProgram *shaderProgram, char *parameterName, float parameterValue[16]) {
+    assert(shaderProgram != NULL);
+    assert(parameterName != NULL);
 
-    return true;
+    return ShaderProgram_SetParameterMatrix4ByHandle(shaderProgram,
+        ShaderProgram_FindParameterIndex(shaderProgram, parameterName),
+        parameterValue);
 }
 
-bool ShaderProgram_SetParameterInt(
-    ShaderProgram *shaderProgram, char *parameterName, int parameterValue) {
+bool ShaderProgram_SetParameterFloat(
+    ShaderProgram *shaderProgram, char *parameterName, float parameterValue) {
     assert(shaderProgram != NULL);
     assert(parameterName != NULL);
 
-    int index = ShaderProgram_FindParameterIndex(shaderProgram, parameterName);
-    if (index == -1) {
-        return false;
-    }
+    return ShaderProgram_SetParameterFloatByHandle(shaderProgram,
+        ShaderProgram_FindParameterIndex(shaderProgram, parameterName),
+        parameterValue);
+}
 
-    ShaderDetail *parameter = &shaderProgram->parameters[index];
-    ShaderParameterValue *value = &shaderProgram->parameterValues[index];
+bool ShaderProgram_SetParameterFloat2(
+    ShaderProgram *shaderProgram, char *parameterName, float parameterValue[2]) {
+    assert(shaderProgram != NULL);
+    assert(parameterName != NULL);
 
-    if (parameter->type != SHADER_PARAMETER_INT) {
-        return false;
-    }
+    return ShaderProgram_SetParameterFloat2ByHandle(shaderProgram,
+        ShaderProgram_FindParameterIndex(shaderProgram, parameterName),
+        parameterValue);
+}
 
-    value->type = parameter->type;
-    value->i[0] = parameterValue;
+bool ShaderProgram_SetParameterFloat3(
+    ShaderProgram *shaderProgram, char *parameterName, float parameterValue[3]) {
+    assert(shaderProgram != NULL);
+    assert(parameterName != NULL);
 
-    return true;
+    return ShaderProgram_SetParameterFloat3ByHandle(shaderProgram,
+        ShaderProgram_FindParameterIndex(shaderProgram, parameterName),
+        parameterValue);
 }
 
-bool ShaderProgram_SetParameterInt2(
-    ShaderProgram *shaderProgram, char *parameterName, int parameterValue[2]) {
+bool ShaderProgram_SetParameterFloat4(
+    ShaderProgram *shaderProgram, char *parameterName, float parameterValue[4]) {
     assert(shaderProgram != NULL);
     assert(parameterName != NULL);
 
-    int index = ShaderProgram_FindParameterIndex(shaderProgram, parameterName);
-    if (index == -1) {
-        return false;
-    }
+    return ShaderProgram_SetParameterFloat4ByHandle(shaderProgram,
+        ShaderProgram_FindParameterIndex(shaderProgram, parameterName),
+        parameterValue);
+}
 
-    ShaderDetail *parameter = &shaderProgram->parameters[index];
-    ShaderParameterValue *value = &shaderProgram->parameterValues[index];
+bool ShaderProgram_SetParameterInt(
+    ShaderProgram *shaderProgram, char *parameterName, int parameterValue) {
+    assert(shaderProgram != NULL);
+    assert(parameterName != NULL);
 
-    if (parameter->type != SHADER_PARAMETER_INT_VEC2) {
-        return false;
-    }
+    return ShaderProgram_SetParameterIntByHandle(shaderProgram,
+        ShaderProgram_FindParameterIndex(shaderProgram, parameterName),
+        parameterValue);
+}
 
-    value->type = parameter->type;
-    value->i[0] = parameterValue[0];
-    value->i[1] = parameterValue[1];
+bool ShaderProgram_SetParameterInt2(
+    ShaderProgram *shaderProgram, char *parameterName, int parameterValue[2]) {
+    assert(shaderProgram != NULL);
+    assert(parameterName != NULL);
 
-    return true;
+    return ShaderProgram_SetParameterInt2ByHandle(shaderProgram,
+        ShaderProgram_FindParameterIndex(shaderProgram, parameterName),
+        parameterValue);
 }
 
 bool ShaderProgram_SetParameterInt3(
@@ -547,24 +1040,9 @@ bool ShaderProgram_SetParameterInt3(
     assert(shaderProgram != NULL);
     assert(parameterName != NULL);
 
-    int index = ShaderProgram_FindParameterIndex(shaderProgram, parameterName);
-    if (index == -1) {
-        return false;
-    }
-
-    ShaderDetail *parameter = &shaderProgram->parameters[index];
-    ShaderParameterValue *value = &shaderProgram->parameterValues[index];
-
-    if (parameter->type != SHADER_PARAMETER_INT_VEC3) {
-        return false;
-    }
-
-    value->type = parameter->type;
-    value->i[0] = parameterValue[0];
-    value->i[1] = parameterValue[1];
-    value->i[2] = parameterValue[2];
-
-    return true;
+    return ShaderProgram_SetParameterInt3ByHandle(shaderProgram,
+        ShaderProgram_FindParameterIndex(shaderProgram, parameterName),
+        parameterValue);
 }
 
 bool ShaderProgram_SetParameterInt4(
@@ -572,25 +1050,9 @@ bool ShaderProgram_SetParameterInt4(
     assert(shaderProgram != NULL);
     assert(parameterName != NULL);
 
-    int index = ShaderProgram_FindParameterIndex(shaderProgram, parameterName);
-    if (index == -1) {
-        return false;
-    }
-
-    ShaderDetail *parameter = &shaderProgram->parameters[index];
-    ShaderParameterValue *value = &shaderProgram->parameterValues[index];
-
-    if (parameter->type != SHADER_PARAMETER_INT_VEC4) {
-        return false;
-    }
-
-    value->type = parameter->type;
-    value->i[0] = parameterValue[0];
-    value->i[1] = parameterValue[1];
-    value->i[2] = parameterValue[2];
-    value->i[3] = parameterValue[3];
-
-    return true;
+    return ShaderProgram_SetParameterInt4ByHandle(shaderProgram,
+        ShaderProgram_FindParameterIndex(shaderProgram, parameterName),
+        parameterValue);
 }
 
 void ShaderProgram_ClearParameter(ShaderProgram *shaderProgram, char *parameterName) {
@@ -599,20 +1061,38 @@ void ShaderProgram_ClearParameter(ShaderProgram *shaderProgram, char *parameterN
 
     int index = ShaderProgram_FindParameterIndex(shaderProgram, parameterName);
     if (index != -1) {
+        COMMAND_CAPTURE_CALL(shaderProgram->graphicsDevice,
+            CommandCapture_RecordClearParameter,
+            shaderProgram,
+            parameterName);
+        GraphicsDevice_NotifyStateChange(shaderProgram->graphicsDevice);
         shaderProgram->parameterValues[index].type = SHADER_PARAMETER_INVALID;
     }
 }
 
+// uniforms are program state, so only values set since the last apply are uploaded. textures
+// are bound every time since the units are shared, the device skips the ones already bound.
 void ShaderProgram_ApplyParameters(ShaderProgram *shaderProgram) {
     assert(shaderProgram != NULL);
 
+    TRACE_ZONE("ShaderProgram_ApplyParameters");
+
     for (int i = 0; i < shaderProgram->parameterCount; i++) {
         ShaderParameterValue *parameterValue = &shaderProgram->parameterValues[i];
         ShaderDetail *parameter = &shaderProgram->parameters[i];
+
+        if (parameterValue->type == SHADER_PARAMETER_TEXTURE2D) {
+            GraphicsDevice_BindTexture(
+                shaderProgram->graphicsDevice, parameterValue->slot, parameterValue->textureId);
+        }
+
+        if (!parameterValue->dirty) {
+            continue;
+        }
+        parameterValue->dirty = false;
+
         switch (parameterValue->type) {
         case SHADER_PARAMETER_TEXTURE2D:
-            glActiveTexture(GL_TEXTURE0 + parameterValue->slot);
-            glBindTexture(GL_TEXTURE_2D, parameterValue->textureId);
             glUniform1i(parameter->location, parameterValue->slot);
             break;
         case SHADER_PARAMETER_FLOAT_MAT4:
@@ -715,4 +1195,16 @@ uint32_t ShaderProgram_GetShaderId(ShaderProgram *shaderProgram) {
     assert(shaderProgram != NULL);
 
     return shaderProgram->id;
-}
\ No newline at end of file
+}
+
+#ifdef PINIM_CAPTURE
+void ShaderProgram_GetSources(ShaderProgram *shaderProgram, const char **vertexSource,
+    uint32_t *vertexLength, const char **fragmentSource, uint32_t *fragmentLength) {
+    assert(shaderProgram != NULL);
+
+    *vertexSource = shaderProgram->vertexSource;
+    *vertexLength = shaderProgram->vertexLength;
+    *fragmentSource = shaderProgram->fragmentSource;
+    *fragmentLength = shaderProgram->fragmentLength;
+}
+#endif
\ No newline at end of file
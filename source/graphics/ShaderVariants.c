@@ -0,0 +1,451 @@
+#include <assert.h>
+#include <SDL3/SDL.h>
+
+#include <ShaderProgram.h>
+#include <ShaderVariants.h>
+
+// includes nested deeper than this are taken to be a cycle
+#define SHADER_INCLUDE_MAXIMUM_DEPTH 16
+#define SHADER_VARIANTS_MAXIMUM_FEATURES 32
+
+typedef struct ShaderSourceBuilder {
+    char *data;
+    size_t length;
+    size_t capacity;
+    bool failed;
+} ShaderSourceBuilder;
+
+typedef struct ShaderVariant {
+    uint32_t featureMask;
+    // null when the variant failed to compile
+    ShaderProgram *shaderProgram;
+} ShaderVariant;
+
+struct ShaderVariants {
+    GraphicsDevice *graphicsDevice;
+
+    // with the includes already expanded
+    char *vertexSource;
+    uint32_t vertexLength;
+    char *fragmentSource;
+    uint32_t fragmentLength;
+
+    char *features[SHADER_VARIANTS_MAXIMUM_FEATURES];
+    uint32_t featureCount;
+
+    ShaderVariant *variants;
+    uint32_t variantCount;
+    uint32_t variantCapacity;
+};
+
+static void ShaderVariants_Append(ShaderSourceBuilder *builder, const char *text, size_t length) {
+    if (builder->failed) {
+        return;
+    }
+
+    if (builder->length + length + 1 > builder->capacity) {
+        size_t capacity = SDL_max(builder->capacity * 2, builder->length + length + 1);
+        capacity = SDL_max(capacity, 1024);
+
+        char *data = SDL_realloc(builder->data, capacity);
+        if (data == NULL) {
+            SDL_Log("SDL_realloc failed");
+            builder->failed = true;
+            return;
+        }
+
+        builder->data = data;
+        builder->capacity = capacity;
+    }
+
+    SDL_memcpy(builder->data + builder->length, text, length);
+    builder->length += length;
+    builder->data[builder->length] = '\0';
+}
+
+// the directory part of path including the separator, empty when there is none
+static void ShaderVariants_GetDirectory(const char *path, char *directory, size_t directorySize) {
+    size_t length = 0;
+    for (size_t i = 0; path[i] != '\0'; i++) {
+        if (path[i] == '/' || path[i] == '\\') {
+            length = i + 1;
+        }
+    }
+
+    length = SDL_min(length, directorySize - 1);
+    SDL_memcpy(directory, path, length);
+    directory[length] = '\0';
+}
+
+static size_t ShaderVariants_SkipWhitespace(const char *line, size_t lineLength, size_t i) {
+    while (i < lineLength && (line[i] == ' ' || line[i] == '\t')) {
+        i++;
+    }
+    return i;
+}
+
+// the file name of an #include "fileName" line, false for any other line
+static bool ShaderVariants_ParseInclude(
+    const char *line, size_t lineLength, char *fileName, size_t fileNameSize) {
+    size_t i = ShaderVariants_SkipWhitespace(line, lineLength, 0);
+    if (i == lineLength || line[i] != '#') {
+        return false;
+    }
+
+    i = ShaderVariants_SkipWhitespace(line, lineLength, i + 1);
+    if (lineLength - i < 7 || SDL_strncmp(line + i, "include", 7) != 0) {
+        return false;
+    }
+
+    i = ShaderVariants_SkipWhitespace(line, lineLength, i + 7);
+    if (i == lineLength || line[i] != '"') {
+        return false;
+    }
+
+    size_t start = ++i;
+    while (i < lineLength && line[i] != '"') {
+        i++;
+    }
+
+    // malformed includes are left for the glsl compiler to complain about
+    if (i == lineLength || i - start >= fileNameSize) {
+        return false;
+    }
+
+    SDL_memcpy(fileName, line + start, i - start);
+    fileName[i - start] = '\0';
+    return true;
+}
+
+// copies source into builder line by line, replacing #include lines with the included file. the
+// source ends at length or at a null terminator, whichever comes first.
+static bool ShaderVariants_ExpandIncludes(ShaderSourceBuilder *builder, const char *source,
+    size_t length, const char *includeDirectory, int depth) {
+    if (depth > SHADER_INCLUDE_MAXIMUM_DEPTH) {
+        SDL_Log("Shader includes are nested too deeply, they probably include each other");
+        return false;
+    }
+
+    size_t position = 0;
+    while (position < length && source[position] != '\0') {
+        size_t lineEnd = position;
+        while (lineEnd < length && source[lineEnd] != '\n' && source[lineEnd] != '\0') {
+            lineEnd++;
+        }
+
+        char fileName[256];
+        if (ShaderVariants_ParseInclude(
+                source + position, lineEnd - position, fileName, sizeof(fileName))) {
+            char path[1024];
+            SDL_snprintf(path,
+                sizeof(path),
+                "%s%s",
+                (includeDirectory != NULL) ? includeDirectory : "",
+                fileName);
+
+            size_t dataSize;
+            char *data = SDL_LoadFile(path, &dataSize);
+            if (data == NULL) {
+                SDL_Log("SDL_LoadFile failed %s", path);
+                return false;
+            }
+
+            // nested includes are relative to the file they're in
+            char directory[1024];
+            ShaderVariants_GetDirectory(path, directory, sizeof(directory));
+            bool expanded =
+                ShaderVariants_ExpandIncludes(builder, data, dataSize, directory, depth + 1);
+            SDL_free(data);
+            if (!expanded) {
+                return false;
+            }
+
+            if (builder->length > 0 && builder->data[builder->length - 1] != '\n') {
+                ShaderVariants_Append(builder, "\n", 1);
+            }
+        } else {
+            ShaderVariants_Append(builder, source + position, lineEnd - position);
+            if (lineEnd < length && source[lineEnd] == '\n') {
+                ShaderVariants_Append(builder, "\n", 1);
+            }
+        }
+
+        position = lineEnd + 1;
+    }
+
+    return !builder->failed;
+}
+
+// #version has to stay the first directive, so the defines go on the lines after it
+static char *ShaderVariants_AddDefines(const char *source, size_t length, const char **defines,
+    uint32_t defineCount, uint32_t *resultLength) {
+    size_t insertPosition = 0;
+    const char *version = SDL_strstr(source, "#version");
+    if (version != NULL) {
+        const char *lineEnd = SDL_strchr(version, '\n');
+        insertPosition = (lineEnd != NULL) ? (size_t)(lineEnd + 1 - source) : length;
+    }
+
+    ShaderSourceBuilder builder = {0};
+    ShaderVariants_Append(&builder, source, insertPosition);
+    if (insertPosition > 0 && source[insertPosition - 1] != '\n') {
+        ShaderVariants_Append(&builder, "\n", 1);
+    }
+
+    for (uint32_t i = 0; i < defineCount; i++) {
+        char define[256];
+        const char *value = SDL_strchr(defines[i], '=');
+        if (value != NULL) {
+            SDL_snprintf(define,
+                sizeof(define),
+                "#define %.*s %s\n",
+                (int)(value - defines[i]),
+                defines[i],
+                value + 1);
+        } else {
+            SDL_snprintf(define, sizeof(define), "#define %s 1\n", defines[i]);
+        }
+        ShaderVariants_Append(&builder, define, SDL_strlen(define));
+    }
+
+    ShaderVariants_Append(&builder, source + insertPosition, length - insertPosition);
+
+    if (builder.failed || builder.data == NULL) {
+        SDL_free(builder.data);
+        return NULL;
+    }
+
+    *resultLength = (uint32_t)builder.length;
+    return builder.data;
+}
+
+static char *ShaderVariants_Expand(
+    const char *source, uint32_t length, const char *includeDirectory, uint32_t *resultLength) {
+    ShaderSourceBuilder builder = {0};
+    if (!ShaderVariants_ExpandIncludes(&builder, source, length, includeDirectory, 0) ||
+        builder.data == NULL) {
+        SDL_free(builder.data);
+        return NULL;
+    }
+
+    *resultLength = (uint32_t)builder.length;
+    return builder.data;
+}
+
+char *ShaderVariants_Preprocess(const char *source, uint32_t length, const char *includeDirectory,
+    const char **defines, uint32_t defineCount, uint32_t *resultLength) {
+    assert(source != NULL);
+    assert(defines != NULL || defineCount == 0);
+    assert(resultLength != NULL);
+
+    uint32_t expandedLength;
+    char *expanded = ShaderVariants_Expand(source, length, includeDirectory, &expandedLength);
+    if (expanded == NULL) {
+        return NULL;
+    }
+
+    char *result =
+        ShaderVariants_AddDefines(expanded, expandedLength, defines, defineCount, resultLength);
+    SDL_free(expanded);
+    return result;
+}
+
+static ShaderVariants *ShaderVariants_CreateFromSources(GraphicsDevice *graphicsDevice,
+    void *vertexSource, uint32_t vertexLength, const char *vertexDirectory, void *fragmentSource,
+    uint32_t fragmentLength, const char *fragmentDirectory, const char **features,
+    uint32_t featureCount) {
+    assert(graphicsDevice != NULL);
+    assert(vertexSource != NULL);
+    assert(fragmentSource != NULL);
+    assert(features != NULL || featureCount == 0);
+
+    if (featureCount > SHADER_VARIANTS_MAXIMUM_FEATURES) {
+        SDL_Log("ShaderVariants supports at most %d features", SHADER_VARIANTS_MAXIMUM_FEATURES);
+        return NULL;
+    }
+
+    ShaderVariants *shaderVariants = SDL_calloc(1, sizeof(ShaderVariants));
+    if (shaderVariants == NULL) {
+        SDL_Log("SDL_calloc failed");
+        return NULL;
+    }
+
+    shaderVariants->graphicsDevice = graphicsDevice;
+    shaderVariants->vertexSource = ShaderVariants_Expand(
+        vertexSource, vertexLength, vertexDirectory, &shaderVariants->vertexLength);
+    shaderVariants->fragmentSource = ShaderVariants_Expand(
+        fragmentSource, fragmentLength, fragmentDirectory, &shaderVariants->fragmentLength);
+    if (shaderVariants->vertexSource == NULL || shaderVariants->fragmentSource == NULL) {
+        ShaderVariants_Destroy(shaderVariants);
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < featureCount; i++) {
+        shaderVariants->features[i] = SDL_strdup(features[i]);
+        if (shaderVariants->features[i] == NULL) {
+            SDL_Log("SDL_strdup failed");
+            ShaderVariants_Destroy(shaderVariants);
+            return NULL;
+        }
+        shaderVariants->featureCount++;
+    }
+
+    return shaderVariants;
+}
+
+ShaderVariants *ShaderVariants_Create(GraphicsDevice *graphicsDevice, char *vertexFileName,
+    char *fragmentFileName, const char **features, uint32_t featureCount) {
+    assert(vertexFileName != NULL);
+    assert(fragmentFileName != NULL);
+
+    size_t vertexSize;
+    void *vertexData = SDL_LoadFile(vertexFileName, &vertexSize);
+    if (vertexData == NULL) {
+        SDL_Log("SDL_LoadFile failed %s", vertexFileName);
+        return NULL;
+    }
+
+    size_t fragmentSize;
+    void *fragmentData = SDL_LoadFile(fragmentFileName, &fragmentSize);
+    if (fragmentData == NULL) {
+        SDL_Log("SDL_LoadFile failed %s", fragmentFileName);
+        SDL_free(vertexData);
+        return NULL;
+    }
+
+    char vertexDirectory[1024];
+    char fragmentDirectory[1024];
+    ShaderVariants_GetDirectory(vertexFileName, vertexDirectory, sizeof(vertexDirectory));
+    ShaderVariants_GetDirectory(fragmentFileName, fragmentDirectory, sizeof(fragmentDirectory));
+
+    ShaderVariants *shaderVariants = ShaderVariants_CreateFromSources(graphicsDevice,
+        vertexData,
+        vertexSize,
+        vertexDirectory,
+        fragmentData,
+        fragmentSize,
+        fragmentDirectory,
+        features,
+        featureCount);
+
+    SDL_free(fragmentData);
+    SDL_free(vertexData);
+    return shaderVariants;
+}
+
+ShaderVariants *ShaderVariants_CreateFromBuffer(GraphicsDevice *graphicsDevice,
+    void *vertexSource, uint32_t vertexLength, void *fragmentSource, uint32_t fragmentLength,
+    const char *includeDirectory, const char **features, uint32_t featureCount) {
+    return ShaderVariants_CreateFromSources(graphicsDevice,
+        vertexSource,
+        vertexLength,
+        includeDirectory,
+        fragmentSource,
+        fragmentLength,
+        includeDirectory,
+        features,
+        featureCount);
+}
+
+void ShaderVariants_Destroy(ShaderVariants *shaderVariants) {
+    assert(shaderVariants != NULL);
+
+    for (uint32_t i = 0; i < shaderVariants->variantCount; i++) {
+        if (shaderVariants->variants[i].shaderProgram != NULL) {
+            ShaderProgram_Destroy(shaderVariants->variants[i].shaderProgram);
+        }
+    }
+
+    for (uint32_t i = 0; i < shaderVariants->featureCount; i++) {
+        SDL_free(shaderVariants->features[i]);
+    }
+
+    SDL_free(shaderVariants->variants);
+    SDL_free(shaderVariants->fragmentSource);
+    SDL_free(shaderVariants->vertexSource);
+    SDL_free(shaderVariants);
+}
+
+static ShaderProgram *ShaderVariants_Compile(ShaderVariants *shaderVariants, uint32_t featureMask) {
+    const char *defines[SHADER_VARIANTS_MAXIMUM_FEATURES];
+    uint32_t defineCount = 0;
+    for (uint32_t i = 0; i < shaderVariants->featureCount; i++) {
+        if (featureMask & (1u << i)) {
+            defines[defineCount++] = shaderVariants->features[i];
+        }
+    }
+
+    uint32_t vertexLength;
+    uint32_t fragmentLength;
+    char *vertexSource = ShaderVariants_AddDefines(shaderVariants->vertexSource,
+        shaderVariants->vertexLength,
+        defines,
+        defineCount,
+        &vertexLength);
+    char *fragmentSource = ShaderVariants_AddDefines(shaderVariants->fragmentSource,
+        shaderVariants->fragmentLength,
+        defines,
+        defineCount,
+        &fragmentLength);
+
+    ShaderProgram *shaderProgram = NULL;
+    VertexShader *vertexShader = NULL;
+    FragmentShader *fragmentShader = NULL;
+
+    if (vertexSource != NULL && fragmentSource != NULL) {
+        vertexShader = VertexShader_CreateFromBuffer(
+            shaderVariants->graphicsDevice, vertexSource, vertexLength);
+        fragmentShader = FragmentShader_CreateFromBuffer(
+            shaderVariants->graphicsDevice, fragmentSource, fragmentLength);
+    }
+
+    if (vertexShader != NULL && fragmentShader != NULL) {
+        shaderProgram =
+            ShaderProgram_Create(shaderVariants->graphicsDevice, vertexShader, fragmentShader);
+    }
+
+    if (shaderProgram == NULL) {
+        SDL_Log("Shader variant 0x%x failed to compile", featureMask);
+    }
+
+    if (fragmentShader != NULL) {
+        FragmentShader_Destroy(fragmentShader);
+    }
+    if (vertexShader != NULL) {
+        VertexShader_Destroy(vertexShader);
+    }
+    SDL_free(fragmentSource);
+    SDL_free(vertexSource);
+
+    return shaderProgram;
+}
+
+ShaderProgram *ShaderVariants_GetProgram(ShaderVariants *shaderVariants, uint32_t featureMask) {
+    assert(shaderVariants != NULL);
+
+    for (uint32_t i = 0; i < shaderVariants->variantCount; i++) {
+        if (shaderVariants->variants[i].featureMask == featureMask) {
+            return shaderVariants->variants[i].shaderProgram;
+        }
+    }
+
+    if (shaderVariants->variantCount == shaderVariants->variantCapacity) {
+        uint32_t capacity = SDL_max(shaderVariants->variantCapacity * 2, 4);
+        ShaderVariant *variants =
+            SDL_realloc(shaderVariants->variants, capacity * sizeof(ShaderVariant));
+        if (variants == NULL) {
+            SDL_Log("SDL_realloc failed");
+            return NULL;
+        }
+
+        shaderVariants->variants = variants;
+        shaderVariants->variantCapacity = capacity;
+    }
+
+    // failures are remembered too, so a broken variant is only reported once
+    ShaderVariant *variant = &shaderVariants->variants[shaderVariants->variantCount++];
+    variant->featureMask = featureMask;
+    variant->shaderProgram = ShaderVariants_Compile(shaderVariants, featureMask);
+
+    return variant->shaderProgram;
+}
@@ -0,0 +1,379 @@
+#include <assert.h>
+#include <SDL3/SDL.h>
+
+#include <CommandCapture.h>
+#include <GameMath.h>
+#include <GraphicsDevice.h>
+#include <ShaderProgram.h>
+#include <SpriteRenderer.h>
+#include <Texture.h>
+#include <VertexBuffer.h>
+
+struct SpriteRenderer {
+    GraphicsDevice *graphicsDevice;
+    ShaderProgram *defaultShaderProgram;
+    ShaderProgram *currentShaderProgram;
+    VertexBuffer *instanceBuffer;
+    Texture *texture;
+    Matrix4 transformMatrix;
+    BlendMode blendMode;
+    uint32_t activeSprites;
+    uint32_t maximumSprites;
+    // memory from VertexBuffer_BeginWrite, null until the first sprite after a flush
+    SpriteInstance *instances;
+    bool batchStarted;
+
+    // parameter handles of handleShaderProgram, looked up again when the shader changes
+    ShaderProgram *handleShaderProgram;
+    int32_t transformMatrixHandle;
+    int32_t projectionMatrixHandle;
+    int32_t textureSamplerHandle;
+    int32_t textureSizeHandle;
+};
+
+static char defaultSpriteVertexShaderSource[] =
+    // input from CPU, one of each per sprite
+    "#version 410\n"
+    "in vec4 position;\n"
+    "in float rotation;\n"
+    "in vec2 scale;\n"
+    "in vec2 origin;\n"
+    "in vec4 sourceRectangle;\n"
+    "in vec4 color;\n"
+    "in float uvMode;\n"
+    // output to fragment shader
+    "out vec4 v_color;\n"
+    "out vec2 v_texcoord;\n"
+    // custom input from program
+    VIEW_CONSTANTS_GLSL
+    "uniform mat4 TransformMatrix;\n"
+    "uniform vec2 TextureSize;\n"
+    //
+    "void main()\n"
+    "{\n"
+    // drawn as a triangle strip: top left, top right, bottom left, bottom right
+    "	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+    "	int mode = int(uvMode + 0.5);\n"
+    // flips pick the uv of the mirrored corner, see UVMode
+    "	vec2 uvCorner = corner;\n"
+    "	if ((mode & 4) != 0) uvCorner.x = 1.0 - uvCorner.x;\n"
+    "	if ((mode & 8) != 0) uvCorner.y = 1.0 - uvCorner.y;\n"
+    "	vec2 texel;\n"
+    "	if ((mode & 2) != 0) {\n"
+    "		texel = sourceRectangle.xy + vec2((1.0 - uvCorner.y) * sourceRectangle.w,\n"
+    "			uvCorner.x * sourceRectangle.z);\n"
+    "	} else {\n"
+    "		texel = sourceRectangle.xy + uvCorner * sourceRectangle.zw;\n"
+    "	}\n"
+    "	vec2 local = (corner - origin) * scale * sourceRectangle.zw;\n"
+    "	float s = sin(rotation);\n"
+    "	float c = cos(rotation);\n"
+    "	vec2 world = vec2(local.x * c - local.y * s, local.x * s + local.y * c) + position.xy;\n"
+    "	gl_Position = ViewProjectionMatrix * TransformMatrix * vec4(world, 0.0, 1.0);\n"
+    "	v_color = color;\n"
+    "	v_texcoord = texel / TextureSize;\n"
+    "}\n";
+
+static char defaultSpriteFragmentShaderSource[] =
+    // input from vertex shader
+    "#version 410\n"
+    "in vec4 v_color;\n"
+    "in vec2 v_texcoord;\n"
+    "out vec4 fragColor;\n"
+    // custom input from program
+    "uniform sampler2D TextureSampler;\n"
+    //
+    "void main()\n"
+    "{\n"
+    "	fragColor = texture(TextureSampler, v_texcoord) * v_color;\n"
+    "}\n";
+
+static ShaderProgram *SpriteRenderer_CreateShaderProgram(GraphicsDevice *graphicsDevice) {
+    VertexShader *vertexShader = VertexShader_CreateFromBuffer(graphicsDevice,
+        defaultSpriteVertexShaderSource,
+        sizeof(defaultSpriteVertexShaderSource));
+    if (vertexShader == NULL) {
+        SDL_Log("VertexShader_CreateFromBuffer failed");
+        return NULL;
+    }
+
+    FragmentShader *fragmentShader = FragmentShader_CreateFromBuffer(graphicsDevice,
+        defaultSpriteFragmentShaderSource,
+        sizeof(defaultSpriteFragmentShaderSource));
+    if (fragmentShader == NULL) {
+        SDL_Log("FragmentShader_CreateFromBuffer failed");
+        VertexShader_Destroy(vertexShader);
+        return NULL;
+    }
+
+    ShaderProgram *shaderProgram =
+        ShaderProgram_Create(graphicsDevice, vertexShader, fragmentShader);
+    if (shaderProgram == NULL) {
+        SDL_Log("ShaderProgram_Create failed");
+    }
+
+    FragmentShader_Destroy(fragmentShader);
+    VertexShader_Destroy(vertexShader);
+
+    return shaderProgram;
+}
+
+SpriteRenderer *SpriteRenderer_Create(GraphicsDevice *graphicsDevice, uint32_t maximumSprites) {
+    assert(graphicsDevice != NULL);
+    assert(maximumSprites > 0);
+
+    SpriteRenderer *spriteRenderer = SDL_calloc(1, sizeof(SpriteRenderer));
+    if (spriteRenderer == NULL) {
+        SDL_Log("SDL_calloc failed");
+        return NULL;
+    }
+    spriteRenderer->maximumSprites = maximumSprites;
+
+    spriteRenderer->defaultShaderProgram = SpriteRenderer_CreateShaderProgram(graphicsDevice);
+    if (spriteRenderer->defaultShaderProgram == NULL) {
+        SDL_Log("SpriteRenderer_CreateShaderProgram failed");
+        SDL_free(spriteRenderer);
+        return NULL;
+    }
+
+    spriteRenderer->instanceBuffer = VertexBuffer_Create(
+        graphicsDevice, VERTEX_BUFFER_DYNAMIC, VERTEX_FORMAT_SPRITE_INSTANCE, maximumSprites);
+    if (spriteRenderer->instanceBuffer == NULL) {
+        SDL_Log("VertexBuffer_Create failed");
+        ShaderProgram_Destroy(spriteRenderer->defaultShaderProgram);
+        SDL_free(spriteRenderer);
+        return NULL;
+    }
+
+    // fall back to glBufferSubData if the driver won't map, SetUploadStrategy logs why
+    VertexBuffer_SetUploadStrategy(
+        spriteRenderer->instanceBuffer, VERTEX_BUFFER_UPLOAD_MAP_UNSYNCHRONIZED);
+
+    spriteRenderer->graphicsDevice = graphicsDevice;
+
+    return spriteRenderer;
+}
+
+void SpriteRenderer_Destroy(SpriteRenderer *spriteRenderer) {
+    assert(spriteRenderer != NULL);
+
+    VertexBuffer_Destroy(spriteRenderer->instanceBuffer);
+    ShaderProgram_Destroy(spriteRenderer->defaultShaderProgram);
+    SDL_free(spriteRenderer);
+}
+
+void SpriteRenderer_Begin(SpriteRenderer *spriteRenderer, BlendMode blendMode, Texture *texture,
+    ShaderProgram *shaderProgram, Matrix4 transformMatrix) {
+    assert(spriteRenderer != NULL);
+    assert(texture != NULL);
+
+    if (spriteRenderer->batchStarted) {
+        SDL_Log("SpriteRenderer_Begin called on already started SpriteRenderer");
+        return;
+    }
+
+    spriteRenderer->activeSprites = 0;
+    spriteRenderer->instances = NULL;
+    spriteRenderer->batchStarted = true;
+    spriteRenderer->blendMode = blendMode;
+    spriteRenderer->texture = texture;
+    spriteRenderer->currentShaderProgram =
+        (shaderProgram != NULL) ? shaderProgram : spriteRenderer->defaultShaderProgram;
+
+    Matrix4_Copy(transformMatrix, spriteRenderer->transformMatrix);
+}
+
+void SpriteRenderer_End(SpriteRenderer *spriteRenderer) {
+    assert(spriteRenderer != NULL);
+
+    if (!spriteRenderer->batchStarted) {
+        SDL_Log("SpriteRenderer_End called on unstarted SpriteRenderer");
+        return;
+    }
+
+    SpriteRenderer_Flush(spriteRenderer);
+
+    spriteRenderer->batchStarted = false;
+}
+
+void SpriteRenderer_SetTexture(SpriteRenderer *spriteRenderer, Texture *texture) {
+    assert(spriteRenderer != NULL);
+    assert(texture != NULL);
+
+    if (spriteRenderer->texture != texture) {
+        SpriteRenderer_Flush(spriteRenderer);
+        spriteRenderer->texture = texture;
+    }
+}
+
+void SpriteRenderer_Flush(SpriteRenderer *spriteRenderer) {
+    assert(spriteRenderer != NULL);
+
+    if (!spriteRenderer->batchStarted || spriteRenderer->instances == NULL) {
+        return;
+    }
+
+    if (spriteRenderer->activeSprites == 0) {
+        VertexBuffer_EndWrite(
+            spriteRenderer->instanceBuffer, NULL, VERTEX_FORMAT_SPRITE_INSTANCE, 0);
+        spriteRenderer->instances = NULL;
+        return;
+    }
+
+    // SpriteRenderer isn't captured, neither are the calls it makes to draw
+    COMMAND_CAPTURE_SCOPE(spriteRenderer->graphicsDevice);
+
+    // programs still compiling draw with the default shader instead of waiting on the driver
+    ShaderProgram *shaderProgram = spriteRenderer->currentShaderProgram;
+    if (!ShaderProgram_IsReady(shaderProgram)) {
+        shaderProgram = spriteRenderer->defaultShaderProgram;
+    }
+
+    if (spriteRenderer->handleShaderProgram != shaderProgram) {
+        spriteRenderer->handleShaderProgram = shaderProgram;
+        spriteRenderer->transformMatrixHandle =
+            ShaderProgram_GetParameterHandle(shaderProgram, "TransformMatrix");
+        spriteRenderer->projectionMatrixHandle =
+            ShaderProgram_GetParameterHandle(shaderProgram, "ProjectionMatrix");
+        spriteRenderer->textureSamplerHandle =
+            ShaderProgram_GetParameterHandle(shaderProgram, "TextureSampler");
+        spriteRenderer->textureSizeHandle =
+            ShaderProgram_GetParameterHandle(shaderProgram, "TextureSize");
+    }
+
+    GraphicsDevice_SetBlendMode(spriteRenderer->graphicsDevice, spriteRenderer->blendMode);
+    GraphicsDevice_ApplyShaderProgram(spriteRenderer->graphicsDevice, shaderProgram);
+
+    float textureSize[2] = {(float)Texture_GetWidth(spriteRenderer->texture),
+        (float)Texture_GetHeight(spriteRenderer->texture)};
+    ShaderProgram_SetParameterTexture2DByHandle(
+        shaderProgram, spriteRenderer->textureSamplerHandle, spriteRenderer->texture, 0);
+    ShaderProgram_SetParameterFloat2ByHandle(
+        shaderProgram, spriteRenderer->textureSizeHandle, textureSize);
+    ShaderProgram_SetParameterMatrix4ByHandle(
+        shaderProgram, spriteRenderer->transformMatrixHandle, spriteRenderer->transformMatrix);
+
+    // custom shaders can still take the combined matrix instead of ViewConstants
+    if (spriteRenderer->projectionMatrixHandle != -1) {
+        Matrix4 projectionMatrix;
+        GraphicsDevice_GetProjectionMatrix(spriteRenderer->graphicsDevice, projectionMatrix);
+        Matrix4_Multiply(projectionMatrix, spriteRenderer->transformMatrix, projectionMatrix);
+        ShaderProgram_SetParameterMatrix4ByHandle(
+            shaderProgram, spriteRenderer->projectionMatrixHandle, projectionMatrix);
+    }
+
+    ShaderProgram_ApplyParameters(shaderProgram);
+
+    VertexBuffer_EndWrite(spriteRenderer->instanceBuffer,
+        shaderProgram,
+        VERTEX_FORMAT_SPRITE_INSTANCE,
+        spriteRenderer->activeSprites);
+
+    GraphicsDevice_DrawInstancedPrimitives(spriteRenderer->graphicsDevice,
+        spriteRenderer->instanceBuffer,
+        RENDER_PRIMITIVE_TRIANGLE_STRIP,
+        0,
+        2,
+        spriteRenderer->activeSprites);
+
+    spriteRenderer->instances = NULL;
+    spriteRenderer->activeSprites = 0;
+}
+
+// makes sure there is room for at least one more sprite and returns how many fit
+static uint32_t SpriteRenderer_ReserveSprites(SpriteRenderer *spriteRenderer) {
+    if (spriteRenderer->activeSprites == spriteRenderer->maximumSprites) {
+        SpriteRenderer_Flush(spriteRenderer);
+    }
+
+    if (spriteRenderer->instances == NULL) {
+        spriteRenderer->instances = VertexBuffer_BeginWrite(spriteRenderer->instanceBuffer,
+            VERTEX_FORMAT_SPRITE_INSTANCE,
+            spriteRenderer->maximumSprites);
+        if (spriteRenderer->instances == NULL) {
+            return 0;
+        }
+    }
+
+    return spriteRenderer->maximumSprites - spriteRenderer->activeSprites;
+}
+
+static inline uint8_t SpriteRenderer_PackUnorm8(float value) {
+    return (uint8_t)(SDL_clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+void SpriteRenderer_BatchSprite(SpriteRenderer *spriteRenderer, Rectangle *sourceRectangle,
+    Vector2 position, float rotation, Vector2 scale, Vector2 origin, UVMode uvMode, Color *color) {
+    assert(spriteRenderer != NULL);
+
+    if (!spriteRenderer->batchStarted) {
+        SDL_Log("SpriteRenderer_BatchSprite called on unstarted batch");
+        return;
+    }
+
+    if (SpriteRenderer_ReserveSprites(spriteRenderer) == 0) {
+        return;
+    }
+
+    Rectangle source;
+    if (sourceRectangle != NULL) {
+        source = *sourceRectangle;
+    } else {
+        source = (Rectangle){.x = 0,
+            .y = 0,
+            .width = Texture_GetWidth(spriteRenderer->texture),
+            .height = Texture_GetHeight(spriteRenderer->texture)};
+    }
+
+    SpriteInstance *instance = &spriteRenderer->instances[spriteRenderer->activeSprites++];
+    instance->x = position[0];
+    instance->y = position[1];
+    instance->rotation = rotation;
+    instance->scaleX = scale[0];
+    instance->scaleY = scale[1];
+    instance->originX = origin[0];
+    instance->originY = origin[1];
+    instance->sourceX = (uint16_t)source.x;
+    instance->sourceY = (uint16_t)source.y;
+    instance->sourceWidth = (uint16_t)source.width;
+    instance->sourceHeight = (uint16_t)source.height;
+    if (color != NULL) {
+        instance->r = SpriteRenderer_PackUnorm8(color->r);
+        instance->g = SpriteRenderer_PackUnorm8(color->g);
+        instance->b = SpriteRenderer_PackUnorm8(color->b);
+        instance->a = SpriteRenderer_PackUnorm8(color->a);
+    } else {
+        instance->r = 255;
+        instance->g = 255;
+        instance->b = 255;
+        instance->a = 255;
+    }
+    instance->uvMode = uvMode;
+}
+
+void SpriteRenderer_BatchSpriteInstances(
+    SpriteRenderer *spriteRenderer, SpriteInstance *instances, uint32_t instanceCount) {
+    assert(spriteRenderer != NULL);
+    assert(instances != NULL || instanceCount == 0);
+
+    if (!spriteRenderer->batchStarted) {
+        SDL_Log("SpriteRenderer_BatchSpriteInstances called on unstarted batch");
+        return;
+    }
+
+    while (instanceCount > 0) {
+        uint32_t available = SpriteRenderer_ReserveSprites(spriteRenderer);
+        if (available == 0) {
+            return;
+        }
+
+        uint32_t count = SDL_min(available, instanceCount);
+        SDL_memcpy(&spriteRenderer->instances[spriteRenderer->activeSprites],
+            instances,
+            count * sizeof(SpriteInstance));
+
+        spriteRenderer->activeSprites += count;
+        instances += count;
+        instanceCount -= count;
+    }
+}
@@ -3,10 +3,13 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include <CommandCapture.h>
 #include <GraphicsDevice.h>
 #include <Texture.h>
+#include <Trace.h>
 
 struct Texture {
+    GraphicsDevice *graphicsDevice;
     TextureFilter textureFilter;
     TextureType textureType;
     uint32_t width;
@@ -28,24 +31,28 @@ static bool Texture_Initialize(Texture *texture, TextureType textureType, uint32
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixelData);
+    if (pixelData != NULL) {
+        GraphicsDevice_AddUploadedBytes(texture->graphicsDevice, (uint64_t)width * height * 4);
+    }
 
     if (textureType == TEXTURE_TYPE_RENDERTARGET) {
-        int currentFramebufferObject;
-        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &currentFramebufferObject);
-
         glGenFramebuffers(1, &texture->fbo);
-        glBindFramebuffer(GL_FRAMEBUFFER, texture->fbo);
+        GraphicsDevice_BindFramebuffer(texture->graphicsDevice, texture->fbo);
         glFramebufferTexture2D(
             GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture->textureId, 0);
 
         GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
         if (status != GL_FRAMEBUFFER_COMPLETE) {
             SDL_Log("Failed to create render target texture");
+            GraphicsDevice_RestoreFramebuffer(texture->graphicsDevice);
+            glDeleteFramebuffers(1, &texture->fbo);
+            GraphicsDevice_ForgetFramebuffer(texture->graphicsDevice, texture->fbo);
             glDeleteTextures(1, &texture->textureId);
+            GraphicsDevice_ForgetTexture(texture->graphicsDevice, texture->textureId);
             return NULL;
         }
 
-        glBindFramebuffer(GL_FRAMEBUFFER, currentFramebufferObject);
+        GraphicsDevice_RestoreFramebuffer(texture->graphicsDevice);
     }
 
     return texture;
@@ -56,6 +63,8 @@ Texture *Texture_Create(GraphicsDevice *graphicsDevice, char *fileName, TextureF
     assert(graphicsDevice != NULL);
     assert(fileName != NULL);
 
+    TRACE_ZONE("Texture_Create");
+
     int imageWidth, imageHeight, imageChannels;
     uint8_t *imagePixels = stbi_load(fileName, &imageWidth, &imageHeight, &imageChannels, 4);
     if (imagePixels == NULL) {
@@ -70,6 +79,8 @@ Texture *Texture_Create(GraphicsDevice *graphicsDevice, char *fileName, TextureF
         return NULL;
     }
 
+    texture->graphicsDevice = graphicsDevice;
+
     if (!Texture_Initialize(texture,
             TEXTURE_TYPE_NORMAL,
             imageWidth,
@@ -109,6 +120,8 @@ Texture *Texture_CreateFromBuffer(GraphicsDevice *graphicsDevice, void *buffer,
         return NULL;
     }
 
+    texture->graphicsDevice = graphicsDevice;
+
     if (!Texture_Initialize(texture,
             TEXTURE_TYPE_NORMAL,
             imageWidth,
@@ -143,6 +156,8 @@ Texture *Texture_CreateFromPixelData(GraphicsDevice *graphicsDevice, uint32_t wi
         return NULL;
     }
 
+    texture->graphicsDevice = graphicsDevice;
+
     if (!Texture_Initialize(
             texture, textureType, width, height, pixelData, dataLength, textureFilter)) {
         SDL_Log("Texture_Initialize failed");
@@ -154,11 +169,16 @@ Texture *Texture_CreateFromPixelData(GraphicsDevice *graphicsDevice, uint32_t wi
 void Texture_Destroy(Texture *texture) {
     assert(texture != NULL);
 
+    GraphicsDevice_NotifyStateChange(texture->graphicsDevice);
+
     if (texture->textureType == TEXTURE_TYPE_RENDERTARGET) {
         glDeleteFramebuffers(1, &texture->fbo);
+        GraphicsDevice_ForgetFramebuffer(texture->graphicsDevice, texture->fbo);
     }
 
     glDeleteTextures(1, &texture->textureId);
+    GraphicsDevice_ForgetTexture(texture->graphicsDevice, texture->textureId);
+    COMMAND_CAPTURE_FORGET_OBJECT(texture->graphicsDevice, texture);
 
     SDL_free(texture);
 }
@@ -170,9 +190,20 @@ void Texture_SetTextureData(Texture *texture, uint32_t x, uint32_t y, uint32_t w
     assert(x + w <= texture->width);
     assert(y + h <= texture->height);
     assert(dataLength == w * h * 4);
-
-    glBindTexture(GL_TEXTURE_2D, texture->textureId);
+    COMMAND_CAPTURE_CALL(texture->graphicsDevice,
+        CommandCapture_RecordSetTextureData,
+        texture,
+        x,
+        y,
+        w,
+        h,
+        pixelData,
+        dataLength);
+
+    GraphicsDevice_NotifyStateChange(texture->graphicsDevice);
+    GraphicsDevice_BindTextureForUpdate(texture->graphicsDevice, texture->textureId);
     glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixelData);
+    GraphicsDevice_AddUploadedBytes(texture->graphicsDevice, dataLength);
 }
 
 TextureFilter Texture_GetTextureFilter(Texture *texture) {
@@ -184,7 +215,8 @@ void Texture_SetTextureFilter(Texture *texture, TextureFilter textureFilter) {
     texture->textureFilter = textureFilter;
     assert(texture != NULL);
 
-    glBindTexture(GL_TEXTURE_2D, texture->textureId);
+    GraphicsDevice_NotifyStateChange(texture->graphicsDevice);
+    GraphicsDevice_BindTextureForUpdate(texture->graphicsDevice, texture->textureId);
 
     switch (textureFilter) {
     case TEXTURE_FILTER_LINEAR:
@@ -1,17 +1,63 @@
 #include <assert.h>
+#include <stddef.h>
 #include <glad/gl.h>
 #include <SDL3/SDL.h>
 
 #include <GraphicsDevice.h>
 #include <ShaderProgram.h>
+#include <Trace.h>
 #include <VertexBuffer.h>
 
+// streaming buffers are split in this many regions, one can be written while the gpu is still
+// reading the others. a fence is placed when writing moves past a region and waited on before
+// writing comes back around to it.
+#define VERTEX_BUFFER_RING_REGIONS 3
+// a region holds at least this many full batches and this many bytes, so flushes pack into it
+// and the ring spans a few frames of typical sprite counts before it waits on anything
+#define VERTEX_BUFFER_RING_REGION_BATCHES 4
+#define VERTEX_BUFFER_RING_MINIMUM_REGION_SIZE (4 * 1024 * 1024)
+
+// ARB_buffer_storage is core in 4.4, glad is only generated for 3.3
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+typedef void(GLAD_API_PTR *PFNGLBUFFERSTORAGEPROC)(
+    GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+
+static PFNGLBUFFERSTORAGEPROC glBufferStorage_ = NULL;
+
 struct VertexBuffer {
+    GraphicsDevice *graphicsDevice;
     uint32_t vertexArrayId;
     uint32_t vertexBufferId;
+    // bytes for maximumVertices, the most one write can hold
+    uint32_t size;
+    // bytes per ring region, the ring is VERTEX_BUFFER_RING_REGIONS times this
+    uint32_t regionSize;
+    VertexBufferType bufferType;
+    VertexBufferUploadStrategy uploadStrategy;
+    GLenum bufferUsage;
+
+    // cpu copy written through BeginWrite with VERTEX_BUFFER_UPLOAD_SUBDATA
+    uint8_t *stagingMemory;
+    // the whole buffer, mapped once with VERTEX_BUFFER_UPLOAD_PERSISTENT
+    uint8_t *persistentMemory;
+    uint32_t region;
+    uint32_t writeOffset;
+    uint32_t writeSize;
+    bool writing;
+    // between SuspendWrite and ResumeWrite, a MAP_UNSYNCHRONIZED write is unmapped meanwhile
+    bool suspended;
+    GLsync regionFences[VERTEX_BUFFER_RING_REGIONS];
 };
 
-VertexBuffer *VertexBuffer_Create(VertexBufferType bufferType, uint32_t maximumVertices) {
+VertexBuffer *VertexBuffer_Create(GraphicsDevice *graphicsDevice, VertexBufferType bufferType,
+    VertexFormat vertexFormat, uint32_t maximumVertices) {
+    assert(graphicsDevice != NULL);
     assert(maximumVertices > 0);
 
     VertexBuffer *vertexBuffer = SDL_malloc(sizeof(VertexBuffer));
@@ -20,57 +66,599 @@ VertexBuffer *VertexBuffer_Create(VertexBufferType bufferType, uint32_t maximumV
         return NULL;
     }
 
+    *vertexBuffer = (VertexBuffer){0};
+    vertexBuffer->graphicsDevice = graphicsDevice;
+    vertexBuffer->size = maximumVertices * VertexBuffer_GetVertexSize(vertexFormat);
+    vertexBuffer->regionSize = SDL_max(vertexBuffer->size * VERTEX_BUFFER_RING_REGION_BATCHES,
+        VERTEX_BUFFER_RING_MINIMUM_REGION_SIZE);
+    vertexBuffer->bufferType = bufferType;
+    vertexBuffer->uploadStrategy = VERTEX_BUFFER_UPLOAD_SUBDATA;
+    vertexBuffer->bufferUsage =
+        (bufferType == VERTEX_BUFFER_STATIC) ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW;
+
     glGenVertexArrays(1, &vertexBuffer->vertexArrayId);
-    glBindVertexArray(vertexBuffer->vertexArrayId);
+    GraphicsDevice_BindVertexArray(graphicsDevice, vertexBuffer->vertexArrayId);
     glEnableVertexAttribArray(vertexBuffer->vertexArrayId);
     glGenBuffers(1, &vertexBuffer->vertexBufferId);
 
-    GLenum bufferUsage = (bufferType == VERTEX_BUFFER_STATIC) ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW;
-
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer->vertexBufferId);
-    glBufferData(GL_ARRAY_BUFFER, maximumVertices * sizeof(Vertex2d), NULL, bufferUsage);
+    GraphicsDevice_BindBuffer(graphicsDevice, BUFFER_TARGET_ARRAY, vertexBuffer->vertexBufferId);
+    glBufferData(GL_ARRAY_BUFFER, vertexBuffer->size, NULL, vertexBuffer->bufferUsage);
 
     return vertexBuffer;
 }
 
+static void VertexBuffer_DeleteFences(VertexBuffer *vertexBuffer) {
+    for (uint32_t region = 0; region < VERTEX_BUFFER_RING_REGIONS; region++) {
+        if (vertexBuffer->regionFences[region] != NULL) {
+            glDeleteSync(vertexBuffer->regionFences[region]);
+            vertexBuffer->regionFences[region] = NULL;
+        }
+    }
+}
+
 void VertexBuffer_Destroy(VertexBuffer *vertexBuffer) {
+    VertexBuffer_DeleteFences(vertexBuffer);
     glDeleteBuffers(1, &vertexBuffer->vertexBufferId);
     glDeleteVertexArrays(1, &vertexBuffer->vertexArrayId);
+    GraphicsDevice_ForgetBuffer(vertexBuffer->graphicsDevice, vertexBuffer->vertexBufferId);
+    GraphicsDevice_ForgetVertexArray(vertexBuffer->graphicsDevice, vertexBuffer->vertexArrayId);
+    SDL_free(vertexBuffer->stagingMemory);
     SDL_free(vertexBuffer);
 }
 
-void VertexBuffer_SetVertexData(VertexBuffer *vertexBuffer, ShaderProgram *shaderProgram,
-    Vertex2d *vertices, uint32_t vertexCount) {
-    assert(shaderProgram != NULL);
-    assert(vertices != NULL);
-    assert(vertexCount > 0);
+bool VertexBuffer_IsUploadStrategySupported(VertexBufferUploadStrategy uploadStrategy) {
+    switch (uploadStrategy) {
+    case VERTEX_BUFFER_UPLOAD_SUBDATA:
+    case VERTEX_BUFFER_UPLOAD_MAP_UNSYNCHRONIZED:
+        return true;
 
-    glBindVertexArray(vertexBuffer->vertexArrayId);
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer->vertexBufferId);
+    case VERTEX_BUFFER_UPLOAD_PERSISTENT:
+        if (glBufferStorage_ == NULL && SDL_GL_ExtensionSupported("GL_ARB_buffer_storage")) {
+            glBufferStorage_ = (PFNGLBUFFERSTORAGEPROC)SDL_GL_GetProcAddress("glBufferStorage");
+        }
+        return glBufferStorage_ != NULL;
 
-    glBufferSubData(GL_ARRAY_BUFFER, 0, vertexCount * sizeof(Vertex2d), vertices);
+    default:
+        return false;
+    }
+}
 
-    int32_t positionLocation = ShaderProgram_GetAttributeLocation(shaderProgram, "position");
-    if (positionLocation != -1) {
-        glVertexAttribPointer(positionLocation, 2, GL_FLOAT, 0, sizeof(Vertex2d), 0);
-        glEnableVertexAttribArray(positionLocation);
+bool VertexBuffer_SetUploadStrategy(
+    VertexBuffer *vertexBuffer, VertexBufferUploadStrategy uploadStrategy) {
+    assert(vertexBuffer != NULL);
+    assert(!vertexBuffer->writing);
+
+    if (vertexBuffer->uploadStrategy == uploadStrategy) {
+        return true;
     }
 
-    int32_t colorLocation = ShaderProgram_GetAttributeLocation(shaderProgram, "color");
-    if (colorLocation != -1) {
-        glVertexAttribPointer(
-            colorLocation, 4, GL_FLOAT, 0, sizeof(Vertex2d), (void *)(sizeof(float) * 4));
-        glEnableVertexAttribArray(colorLocation);
+    if (vertexBuffer->bufferType != VERTEX_BUFFER_DYNAMIC &&
+        uploadStrategy != VERTEX_BUFFER_UPLOAD_SUBDATA) {
+        SDL_Log("Only dynamic vertex buffers can be streamed");
+        return false;
+    }
+
+    if (!VertexBuffer_IsUploadStrategySupported(uploadStrategy)) {
+        SDL_Log("Unsupported VertexBufferUploadStrategy: %d", uploadStrategy);
+        return false;
+    }
+
+    // buffer storage is immutable, so every switch starts over with a new buffer
+    VertexBuffer_DeleteFences(vertexBuffer);
+    glDeleteBuffers(1, &vertexBuffer->vertexBufferId);
+    GraphicsDevice_ForgetBuffer(vertexBuffer->graphicsDevice, vertexBuffer->vertexBufferId);
+    glGenBuffers(1, &vertexBuffer->vertexBufferId);
+    GraphicsDevice_BindBuffer(
+        vertexBuffer->graphicsDevice, BUFFER_TARGET_ARRAY, vertexBuffer->vertexBufferId);
+
+    vertexBuffer->persistentMemory = NULL;
+    vertexBuffer->region = 0;
+    vertexBuffer->writeOffset = 0;
+    vertexBuffer->uploadStrategy = uploadStrategy;
+
+    uint32_t ringSize = vertexBuffer->regionSize * VERTEX_BUFFER_RING_REGIONS;
+
+    switch (uploadStrategy) {
+    case VERTEX_BUFFER_UPLOAD_SUBDATA:
+        glBufferData(GL_ARRAY_BUFFER, vertexBuffer->size, NULL, vertexBuffer->bufferUsage);
+        break;
+
+    case VERTEX_BUFFER_UPLOAD_MAP_UNSYNCHRONIZED:
+        glBufferData(GL_ARRAY_BUFFER, ringSize, NULL, GL_STREAM_DRAW);
+        break;
+
+    case VERTEX_BUFFER_UPLOAD_PERSISTENT: {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage_(GL_ARRAY_BUFFER, ringSize, NULL, flags);
+        vertexBuffer->persistentMemory = glMapBufferRange(GL_ARRAY_BUFFER, 0, ringSize, flags);
+        if (vertexBuffer->persistentMemory == NULL) {
+            SDL_Log("glMapBufferRange failed, falling back to glBufferSubData");
+            VertexBuffer_SetUploadStrategy(vertexBuffer, VERTEX_BUFFER_UPLOAD_SUBDATA);
+            return false;
+        }
+        break;
+    }
+
+    default:
+        break;
     }
 
-    int32_t texcoordLocation = ShaderProgram_GetAttributeLocation(shaderProgram, "texcoord");
-    if (texcoordLocation != -1) {
+    return true;
+}
+
+VertexBufferUploadStrategy VertexBuffer_GetUploadStrategy(VertexBuffer *vertexBuffer) {
+    return vertexBuffer->uploadStrategy;
+}
+
+uint32_t VertexBuffer_GetVertexSize(VertexFormat vertexFormat) {
+    switch (vertexFormat) {
+    case VERTEX_FORMAT_STANDARD:
+        return sizeof(Vertex2d);
+    case VERTEX_FORMAT_MULTITEXTURE:
+        return sizeof(Vertex2dMultiTexture);
+    case VERTEX_FORMAT_COMPACT:
+        return sizeof(Vertex2dCompact);
+    case VERTEX_FORMAT_COMPACT_MULTITEXTURE:
+        return sizeof(Vertex2dCompactMultiTexture);
+    case VERTEX_FORMAT_SPRITE_INSTANCE:
+        return sizeof(SpriteInstance);
+    default:
+        SDL_Log("Unsupported VertexFormat: %d", vertexFormat);
+        return 0;
+    }
+}
+
+// a divisor of 0 steps the attribute per vertex, 1 per instance
+static void VertexBuffer_EnableAttributeWithDivisor(ShaderProgram *shaderProgram,
+    char *attributeName, int32_t componentCount, GLenum componentType, bool normalized,
+    uint32_t stride, uintptr_t offset, uint32_t divisor) {
+    int32_t location = ShaderProgram_GetAttributeLocation(shaderProgram, attributeName);
+    if (location != -1) {
         glVertexAttribPointer(
-            texcoordLocation, 2, GL_FLOAT, 0, sizeof(Vertex2d), (void *)(sizeof(float) * 2));
-        glEnableVertexAttribArray(texcoordLocation);
+            location, componentCount, componentType, normalized, stride, (void *)offset);
+        glVertexAttribDivisor(location, divisor);
+        glEnableVertexAttribArray(location);
+    }
+}
+
+static void VertexBuffer_EnableAttribute(ShaderProgram *shaderProgram, char *attributeName,
+    int32_t componentCount, GLenum componentType, bool normalized, uint32_t stride,
+    uintptr_t offset) {
+    VertexBuffer_EnableAttributeWithDivisor(shaderProgram,
+        attributeName,
+        componentCount,
+        componentType,
+        normalized,
+        stride,
+        offset,
+        0);
+}
+
+// points the attributes at vertices starting offset bytes into the buffer
+static void VertexBuffer_SetAttributes(VertexBuffer *vertexBuffer, ShaderProgram *shaderProgram,
+    VertexFormat vertexFormat, uintptr_t offset) {
+    uint32_t vertexSize = VertexBuffer_GetVertexSize(vertexFormat);
+
+    GraphicsDevice_BindVertexArray(vertexBuffer->graphicsDevice, vertexBuffer->vertexArrayId);
+    GraphicsDevice_BindBuffer(
+        vertexBuffer->graphicsDevice, BUFFER_TARGET_ARRAY, vertexBuffer->vertexBufferId);
+
+    switch (vertexFormat) {
+    case VERTEX_FORMAT_STANDARD:
+        VertexBuffer_EnableAttribute(shaderProgram,
+            "position",
+            2,
+            GL_FLOAT,
+            false,
+            vertexSize,
+            offset + offsetof(Vertex2d, x));
+        VertexBuffer_EnableAttribute(shaderProgram,
+            "color",
+            4,
+            GL_FLOAT,
+            false,
+            vertexSize,
+            offset + offsetof(Vertex2d, r));
+        VertexBuffer_EnableAttribute(shaderProgram,
+            "texcoord",
+            2,
+            GL_FLOAT,
+            false,
+            vertexSize,
+            offset + offsetof(Vertex2d, u));
+        break;
+
+    case VERTEX_FORMAT_MULTITEXTURE:
+        VertexBuffer_EnableAttribute(shaderProgram,
+            "position",
+            2,
+            GL_FLOAT,
+            false,
+            vertexSize,
+            offset + offsetof(Vertex2dMultiTexture, x));
+        VertexBuffer_EnableAttribute(shaderProgram,
+            "color",
+            4,
+            GL_FLOAT,
+            false,
+            vertexSize,
+            offset + offsetof(Vertex2dMultiTexture, r));
+        VertexBuffer_EnableAttribute(shaderProgram,
+            "texcoord",
+            2,
+            GL_FLOAT,
+            false,
+            vertexSize,
+            offset + offsetof(Vertex2dMultiTexture, u));
+        VertexBuffer_EnableAttribute(shaderProgram,
+            "textureIndex",
+            1,
+            GL_FLOAT,
+            false,
+            vertexSize,
+            offset + offsetof(Vertex2dMultiTexture, textureIndex));
+        break;
+
+    case VERTEX_FORMAT_COMPACT:
+        VertexBuffer_EnableAttribute(shaderProgram,
+            "position",
+            2,
+            GL_FLOAT,
+            false,
+            vertexSize,
+            offset + offsetof(Vertex2dCompact, x));
+        VertexBuffer_EnableAttribute(shaderProgram,
+            "color",
+            4,
+            GL_UNSIGNED_BYTE,
+            true,
+            vertexSize,
+            offset + offsetof(Vertex2dCompact, r));
+        VertexBuffer_EnableAttribute(shaderProgram,
+            "texcoord",
+            2,
+            GL_UNSIGNED_SHORT,
+            true,
+            vertexSize,
+            offset + offsetof(Vertex2dCompact, u));
+        break;
+
+    case VERTEX_FORMAT_COMPACT_MULTITEXTURE:
+        VertexBuffer_EnableAttribute(shaderProgram,
+            "position",
+            2,
+            GL_FLOAT,
+            false,
+            vertexSize,
+            offset + offsetof(Vertex2dCompactMultiTexture, x));
+        VertexBuffer_EnableAttribute(shaderProgram,
+            "color",
+            4,
+            GL_UNSIGNED_BYTE,
+            true,
+            vertexSize,
+            offset + offsetof(Vertex2dCompactMultiTexture, r));
+        VertexBuffer_EnableAttribute(shaderProgram,
+            "texcoord",
+            2,
+            GL_UNSIGNED_SHORT,
+            true,
+            vertexSize,
+            offset + offsetof(Vertex2dCompactMultiTexture, u));
+        VertexBuffer_EnableAttribute(shaderProgram,
+            "textureIndex",
+            1,
+            GL_FLOAT,
+            false,
+            vertexSize,
+            offset + offsetof(Vertex2dCompactMultiTexture, textureIndex));
+        break;
+
+    case VERTEX_FORMAT_SPRITE_INSTANCE:
+        VertexBuffer_EnableAttributeWithDivisor(shaderProgram,
+            "position",
+            2,
+            GL_FLOAT,
+            false,
+            vertexSize,
+            offset + offsetof(SpriteInstance, x),
+            1);
+        VertexBuffer_EnableAttributeWithDivisor(shaderProgram,
+            "rotation",
+            1,
+            GL_FLOAT,
+            false,
+            vertexSize,
+            offset + offsetof(SpriteInstance, rotation),
+            1);
+        VertexBuffer_EnableAttributeWithDivisor(shaderProgram,
+            "scale",
+            2,
+            GL_FLOAT,
+            false,
+            vertexSize,
+            offset + offsetof(SpriteInstance, scaleX),
+            1);
+        VertexBuffer_EnableAttributeWithDivisor(shaderProgram,
+            "origin",
+            2,
+            GL_FLOAT,
+            false,
+            vertexSize,
+            offset + offsetof(SpriteInstance, originX),
+            1);
+        VertexBuffer_EnableAttributeWithDivisor(shaderProgram,
+            "sourceRectangle",
+            4,
+            GL_UNSIGNED_SHORT,
+            false,
+            vertexSize,
+            offset + offsetof(SpriteInstance, sourceX),
+            1);
+        VertexBuffer_EnableAttributeWithDivisor(shaderProgram,
+            "color",
+            4,
+            GL_UNSIGNED_BYTE,
+            true,
+            vertexSize,
+            offset + offsetof(SpriteInstance, r),
+            1);
+        VertexBuffer_EnableAttributeWithDivisor(shaderProgram,
+            "uvMode",
+            1,
+            GL_UNSIGNED_INT,
+            false,
+            vertexSize,
+            offset + offsetof(SpriteInstance, uvMode),
+            1);
+        break;
+
+    default:
+        SDL_Log("Unsupported VertexFormat: %d", vertexFormat);
+        return;
+    }
+}
+
+void VertexBuffer_SetVertexFormat(
+    VertexBuffer *vertexBuffer, ShaderProgram *shaderProgram, VertexFormat vertexFormat) {
+    assert(vertexBuffer != NULL);
+    assert(shaderProgram != NULL);
+
+    VertexBuffer_SetAttributes(vertexBuffer, shaderProgram, vertexFormat, 0);
+}
+
+// moves the ring on to the next region, waiting for the gpu if it is still reading from it
+static void VertexBuffer_NextRegion(VertexBuffer *vertexBuffer) {
+    vertexBuffer->regionFences[vertexBuffer->region] =
+        glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    vertexBuffer->region = (vertexBuffer->region + 1) % VERTEX_BUFFER_RING_REGIONS;
+    vertexBuffer->writeOffset = vertexBuffer->region * vertexBuffer->regionSize;
+
+    GLsync fence = vertexBuffer->regionFences[vertexBuffer->region];
+    if (fence == NULL) {
+        return;
+    }
+
+    TRACE_ZONE("VertexBuffer_WaitFence");
+
+    // a fence that isn't signaled yet is a stall, the cpu waits for the gpu to catch up
+    GLenum waitResult = glClientWaitSync(fence, 0, 0);
+    bool stalled = waitResult == GL_TIMEOUT_EXPIRED;
+    while (waitResult == GL_TIMEOUT_EXPIRED) {
+        waitResult = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+    }
+    GraphicsDevice_AddFenceWait(vertexBuffer->graphicsDevice, stalled);
+
+    if (waitResult == GL_WAIT_FAILED) {
+        SDL_Log("glClientWaitSync failed");
+    }
+
+    glDeleteSync(fence);
+    vertexBuffer->regionFences[vertexBuffer->region] = NULL;
+}
+
+void *VertexBuffer_BeginWrite(
+    VertexBuffer *vertexBuffer, VertexFormat vertexFormat, uint32_t maximumVertices) {
+    assert(vertexBuffer != NULL);
+    assert(!vertexBuffer->writing);
+
+    TRACE_ZONE("VertexBuffer_BeginWrite");
+
+    uint32_t writeSize = maximumVertices * VertexBuffer_GetVertexSize(vertexFormat);
+    assert(writeSize > 0 && writeSize <= vertexBuffer->size);
+
+    uint8_t *memory = NULL;
+
+    switch (vertexBuffer->uploadStrategy) {
+    case VERTEX_BUFFER_UPLOAD_SUBDATA:
+        if (vertexBuffer->stagingMemory == NULL) {
+            vertexBuffer->stagingMemory = SDL_malloc(vertexBuffer->size);
+            if (vertexBuffer->stagingMemory == NULL) {
+                SDL_Log("SDL_malloc failed");
+                return NULL;
+            }
+        }
+        vertexBuffer->writeOffset = 0;
+        memory = vertexBuffer->stagingMemory;
+        break;
+
+    case VERTEX_BUFFER_UPLOAD_MAP_UNSYNCHRONIZED:
+    case VERTEX_BUFFER_UPLOAD_PERSISTENT: {
+        // room for a whole batch is kept because batches are written straight into this memory,
+        // but only what was written is used up, so a region fills with several flushes
+        uint32_t regionEnd = (vertexBuffer->region + 1) * vertexBuffer->regionSize;
+        if (vertexBuffer->writeOffset + writeSize > regionEnd) {
+            VertexBuffer_NextRegion(vertexBuffer);
+        }
+
+        if (vertexBuffer->persistentMemory != NULL) {
+            memory = vertexBuffer->persistentMemory + vertexBuffer->writeOffset;
+            break;
+        }
+
+        // the fences already keep us off anything the gpu is reading, so the driver doesn't
+        // need to synchronize and nothing in the range needs to be kept
+        GraphicsDevice_BindBuffer(
+            vertexBuffer->graphicsDevice, BUFFER_TARGET_ARRAY, vertexBuffer->vertexBufferId);
+        memory = glMapBufferRange(GL_ARRAY_BUFFER,
+            vertexBuffer->writeOffset,
+            writeSize,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT |
+                GL_MAP_FLUSH_EXPLICIT_BIT);
+        if (memory == NULL) {
+            SDL_Log("glMapBufferRange failed");
+            return NULL;
+        }
+        break;
     }
 
-    return;
+    default:
+        SDL_Log("Unsupported VertexBufferUploadStrategy: %d", vertexBuffer->uploadStrategy);
+        return NULL;
+    }
+
+    vertexBuffer->writeSize = writeSize;
+    vertexBuffer->writing = true;
+    return memory;
+}
+
+void VertexBuffer_SuspendWrite(
+    VertexBuffer *vertexBuffer, VertexFormat vertexFormat, uint32_t vertexCount) {
+    assert(vertexBuffer != NULL);
+    assert(vertexBuffer->writing && !vertexBuffer->suspended);
+
+    uint32_t writtenSize = vertexCount * VertexBuffer_GetVertexSize(vertexFormat);
+    assert(writtenSize <= vertexBuffer->writeSize);
+
+    vertexBuffer->suspended = true;
+
+    // staging memory and the persistent map stay valid as they are
+    if (vertexBuffer->uploadStrategy != VERTEX_BUFFER_UPLOAD_MAP_UNSYNCHRONIZED) {
+        return;
+    }
+
+    GraphicsDevice_BindBuffer(
+        vertexBuffer->graphicsDevice, BUFFER_TARGET_ARRAY, vertexBuffer->vertexBufferId);
+    if (writtenSize > 0) {
+        glFlushMappedBufferRange(GL_ARRAY_BUFFER, 0, writtenSize);
+    }
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+}
+
+void *VertexBuffer_ResumeWrite(VertexBuffer *vertexBuffer) {
+    assert(vertexBuffer != NULL);
+    assert(vertexBuffer->writing && vertexBuffer->suspended);
+
+    vertexBuffer->suspended = false;
+
+    switch (vertexBuffer->uploadStrategy) {
+    case VERTEX_BUFFER_UPLOAD_SUBDATA:
+        return vertexBuffer->stagingMemory;
+
+    case VERTEX_BUFFER_UPLOAD_PERSISTENT:
+        return vertexBuffer->persistentMemory + vertexBuffer->writeOffset;
+
+    case VERTEX_BUFFER_UPLOAD_MAP_UNSYNCHRONIZED: {
+        // the same range as BeginWrite, without invalidating it so what was written is kept
+        GraphicsDevice_BindBuffer(
+            vertexBuffer->graphicsDevice, BUFFER_TARGET_ARRAY, vertexBuffer->vertexBufferId);
+        void *memory = glMapBufferRange(GL_ARRAY_BUFFER,
+            vertexBuffer->writeOffset,
+            vertexBuffer->writeSize,
+            GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+        if (memory == NULL) {
+            SDL_Log("glMapBufferRange failed");
+            vertexBuffer->writing = false;
+        }
+        return memory;
+    }
+
+    default:
+        return NULL;
+    }
+}
+
+void VertexBuffer_EndWrite(VertexBuffer *vertexBuffer, ShaderProgram *shaderProgram,
+    VertexFormat vertexFormat, uint32_t vertexCount) {
+    assert(vertexBuffer != NULL);
+    assert(vertexBuffer->writing);
+
+    TRACE_ZONE("VertexBuffer_EndWrite");
+
+    uint32_t writtenSize = vertexCount * VertexBuffer_GetVertexSize(vertexFormat);
+    assert(writtenSize <= vertexBuffer->writeSize);
+
+    bool suspended = vertexBuffer->suspended;
+    vertexBuffer->writing = false;
+    vertexBuffer->suspended = false;
+    GraphicsDevice_AddUploadedBytes(vertexBuffer->graphicsDevice, writtenSize);
+
+    switch (vertexBuffer->uploadStrategy) {
+    case VERTEX_BUFFER_UPLOAD_SUBDATA:
+        if (writtenSize > 0) {
+            GraphicsDevice_BindBuffer(
+                vertexBuffer->graphicsDevice, BUFFER_TARGET_ARRAY, vertexBuffer->vertexBufferId);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, writtenSize, vertexBuffer->stagingMemory);
+        }
+        break;
+
+    case VERTEX_BUFFER_UPLOAD_MAP_UNSYNCHRONIZED:
+        // a suspended write was flushed and unmapped by SuspendWrite
+        if (suspended) {
+            break;
+        }
+        GraphicsDevice_BindBuffer(
+            vertexBuffer->graphicsDevice, BUFFER_TARGET_ARRAY, vertexBuffer->vertexBufferId);
+        if (writtenSize > 0) {
+            glFlushMappedBufferRange(GL_ARRAY_BUFFER, 0, writtenSize);
+        }
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        break;
+
+    default:
+        break;
+    }
+
+    if (vertexCount == 0) {
+        return;
+    }
+
+    assert(shaderProgram != NULL);
+    VertexBuffer_SetAttributes(
+        vertexBuffer, shaderProgram, vertexFormat, vertexBuffer->writeOffset);
+
+    // keep every write 16 byte aligned so any vertex format can start there
+    vertexBuffer->writeOffset += (writtenSize + 15) & ~15u;
+}
+
+void VertexBuffer_SetVertexData(VertexBuffer *vertexBuffer, ShaderProgram *shaderProgram,
+    VertexFormat vertexFormat, void *vertices, uint32_t vertexCount) {
+    assert(shaderProgram != NULL);
+    assert(vertices != NULL);
+    assert(vertexCount > 0);
+
+    TRACE_ZONE("VertexBuffer_SetVertexData");
+
+    uint32_t vertexSize = VertexBuffer_GetVertexSize(vertexFormat);
+    assert(vertexCount * vertexSize <= vertexBuffer->size);
+
+    if (vertexBuffer->uploadStrategy != VERTEX_BUFFER_UPLOAD_SUBDATA) {
+        void *memory = VertexBuffer_BeginWrite(vertexBuffer, vertexFormat, vertexCount);
+        if (memory == NULL) {
+            return;
+        }
+        SDL_memcpy(memory, vertices, vertexCount * vertexSize);
+        VertexBuffer_EndWrite(vertexBuffer, shaderProgram, vertexFormat, vertexCount);
+        return;
+    }
+
+    GraphicsDevice_BindBuffer(
+        vertexBuffer->graphicsDevice, BUFFER_TARGET_ARRAY, vertexBuffer->vertexBufferId);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, vertexCount * vertexSize, vertices);
+    GraphicsDevice_AddUploadedBytes(vertexBuffer->graphicsDevice, vertexCount * vertexSize);
+
+    VertexBuffer_SetAttributes(vertexBuffer, shaderProgram, vertexFormat, 0);
 }
 
 uint32_t VertexBuffer_GetArrayId(VertexBuffer *vertexBuffer) {
@@ -3,11 +3,16 @@
 #include <SDL3/SDL_main.h>
 
 #include <BatchRenderer.h>
+#include <CommandCapture.h>
+#include <FrameWriter.h>
 #define GAME_MATH_IMPLEMENTATION
 #include <GameMath.h>
 #include <GraphicsDevice.h>
+#include <Profiler.h>
+#include <RenderThread.h>
 #include <ShaderProgram.h>
 #include <Texture.h>
+#include <Trace.h>
 #include <VertexBuffer.h>
 
 typedef struct Vertex {
@@ -21,82 +26,130 @@ typedef struct {
     SDL_Window *window;
     GraphicsDevice *graphicsDevice;
     BatchRenderer *batchRenderer;
+    Profiler *profiler;
+    RenderThread *renderThread;
+    FrameWriter *screenshotWriter;
+    bool screenshotRequested;
+    CommandCapture *commandCapture;
     Texture *renderTarget;
     Texture *texture;
     float time;
     uint64_t currentTime;
 } Context;
 
+// runs on the render thread, which owns both the profiler and the batch renderer
+static void DrawProfilerOverlay(GraphicsDevice *graphicsDevice, void *userData) {
+    Context *context = (Context *)userData;
+    Profiler_DrawOverlay(context->profiler, context->batchRenderer, (Vector2){8, 8});
+}
+
+// also on the render thread, the pixels reach the writer a few frames later without a stall
+static void TakeScreenshot(GraphicsDevice *graphicsDevice, void *userData) {
+    Context *context = (Context *)userData;
+    GraphicsDevice_ReadPixelsAsync(graphicsDevice,
+        0,
+        0,
+        GraphicsDevice_GetWindowWidth(graphicsDevice),
+        GraphicsDevice_GetWindowHeight(graphicsDevice),
+        FrameWriter_QueueReadback,
+        context->screenshotWriter);
+}
+
 SDL_AppResult SDL_AppIterate(void *state) {
     if (state == NULL) {
         return SDL_APP_FAILURE;
     }
 
+    TRACE_ZONE("SDL_AppIterate");
+
     Context *context = (Context *)state;
     uint64_t newTime = SDL_GetPerformanceCounter();
     float deltaSeconds = (newTime - context->currentTime) / (float)SDL_GetPerformanceFrequency();
     context->currentTime = newTime;
     context->time += deltaSeconds;
 
-    GraphicsDevice_BeginFrame(context->graphicsDevice);
-
-    GraphicsDevice_BindRenderTarget(context->graphicsDevice, context->renderTarget, true);
-
-    GraphicsDevice_ClearScreen(context->graphicsDevice, &(Color){.r = 0, .g = 0, .b = 1, .a = 1});
-
-    BatchRenderer_Begin(context->batchRenderer,
-        BLEND_MODE_PREMULTIPLIED_ALPHA,
-        context->texture,
-        NULL,
-        MATRIX4_IDENTITY);
+    // the render thread finishes the capture, it is only let go of here
+    if (context->commandCapture != NULL && CommandCapture_IsFinished(context->commandCapture)) {
+        CommandCapture_Destroy(context->commandCapture);
+        context->commandCapture = NULL;
+    }
 
-    BatchRenderer_BatchQuadUV(context->batchRenderer,
-        (Vector2){0, 0},
-        (Vector2){1, 1},
-        (Vector2){0, 0},
-        (Vector2){WINDOW_WIDTH, WINDOW_HEIGHT},
-        NULL);
+    // the render thread draws the previous frame while this one is recorded
+    FrameCommandList *frame = RenderThread_BeginFrame(context->renderThread);
 
-    BatchRenderer_End(context->batchRenderer);
+    TRACE_BEGIN("SDL_AppIterate record frame");
 
-    GraphicsDevice_UnbindRenderTarget(context->graphicsDevice, true);
+    FrameCommandList_BindRenderTarget(frame, context->renderTarget, true);
 
-    GraphicsDevice_ClearScreen(context->graphicsDevice, &(Color){.r = 0, .g = 0, .b = 0, .a = 1});
+    FrameCommandList_ClearScreen(frame, &(Color){.r = 0, .g = 0, .b = 1, .a = 1});
 
-    BatchRenderer_Begin(
-        context->batchRenderer, BLEND_MODE_NONE, context->renderTarget, NULL, MATRIX4_IDENTITY);
+    // without a recorder the frame goes out with only its clears
+    BatchRenderer *batchRenderer = FrameCommandList_GetRecorder(frame);
+    if (batchRenderer != NULL) {
+        BatchRenderer_Begin(batchRenderer,
+            BLEND_MODE_PREMULTIPLIED_ALPHA,
+            context->texture,
+            NULL,
+            MATRIX4_IDENTITY);
 
-    BatchRenderer_BatchQuad(context->batchRenderer,
-        NULL,
-        (float[]){640, 360},
-        0,
-        (float[]){1, 1},
-        (float[]){0.5f, 0.5f},
-        UVMODE_NORMAL,
-        NULL);
+        BatchRenderer_BatchQuadUV(batchRenderer,
+            (Vector2){0, 0},
+            (Vector2){1, 1},
+            (Vector2){0, 0},
+            (Vector2){WINDOW_WIDTH, WINDOW_HEIGHT},
+            NULL);
 
-    BatchRenderer_End(context->batchRenderer);
+        BatchRenderer_End(batchRenderer);
+    }
 
-    BatchRenderer_Begin(context->batchRenderer,
-        BLEND_MODE_PREMULTIPLIED_ALPHA,
-        context->texture,
-        NULL,
-        MATRIX4_IDENTITY);
+    FrameCommandList_UnbindRenderTarget(frame, true);
+
+    FrameCommandList_ClearScreen(frame, &(Color){.r = 0, .g = 0, .b = 0, .a = 1});
+
+    batchRenderer = FrameCommandList_GetRecorder(frame);
+    if (batchRenderer != NULL) {
+        BatchRenderer_Begin(
+            batchRenderer, BLEND_MODE_NONE, context->renderTarget, NULL, MATRIX4_IDENTITY);
+
+        BatchRenderer_BatchQuad(batchRenderer,
+            NULL,
+            (float[]){640, 360},
+            0,
+            (float[]){1, 1},
+            (float[]){0.5f, 0.5f},
+            UVMODE_NORMAL,
+            NULL);
+
+        BatchRenderer_End(batchRenderer);
+
+        BatchRenderer_Begin(batchRenderer,
+            BLEND_MODE_PREMULTIPLIED_ALPHA,
+            context->texture,
+            NULL,
+            MATRIX4_IDENTITY);
+
+        BatchRenderer_BatchQuad(batchRenderer,
+            NULL,
+            (float[]){640, 360},
+            context->time,
+            (float[]){1, 1},
+            (float[]){0.5f, 0.5f},
+            UVMODE_FLIP_HORIZONTAL,
+            NULL);
+
+        BatchRenderer_End(batchRenderer);
+    }
 
-    BatchRenderer_BatchQuad(context->batchRenderer,
-        NULL,
-        (float[]){640, 360},
-        context->time,
-        (float[]){1, 1},
-        (float[]){0.5f, 0.5f},
-        UVMODE_FLIP_HORIZONTAL,
-        NULL);
+    if (context->screenshotRequested) {
+        FrameCommandList_Call(frame, TakeScreenshot, context);
+        context->screenshotRequested = false;
+    }
 
-    BatchRenderer_End(context->batchRenderer);
+    FrameCommandList_Call(frame, DrawProfilerOverlay, context);
 
-    GraphicsDevice_EndFrame(context->graphicsDevice);
+    TRACE_END();
 
-    SDL_GL_SwapWindow(context->window);
+    RenderThread_EndFrame(context->renderThread);
 
     return SDL_APP_CONTINUE;
 }
@@ -107,6 +160,9 @@ SDL_AppResult SDL_AppInit(void **state, int argc, char *argv[]) {
         return SDL_APP_FAILURE;
     }
 
+    TRACE_THREAD_NAME("main");
+    TRACE_ZONE("SDL_AppInit");
+
     Context *context = SDL_calloc(1, sizeof(Context));
     if (!context) {
         SDL_Log("SDL_calloc failed");
@@ -119,19 +175,37 @@ SDL_AppResult SDL_AppInit(void **state, int argc, char *argv[]) {
 
     uint32_t windowFlags = GraphicsDevice_PrepareSDLWindowAttributes(GRAPHICS_API_OPENGL);
 
+    TRACE_BEGIN("SDL_CreateWindow");
     context->window = SDL_CreateWindow("test", WINDOW_WIDTH, WINDOW_HEIGHT, windowFlags);
+    TRACE_END();
     if (context->window == NULL) {
         SDL_Log("SDL_CreateWindow failed");
         return SDL_APP_FAILURE;
     }
 
+    TRACE_BEGIN("GraphicsDevice_Create");
     context->graphicsDevice =
         GraphicsDevice_Create(GRAPHICS_API_OPENGL, context->window, VERTICAL_SYNC_DISABLED);
+    TRACE_END();
     if (context->graphicsDevice == NULL) {
         SDL_Log("GraphicsDevice_Create failed");
         return SDL_APP_FAILURE;
     }
 
+    // without a pref path the shaders are just compiled every launch
+    char *prefPath = SDL_GetPrefPath("pinim", "pinim");
+    if (prefPath != NULL) {
+        GraphicsDevice_SetShaderCacheDirectory(context->graphicsDevice, prefPath);
+    }
+
+    // screenshots go next to the shader cache, or the working directory without a pref path
+    context->screenshotWriter = FrameWriter_Create(prefPath, FRAME_WRITER_FORMAT_PNG, 4);
+    SDL_free(prefPath);
+    if (context->screenshotWriter == NULL) {
+        SDL_Log("FrameWriter_Create failed");
+        return SDL_APP_FAILURE;
+    }
+
     context->texture = Texture_Create(
         context->graphicsDevice, "Content/texture.png", TEXTURE_FILTER_LINEAR, TEXTURE_TYPE_NORMAL);
     if (context->texture == NULL) {
@@ -151,12 +225,29 @@ SDL_AppResult SDL_AppInit(void **state, int argc, char *argv[]) {
         return SDL_APP_FAILURE;
     }
 
+    TRACE_BEGIN("BatchRenderer_Create");
     context->batchRenderer = BatchRenderer_Create(context->graphicsDevice, 1000);
+    TRACE_END();
     if (context->batchRenderer == NULL) {
         SDL_Log("BatchRenderer_Create failed");
         return SDL_APP_FAILURE;
     }
 
+    context->profiler = Profiler_Create(context->graphicsDevice);
+    if (context->profiler == NULL) {
+        SDL_Log("Profiler_Create failed");
+        return SDL_APP_FAILURE;
+    }
+
+    // everything gl has to be created by now, the context belongs to the render thread from here
+    TRACE_BEGIN("RenderThread_Create");
+    context->renderThread = RenderThread_Create(context->graphicsDevice, context->batchRenderer);
+    TRACE_END();
+    if (context->renderThread == NULL) {
+        SDL_Log("RenderThread_Create failed");
+        return SDL_APP_FAILURE;
+    }
+
     return SDL_APP_CONTINUE;
 }
 
@@ -164,13 +255,44 @@ SDL_AppResult SDL_AppEvent(void *state, SDL_Event *event) {
     switch (event->type) {
     case SDL_EVENT_QUIT:
         return SDL_APP_SUCCESS;
+
+    // F12 saves the trace so far (for catching a spike while it is still in view), F11 takes a
+    // screenshot and F10 captures the next 60 frames to capture.bin for bench/CaptureReplay.c
+    case SDL_EVENT_KEY_DOWN:
+        if (event->key.key == SDLK_F12 && !event->key.repeat) {
+            TRACE_WRITE("trace.json");
+        }
+        if (event->key.key == SDLK_F11 && !event->key.repeat) {
+            ((Context *)state)->screenshotRequested = true;
+        }
+        if (event->key.key == SDLK_F10 && !event->key.repeat &&
+            ((Context *)state)->commandCapture == NULL) {
+            ((Context *)state)->commandCapture =
+                CommandCapture_Create(((Context *)state)->graphicsDevice, "capture.bin", 60);
+        }
+        break;
     }
     return SDL_APP_CONTINUE;
 }
 
 void SDL_AppQuit(void *state, SDL_AppResult result) {
+    TRACE_WRITE("trace.json");
+
     if (state != NULL) {
         Context *context = (Context *)state;
+        if (context->renderThread != NULL) {
+            RenderThread_Destroy(context->renderThread);
+        }
+        // the device's calls are made here again, an unfinished capture writes what it has
+        if (context->commandCapture != NULL) {
+            CommandCapture_Destroy(context->commandCapture);
+        }
+        if (context->profiler != NULL) {
+            Profiler_Destroy(context->profiler);
+        }
+        if (context->screenshotWriter != NULL) {
+            FrameWriter_Destroy(context->screenshotWriter);
+        }
         if (context->batchRenderer != NULL) {
             BatchRenderer_Destroy(context->batchRenderer);
         }